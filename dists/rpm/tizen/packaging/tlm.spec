@@ -27,7 +27,7 @@ Requires(postun): /sbin/ldconfig
 Requires(postun): systemd
 Requires: gumd
 Requires: libsystemd
-BuildRequires: pkgconfig(glib-2.0) >= 2.30
+BuildRequires: pkgconfig(glib-2.0) >= 2.36
 BuildRequires: pkgconfig(gobject-2.0)
 BuildRequires: pkgconfig(gio-2.0)
 BuildRequires: pkgconfig(gio-unix-2.0)
@@ -174,6 +174,7 @@ rm -rf %{buildroot}
 rm -f %{buildroot}%{_sysconfdir}/tlm.conf
 install -m 755 -d %{buildroot}%{_unitdir}
 install -m 644 data/tlm.service %{buildroot}%{_unitdir}
+install -m 644 data/tlm.socket %{buildroot}%{_unitdir}
 install -m 755 -d %{buildroot}%{_sysconfdir}/pam.d
 install -m 644 data/tizen/tlm-login %{buildroot}%{_sysconfdir}/pam.d/
 install -m 644 data/tizen/tlm-default-login %{buildroot}%{_sysconfdir}/pam.d/
@@ -329,6 +330,7 @@ fi
 %{_libdir}/lib%{name}*.so.*
 %{_libdir}/%{name}/plugins/*.so*
 %{_unitdir}/tlm.service
+%{_unitdir}/tlm.socket
 %config %{_sysconfdir}/pam.d/tlm-login
 %config %{_sysconfdir}/pam.d/tlm-default-login
 %config %{_sysconfdir}/pam.d/tlm-system-login
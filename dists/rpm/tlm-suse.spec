@@ -13,7 +13,7 @@ URL: https://github.com/01org/tlm
 Requires(post): /sbin/ldconfig
 Requires(postun): /sbin/ldconfig
 BuildRequires: pkgconfig(gtk-doc)
-BuildRequires: pkgconfig(glib-2.0) >= 2.30
+BuildRequires: pkgconfig(glib-2.0) >= 2.36
 BuildRequires: pkgconfig(gobject-2.0)
 BuildRequires: pkgconfig(gio-2.0)
 BuildRequires: pkgconfig(gio-unix-2.0)
@@ -27,8 +27,10 @@
 #include <glib/gstdio.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <stdlib.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/un.h>
 #include <fcntl.h>
 
 #include "tlm-dbus.h"
@@ -61,10 +63,16 @@ struct _TlmDbusServerP2PPrivate
 {
     GHashTable *adaptor_objects;
     GDBusServer *bus_server;
+    GSocketService *socket_service; /* serving an inherited socket */
+    gboolean adopted;
+    gchar *guid;
     gchar *address;
     uid_t uid;
 };
 
+/* first descriptor passed by the service manager, see sd_listen_fds() */
+#define LISTEN_FDS_START 3
+
 static void
 _tlm_dbus_server_p2p_interface_init (
         TlmDbusServerInterface *iface);
@@ -124,8 +132,11 @@ _get_property (
             break;
         }
         case PROP_ADDRESS: {
-            g_value_set_string (value, g_dbus_server_get_client_address (
-                    self->priv->bus_server));
+            if (self->priv->bus_server)
+                g_value_set_string (value, g_dbus_server_get_client_address (
+                        self->priv->bus_server));
+            else
+                g_value_set_string (value, self->priv->address);
             break;
         }
         default:
@@ -195,8 +206,12 @@ _finalize (
         GObject *object)
 {
     TlmDbusServerP2P *self = TLM_DBUS_SERVER_P2P (object);
+    g_free (self->priv->guid);
+    self->priv->guid = NULL;
     if (self->priv->address) {
-        if (g_str_has_prefix (self->priv->address, "unix:path=")) {
+        /* an inherited socket stays with the service manager */
+        if (g_str_has_prefix (self->priv->address, "unix:path=") &&
+            !self->priv->adopted) {
             const gchar *path = g_strstr_len(self->priv->address, -1,
                     "unix:path=") + 10;
             if (path) {
@@ -271,6 +286,9 @@ tlm_dbus_server_p2p_init (
 {
     self->priv = TLM_DBUS_SERVER_P2P_GET_PRIV(self);
     self->priv->bus_server = NULL;
+    self->priv->socket_service = NULL;
+    self->priv->adopted = FALSE;
+    self->priv->guid = NULL;
     self->priv->address = NULL;
     self->priv->uid = 0;
     self->priv->adaptor_objects = g_hash_table_new_full (g_direct_hash,
@@ -313,6 +331,88 @@ _on_client_request (
     return TRUE;
 }
 
+static void
+_on_connection_ready (
+        GObject *object,
+        GAsyncResult *res,
+        gpointer user_data)
+{
+    TlmDbusServerP2P *server = TLM_DBUS_SERVER_P2P (user_data);
+    GDBusConnection *connection = NULL;
+    GError *error = NULL;
+
+    connection = g_dbus_connection_new_finish (res, &error);
+    if (!connection) {
+        WARN ("Failed to set up p2p dbus connection: %s",
+                error ? error->message : "NULL");
+        g_error_free (error);
+        g_object_unref (server);
+        return;
+    }
+
+    /* same as GDBusServer, handlers take their reference */
+    if (server->priv->socket_service)
+        g_signal_emit (server, signals[SIG_NEW_CONNECTION], 0, connection);
+    g_dbus_connection_start_message_processing (connection);
+    g_object_unref (connection);
+    g_object_unref (server);
+}
+
+static gboolean
+_on_incoming_connection (
+        GSocketService *service,
+        GSocketConnection *socket_connection,
+        GObject *source_object,
+        gpointer user_data)
+{
+    TlmDbusServerP2P *server = TLM_DBUS_SERVER_P2P (user_data);
+
+    g_dbus_connection_new (G_IO_STREAM (socket_connection), server->priv->guid,
+            G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_SERVER |
+            G_DBUS_CONNECTION_FLAGS_DELAY_MESSAGE_PROCESSING,
+            NULL, NULL, _on_connection_ready, g_object_ref (server));
+    return TRUE;
+}
+
+static gboolean
+_start_socket_service (
+        TlmDbusServerP2P *server,
+        gint fd)
+{
+    GError *err = NULL;
+    GSocket *socket = NULL;
+
+    socket = g_socket_new_from_fd (fd, &err);
+    if (!socket) {
+        WARN ("Failed to adopt socket for '%s':%s", server->priv->address,
+                err ? err->message : "NULL");
+        g_error_free (err);
+        return FALSE;
+    }
+
+    server->priv->socket_service = g_socket_service_new ();
+    if (!g_socket_listener_add_socket (
+            G_SOCKET_LISTENER (server->priv->socket_service), socket, NULL,
+            &err)) {
+        WARN ("Failed to listen on socket for '%s':%s", server->priv->address,
+                err ? err->message : "NULL");
+        g_error_free (err);
+        g_object_unref (socket);
+        g_clear_object (&server->priv->socket_service);
+        return FALSE;
+    }
+    g_object_unref (socket);
+
+    server->priv->adopted = TRUE;
+    server->priv->guid = g_dbus_generate_guid ();
+    g_signal_connect (server->priv->socket_service, "incoming",
+            G_CALLBACK (_on_incoming_connection), server);
+    g_socket_service_start (server->priv->socket_service);
+    DBG ("adopted listening socket %d", fd);
+
+    return TRUE;
+}
+
 gboolean
 _tlm_dbus_server_p2p_start (
         TlmDbusServer *self)
@@ -322,6 +422,22 @@ _tlm_dbus_server_p2p_start (
     DBG("start P2P DBus Server");
 
     TlmDbusServerP2P *server = TLM_DBUS_SERVER_P2P (self);
+    if (!server->priv->socket_service && !server->priv->bus_server) {
+        /* clients may already be waiting in the backlog of a socket the
+         * service manager created before tlm was up */
+        gint fd = tlm_dbus_server_p2p_get_listen_fd (server->priv->address);
+        if (fd >= 0) {
+            if (!_start_socket_service (server, fd))
+                return FALSE;
+            DBG("dbus server started at : %s", server->priv->address);
+            return TRUE;
+        }
+    }
+    if (server->priv->socket_service) {
+        g_socket_service_start (server->priv->socket_service);
+        return TRUE;
+    }
+
     if (!server->priv->bus_server) {
         GError *err = NULL;
         gchar *guid = g_dbus_generate_guid ();
@@ -377,6 +493,16 @@ _tlm_dbus_server_p2p_stop (
         server->priv->adaptor_objects = NULL;
     }
 
+    if (server->priv->socket_service) {
+        DBG("stop P2P DBus Server on inherited socket");
+        g_signal_handlers_disconnect_by_func (server->priv->socket_service,
+                _on_incoming_connection, server);
+        g_socket_service_stop (server->priv->socket_service);
+        g_socket_listener_close (
+                G_SOCKET_LISTENER (server->priv->socket_service));
+        g_clear_object (&server->priv->socket_service);
+    }
+
     if (server->priv->bus_server) {
         DBG("stop P2P DBus Server");
         g_signal_handlers_disconnect_by_func (server->priv->bus_server,
@@ -439,6 +565,56 @@ tlm_dbus_server_p2p_add_adaptor_object (
     g_signal_emit (server, signals[SIG_CLIENT_ADDED], 0, adaptor_object);
 }
 
+/**
+ * tlm_dbus_server_p2p_get_listen_fd:
+ * @address: dbus address of the server
+ *
+ * Looks for a listening socket bound to the unix:path= @address among the
+ * ones passed by the service manager (LISTEN_PID and LISTEN_FDS).
+ *
+ * Returns: the socket descriptor, or -1 if there is none.
+ */
+gint
+tlm_dbus_server_p2p_get_listen_fd (
+        const gchar *address)
+{
+    const gchar *e_val = NULL;
+    const gchar *path = NULL;
+    gint n_fds, fd;
+
+    if (!address || !g_str_has_prefix (address, "unix:path="))
+        return -1;
+    path = address + 10;
+
+    e_val = g_getenv ("LISTEN_PID");
+    if (!e_val || (pid_t) atol (e_val) != getpid ())
+        return -1;
+    e_val = g_getenv ("LISTEN_FDS");
+    if (!e_val || (n_fds = atoi (e_val)) <= 0)
+        return -1;
+
+    for (fd = LISTEN_FDS_START; fd < LISTEN_FDS_START + n_fds; fd++) {
+        struct sockaddr_un addr;
+        socklen_t addr_len = sizeof (addr);
+        gint listening = 0;
+        socklen_t opt_len = sizeof (listening);
+
+        memset (&addr, 0, sizeof (addr));
+        if (getsockname (fd, (struct sockaddr *) &addr, &addr_len) != 0 ||
+            addr.sun_family != AF_UNIX ||
+            g_strcmp0 (addr.sun_path, path) != 0)
+            continue;
+        if (getsockopt (fd, SOL_SOCKET, SO_ACCEPTCONN, &listening,
+                        &opt_len) != 0 || !listening)
+            continue;
+        /* not for the sessions we spawn */
+        fcntl (fd, F_SETFD, FD_CLOEXEC);
+        return fd;
+    }
+
+    return -1;
+}
+
 TlmDbusServerP2P *
 tlm_dbus_server_p2p_new (
         const gchar *address,
@@ -453,7 +629,8 @@ tlm_dbus_server_p2p_new (
     }
     server->priv->uid = uid;
 
-    if (g_str_has_prefix(address, "unix:path=")) {
+    if (g_str_has_prefix(address, "unix:path=") &&
+        tlm_dbus_server_p2p_get_listen_fd (address) < 0) {
         const gchar *file_path = g_strstr_len (address, -1, "unix:path=") + 10;
 
         if (g_file_test(file_path, G_FILE_TEST_EXISTS)) {
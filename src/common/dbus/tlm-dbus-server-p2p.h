@@ -71,6 +71,10 @@ tlm_dbus_server_p2p_add_adaptor_object (
         GDBusConnection *connection,
         GObject *adaptor_object);
 
+gint
+tlm_dbus_server_p2p_get_listen_fd (
+        const gchar *address);
+
 TlmDbusServerP2P *
 tlm_dbus_server_p2p_new (
         const gchar *address,
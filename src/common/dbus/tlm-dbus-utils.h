@@ -36,7 +36,9 @@ typedef enum
     TLM_DBUS_REQUEST_TYPE_LOGIN_USER,
     TLM_DBUS_REQUEST_TYPE_LOGOUT_USER,
     TLM_DBUS_REQUEST_TYPE_SWITCH_USER,
-    TLM_DBUS_REQUEST_TYPE_GET_SESSION_INFO
+    TLM_DBUS_REQUEST_TYPE_GET_SESSION_INFO,
+    TLM_DBUS_REQUEST_TYPE_ADD_SEAT,
+    TLM_DBUS_REQUEST_TYPE_REMOVE_SEAT
 } TlmDbusRequestType;
 
 typedef struct
@@ -54,7 +56,8 @@ typedef struct
     gchar *username;
     gchar *password;
     gchar *sessionid;
-    GHashTable *environment;
+    GHashTable *environment; /* seat configuration for ADD_SEAT */
+    gboolean persist;
 } TlmDbusRequest;
 
 TlmDbusRequest *
@@ -37,6 +37,14 @@
 #define TLM_SESSION_OBJECTPATH   "/org/O1/Tlm/Session"
 #define TLM_LAUNCHER_OBJECTPATH   "/org/O1/Tlm/Launcher"
 
+/* control sockets of the sessions kept running across daemon restarts,
+ * named by the pid of their tlm-sessiond */
+#define TLM_SESSIOND_CONTROL_DIR TLM_DBUS_SOCKET_PATH "/sessiond"
+
+/* environment variable carrying the secret that tlm-sessiond expects as the
+ * nonce of an auth token, set by tlm for each tlm-sessiond it spawns */
+#define TLM_SESSIOND_TOKEN_SECRET_ENV "TLM_SESSIOND_TOKEN_SECRET"
+
 #define TLM_DBUS_FREEDESKTOP_SERVICE    "org.freedesktop.DBus"
 #define TLM_DBUS_FREEDESKTOP_PATH       "/org/freedesktop/DBus"
 #define TLM_DBUS_FREEDESKTOP_INTERFACE  "org.freedesktop.DBus"
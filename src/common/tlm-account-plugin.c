@@ -55,9 +55,24 @@
  * @setup_guest_user_account: implementation of tlm_account_plugin_setup_guest_user_account()
  * @is_valid_user: implementation of tlm_account_plugin_is_valid_user()
  * @cleanup_guest_user: implementation of tlm_account_plugin_cleanup_guest_user()
+ * @setup_guest_user_account_async: implementation of
+ * tlm_account_plugin_setup_guest_user_account_async()
+ * @setup_guest_user_account_finish: implementation of
+ * tlm_account_plugin_setup_guest_user_account_finish()
+ * @is_valid_user_async: implementation of
+ * tlm_account_plugin_is_valid_user_async()
+ * @is_valid_user_finish: implementation of
+ * tlm_account_plugin_is_valid_user_finish()
+ * @cleanup_guest_user_async: implementation of
+ * tlm_account_plugin_cleanup_guest_user_async()
+ * @cleanup_guest_user_finish: implementation of
+ * tlm_account_plugin_cleanup_guest_user_finish()
  *
  * #TlmAccountPluginInterface interface containing pointers to methods that all
  * plugin implementations should provide.
+ *
+ * The asynchronous methods are optional and come in pairs. Plugins that
+ * leave them unset get their synchronous method run in a thread instead.
  */
 
 /**
@@ -146,3 +161,286 @@ tlm_account_plugin_cleanup_guest_user (TlmAccountPlugin   *self,
                     self, user_name, delete_account);
 }
 
+
+typedef struct {
+    gchar *user_name;
+    gboolean delete_account;
+} TlmAccountPluginOp;
+
+static void
+_op_free (TlmAccountPluginOp *op)
+{
+    g_free (op->user_name);
+    g_slice_free (TlmAccountPluginOp, op);
+}
+
+static GTask *
+_op_task_new (
+        TlmAccountPlugin *self,
+        const gchar *user_name,
+        gboolean delete_account,
+        GCancellable *cancellable,
+        GAsyncReadyCallback callback,
+        gpointer user_data,
+        gpointer source_tag)
+{
+    GTask *task = g_task_new (self, cancellable, callback, user_data);
+    TlmAccountPluginOp *op = g_slice_new0 (TlmAccountPluginOp);
+
+    op->user_name = g_strdup (user_name);
+    op->delete_account = delete_account;
+    g_task_set_source_tag (task, source_tag);
+    g_task_set_task_data (task, op, (GDestroyNotify) _op_free);
+    return task;
+}
+
+static void
+_setup_guest_user_account_thread (
+        GTask *task,
+        gpointer source_object,
+        gpointer task_data,
+        GCancellable *cancellable)
+{
+    TlmAccountPluginOp *op = task_data;
+    g_task_return_boolean (task,
+            tlm_account_plugin_setup_guest_user_account (
+                    TLM_ACCOUNT_PLUGIN (source_object), op->user_name));
+}
+
+static void
+_is_valid_user_thread (
+        GTask *task,
+        gpointer source_object,
+        gpointer task_data,
+        GCancellable *cancellable)
+{
+    TlmAccountPluginOp *op = task_data;
+    g_task_return_boolean (task,
+            tlm_account_plugin_is_valid_user (
+                    TLM_ACCOUNT_PLUGIN (source_object), op->user_name));
+}
+
+static void
+_cleanup_guest_user_thread (
+        GTask *task,
+        gpointer source_object,
+        gpointer task_data,
+        GCancellable *cancellable)
+{
+    TlmAccountPluginOp *op = task_data;
+    g_task_return_boolean (task,
+            tlm_account_plugin_cleanup_guest_user (
+                    TLM_ACCOUNT_PLUGIN (source_object), op->user_name,
+                    op->delete_account));
+}
+
+/**
+ * tlm_account_plugin_setup_guest_user_account_async:
+ * @self: plugin instance
+ * @user_name: the user name
+ * @cancellable: (allow-none): a #GCancellable
+ * @callback: called in the thread-default main context of the caller when
+ * the account is set up
+ * @user_data: user data for @callback
+ *
+ * Asynchronous version of tlm_account_plugin_setup_guest_user_account().
+ * Call tlm_account_plugin_setup_guest_user_account_finish() from @callback
+ * to get the result.
+ */
+void
+tlm_account_plugin_setup_guest_user_account_async (
+        TlmAccountPlugin *self,
+        const gchar *user_name,
+        GCancellable *cancellable,
+        GAsyncReadyCallback callback,
+        gpointer user_data)
+{
+    TlmAccountPluginInterface *iface = NULL;
+    GTask *task = NULL;
+
+    g_return_if_fail (self && TLM_IS_PLUGIN (self));
+
+    iface = TLM_ACCOUNT_PLUGIN_GET_IFACE (self);
+    if (iface->setup_guest_user_account_async) {
+        iface->setup_guest_user_account_async (self, user_name, cancellable,
+                                               callback, user_data);
+        return;
+    }
+
+    task = _op_task_new (self, user_name, FALSE, cancellable, callback,
+                         user_data,
+                         tlm_account_plugin_setup_guest_user_account_async);
+    g_task_run_in_thread (task, _setup_guest_user_account_thread);
+    g_object_unref (task);
+}
+
+/**
+ * tlm_account_plugin_setup_guest_user_account_finish:
+ * @self: plugin instance
+ * @result: the #GAsyncResult passed to the callback
+ * @error: (allow-none): return location for the error
+ *
+ * Finishes tlm_account_plugin_setup_guest_user_account_async().
+ *
+ * Returns: whether the operation succeeded.
+ */
+gboolean
+tlm_account_plugin_setup_guest_user_account_finish (
+        TlmAccountPlugin *self,
+        GAsyncResult *result,
+        GError **error)
+{
+    TlmAccountPluginInterface *iface = NULL;
+
+    g_return_val_if_fail (self && TLM_IS_PLUGIN (self), FALSE);
+
+    iface = TLM_ACCOUNT_PLUGIN_GET_IFACE (self);
+    if (iface->setup_guest_user_account_async) {
+        g_return_val_if_fail (iface->setup_guest_user_account_finish, FALSE);
+        return iface->setup_guest_user_account_finish (self, result, error);
+    }
+
+    g_return_val_if_fail (g_task_is_valid (result, self), FALSE);
+    return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+/**
+ * tlm_account_plugin_is_valid_user_async:
+ * @self: plugin instance
+ * @user_name: user name to check
+ * @cancellable: (allow-none): a #GCancellable
+ * @callback: called in the thread-default main context of the caller when
+ * the check is done
+ * @user_data: user data for @callback
+ *
+ * Asynchronous version of tlm_account_plugin_is_valid_user(). Call
+ * tlm_account_plugin_is_valid_user_finish() from @callback to get the
+ * result.
+ */
+void
+tlm_account_plugin_is_valid_user_async (
+        TlmAccountPlugin *self,
+        const gchar *user_name,
+        GCancellable *cancellable,
+        GAsyncReadyCallback callback,
+        gpointer user_data)
+{
+    TlmAccountPluginInterface *iface = NULL;
+    GTask *task = NULL;
+
+    g_return_if_fail (self && TLM_IS_PLUGIN (self));
+
+    iface = TLM_ACCOUNT_PLUGIN_GET_IFACE (self);
+    if (iface->is_valid_user_async) {
+        iface->is_valid_user_async (self, user_name, cancellable, callback,
+                                    user_data);
+        return;
+    }
+
+    task = _op_task_new (self, user_name, FALSE, cancellable, callback,
+                         user_data, tlm_account_plugin_is_valid_user_async);
+    g_task_run_in_thread (task, _is_valid_user_thread);
+    g_object_unref (task);
+}
+
+/**
+ * tlm_account_plugin_is_valid_user_finish:
+ * @self: plugin instance
+ * @result: the #GAsyncResult passed to the callback
+ * @error: (allow-none): return location for the error
+ *
+ * Finishes tlm_account_plugin_is_valid_user_async().
+ *
+ * Returns: whether the user exists.
+ */
+gboolean
+tlm_account_plugin_is_valid_user_finish (
+        TlmAccountPlugin *self,
+        GAsyncResult *result,
+        GError **error)
+{
+    TlmAccountPluginInterface *iface = NULL;
+
+    g_return_val_if_fail (self && TLM_IS_PLUGIN (self), FALSE);
+
+    iface = TLM_ACCOUNT_PLUGIN_GET_IFACE (self);
+    if (iface->is_valid_user_async) {
+        g_return_val_if_fail (iface->is_valid_user_finish, FALSE);
+        return iface->is_valid_user_finish (self, result, error);
+    }
+
+    g_return_val_if_fail (g_task_is_valid (result, self), FALSE);
+    return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+/**
+ * tlm_account_plugin_cleanup_guest_user_async:
+ * @self: plugin instance
+ * @user_name: user name to clean up
+ * @delete_account: whether the user account should be deleted
+ * @cancellable: (allow-none): a #GCancellable
+ * @callback: called in the thread-default main context of the caller when
+ * the cleanup is done
+ * @user_data: user data for @callback
+ *
+ * Asynchronous version of tlm_account_plugin_cleanup_guest_user(). Call
+ * tlm_account_plugin_cleanup_guest_user_finish() from @callback to get the
+ * result.
+ */
+void
+tlm_account_plugin_cleanup_guest_user_async (
+        TlmAccountPlugin *self,
+        const gchar *user_name,
+        gboolean delete_account,
+        GCancellable *cancellable,
+        GAsyncReadyCallback callback,
+        gpointer user_data)
+{
+    TlmAccountPluginInterface *iface = NULL;
+    GTask *task = NULL;
+
+    g_return_if_fail (self && TLM_IS_PLUGIN (self));
+
+    iface = TLM_ACCOUNT_PLUGIN_GET_IFACE (self);
+    if (iface->cleanup_guest_user_async) {
+        iface->cleanup_guest_user_async (self, user_name, delete_account,
+                                         cancellable, callback, user_data);
+        return;
+    }
+
+    task = _op_task_new (self, user_name, delete_account, cancellable,
+                         callback, user_data,
+                         tlm_account_plugin_cleanup_guest_user_async);
+    g_task_run_in_thread (task, _cleanup_guest_user_thread);
+    g_object_unref (task);
+}
+
+/**
+ * tlm_account_plugin_cleanup_guest_user_finish:
+ * @self: plugin instance
+ * @result: the #GAsyncResult passed to the callback
+ * @error: (allow-none): return location for the error
+ *
+ * Finishes tlm_account_plugin_cleanup_guest_user_async().
+ *
+ * Returns: whether the operation succeeded.
+ */
+gboolean
+tlm_account_plugin_cleanup_guest_user_finish (
+        TlmAccountPlugin *self,
+        GAsyncResult *result,
+        GError **error)
+{
+    TlmAccountPluginInterface *iface = NULL;
+
+    g_return_val_if_fail (self && TLM_IS_PLUGIN (self), FALSE);
+
+    iface = TLM_ACCOUNT_PLUGIN_GET_IFACE (self);
+    if (iface->cleanup_guest_user_async) {
+        g_return_val_if_fail (iface->cleanup_guest_user_finish, FALSE);
+        return iface->cleanup_guest_user_finish (self, result, error);
+    }
+
+    g_return_val_if_fail (g_task_is_valid (result, self), FALSE);
+    return g_task_propagate_boolean (G_TASK (result), error);
+}
@@ -27,6 +27,7 @@
 #define _TLM_ACCOUNT_PLUGIN_H
 
 #include <glib-object.h>
+#include <gio/gio.h>
 
 G_BEGIN_DECLS
 
@@ -54,6 +55,34 @@ struct _TlmAccountPluginInterface {
    gboolean  (*cleanup_guest_user) (TlmAccountPlugin *self,
                                     const gchar *guest_user,
                                     gboolean delete_account);
+
+    void (*setup_guest_user_account_async) (TlmAccountPlugin *self,
+                                            const gchar *user_name,
+                                            GCancellable *cancellable,
+                                            GAsyncReadyCallback callback,
+                                            gpointer user_data);
+    gboolean (*setup_guest_user_account_finish) (TlmAccountPlugin *self,
+                                                 GAsyncResult *result,
+                                                 GError **error);
+
+    void (*is_valid_user_async) (TlmAccountPlugin *self,
+                                 const gchar *user_name,
+                                 GCancellable *cancellable,
+                                 GAsyncReadyCallback callback,
+                                 gpointer user_data);
+    gboolean (*is_valid_user_finish) (TlmAccountPlugin *self,
+                                      GAsyncResult *result,
+                                      GError **error);
+
+    void (*cleanup_guest_user_async) (TlmAccountPlugin *self,
+                                      const gchar *guest_user,
+                                      gboolean delete_account,
+                                      GCancellable *cancellable,
+                                      GAsyncReadyCallback callback,
+                                      gpointer user_data);
+    gboolean (*cleanup_guest_user_finish) (TlmAccountPlugin *self,
+                                           GAsyncResult *result,
+                                           GError **error);
 };
 
 
@@ -72,6 +101,43 @@ tlm_account_plugin_cleanup_guest_user (TlmAccountPlugin *self,
                                const gchar *user_name,
                                gboolean delete_account);
 
+void
+tlm_account_plugin_setup_guest_user_account_async (TlmAccountPlugin *self,
+                                   const gchar *user_name,
+                                   GCancellable *cancellable,
+                                   GAsyncReadyCallback callback,
+                                   gpointer user_data);
+
+gboolean
+tlm_account_plugin_setup_guest_user_account_finish (TlmAccountPlugin *self,
+                                    GAsyncResult *result,
+                                    GError **error);
+
+void
+tlm_account_plugin_is_valid_user_async (TlmAccountPlugin *self,
+                        const gchar *user_name,
+                        GCancellable *cancellable,
+                        GAsyncReadyCallback callback,
+                        gpointer user_data);
+
+gboolean
+tlm_account_plugin_is_valid_user_finish (TlmAccountPlugin *self,
+                         GAsyncResult *result,
+                         GError **error);
+
+void
+tlm_account_plugin_cleanup_guest_user_async (TlmAccountPlugin *self,
+                             const gchar *user_name,
+                             gboolean delete_account,
+                             GCancellable *cancellable,
+                             GAsyncReadyCallback callback,
+                             gpointer user_data);
+
+gboolean
+tlm_account_plugin_cleanup_guest_user_finish (TlmAccountPlugin *self,
+                              GAsyncResult *result,
+                              GError **error);
+
 G_END_DECLS
 
 #endif /* _TLM_ACCOUNT_PLUGIN_H */
@@ -192,4 +192,260 @@
  */
 #define TLM_CONFIG_GENERAL_SESSION_TYPE     "SESSION_TYPE"
 
+/**
+ * TLM_CONFIG_GENERAL_SESSIOND_POOL_SIZE
+ *
+ * Number of idle tlm-sessiond helpers to keep spawned and connected per seat.
+ * Default value: 0 (spawn a helper on demand for each login).
+ *
+ * Pre-spawned helpers remove the process start and D-Bus handshake from the
+ * login path. The pool is refilled in the background after each login. Can be
+ * overridden in the seat group.
+ */
+#define TLM_CONFIG_GENERAL_SESSIOND_POOL_SIZE "SESSIOND_POOL_SIZE"
+
+/**
+ * TLM_CONFIG_GENERAL_SESSIOND_CONNECT_TIMEOUT
+ *
+ * Timeout in seconds for the D-Bus handshake with a newly spawned
+ * tlm-sessiond. Default value: 10, 0 disables the timeout.
+ */
+#define TLM_CONFIG_GENERAL_SESSIOND_CONNECT_TIMEOUT "SESSIOND_CONNECT_TIMEOUT"
+
+/**
+ * TLM_CONFIG_GENERAL_SESSIOND_PROXY_TIMEOUT
+ *
+ * Timeout in seconds for reaching the session object of tlm-sessiond once
+ * connected. Default value: 10, 0 disables the timeout.
+ */
+#define TLM_CONFIG_GENERAL_SESSIOND_PROXY_TIMEOUT "SESSIOND_PROXY_TIMEOUT"
+
+/**
+ * TLM_CONFIG_GENERAL_SESSION_REQUEST_TIMEOUT
+ *
+ * Timeout in seconds for tlm-sessiond to accept a session creation request.
+ * Default value: 10, 0 disables the timeout.
+ */
+#define TLM_CONFIG_GENERAL_SESSION_REQUEST_TIMEOUT "SESSION_REQUEST_TIMEOUT"
+
+/**
+ * TLM_CONFIG_GENERAL_SESSION_SETUP_TIMEOUT
+ *
+ * Timeout in seconds from an accepted session creation request until the
+ * session is created (authentication, PAM session setup and launch).
+ * Default value: 60, 0 disables the timeout.
+ */
+#define TLM_CONFIG_GENERAL_SESSION_SETUP_TIMEOUT "SESSION_SETUP_TIMEOUT"
+
+/**
+ * TLM_CONFIG_GENERAL_SHUTDOWN_TIMEOUT
+ *
+ * Global deadline in seconds for terminating the sessions of all seats on
+ * shutdown. Default value: 30, 0 waits until all sessions are gone.
+ *
+ * Seats are terminated in parallel; when the deadline expires the daemon
+ * stops without waiting for the remaining ones.
+ */
+#define TLM_CONFIG_GENERAL_SHUTDOWN_TIMEOUT "SHUTDOWN_TIMEOUT"
+
+/**
+ * TLM_CONFIG_GENERAL_AUTH_WORKERS
+ *
+ * Maximum number of worker threads verifying passwords for user switches.
+ * Default value: 2
+ *
+ * PAM conversations run on these workers so that a slow PAM stack does not
+ * block the daemon. The value is read when the first verification starts.
+ */
+#define TLM_CONFIG_GENERAL_AUTH_WORKERS     "AUTH_WORKERS"
+
+/**
+ * TLM_CONFIG_GENERAL_AUTH_TOKEN_LIFETIME
+ *
+ * Lifetime in seconds of the token handed to the new session after the
+ * password of a user switch was verified. Default value: 30, 0 disables
+ * the handoff.
+ *
+ * With a valid token tlm-sessiond skips its own PAM authentication and goes
+ * straight to opening the session. The token is bound to the seat, the user
+ * and the PAM service and is used at most once. It is only issued when the
+ * session uses the same PAM service as the password verification, see
+ * #TLM_CONFIG_GENERAL_PAM_SERVICE.
+ */
+#define TLM_CONFIG_GENERAL_AUTH_TOKEN_LIFETIME "AUTH_TOKEN_LIFETIME"
+
+/**
+ * TLM_CONFIG_GENERAL_MAX_PARKED_SESSIONS
+ *
+ * Maximum number of sessions per seat kept running in the background after
+ * switching to another user. Default value: 0 (switching user logs out the
+ * current one).
+ *
+ * Parked sessions stay on their own VT, switching back to one of them with
+ * the same password only checks the account with PAM and activates its VT.
+ * The password is compared with a verifier kept in the daemon's memory,
+ * derived from it with PBKDF2-HMAC-SHA256 and a per-seat salt. Any change
+ * of /etc/shadow invalidates the verifiers, the next switch back runs the
+ * full PAM conversation. The trade-off is that password changes done
+ * outside /etc/shadow, like in a network directory, are not noticed: the
+ * previous password keeps unlocking a parked session until it is logged
+ * out. Logging out the active user does not bring a parked session back. The
+ * oldest parked session is logged out when the limit is reached. Requires
+ * #TLM_CONFIG_SEAT_VTNR for the seat, can be overridden in the seat group.
+ */
+#define TLM_CONFIG_GENERAL_MAX_PARKED_SESSIONS "MAX_PARKED_SESSIONS"
+
+/**
+ * TLM_CONFIG_GENERAL_FREEZE_PARKED_SESSIONS
+ *
+ * Stop the processes of parked sessions until they are activated again.
+ * Default value: FALSE. Can be overridden in the seat group.
+ */
+#define TLM_CONFIG_GENERAL_FREEZE_PARKED_SESSIONS "FREEZE_PARKED_SESSIONS"
+
+/**
+ * TLM_CONFIG_GENERAL_PIPELINED_RELOGIN
+ *
+ * Bring up the next session of a user switch or logout while the previous
+ * one is still being terminated. Default value: FALSE.
+ *
+ * The new session is authenticated and opened right away, only starting the
+ * user session waits until the previous session has exited and released its
+ * VT, tty and runtime directory. Not used for relogins of the default user
+ * when #TLM_CONFIG_GENERAL_PREPARE_DEFAULT recycles its home directory. Can
+ * be overridden in the seat group.
+ */
+#define TLM_CONFIG_GENERAL_PIPELINED_RELOGIN "PIPELINED_RELOGIN"
+
+/**
+ * TLM_CONFIG_GENERAL_MAX_CONCURRENT_LOGINS
+ *
+ * Maximum number of seats running their initial auto-login at the same
+ * time. Default value: 0 (no limit).
+ *
+ * A seat counts until its session is created or has failed, the next seat
+ * in #TLM_CONFIG_SEAT_PRIORITY order is admitted then.
+ */
+#define TLM_CONFIG_GENERAL_MAX_CONCURRENT_LOGINS "MAX_CONCURRENT_LOGINS"
+
+/**
+ * TLM_CONFIG_GENERAL_SEAT_CHANGE_DELAY
+ *
+ * Time in milliseconds seat additions and removals reported by logind are
+ * collected before being applied. Default value: 250, 0 applies every change
+ * right away.
+ *
+ * A seat that is removed and added again, or the other way round, within
+ * the window keeps its state, so hotplug storms do not start sessions only
+ * to tear them down again.
+ */
+#define TLM_CONFIG_GENERAL_SEAT_CHANGE_DELAY "SEAT_CHANGE_DELAY"
+
+/**
+ * TLM_CONFIG_GENERAL_CONFIG_WATCH_DELAY
+ *
+ * Time in milliseconds to wait after the last change of the configuration
+ * file before reloading it. Default value: 0, the file is not watched and
+ * is only reloaded on SIGHUP.
+ *
+ * Either way only the plugins whose group changed are reloaded and only
+ * the seats whose group or the General group changed are updated. Running
+ * sessions keep their configuration, new values apply from the next
+ * session of a seat.
+ */
+#define TLM_CONFIG_GENERAL_CONFIG_WATCH_DELAY "CONFIG_WATCH_DELAY"
+
+/**
+ * TLM_CONFIG_GENERAL_FAST_BOOT
+ *
+ * Start the auto-login of #TLM_CONFIG_GENERAL_PRIMARY_SEAT before anything
+ * else. Default value: FALSE.
+ *
+ * Connecting to the system bus, loading the plugins, setting up the root
+ * D-Bus observer and adding the other seats wait until the main loop is
+ * idle, so the first session does not depend on the system bus being up.
+ * READY=1 is sent to the service manager (see sd_notify()) once the session
+ * on the primary seat is created, or has failed.
+ */
+#define TLM_CONFIG_GENERAL_FAST_BOOT "FAST_BOOT"
+
+/**
+ * TLM_CONFIG_GENERAL_PRIMARY_SEAT
+ *
+ * Seat started first with #TLM_CONFIG_GENERAL_FAST_BOOT. Default value:
+ * "seat0" if #TLM_CONFIG_GENERAL_NSEATS is set, otherwise fast boot needs
+ * this to be set.
+ */
+#define TLM_CONFIG_GENERAL_PRIMARY_SEAT "PRIMARY_SEAT"
+
+/**
+ * TLM_CONFIG_GENERAL_PERSIST_SESSIONS
+ *
+ * Keep the active sessions running when the daemon stops and take them over
+ * again when it starts. Default value: FALSE.
+ *
+ * Each tlm-sessiond with a running session listens on a control socket in
+ * TLM_DBUS_SOCKET_PATH/sessiond, the restarted daemon reconnects to them
+ * instead of logging in again. Parked sessions and sessions still coming up
+ * are terminated as before. The service manager must not kill the whole
+ * service on stop, e.g. KillMode=process in tlm.service.
+ */
+#define TLM_CONFIG_GENERAL_PERSIST_SESSIONS "PERSIST_SESSIONS"
+
+/**
+ * TLM_CONFIG_GENERAL_VIRTUAL_SEATS
+ *
+ * Semicolon separated list of virtual seats that are created at startup in
+ * addition to the #TLM_CONFIG_GENERAL_NSEATS or systemd ones, each
+ * configured in its own group. addSeat() and removeSeat() on the root login
+ * object maintain the list when asked to persist the change.
+ * Default value: none.
+ */
+#define TLM_CONFIG_GENERAL_VIRTUAL_SEATS    "VIRTUAL_SEATS"
+
+/**
+ * TLM_CONFIG_GENERAL_SEAT_THREADS
+ *
+ * Number of worker threads the blocking work of the seats is spread over,
+ * currently the guest account preparation and cleanup of
+ * #TLM_CONFIG_GENERAL_PREPARE_DEFAULT. Each seat is given one of them when
+ * it is added, a login waits only for the work of its own seat.
+ * Default value: 0, the asynchronous account plugin methods are used from
+ * the main loop instead.
+ *
+ * The account plugin in use has to be thread safe for this. The rest of the
+ * seat handling stays on the main loop, see #TlmSeatWorker.
+ */
+#define TLM_CONFIG_GENERAL_SEAT_THREADS     "SEAT_THREADS"
+
+/**
+ * TLM_CONFIG_GENERAL_GUEST_POOL_SIZE:
+ *
+ * Number of guest accounts kept for each default user name with
+ * #TLM_CONFIG_GENERAL_PREPARE_DEFAULT. The accounts are named after the
+ * default user with a "-1" to "-N" suffix and are provisioned in the
+ * background; a default user login leases a ready one instead of preparing
+ * the account, and returns it at logout for recycling. A login finding no
+ * account ready uses the default user name itself, prepared as without
+ * the pool. Read at startup. Default value: 0, no pool.
+ */
+#define TLM_CONFIG_GENERAL_GUEST_POOL_SIZE  "GUEST_POOL_SIZE"
+
+/**
+ * TLM_CONFIG_GENERAL_GUEST_POOL_LOW_WATER:
+ *
+ * The returned accounts of a default user name are recycled once fewer
+ * than this many of them are ready. Read at startup. Default value:
+ * #TLM_CONFIG_GENERAL_GUEST_POOL_SIZE, they are recycled right away.
+ */
+#define TLM_CONFIG_GENERAL_GUEST_POOL_LOW_WATER "GUEST_POOL_LOW_WATER"
+
+/**
+ * TLM_CONFIG_GENERAL_GUEST_POOL_JOBS:
+ *
+ * Number of pool accounts provisioned or recycled at a time. Read at
+ * startup. Default value: 1.
+ */
+#define TLM_CONFIG_GENERAL_GUEST_POOL_JOBS  "GUEST_POOL_JOBS"
+
 #endif /* __TLM_GENERAL_CONFIG_H_ */
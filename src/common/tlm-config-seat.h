@@ -67,4 +67,14 @@
  */
 #define TLM_CONFIG_SEAT_VTNR            "VTNR"
 
+/**
+ * TLM_CONFIG_SEAT_PRIORITY:
+ *
+ * Order of the seat's initial auto-login at startup, seats with a higher
+ * value are logged in first. Seats with the same priority are logged in in
+ * the order they were found.
+ * Default value: 0
+ */
+#define TLM_CONFIG_SEAT_PRIORITY        "PRIORITY"
+
 #endif /* __TLM_CONFIG_SEAT_H_ */
@@ -25,12 +25,17 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <glib/gstdio.h>
 
 #include "config.h"
 #include "tlm-config.h"
 #include "tlm-config-general.h"
+#include "tlm-seat-config.h"
 #include "tlm-log.h"
 
 /**
@@ -44,6 +49,10 @@
  * Note that authentication and account plugins may use plugin-specific
  * configuration keys; see plugins' documentation for specifics.
  *
+ * The values needed on the login path of a seat are better read from the
+ * #TlmSeatConfig snapshot returned by tlm_config_get_seat_config(), which
+ * has them resolved and converted once.
+ *
  * The configuration is retrieved from the tlm configuration file. See below
  * for where the file is searched for.
  *
@@ -70,6 +79,17 @@
  * Otherwise, the config file location is determined at compilation time as
  * $(sysconfdir) + "tlm.conf"
  *
+ * <refsect1><title>Configuration cache</title></refsect1>
+ *
+ * Unless disabled with --disable-config-cache, processes running as root
+ * store the parsed configuration as a binary image (a serialized #GVariant)
+ * in a cache file, by default /var/run/tlm.conf.cache. Later instances map
+ * the image instead of parsing the configuration file, as long as the
+ * file's path, device, inode, size and modification time recorded in the
+ * image still match. Otherwise the file is parsed again and the cache is
+ * rewritten. Debug builds take the cache file from the TLM_CONFIG_CACHE_FILE
+ * environment variable if it is set.
+ *
  * <refsect1><title>Example configuration file</title></refsect1>
  *
  * See example configuration file here:
@@ -95,6 +115,7 @@ struct _TlmConfigPrivate
 {
     gchar *config_file_path;
     GHashTable *config_table;
+    GHashTable *seat_configs; /* { gchar*:TlmSeatConfig* } */
 };
 
 #define TLM_CONFIG_PRIV(obj) G_TYPE_INSTANCE_GET_PRIVATE ((obj), \
@@ -102,6 +123,178 @@ struct _TlmConfigPrivate
 
 G_DEFINE_TYPE (TlmConfig, tlm_config, G_TYPE_OBJECT);
 
+enum {
+    SIG_GROUP_CHANGED,
+    SIG_MAX
+};
+
+static guint signals[SIG_MAX];
+
+#ifdef TLM_CONFIG_CACHE_FILE
+
+#define TLM_CONFIG_CACHE_VERSION 1
+/* version, config file path, st_dev, st_ino, mtime seconds, mtime
+ * nanoseconds, size, { group: { key: value } } */
+#define TLM_CONFIG_CACHE_TYPE "(usttxxta{sa{ss}})"
+
+static const gchar *
+_get_cache_file (void)
+{
+#   ifdef ENABLE_DEBUG
+    const gchar *env_val = g_getenv ("TLM_CONFIG_CACHE_FILE");
+    if (env_val)
+        return env_val;
+#   endif
+    return TLM_CONFIG_CACHE_FILE;
+}
+
+static gboolean
+_load_cache (TlmConfig *self, const struct stat *file_st)
+{
+    TlmConfigPrivate *priv = self->priv;
+    GError *err = NULL;
+    GMappedFile *mapped = NULL;
+    GVariant *image = NULL;
+    GVariant *groups = NULL;
+    GVariantIter group_iter;
+    GVariantIter *key_iter = NULL;
+    struct stat st;
+    guint32 version = 0;
+    const gchar *path = NULL;
+    guint64 dev = 0, ino = 0, size = 0;
+    gint64 mtime = 0, mtime_nsec = 0;
+    const gchar *group = NULL, *key = NULL, *value = NULL;
+    const gchar *cache_file = _get_cache_file ();
+
+    if (g_stat (cache_file, &st) != 0)
+        return FALSE;
+    /* whoever can write the cache could change the configuration */
+    if (st.st_uid != 0 || (st.st_mode & (S_IWGRP | S_IWOTH))) {
+        WARN ("ignoring config cache %s with unsafe owner or mode",
+              cache_file);
+        return FALSE;
+    }
+
+    mapped = g_mapped_file_new (cache_file, FALSE, &err);
+    if (!mapped) {
+        DBG ("failed to map config cache: %s", err->message);
+        g_error_free (err);
+        return FALSE;
+    }
+    /* not trusted: the serializer copes with any contents */
+    image = g_variant_ref_sink (g_variant_new_from_data (
+            G_VARIANT_TYPE (TLM_CONFIG_CACHE_TYPE),
+            g_mapped_file_get_contents (mapped),
+            g_mapped_file_get_length (mapped),
+            FALSE,
+            (GDestroyNotify) g_mapped_file_unref,
+            mapped));
+
+    g_variant_get (image, "(u&sttxxt@a{sa{ss}})", &version, &path, &dev,
+                   &ino, &mtime, &mtime_nsec, &size, &groups);
+    if (version != TLM_CONFIG_CACHE_VERSION ||
+        g_strcmp0 (path, priv->config_file_path) != 0 ||
+        dev != (guint64) file_st->st_dev ||
+        ino != (guint64) file_st->st_ino ||
+        mtime != (gint64) file_st->st_mtim.tv_sec ||
+        mtime_nsec != (gint64) file_st->st_mtim.tv_nsec ||
+        size != (guint64) file_st->st_size) {
+        DBG ("config cache is stale");
+        g_variant_unref (groups);
+        g_variant_unref (image);
+        return FALSE;
+    }
+
+    g_variant_iter_init (&group_iter, groups);
+    while (g_variant_iter_next (&group_iter, "{&sa{ss}}", &group,
+                                &key_iter)) {
+        GHashTable *group_table = g_hash_table_new_full (g_str_hash,
+                                                         g_str_equal,
+                                                         g_free,
+                                                         g_free);
+        while (g_variant_iter_next (key_iter, "{&s&s}", &key, &value))
+            g_hash_table_insert (group_table, g_strdup (key),
+                                 g_strdup (value));
+        g_variant_iter_free (key_iter);
+        g_hash_table_insert (priv->config_table, g_strdup (group),
+                             group_table);
+    }
+
+    g_variant_unref (groups);
+    g_variant_unref (image);
+    DBG ("loaded TLM config from cache %s", cache_file);
+    return TRUE;
+}
+
+static void
+_save_cache (TlmConfig *self, const struct stat *file_st)
+{
+    TlmConfigPrivate *priv = self->priv;
+    GVariantBuilder groups;
+    GHashTableIter group_iter, key_iter;
+    gpointer group, group_table, key, value;
+    GVariant *image = NULL;
+    gchar *tmp_path = NULL;
+    gssize written = 0;
+    int fd;
+    const gchar *cache_file = _get_cache_file ();
+
+    /* only root may provide the cache, see _load_cache() */
+    if (geteuid () != 0)
+        return;
+
+    g_variant_builder_init (&groups, G_VARIANT_TYPE ("a{sa{ss}}"));
+    g_hash_table_iter_init (&group_iter, priv->config_table);
+    while (g_hash_table_iter_next (&group_iter, &group, &group_table)) {
+        g_variant_builder_open (&groups, G_VARIANT_TYPE ("{sa{ss}}"));
+        g_variant_builder_add (&groups, "s", (const gchar *) group);
+        g_variant_builder_open (&groups, G_VARIANT_TYPE ("a{ss}"));
+        g_hash_table_iter_init (&key_iter, (GHashTable *) group_table);
+        while (g_hash_table_iter_next (&key_iter, &key, &value))
+            g_variant_builder_add (&groups, "{ss}", (const gchar *) key,
+                                   (const gchar *) value);
+        g_variant_builder_close (&groups);
+        g_variant_builder_close (&groups);
+    }
+    image = g_variant_ref_sink (g_variant_new (TLM_CONFIG_CACHE_TYPE,
+            TLM_CONFIG_CACHE_VERSION,
+            priv->config_file_path,
+            (guint64) file_st->st_dev,
+            (guint64) file_st->st_ino,
+            (gint64) file_st->st_mtim.tv_sec,
+            (gint64) file_st->st_mtim.tv_nsec,
+            (guint64) file_st->st_size,
+            &groups));
+
+    /* readers never see a partially written image */
+    tmp_path = g_strdup_printf ("%s.%u", cache_file, getpid ());
+    g_unlink (tmp_path);
+    fd = open (tmp_path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        DBG ("failed to create config cache: %s", strerror (errno));
+        goto out;
+    }
+    /* readable by whoever may read the configuration file, no one else */
+    if (fchmod (fd, file_st->st_mode & 0644) != 0)
+        WARN ("failed to set config cache mode: %s", strerror (errno));
+    written = write (fd, g_variant_get_data (image),
+                     g_variant_get_size (image));
+    close (fd);
+    if (written != (gssize) g_variant_get_size (image) ||
+        g_rename (tmp_path, cache_file) != 0) {
+        WARN ("failed to write config cache: %s", strerror (errno));
+        g_unlink (tmp_path);
+        goto out;
+    }
+    DBG ("config cache written to %s", cache_file);
+
+out:
+    g_free (tmp_path);
+    g_variant_unref (image);
+}
+
+#endif /* TLM_CONFIG_CACHE_FILE */
+
 static gchar *
 _check_config_file (const gchar *path)
 {
@@ -121,7 +314,9 @@ _load_config (TlmConfig *self)
     gchar **groups = NULL;
     gsize n_groups = 0;
     int i,j;
-    GKeyFile *settings = g_key_file_new ();
+    GKeyFile *settings = NULL;
+    struct stat file_st;
+    gboolean have_stat = FALSE;
 
     const gchar * const *sysconfdirs;
 
@@ -148,6 +343,12 @@ _load_config (TlmConfig *self)
     }
 
     if (priv->config_file_path) {
+        have_stat = g_stat (priv->config_file_path, &file_st) == 0;
+#ifdef TLM_CONFIG_CACHE_FILE
+        if (have_stat && _load_cache (self, &file_st))
+            return TRUE;
+#endif
+        settings = g_key_file_new ();
         DBG ("loading TLM config from %s", priv->config_file_path);
         if (!g_key_file_load_from_file (settings,
                                         priv->config_file_path,
@@ -220,6 +421,11 @@ _load_config (TlmConfig *self)
 
     g_key_file_free (settings);
 
+#ifdef TLM_CONFIG_CACHE_FILE
+    if (have_stat)
+        _save_cache (self, &file_st);
+#endif
+
     return TRUE;
 }
 
@@ -354,6 +560,8 @@ tlm_config_set_string (
                          (gpointer) g_strdup (key),
                          (gpointer) g_strdup (value));
 
+    /* snapshots already handed out keep the values they had */
+    g_hash_table_remove_all (self->priv->seat_configs);
 }
 /**
  * tlm_config_get_int:
@@ -568,9 +776,45 @@ tlm_config_has_key (
     return g_hash_table_contains (group_table, (gconstpointer)key);
 }
 
+/**
+ * tlm_config_get_seat_config:
+ * @self: (transfer none): an instance of #TlmConfig
+ * @seat_id: (transfer none): the seat id
+ *
+ * Gets the current configuration snapshot of a seat. The snapshot is
+ * resolved on first use and shared until the configuration changes.
+ *
+ * Returns: (transfer full): the #TlmSeatConfig of the seat, release with
+ * tlm_seat_config_unref().
+ */
+TlmSeatConfig *
+tlm_config_get_seat_config (
+        TlmConfig *self,
+        const gchar *seat_id)
+{
+    TlmSeatConfig *seat_config = NULL;
+
+    g_return_val_if_fail (self && TLM_IS_CONFIG (self), NULL);
+    g_return_val_if_fail (seat_id && seat_id[0], NULL);
+
+    seat_config = g_hash_table_lookup (self->priv->seat_configs, seat_id);
+    if (!seat_config) {
+        seat_config = tlm_seat_config_new (self, seat_id);
+        g_hash_table_insert (self->priv->seat_configs,
+                             seat_config->seat_id, seat_config);
+    }
+
+    return tlm_seat_config_ref (seat_config);
+}
+
 static void
 _cleanup (TlmConfig *self)
 {
+    if (self->priv->seat_configs) {
+        g_hash_table_unref (self->priv->seat_configs);
+        self->priv->seat_configs = NULL;
+    }
+
     if (self->priv->config_table) {
         g_hash_table_unref (self->priv->config_table);
         self->priv->config_table = NULL;
@@ -615,6 +859,28 @@ tlm_config_class_init (
 
     object_class->dispose = tlm_config_dispose;
     object_class->finalize = tlm_config_finalize;
+
+    /**
+     * TlmConfig::group-changed:
+     * @config: the #TlmConfig
+     * @group: the name of the group
+     *
+     * Emitted by tlm_config_reload() for every group that was added,
+     * removed or has different keys or values than before. The detail is
+     * the group name, so "group-changed::General" only reports changes of
+     * the General group.
+     */
+    signals[SIG_GROUP_CHANGED] = g_signal_new ("group-changed",
+                                               TLM_TYPE_CONFIG,
+                                               G_SIGNAL_RUN_LAST |
+                                               G_SIGNAL_DETAILED,
+                                               0,
+                                               NULL,
+                                               NULL,
+                                               NULL,
+                                               G_TYPE_NONE,
+                                               1,
+                                               G_TYPE_STRING);
 }
 
 static void
@@ -626,6 +892,11 @@ _initialize (TlmConfig *self)
                                     g_str_equal,
                                     g_free,
                                     (GDestroyNotify)g_hash_table_unref);
+    self->priv->seat_configs = g_hash_table_new_full (
+                                    g_str_hash,
+                                    g_str_equal,
+                                    NULL,
+                                    (GDestroyNotify)tlm_seat_config_unref);
 
 
     if (!_load_config (self))
@@ -644,22 +915,136 @@ tlm_config_init (
     _initialize (self);
 }
 
+static gboolean
+_group_equal (GHashTable *group_table, GHashTable *other)
+{
+    GHashTableIter iter;
+    gpointer key, value;
+
+    if (g_hash_table_size (group_table) != g_hash_table_size (other))
+        return FALSE;
+
+    g_hash_table_iter_init (&iter, group_table);
+    while (g_hash_table_iter_next (&iter, &key, &value)) {
+        if (g_strcmp0 ((const gchar *) value,
+                       g_hash_table_lookup (other, key)) != 0)
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/* returns the names of the groups that differ, the unchanged ones in the new
+ * configuration are replaced by the old tables so that the pointers handed
+ * out by tlm_config_get_group() stay valid and current */
+static GPtrArray *
+_diff_groups (TlmConfig *self, GHashTable *old_table)
+{
+    GHashTable *config_table = self->priv->config_table;
+    GPtrArray *changed = g_ptr_array_new_with_free_func (g_free);
+    GHashTableIter iter;
+    gpointer group, group_table, new_table;
+
+    g_hash_table_iter_init (&iter, old_table);
+    while (g_hash_table_iter_next (&iter, &group, &group_table)) {
+        new_table = g_hash_table_lookup (config_table, group);
+        if (new_table && _group_equal (group_table, new_table)) {
+            g_hash_table_insert (config_table, g_strdup (group),
+                                 g_hash_table_ref (group_table));
+            continue;
+        }
+        g_ptr_array_add (changed, g_strdup (group));
+    }
+
+    g_hash_table_iter_init (&iter, config_table);
+    while (g_hash_table_iter_next (&iter, &group, &group_table)) {
+        if (!g_hash_table_contains (old_table, group))
+            g_ptr_array_add (changed, g_strdup (group));
+    }
+
+    return changed;
+}
+
+static gboolean
+_contains_group (GPtrArray *groups, const gchar *group)
+{
+    guint i;
+
+    for (i = 0; i < groups->len; i++) {
+        if (g_strcmp0 (g_ptr_array_index (groups, i), group) == 0)
+            return TRUE;
+    }
+    return FALSE;
+}
+
 /**
  * tlm_config_reload:
  * @self: (transfer none): an instance of #TlmConfig
  *
- * Reloads the configuration.
+ * Reloads the configuration and emits #TlmConfig::group-changed for each
+ * group that differs from before. Groups that did not change keep their
+ * tables, see tlm_config_get_group().
  *
+ * #TlmSeatConfig snapshots taken before stay unchanged,
+ * tlm_config_get_seat_config() returns ones resolved from the new
+ * configuration afterwards for the seats whose group or the General group
+ * changed.
  */
 void
 tlm_config_reload (
         TlmConfig *self)
 {
+    GHashTable *old_table = NULL;
+    GHashTable *old_seat_configs = NULL;
+    GPtrArray *changed = NULL;
+    GHashTableIter iter;
+    gpointer seat_id, seat_config;
+    guint i;
+
     g_return_if_fail (self && TLM_IS_CONFIG (self));
 
     DBG ("reload configuration");
+    old_table = g_hash_table_ref (self->priv->config_table);
+    old_seat_configs = g_hash_table_ref (self->priv->seat_configs);
     _cleanup (self);
     _initialize (self);
+
+    changed = _diff_groups (self, old_table);
+    if (!_contains_group (changed, TLM_CONFIG_GENERAL)) {
+        g_hash_table_iter_init (&iter, old_seat_configs);
+        while (g_hash_table_iter_next (&iter, &seat_id, &seat_config)) {
+            if (!_contains_group (changed, seat_id))
+                g_hash_table_insert (self->priv->seat_configs, seat_id,
+                                     tlm_seat_config_ref (seat_config));
+        }
+    }
+    g_hash_table_unref (old_seat_configs);
+    g_hash_table_unref (old_table);
+
+    DBG ("%u group(s) changed", changed->len);
+    for (i = 0; i < changed->len; i++) {
+        const gchar *group = g_ptr_array_index (changed, i);
+        g_signal_emit (self, signals[SIG_GROUP_CHANGED],
+                       g_quark_from_string (group), group);
+    }
+    g_ptr_array_unref (changed);
+}
+
+/**
+ * tlm_config_get_path:
+ * @self: (transfer none): an instance of #TlmConfig
+ *
+ * Gets the location of the configuration file in use.
+ *
+ * Returns: (transfer none): the path of the configuration file, NULL if
+ * none was found.
+ */
+const gchar *
+tlm_config_get_path (
+        TlmConfig *self)
+{
+    g_return_val_if_fail (self && TLM_IS_CONFIG (self), NULL);
+
+    return self->priv->config_file_path;
 }
 
 /**
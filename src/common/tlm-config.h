@@ -150,6 +150,10 @@ void
 tlm_config_reload (
         TlmConfig *self);
 
+const gchar *
+tlm_config_get_path (
+        TlmConfig *self);
+
 G_END_DECLS
 
 #endif /* __TLM_CONFIG_H_ */
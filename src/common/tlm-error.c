@@ -65,6 +65,15 @@
  * @TLM_ERROR_SESSION_TERMINATION_FAILURE: Session termination failed
  * @TLM_ERROR_DBUS_SERVER_START_FAILURE: dbus-server startup failed
  * @TLM_ERROR_PAM_AUTH_FAILURE: PAM authentication failed
+ * @TLM_ERROR_SESSION_SPAWN_FAILURE: Session helper process could not be
+ * started
+ * @TLM_ERROR_SESSION_CONNECT_FAILURE: Connection to session helper failed or
+ * timed out
+ * @TLM_ERROR_SESSION_PROXY_FAILURE: Session object of the helper could not be
+ * reached in time
+ * @TLM_ERROR_SESSION_REQUEST_FAILURE: Session creation request failed or
+ * timed out
+ * @TLM_ERROR_SESSION_SETUP_TIMEOUT: Session was not created in time
  * @TLM_ERROR_DBUS_REQ_ABORTED: Dbus request aborted
  * @TLM_ERROR_DBUS_REQ_NOT_SUPPORTED: Dbus request not supported
  * @TLM_ERROR_DBUS_REQ_UNKNOWN: Dbus request failed with unknown error
@@ -109,6 +118,13 @@ GDBusErrorEntry _tlm_errors[] =
             _ERROR_PREFIX".DBusServerStartFailure"},
     {TLM_ERROR_PAM_AUTH_FAILURE,
             _ERROR_PREFIX".PamAuthFailure"},
+    {TLM_ERROR_SESSION_SPAWN_FAILURE, _ERROR_PREFIX".SessionSpawnFailure"},
+    {TLM_ERROR_SESSION_CONNECT_FAILURE,
+            _ERROR_PREFIX".SessionConnectFailure"},
+    {TLM_ERROR_SESSION_PROXY_FAILURE, _ERROR_PREFIX".SessionProxyFailure"},
+    {TLM_ERROR_SESSION_REQUEST_FAILURE,
+            _ERROR_PREFIX".SessionRequestFailure"},
+    {TLM_ERROR_SESSION_SETUP_TIMEOUT, _ERROR_PREFIX".SessionSetupTimeout"},
     {TLM_ERROR_DBUS_REQ_ABORTED, _ERROR_PREFIX".DBusRequestAborted"},
     {TLM_ERROR_DBUS_REQ_NOT_SUPPORTED, _ERROR_PREFIX".DBusRequestNotSupported"},
     {TLM_ERROR_DBUS_REQ_UNKNOWN, _ERROR_PREFIX".DBusRequestUknown"},
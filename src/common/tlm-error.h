@@ -48,6 +48,11 @@ typedef enum {
     TLM_ERROR_SESSION_TERMINATION_FAILURE,
     TLM_ERROR_DBUS_SERVER_START_FAILURE,
     TLM_ERROR_PAM_AUTH_FAILURE,
+    TLM_ERROR_SESSION_SPAWN_FAILURE,
+    TLM_ERROR_SESSION_CONNECT_FAILURE,
+    TLM_ERROR_SESSION_PROXY_FAILURE,
+    TLM_ERROR_SESSION_REQUEST_FAILURE,
+    TLM_ERROR_SESSION_SETUP_TIMEOUT,
 
     TLM_ERROR_DBUS_REQ_ABORTED = 50,
     TLM_ERROR_DBUS_REQ_NOT_SUPPORTED,
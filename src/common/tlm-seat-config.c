@@ -0,0 +1,269 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of tlm
+ *
+ * Copyright (C) 2014 Intel Corporation.
+ *
+ * Contact: Jussi Laako <jussi.laako@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#include "tlm-seat-config.h"
+#include "tlm-log.h"
+
+/**
+ * SECTION:tlm-seat-config
+ * @short_description: resolved configuration of a seat
+ * @include: tlm-seat-config.h
+ *
+ * #TlmSeatConfig holds the configuration values used on the login path of
+ * a seat, resolved once from a #TlmConfig. Use tlm_config_get_seat_config()
+ * to get the current snapshot of a seat; it stays valid and unchanged for as
+ * long as a reference is held, also across tlm_config_reload().
+ */
+
+G_DEFINE_BOXED_TYPE (TlmSeatConfig, tlm_seat_config,
+                     tlm_seat_config_ref, tlm_seat_config_unref);
+
+typedef enum {
+    TLM_SEAT_CONFIG_SCOPE_GENERAL,
+    TLM_SEAT_CONFIG_SCOPE_SEAT,
+    TLM_SEAT_CONFIG_SCOPE_SEAT_GENERAL
+} TlmSeatConfigScope;
+
+static const gchar *
+_get_group (
+        TlmConfig *config,
+        const gchar *seat_id,
+        TlmSeatConfigScope scope,
+        const gchar *key)
+{
+    switch (scope) {
+        case TLM_SEAT_CONFIG_SCOPE_SEAT:
+            return seat_id;
+        case TLM_SEAT_CONFIG_SCOPE_SEAT_GENERAL:
+            if (tlm_config_has_key (config, seat_id, key))
+                return seat_id;
+            break;
+        default:
+            break;
+    }
+    return TLM_CONFIG_GENERAL;
+}
+
+static gchar *
+_get_string (
+        TlmConfig *config,
+        const gchar *group,
+        const gchar *key,
+        const gchar *def)
+{
+    const gchar *value = tlm_config_get_string (config, group, key);
+    return g_strdup (value ? value : def);
+}
+
+#define TLM_SEAT_CONFIG_GETTER_STRING   _get_string
+#define TLM_SEAT_CONFIG_GETTER_BOOLEAN  tlm_config_get_boolean
+#define TLM_SEAT_CONFIG_GETTER_UINT     tlm_config_get_uint
+#define TLM_SEAT_CONFIG_GETTER_INT      tlm_config_get_int
+
+#define TLM_SEAT_CONFIG_RESOLVE(type, scope, member, key, def) \
+    self->member = TLM_SEAT_CONFIG_GETTER_##type (config, \
+            _get_group (config, seat_id, TLM_SEAT_CONFIG_SCOPE_##scope, key), \
+            key, def);
+
+#define TLM_SEAT_CONFIG_FREE_STRING(member)     g_free (member)
+#define TLM_SEAT_CONFIG_FREE_BOOLEAN(member)
+#define TLM_SEAT_CONFIG_FREE_UINT(member)
+#define TLM_SEAT_CONFIG_FREE_INT(member)
+
+#define TLM_SEAT_CONFIG_FREE(type, scope, member, key, def) \
+    TLM_SEAT_CONFIG_FREE_##type (self->member);
+
+#define TLM_SEAT_CONFIG_COPY_STRING(value)      g_strdup (value)
+#define TLM_SEAT_CONFIG_COPY_BOOLEAN(value)     (value)
+#define TLM_SEAT_CONFIG_COPY_UINT(value)        (value)
+#define TLM_SEAT_CONFIG_COPY_INT(value)         (value)
+
+#define TLM_SEAT_CONFIG_DEFAULT(type, scope, member, key, def) \
+    self->member = TLM_SEAT_CONFIG_COPY_##type (def);
+
+#define TLM_SEAT_CONFIG_VARIANT_TYPE_STRING     G_VARIANT_TYPE_STRING
+#define TLM_SEAT_CONFIG_VARIANT_TYPE_BOOLEAN    G_VARIANT_TYPE_BOOLEAN
+#define TLM_SEAT_CONFIG_VARIANT_TYPE_UINT       G_VARIANT_TYPE_UINT32
+#define TLM_SEAT_CONFIG_VARIANT_TYPE_INT        G_VARIANT_TYPE_INT32
+
+#define TLM_SEAT_CONFIG_TO_VARIANT_STRING(value) \
+    ((value) ? g_variant_new_string (value) : NULL)
+#define TLM_SEAT_CONFIG_TO_VARIANT_BOOLEAN      g_variant_new_boolean
+#define TLM_SEAT_CONFIG_TO_VARIANT_UINT         g_variant_new_uint32
+#define TLM_SEAT_CONFIG_TO_VARIANT_INT          g_variant_new_int32
+
+#define TLM_SEAT_CONFIG_FROM_VARIANT_STRING(value) \
+    g_variant_dup_string (value, NULL)
+#define TLM_SEAT_CONFIG_FROM_VARIANT_BOOLEAN    g_variant_get_boolean
+#define TLM_SEAT_CONFIG_FROM_VARIANT_UINT       g_variant_get_uint32
+#define TLM_SEAT_CONFIG_FROM_VARIANT_INT        g_variant_get_int32
+
+/* unset strings are left out, they read back as NULL */
+#define TLM_SEAT_CONFIG_SERIALIZE(type, scope, member, key, def) \
+    if ((value = TLM_SEAT_CONFIG_TO_VARIANT_##type (self->member))) \
+        g_variant_builder_add (&builder, "{sv}", key, value);
+
+#define TLM_SEAT_CONFIG_DESERIALIZE(type, scope, member, key, def) \
+    if ((value = g_variant_lookup_value (values, key, \
+                    TLM_SEAT_CONFIG_VARIANT_TYPE_##type))) { \
+        TLM_SEAT_CONFIG_FREE_##type (self->member); \
+        self->member = TLM_SEAT_CONFIG_FROM_VARIANT_##type (value); \
+        g_variant_unref (value); \
+    }
+
+/**
+ * tlm_seat_config_new:
+ * @config: (transfer none): the configuration to resolve the values from
+ * @seat_id: (transfer none): the seat id
+ *
+ * Resolves the configuration of a seat.
+ *
+ * Returns: (transfer full): a new #TlmSeatConfig
+ */
+TlmSeatConfig *
+tlm_seat_config_new (
+        TlmConfig *config,
+        const gchar *seat_id)
+{
+    TlmSeatConfig *self = NULL;
+
+    g_return_val_if_fail (config && TLM_IS_CONFIG (config), NULL);
+    g_return_val_if_fail (seat_id && seat_id[0], NULL);
+
+    DBG ("resolving configuration of seat %s", seat_id);
+    self = g_slice_new0 (TlmSeatConfig);
+    self->ref_count = 1;
+    self->seat_id = g_strdup (seat_id);
+    TLM_SEAT_CONFIG_KEYS (TLM_SEAT_CONFIG_RESOLVE)
+
+    return self;
+}
+
+/**
+ * tlm_seat_config_new_from_variant:
+ * @variant: (transfer none): a "(sa{sv})" variant created with
+ * tlm_seat_config_to_variant()
+ *
+ * Recreates a #TlmSeatConfig from its serialized form, without access to
+ * the configuration file. Keys missing from @variant get their built-in
+ * defaults.
+ *
+ * Returns: (transfer full): a new #TlmSeatConfig, or NULL if @variant is
+ * invalid
+ */
+TlmSeatConfig *
+tlm_seat_config_new_from_variant (
+        GVariant *variant)
+{
+    TlmSeatConfig *self = NULL;
+    GVariant *values = NULL;
+    GVariant *value = NULL;
+    const gchar *seat_id = NULL;
+
+    g_return_val_if_fail (variant, NULL);
+
+    if (!g_variant_is_of_type (variant, G_VARIANT_TYPE ("(sa{sv})"))) {
+        WARN ("invalid seat configuration of type %s",
+              g_variant_get_type_string (variant));
+        return NULL;
+    }
+
+    g_variant_get (variant, "(&s@a{sv})", &seat_id, &values);
+    if (!seat_id[0]) {
+        g_variant_unref (values);
+        return NULL;
+    }
+
+    self = g_slice_new0 (TlmSeatConfig);
+    self->ref_count = 1;
+    self->seat_id = g_strdup (seat_id);
+    TLM_SEAT_CONFIG_KEYS (TLM_SEAT_CONFIG_DEFAULT)
+    TLM_SEAT_CONFIG_KEYS (TLM_SEAT_CONFIG_DESERIALIZE)
+    g_variant_unref (values);
+
+    return self;
+}
+
+/**
+ * tlm_seat_config_to_variant:
+ * @self: (transfer none): an instance of #TlmSeatConfig
+ *
+ * Serializes @self for passing it to another process.
+ *
+ * Returns: (transfer floating): a "(sa{sv})" variant of the seat id and
+ * the values keyed by their configuration key names
+ */
+GVariant *
+tlm_seat_config_to_variant (
+        TlmSeatConfig *self)
+{
+    GVariantBuilder builder;
+    GVariant *value = NULL;
+
+    g_return_val_if_fail (self, NULL);
+
+    g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
+    TLM_SEAT_CONFIG_KEYS (TLM_SEAT_CONFIG_SERIALIZE)
+
+    return g_variant_new ("(sa{sv})", self->seat_id, &builder);
+}
+
+/**
+ * tlm_seat_config_ref:
+ * @self: (transfer none): an instance of #TlmSeatConfig
+ *
+ * Increases the reference count, can be called from any thread.
+ *
+ * Returns: (transfer full): @self
+ */
+TlmSeatConfig *
+tlm_seat_config_ref (
+        TlmSeatConfig *self)
+{
+    g_return_val_if_fail (self, NULL);
+
+    g_atomic_int_inc (&self->ref_count);
+    return self;
+}
+
+/**
+ * tlm_seat_config_unref:
+ * @self: (transfer full): an instance of #TlmSeatConfig
+ *
+ * Decreases the reference count and frees @self when it drops to zero.
+ */
+void
+tlm_seat_config_unref (
+        TlmSeatConfig *self)
+{
+    g_return_if_fail (self);
+
+    if (!g_atomic_int_dec_and_test (&self->ref_count))
+        return;
+
+    TLM_SEAT_CONFIG_KEYS (TLM_SEAT_CONFIG_FREE)
+    g_free (self->seat_id);
+    g_slice_free (TlmSeatConfig, self);
+}
@@ -0,0 +1,160 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of tlm
+ *
+ * Copyright (C) 2014 Intel Corporation.
+ *
+ * Contact: Jussi Laako <jussi.laako@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#ifndef __TLM_SEAT_CONFIG_H_
+#define __TLM_SEAT_CONFIG_H_
+
+#include <glib.h>
+#include <glib-object.h>
+
+#include "tlm-config.h"
+#include "tlm-config-general.h"
+#include "tlm-config-seat.h"
+
+G_BEGIN_DECLS
+
+/*
+ * Keys resolved into a #TlmSeatConfig:
+ * X (type, scope, member, key, default)
+ *
+ * scope GENERAL reads the key from the General group only, SEAT from the
+ * seat group only and SEAT_GENERAL from the seat group if the key is there,
+ * General otherwise.
+ */
+#define TLM_SEAT_CONFIG_KEYS(X) \
+    X (STRING,  SEAT_GENERAL, pam_service, \
+       TLM_CONFIG_GENERAL_PAM_SERVICE, "tlm-login") \
+    X (STRING,  SEAT_GENERAL, default_pam_service, \
+       TLM_CONFIG_GENERAL_DEFAULT_PAM_SERVICE, "tlm-default-login") \
+    X (STRING,  SEAT_GENERAL, default_user, \
+       TLM_CONFIG_GENERAL_DEFAULT_USER, "guest") \
+    X (STRING,  SEAT_GENERAL, session_cmd, \
+       TLM_CONFIG_GENERAL_SESSION_CMD, NULL) \
+    X (STRING,  SEAT_GENERAL, session_type, \
+       TLM_CONFIG_GENERAL_SESSION_TYPE, NULL) \
+    X (STRING,  SEAT_GENERAL, runtime_mode, \
+       TLM_CONFIG_GENERAL_RUNTIME_MODE, NULL) \
+    X (STRING,  GENERAL,      session_path, \
+       TLM_CONFIG_GENERAL_SESSION_PATH, "/usr/local/bin:/usr/bin:/bin") \
+    X (STRING,  GENERAL,      data_dirs, \
+       TLM_CONFIG_GENERAL_DATA_DIRS, "/usr/share:/usr/local/share") \
+    X (BOOLEAN, SEAT_GENERAL, setup_terminal, \
+       TLM_CONFIG_GENERAL_SETUP_TERMINAL, FALSE) \
+    X (BOOLEAN, SEAT_GENERAL, setup_runtime_dir, \
+       TLM_CONFIG_GENERAL_SETUP_RUNTIME_DIR, FALSE) \
+    X (BOOLEAN, GENERAL,      pause_session, \
+       TLM_CONFIG_GENERAL_PAUSE_SESSION, FALSE) \
+    X (BOOLEAN, GENERAL,      auto_login, \
+       TLM_CONFIG_GENERAL_AUTO_LOGIN, TRUE) \
+    X (BOOLEAN, GENERAL,      prepare_default, \
+       TLM_CONFIG_GENERAL_PREPARE_DEFAULT, FALSE) \
+    X (BOOLEAN, GENERAL,      x11_session, \
+       TLM_CONFIG_GENERAL_X11_SESSION, FALSE) \
+    X (UINT,    GENERAL,      nseats, \
+       TLM_CONFIG_GENERAL_NSEATS, 0) \
+    X (UINT,    GENERAL,      terminate_timeout, \
+       TLM_CONFIG_GENERAL_TERMINATE_TIMEOUT, 3) \
+    X (UINT,    GENERAL,      auth_token_lifetime, \
+       TLM_CONFIG_GENERAL_AUTH_TOKEN_LIFETIME, 30) \
+    X (UINT,    SEAT_GENERAL, sessiond_pool_size, \
+       TLM_CONFIG_GENERAL_SESSIOND_POOL_SIZE, 0) \
+    X (UINT,    SEAT_GENERAL, max_parked_sessions, \
+       TLM_CONFIG_GENERAL_MAX_PARKED_SESSIONS, 0) \
+    X (BOOLEAN, SEAT_GENERAL, freeze_parked_sessions, \
+       TLM_CONFIG_GENERAL_FREEZE_PARKED_SESSIONS, FALSE) \
+    X (BOOLEAN, SEAT_GENERAL, pipelined_relogin, \
+       TLM_CONFIG_GENERAL_PIPELINED_RELOGIN, FALSE) \
+    X (BOOLEAN, SEAT,         active, \
+       TLM_CONFIG_SEAT_ACTIVE, TRUE) \
+    X (UINT,    SEAT,         vtnr, \
+       TLM_CONFIG_SEAT_VTNR, 0) \
+    X (UINT,    SEAT,         nwatch, \
+       TLM_CONFIG_SEAT_NWATCH, 0) \
+    X (INT,     SEAT,         priority, \
+       TLM_CONFIG_SEAT_PRIORITY, 0)
+
+#define TLM_SEAT_CONFIG_TYPE_STRING     gchar *
+#define TLM_SEAT_CONFIG_TYPE_BOOLEAN    gboolean
+#define TLM_SEAT_CONFIG_TYPE_UINT       guint
+#define TLM_SEAT_CONFIG_TYPE_INT        gint
+
+#define TLM_SEAT_CONFIG_MEMBER(type, scope, member, key, def) \
+    TLM_SEAT_CONFIG_TYPE_##type member;
+
+#define TLM_TYPE_SEAT_CONFIG    (tlm_seat_config_get_type ())
+
+typedef struct _TlmSeatConfig TlmSeatConfig;
+
+/**
+ * TlmSeatConfig:
+ * @seat_id: the seat the values were resolved for
+ *
+ * Immutable snapshot of the configuration of one seat, with the seat group,
+ * General group and built-in defaults already applied and the values
+ * converted to their types. The remaining members are named after the keys,
+ * see TLM_SEAT_CONFIG_KEYS().
+ */
+struct _TlmSeatConfig
+{
+    /*< private >*/
+    volatile gint ref_count;
+
+    /*< public >*/
+    gchar *seat_id;
+    TLM_SEAT_CONFIG_KEYS (TLM_SEAT_CONFIG_MEMBER)
+};
+
+GType
+tlm_seat_config_get_type (void) G_GNUC_CONST;
+
+TlmSeatConfig *
+tlm_seat_config_new (
+        TlmConfig *config,
+        const gchar *seat_id);
+
+TlmSeatConfig *
+tlm_seat_config_new_from_variant (
+        GVariant *variant);
+
+GVariant *
+tlm_seat_config_to_variant (
+        TlmSeatConfig *self);
+
+TlmSeatConfig *
+tlm_seat_config_ref (
+        TlmSeatConfig *self);
+
+void
+tlm_seat_config_unref (
+        TlmSeatConfig *self);
+
+TlmSeatConfig *
+tlm_config_get_seat_config (
+        TlmConfig *self,
+        const gchar *seat_id);
+
+G_END_DECLS
+
+#endif /* __TLM_SEAT_CONFIG_H_ */
@@ -0,0 +1,378 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of tlm
+ *
+ * Copyright (C) 2014 Intel Corporation.
+ *
+ * Contact: Jussi Laako <jussi.laako@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#include <pwd.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include "tlm-user-info.h"
+#include "tlm-log.h"
+
+/**
+ * SECTION:tlm-user-info
+ * @short_description: cached password database entries
+ * @include: tlm-user-info.h
+ *
+ * #TlmUserInfo holds what the login path needs to know about a user,
+ * resolved with a single getpwnam_r() call. tlm_user_info_lookup() caches
+ * the entries for #TLM_USER_INFO_TTL, and drops them all as soon as
+ * /etc/passwd or /etc/group is changed. Users that are not found are not
+ * cached, they may be created by the account plugin right after.
+ *
+ * The same watch tracks /etc/shadow for
+ * tlm_user_info_get_credentials_serial().
+ */
+
+G_DEFINE_BOXED_TYPE (TlmUserInfo, tlm_user_info,
+                     tlm_user_info_ref, tlm_user_info_unref);
+
+/* how long an entry is used before asking NSS again, this is what catches
+ * the changes in remote databases */
+#define TLM_USER_INFO_TTL       (30 * G_USEC_PER_SEC)
+#define TLM_USER_INFO_WATCH_DIR "/etc"
+
+typedef struct {
+    TlmUserInfo *info;
+    gint64 expiry;
+} TlmUserInfoEntry;
+
+G_LOCK_DEFINE_STATIC (user_info_cache);
+static GHashTable *_cache = NULL;
+static guint _generation = 0;
+static guint _credentials_serial = 0;
+static gint _watch_fd = -1;
+
+static void
+_entry_free (TlmUserInfoEntry *entry)
+{
+    tlm_user_info_unref (entry->info);
+    g_slice_free (TlmUserInfoEntry, entry);
+}
+
+/* the files are replaced by renaming on update, so the directory is
+ * watched instead of them */
+static gint
+_open_watch (void)
+{
+    gint fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+
+    if (fd < 0) {
+        WARN ("Failed to start inotify: %s", strerror (errno));
+        return -1;
+    }
+    if (inotify_add_watch (fd, TLM_USER_INFO_WATCH_DIR,
+                           IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE |
+                           IN_DELETE) < 0) {
+        WARN ("failed to add inotify watch on %s: %s",
+              TLM_USER_INFO_WATCH_DIR, strerror (errno));
+        close (fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* drains the pending events, called with the lock held */
+static void
+_poll_watch (void)
+{
+    gchar buf[4096]
+        __attribute__ ((aligned (__alignof__ (struct inotify_event))));
+    const struct inotify_event *event = NULL;
+    gboolean users_changed = FALSE;
+    gboolean shadow_changed = FALSE;
+    gchar *ptr = NULL;
+    ssize_t len;
+
+    if (!_cache) {
+        _cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                        (GDestroyNotify) _entry_free);
+        _watch_fd = _open_watch ();
+    }
+    if (_watch_fd < 0) {
+        /* nothing tells when the passwords change, assume they always do */
+        _credentials_serial++;
+        return;
+    }
+
+    while ((len = read (_watch_fd, buf, sizeof (buf))) > 0) {
+        for (ptr = buf; ptr < buf + len;
+             ptr += sizeof (struct inotify_event) + event->len) {
+            event = (const struct inotify_event *) ptr;
+            if (event->mask & IN_Q_OVERFLOW) {
+                users_changed = shadow_changed = TRUE;
+            } else if (event->len) {
+                if (g_strcmp0 (event->name, "passwd") == 0 ||
+                    g_strcmp0 (event->name, "group") == 0)
+                    users_changed = TRUE;
+                else if (g_strcmp0 (event->name, "shadow") == 0)
+                    shadow_changed = TRUE;
+            }
+        }
+    }
+
+    if (users_changed) {
+        DBG ("user databases changed, dropping cached users");
+        g_hash_table_remove_all (_cache);
+        _generation++;
+    }
+    if (shadow_changed)
+        _credentials_serial++;
+}
+
+static TlmUserInfo *
+_resolve (const gchar *name)
+{
+    TlmUserInfo *self = NULL;
+    struct passwd pwd;
+    struct passwd *result = NULL;
+    glong buf_len = sysconf (_SC_GETPW_R_SIZE_MAX);
+    gchar *buf = NULL;
+    int res;
+
+    if (buf_len <= 0) buf_len = 16384;
+    buf = g_malloc (buf_len);
+    while ((res = getpwnam_r (name, &pwd, buf, buf_len, &result)) == ERANGE) {
+        buf_len *= 2;
+        buf = g_realloc (buf, buf_len);
+    }
+    if (!result) {
+        DBG ("Could not get info for user '%s', error : %s",
+             name, res ? strerror (res) : "not found");
+        g_free (buf);
+        return NULL;
+    }
+
+    self = g_slice_new0 (TlmUserInfo);
+    self->ref_count = 1;
+    self->name = g_strdup (pwd.pw_name);
+    self->uid = pwd.pw_uid;
+    self->gid = pwd.pw_gid;
+    self->home_dir = g_strdup (pwd.pw_dir);
+    self->shell = g_strdup (pwd.pw_shell);
+    g_free (buf);
+
+    return self;
+}
+
+/**
+ * tlm_user_info_lookup:
+ * @name: (transfer none): the user name
+ *
+ * Looks up @name in the password database, or returns the cached entry if
+ * it is still fresh. Can be called from any thread.
+ *
+ * Returns: (transfer full): the #TlmUserInfo of @name, or NULL if there is
+ * no such user
+ */
+TlmUserInfo *
+tlm_user_info_lookup (
+        const gchar *name)
+{
+    TlmUserInfoEntry *entry = NULL;
+    TlmUserInfo *info = NULL;
+    guint generation;
+
+    g_return_val_if_fail (name && name[0], NULL);
+
+    G_LOCK (user_info_cache);
+    _poll_watch ();
+    entry = g_hash_table_lookup (_cache, name);
+    if (entry && entry->expiry > g_get_monotonic_time ())
+        info = tlm_user_info_ref (entry->info);
+    generation = _generation;
+    G_UNLOCK (user_info_cache);
+
+    if (info)
+        return info;
+
+    /* may be an IPC round trip, the other lookups need not wait for it */
+    info = _resolve (name);
+
+    G_LOCK (user_info_cache);
+    if (generation != _generation) {
+        /* invalidated meanwhile, the result may be stale already */
+    } else if (info) {
+        entry = g_slice_new0 (TlmUserInfoEntry);
+        entry->info = tlm_user_info_ref (info);
+        entry->expiry = g_get_monotonic_time () + TLM_USER_INFO_TTL;
+        g_hash_table_replace (_cache, g_strdup (name), entry);
+    } else {
+        g_hash_table_remove (_cache, name);
+    }
+    G_UNLOCK (user_info_cache);
+
+    return info;
+}
+
+/**
+ * tlm_user_info_invalidate:
+ * @name: (transfer none) (allow-none): the user name
+ *
+ * Drops the cached entry of @name, or all entries if @name is NULL. Needed
+ * only for changes that are not made through /etc/passwd or /etc/group.
+ */
+void
+tlm_user_info_invalidate (
+        const gchar *name)
+{
+    G_LOCK (user_info_cache);
+    if (_cache) {
+        if (name)
+            g_hash_table_remove (_cache, name);
+        else
+            g_hash_table_remove_all (_cache);
+        _generation++;
+    }
+    G_UNLOCK (user_info_cache);
+}
+
+/**
+ * tlm_user_info_get_credentials_serial:
+ *
+ * Tells whether /etc/shadow may have changed since an earlier call, like
+ * after a password change. Without a working inotify watch every call
+ * returns a new value. Can be called from any thread.
+ *
+ * Returns: a number that changes whenever /etc/shadow does
+ */
+guint
+tlm_user_info_get_credentials_serial (void)
+{
+    guint serial;
+
+    G_LOCK (user_info_cache);
+    _poll_watch ();
+    serial = _credentials_serial;
+    G_UNLOCK (user_info_cache);
+
+    return serial;
+}
+
+/**
+ * tlm_user_info_new_from_variant:
+ * @variant: (transfer none): a "(suuss)" variant created with
+ * tlm_user_info_to_variant()
+ *
+ * Recreates a #TlmUserInfo from its serialized form without a lookup.
+ *
+ * Returns: (transfer full): a new #TlmUserInfo, or NULL if @variant is
+ * invalid
+ */
+TlmUserInfo *
+tlm_user_info_new_from_variant (
+        GVariant *variant)
+{
+    TlmUserInfo *self = NULL;
+    const gchar *name = NULL;
+    const gchar *home_dir = NULL;
+    const gchar *shell = NULL;
+    guint32 uid = 0;
+    guint32 gid = 0;
+
+    g_return_val_if_fail (variant, NULL);
+
+    if (!g_variant_is_of_type (variant, G_VARIANT_TYPE ("(suuss)"))) {
+        WARN ("invalid user info of type %s",
+              g_variant_get_type_string (variant));
+        return NULL;
+    }
+
+    g_variant_get (variant, "(&suu&s&s)", &name, &uid, &gid, &home_dir,
+                   &shell);
+    if (!name[0])
+        return NULL;
+
+    self = g_slice_new0 (TlmUserInfo);
+    self->ref_count = 1;
+    self->name = g_strdup (name);
+    self->uid = (uid_t) uid;
+    self->gid = (gid_t) gid;
+    self->home_dir = g_strdup (home_dir);
+    self->shell = g_strdup (shell);
+
+    return self;
+}
+
+/**
+ * tlm_user_info_to_variant:
+ * @self: (transfer none): an instance of #TlmUserInfo
+ *
+ * Serializes @self for passing it to another process.
+ *
+ * Returns: (transfer floating): a "(suuss)" variant of the name, uid, gid,
+ * home directory and shell
+ */
+GVariant *
+tlm_user_info_to_variant (
+        TlmUserInfo *self)
+{
+    g_return_val_if_fail (self, NULL);
+
+    return g_variant_new ("(suuss)", self->name, (guint32) self->uid,
+                          (guint32) self->gid,
+                          self->home_dir ? self->home_dir : "",
+                          self->shell ? self->shell : "");
+}
+
+/**
+ * tlm_user_info_ref:
+ * @self: (transfer none): an instance of #TlmUserInfo
+ *
+ * Increases the reference count, can be called from any thread.
+ *
+ * Returns: (transfer full): @self
+ */
+TlmUserInfo *
+tlm_user_info_ref (
+        TlmUserInfo *self)
+{
+    g_return_val_if_fail (self, NULL);
+
+    g_atomic_int_inc (&self->ref_count);
+    return self;
+}
+
+/**
+ * tlm_user_info_unref:
+ * @self: (transfer full): an instance of #TlmUserInfo
+ *
+ * Decreases the reference count and frees @self when it drops to zero.
+ */
+void
+tlm_user_info_unref (
+        TlmUserInfo *self)
+{
+    g_return_if_fail (self);
+
+    if (!g_atomic_int_dec_and_test (&self->ref_count))
+        return;
+
+    g_free (self->name);
+    g_free (self->home_dir);
+    g_free (self->shell);
+    g_slice_free (TlmUserInfo, self);
+}
@@ -0,0 +1,94 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of tlm
+ *
+ * Copyright (C) 2014 Intel Corporation.
+ *
+ * Contact: Jussi Laako <jussi.laako@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#ifndef __TLM_USER_INFO_H_
+#define __TLM_USER_INFO_H_
+
+#include <sys/types.h>
+#include <glib.h>
+#include <glib-object.h>
+
+G_BEGIN_DECLS
+
+#define TLM_TYPE_USER_INFO      (tlm_user_info_get_type ())
+
+typedef struct _TlmUserInfo TlmUserInfo;
+
+/**
+ * TlmUserInfo:
+ * @name: the user name
+ * @uid: the user id
+ * @gid: the primary group id
+ * @home_dir: the home directory
+ * @shell: the login shell
+ *
+ * Immutable copy of the password database entry of a user.
+ */
+struct _TlmUserInfo
+{
+    /*< private >*/
+    volatile gint ref_count;
+
+    /*< public >*/
+    gchar *name;
+    uid_t uid;
+    gid_t gid;
+    gchar *home_dir;
+    gchar *shell;
+};
+
+GType
+tlm_user_info_get_type (void) G_GNUC_CONST;
+
+TlmUserInfo *
+tlm_user_info_lookup (
+        const gchar *name);
+
+void
+tlm_user_info_invalidate (
+        const gchar *name);
+
+guint
+tlm_user_info_get_credentials_serial (void);
+
+TlmUserInfo *
+tlm_user_info_new_from_variant (
+        GVariant *variant);
+
+GVariant *
+tlm_user_info_to_variant (
+        TlmUserInfo *self);
+
+TlmUserInfo *
+tlm_user_info_ref (
+        TlmUserInfo *self);
+
+void
+tlm_user_info_unref (
+        TlmUserInfo *self);
+
+G_END_DECLS
+
+#endif /* __TLM_USER_INFO_H_ */
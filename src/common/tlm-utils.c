@@ -33,7 +33,13 @@
 #include <ctype.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <sys/inotify.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <dirent.h>
 #include <netdb.h>
 #include <string.h>
 #include <unistd.h>
@@ -70,54 +76,6 @@ tlm_user_get_name (uid_t user_id)
     return pwent->pw_name;
 }
 
-uid_t
-tlm_user_get_uid (const gchar *username)
-{
-    struct passwd *pwent;
-
-    pwent = getpwnam (username);
-    if (!pwent)
-        return -1;
-
-    return pwent->pw_uid;
-}
-
-gid_t
-tlm_user_get_gid (const gchar *username)
-{
-    struct passwd *pwent;
-
-    pwent = getpwnam (username);
-    if (!pwent)
-        return -1;
-
-    return pwent->pw_gid;
-}
-
-const gchar *
-tlm_user_get_home_dir (const gchar *username)
-{
-    struct passwd *pwent;
-
-    pwent = getpwnam (username);
-    if (!pwent)
-        return NULL;
-
-    return pwent->pw_dir;
-}
-
-const gchar *
-tlm_user_get_shell (const gchar *username)
-{
-    struct passwd *pwent;
-
-    pwent = getpwnam (username);
-    if (!pwent)
-        return NULL;
-
-    return pwent->pw_shell;
-}
-
 gboolean
 tlm_utils_delete_dir (
         const gchar *dir)
@@ -165,6 +123,282 @@ tlm_utils_delete_dir (
     return TRUE;
 }
 
+#define TRASH_PREFIX ".tlm-trash."
+
+/* from linux/ioprio.h, not exported to user space by older kernels */
+#define IOPRIO_CLASS_IDLE       3
+#define IOPRIO_CLASS_SHIFT      13
+#define IOPRIO_WHO_PROCESS      1
+
+/* from linux/openat2.h, likewise */
+#ifndef RESOLVE_NO_XDEV
+#define RESOLVE_NO_XDEV         0x01
+#endif
+
+struct tlm_open_how {
+    guint64 flags;
+    guint64 mode;
+    guint64 resolve;
+};
+
+typedef struct {
+    int parent_fd;
+    gchar *parent;
+} TlmTrashJob;
+
+static GThreadPool *_trash_pool = NULL;
+G_LOCK_DEFINE_STATIC (_trash_pool);
+
+/* opens the directory name in parent_fd unless it is a symlink or on
+ * another mount, with openat2() where the kernel has it and comparing the
+ * devices otherwise; errno is EXDEV for a mount */
+static int
+_open_dir_at (int parent_fd, const gchar *name, dev_t dev)
+{
+    struct stat st;
+    int fd = -1;
+#ifdef SYS_openat2
+    static gboolean no_openat2 = FALSE;
+    struct tlm_open_how how = {
+        O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC, 0, RESOLVE_NO_XDEV
+    };
+
+    if (!no_openat2) {
+        fd = (int) syscall (SYS_openat2, parent_fd, name, &how, sizeof (how));
+        if (fd >= 0 || errno != ENOSYS)
+            return fd;
+        no_openat2 = TRUE;
+    }
+#endif
+
+    fd = openat (parent_fd, name,
+                 O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+    if (fstat (fd, &st) != 0 || st.st_dev != dev) {
+        close (fd);
+        errno = EXDEV;
+        return -1;
+    }
+    return fd;
+}
+
+/* removes name in parent_fd without following symlinks, crossing into
+ * other mounts or building paths, entries that vanish meanwhile are fine */
+static gboolean
+_delete_at (int parent_fd, const gchar *name, dev_t dev)
+{
+    struct dirent *ent = NULL;
+    DIR *dir = NULL;
+    gboolean res = TRUE;
+    int fd, pass;
+
+    fd = _open_dir_at (parent_fd, name, dev);
+    if (fd < 0) {
+        if (errno == ENOTDIR || errno == ELOOP)
+            return unlinkat (parent_fd, name, 0) == 0 || errno == ENOENT;
+        if (errno == EXDEV)
+            WARN ("not descending into %s, it is a mount point", name);
+        return errno == ENOENT;
+    }
+    if (!(dir = fdopendir (fd))) {
+        close (fd);
+        return FALSE;
+    }
+
+    /* a second pass for the entries readdir missed while deleting */
+    for (pass = 0; pass < 2; pass++) {
+        while ((ent = readdir (dir)) != NULL) {
+            if (g_strcmp0 (ent->d_name, ".") == 0 ||
+                g_strcmp0 (ent->d_name, "..") == 0)
+                continue;
+            if (ent->d_type == DT_DIR || ent->d_type == DT_UNKNOWN)
+                res = _delete_at (dirfd (dir), ent->d_name, dev) && res;
+            else if (unlinkat (dirfd (dir), ent->d_name, 0) != 0 &&
+                     errno != ENOENT)
+                res = FALSE;
+        }
+        closedir (dir);
+
+        if (unlinkat (parent_fd, name, AT_REMOVEDIR) == 0 || errno == ENOENT)
+            return res;
+        if (errno != ENOTEMPTY || pass > 0)
+            return FALSE;
+
+        fd = _open_dir_at (parent_fd, name, dev);
+        if (fd < 0 || !(dir = fdopendir (fd))) {
+            if (fd >= 0) close (fd);
+            return FALSE;
+        }
+    }
+
+    return FALSE;
+}
+
+static void
+_trash_worker (gpointer data, gpointer user_data)
+{
+    TlmTrashJob *job = (TlmTrashJob *) data;
+    struct dirent *ent = NULL;
+    GPtrArray *names = g_ptr_array_new_with_free_func (g_free);
+    DIR *dir = NULL;
+    struct stat st;
+    guint i;
+
+    /* the thread is the pool's own, this does not leak to other work, run
+     * inline the caller's thread keeps its priority */
+    if (GPOINTER_TO_INT (user_data)) {
+        setpriority (PRIO_PROCESS, (id_t) syscall (SYS_gettid), 19);
+        syscall (SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0,
+                 IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT);
+    }
+
+    /* everything trashed here so far, also by earlier runs; the entries
+     * were renamed within the parent, so they are on its device */
+    if (fstat (job->parent_fd, &st) == 0 &&
+        (dir = fdopendir (dup (job->parent_fd)))) {
+        while ((ent = readdir (dir)) != NULL) {
+            if (g_str_has_prefix (ent->d_name, TRASH_PREFIX))
+                g_ptr_array_add (names, g_strdup (ent->d_name));
+        }
+        closedir (dir);
+    }
+    for (i = 0; i < names->len; i++) {
+        const gchar *name = g_ptr_array_index (names, i);
+        if (!_delete_at (job->parent_fd, name, st.st_dev))
+            WARN ("failed to delete %s/%s", job->parent, name);
+        else
+            DBG ("deleted %s/%s", job->parent, name);
+    }
+
+    g_ptr_array_unref (names);
+    close (job->parent_fd);
+    g_free (job->parent);
+    g_slice_free (TlmTrashJob, job);
+}
+
+/**
+ * tlm_utils_trash_dir:
+ * @dir: the directory to remove
+ *
+ * Moves @dir out of the way by renaming it to a hidden trash entry next to
+ * it, on the same filesystem, and deletes it later on a low priority
+ * thread. Trash entries left behind by a process that exited meanwhile are
+ * deleted along. Symlinks are removed, not followed, and file systems
+ * mounted below @dir are left alone. Falls back to tlm_utils_delete_dir()
+ * if @dir can not be renamed, like when it is a mount point.
+ *
+ * Returns: whether @dir is gone from its path
+ */
+gboolean
+tlm_utils_trash_dir (
+        const gchar *dir)
+{
+    gchar *parent = NULL;
+    gchar *base = NULL;
+    gchar *trash_name = NULL;
+    TlmTrashJob *job = NULL;
+    int parent_fd;
+    GError *error = NULL;
+
+    g_return_val_if_fail (dir && dir[0], FALSE);
+
+    parent = g_path_get_dirname (dir);
+    base = g_path_get_basename (dir);
+    parent_fd = open (parent, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (parent_fd < 0) {
+        g_free (parent);
+        g_free (base);
+        return errno == ENOENT;
+    }
+
+    trash_name = g_strdup_printf (TRASH_PREFIX "%s.%08x", base,
+                                  g_random_int ());
+    if (renameat (parent_fd, base, parent_fd, trash_name) != 0) {
+        gboolean gone = errno == ENOENT;
+        if (!gone)
+            DBG ("could not move %s to the trash : %s", dir,
+                 strerror (errno));
+        close (parent_fd);
+        g_free (trash_name);
+        g_free (parent);
+        g_free (base);
+        return gone || tlm_utils_delete_dir (dir);
+    }
+    DBG ("moved %s to %s/%s", dir, parent, trash_name);
+    g_free (trash_name);
+    g_free (base);
+
+    job = g_slice_new0 (TlmTrashJob);
+    job->parent_fd = parent_fd;
+    job->parent = parent;
+
+    G_LOCK (_trash_pool);
+    if (!_trash_pool) {
+        _trash_pool = g_thread_pool_new (_trash_worker,
+                                         GINT_TO_POINTER (TRUE), 1, TRUE,
+                                         &error);
+        if (!_trash_pool) {
+            WARN ("failed to create the trash pool: %s",
+                  error ? error->message : "");
+            g_clear_error (&error);
+        }
+    }
+    G_UNLOCK (_trash_pool);
+
+    if (_trash_pool)
+        g_thread_pool_push (_trash_pool, job, NULL);
+    else
+        _trash_worker (job, NULL);
+
+    return TRUE;
+}
+
+/*
+ * Sends a state update like "READY=1" to the service manager in the
+ * sd_notify() protocol, without linking to libsystemd. Returns FALSE if
+ * there is no service manager listening.
+ */
+gboolean
+tlm_utils_sd_notify (
+        const gchar *state)
+{
+    const gchar *socket_path = g_getenv ("NOTIFY_SOCKET");
+    struct sockaddr_un addr;
+    gsize path_len;
+    gssize sent;
+    int fd;
+
+    g_return_val_if_fail (state, FALSE);
+
+    if (!socket_path || (socket_path[0] != '/' && socket_path[0] != '@'))
+        return FALSE;
+    path_len = strlen (socket_path);
+    if (path_len >= sizeof (addr.sun_path))
+        return FALSE;
+
+    memset (&addr, 0, sizeof (addr));
+    addr.sun_family = AF_UNIX;
+    memcpy (addr.sun_path, socket_path, path_len);
+    /* abstract socket */
+    if (addr.sun_path[0] == '@')
+        addr.sun_path[0] = '\0';
+
+    fd = socket (AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        WARN ("failed to create notify socket: %s", strerror (errno));
+        return FALSE;
+    }
+    sent = sendto (fd, state, strlen (state), MSG_NOSIGNAL,
+                   (struct sockaddr *) &addr,
+                   offsetof (struct sockaddr_un, sun_path) + path_len);
+    if (sent < 0)
+        WARN ("failed to notify service manager: %s", strerror (errno));
+    close (fd);
+
+    return sent >= 0;
+}
+
 static gchar *
 _get_tty_id (
         const gchar *tty_name)
@@ -724,22 +958,10 @@ static int func_conv(
     return PAM_SUCCESS;
 }
 
-gboolean
-tlm_authenticate_user (
-    TlmConfig *config,
-    const gchar *username,
-    const gchar *password)
+static const gchar *
+_get_authentication_service (TlmConfig *config)
 {
-    pam_handle_t *pam_h = NULL;
-    gboolean ret_auth = FALSE;
-    int ret;
     const gchar *service = NULL;
-    TlmLoginInfo *info = NULL;
-
-    if (!password || !username) {
-        WARN("username or password would be NULL");
-        return FALSE;
-    }
 
     // If TLM_CONFIG_PAM_AUTHENTICATION_SERVICE is not specified in tlm.conf
     // use "system-auth" as defult.
@@ -748,6 +970,19 @@ tlm_authenticate_user (
                                     TLM_CONFIG_GENERAL_PAM_SERVICE);
     if (!service)
         service = "system-auth";
+    return service;
+}
+
+static gboolean
+_authenticate_user (
+    const gchar *service,
+    const gchar *username,
+    const gchar *password)
+{
+    pam_handle_t *pam_h = NULL;
+    gboolean ret_auth = FALSE;
+    int ret;
+    TlmLoginInfo *info = NULL;
 
     info = g_malloc0 (sizeof (*info));
     info->username = strndup (username, PAM_MAX_RESP_SIZE - 1);
@@ -757,6 +992,9 @@ tlm_authenticate_user (
     ret = pam_start (service, username, &conv, &pam_h);
     if (ret != PAM_SUCCESS) {
         WARN("Failed to pam_start: %d", ret);
+        free(info->username);
+        free(info->password);
+        g_free(info);
         return FALSE;
     }
 
@@ -775,3 +1013,391 @@ tlm_authenticate_user (
     g_free(info);
     return ret_auth;
 }
+
+/* account management only, for a user whose password is already known */
+static gboolean
+_check_user_account (
+    const gchar *service,
+    const gchar *username)
+{
+    pam_handle_t *pam_h = NULL;
+    /* no password is given out, the modules have no business asking */
+    TlmLoginInfo info = { (gchar *) username, (gchar *) "" };
+    const struct pam_conv conv = {func_conv, &info};
+    int ret;
+
+    ret = pam_start (service, username, &conv, &pam_h);
+    if (ret != PAM_SUCCESS) {
+        WARN("Failed to pam_start: %d", ret);
+        return FALSE;
+    }
+
+    ret = pam_acct_mgmt (pam_h, PAM_SILENT);
+    if (ret != PAM_SUCCESS)
+        WARN("Account of '%s' is not usable: %s", username,
+             pam_strerror (pam_h, ret));
+
+    pam_end(pam_h, ret);
+    return ret == PAM_SUCCESS;
+}
+
+/* PBKDF2-HMAC-SHA256, one block */
+#define TLM_VERIFIER_ITERATIONS 100000
+
+static gchar *
+_derive_verifier (
+    const gchar *salt,
+    const gchar *password)
+{
+    static const guint8 block_index[4] = { 0, 0, 0, 1 };
+    GHmac *key = NULL;
+    GHmac *hmac = NULL;
+    guint8 u[32];
+    guint8 t[32];
+    gsize len = sizeof (u);
+    GString *hex = NULL;
+    guint i, j;
+
+    key = g_hmac_new (G_CHECKSUM_SHA256, (const guchar *) password,
+                      strlen (password));
+    hmac = g_hmac_copy (key);
+    g_hmac_update (hmac, (const guchar *) salt, strlen (salt));
+    g_hmac_update (hmac, block_index, sizeof (block_index));
+    g_hmac_get_digest (hmac, u, &len);
+    g_hmac_unref (hmac);
+    memcpy (t, u, sizeof (t));
+
+    for (i = 1; i < TLM_VERIFIER_ITERATIONS; i++) {
+        hmac = g_hmac_copy (key);
+        g_hmac_update (hmac, u, sizeof (u));
+        len = sizeof (u);
+        g_hmac_get_digest (hmac, u, &len);
+        g_hmac_unref (hmac);
+        for (j = 0; j < sizeof (t); j++)
+            t[j] ^= u[j];
+    }
+    g_hmac_unref (key);
+
+    hex = g_string_sized_new (2 * sizeof (t) + 1);
+    for (j = 0; j < sizeof (t); j++)
+        g_string_append_printf (hex, "%02x", t[j]);
+    memset (u, 0, sizeof (u));
+    memset (t, 0, sizeof (t));
+    return g_string_free (hex, FALSE);
+}
+
+/* takes the same time wherever the secrets differ */
+gboolean
+tlm_utils_secret_equal (
+    const gchar *secret,
+    const gchar *expected)
+{
+    gsize len = 0;
+    gsize i;
+    guchar diff = 0;
+
+    if (!secret || !expected)
+        return FALSE;
+
+    len = strlen (expected);
+    if (strlen (secret) != len)
+        return FALSE;
+    for (i = 0; i < len; i++)
+        diff |= (guchar) secret[i] ^ (guchar) expected[i];
+    return diff == 0;
+}
+
+gboolean
+tlm_authenticate_user (
+    TlmConfig *config,
+    const gchar *username,
+    const gchar *password)
+{
+    if (!password || !username) {
+        WARN("username or password would be NULL");
+        return FALSE;
+    }
+
+    return _authenticate_user (_get_authentication_service (config),
+                               username, password);
+}
+
+const gchar *
+tlm_authenticate_user_get_service (TlmConfig *config)
+{
+    return _get_authentication_service (config);
+}
+
+typedef struct _TlmAuthRequest
+{
+    gchar *service; /* NULL to only derive the verifier */
+    gchar *username;
+    gchar *password;
+    gchar *salt; /* set to derive a verifier of the password */
+    gchar *expected; /* verifier that spares the PAM conversation */
+    gchar *verifier;
+    gboolean authenticated;
+    GMainContext *context;
+    GCancellable *cancellable;
+    TlmAuthenticateCb callback;
+    TlmVerifyCb verify_callback;
+    gpointer user_data;
+    GDestroyNotify destroy;
+} TlmAuthRequest;
+
+static GThreadPool *_auth_pool = NULL;
+
+static void
+_auth_request_free (TlmAuthRequest *req)
+{
+    g_free (req->service);
+    g_free (req->username);
+    if (req->password) {
+        memset (req->password, 0, strlen (req->password));
+        g_free (req->password);
+    }
+    g_free (req->salt);
+    g_free (req->expected);
+    g_free (req->verifier);
+    if (req->destroy) req->destroy (req->user_data);
+    g_main_context_unref (req->context);
+    if (req->cancellable) g_object_unref (req->cancellable);
+    g_slice_free (TlmAuthRequest, req);
+}
+
+static gboolean
+_auth_request_complete (gpointer data)
+{
+    TlmAuthRequest *req = (TlmAuthRequest *)data;
+
+    /* runs in the context of the caller, so is serialized with the
+     * cancellation done by the caller */
+    if (g_cancellable_is_cancelled (req->cancellable))
+        DBG ("authentication of '%s' cancelled",
+             req->username ? req->username : "");
+    else if (req->verify_callback)
+        req->verify_callback (req->authenticated, req->verifier,
+                req->user_data);
+    else
+        req->callback (req->authenticated, req->user_data);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+_auth_request_dispatch (TlmAuthRequest *req)
+{
+    GSource *source = g_idle_source_new ();
+
+    g_source_set_callback (source, _auth_request_complete, req,
+            (GDestroyNotify)_auth_request_free);
+    g_source_attach (source, req->context);
+    g_source_unref (source);
+}
+
+static void
+_auth_worker (gpointer data, gpointer user_data)
+{
+    TlmAuthRequest *req = (TlmAuthRequest *)data;
+
+    if (g_cancellable_is_cancelled (req->cancellable)) {
+        /* result is not delivered */
+    } else if (req->salt) {
+        req->verifier = _derive_verifier (req->salt, req->password);
+        if (!req->service) {
+            req->authenticated = TRUE;
+        } else if (tlm_utils_secret_equal (req->verifier, req->expected)) {
+            /* same password as before, the account may have changed */
+            req->authenticated = _check_user_account (req->service,
+                    req->username);
+            g_clear_string (&req->verifier);
+        } else {
+            req->authenticated = _authenticate_user (req->service,
+                    req->username, req->password);
+            if (!req->authenticated)
+                g_clear_string (&req->verifier);
+        }
+    } else {
+        req->authenticated = _authenticate_user (req->service,
+                req->username, req->password);
+    }
+
+    _auth_request_dispatch (req);
+}
+
+static void
+_auth_request_push (
+    TlmConfig *config,
+    TlmAuthRequest *req)
+{
+    GError *error = NULL;
+
+    if (!_auth_pool) {
+        gint max_threads = (gint) tlm_config_get_uint (config,
+                TLM_CONFIG_GENERAL, TLM_CONFIG_GENERAL_AUTH_WORKERS, 2);
+        _auth_pool = g_thread_pool_new (_auth_worker, NULL,
+                max_threads > 0 ? max_threads : 1, FALSE, &error);
+        if (!_auth_pool) {
+            WARN ("failed to create authentication pool: %s",
+                    error ? error->message : "");
+            g_clear_error (&error);
+            _auth_worker (req, NULL);
+            return;
+        }
+    }
+
+    g_thread_pool_push (_auth_pool, req, NULL);
+}
+
+static TlmAuthRequest *
+_auth_request_new (
+    GCancellable *cancellable,
+    TlmAuthenticateCb callback,
+    gpointer user_data,
+    GDestroyNotify destroy)
+{
+    TlmAuthRequest *req = g_slice_new0 (TlmAuthRequest);
+
+    req->context = g_main_context_ref_thread_default ();
+    req->cancellable = cancellable ? g_object_ref (cancellable) : NULL;
+    req->callback = callback;
+    req->user_data = user_data;
+    req->destroy = destroy;
+    return req;
+}
+
+/**
+ * tlm_authenticate_user_async:
+ * @config: configuration used to pick the PAM service
+ * @username: user to authenticate
+ * @password: password of the user
+ * @cancellable: (allow-none): cancels the delivery of the result
+ * @callback: called with the result in the thread-default main context of
+ * the caller, unless @cancellable has been cancelled
+ * @user_data: data passed to @callback
+ * @destroy: (allow-none): frees @user_data once the request is done
+ *
+ * Same as tlm_authenticate_user(), but runs the PAM conversation on a
+ * bounded pool of worker threads (see #TLM_CONFIG_GENERAL_AUTH_WORKERS).
+ */
+void
+tlm_authenticate_user_async (
+    TlmConfig *config,
+    const gchar *username,
+    const gchar *password,
+    GCancellable *cancellable,
+    TlmAuthenticateCb callback,
+    gpointer user_data,
+    GDestroyNotify destroy)
+{
+    TlmAuthRequest *req = NULL;
+
+    g_return_if_fail (callback);
+
+    req = _auth_request_new (cancellable, callback, user_data, destroy);
+
+    if (!password || !username) {
+        WARN("username or password would be NULL");
+        _auth_request_dispatch (req);
+        return;
+    }
+
+    /* config is not thread safe, resolve everything here */
+    req->service = g_strdup (_get_authentication_service (config));
+    req->username = g_strdup (username);
+    req->password = g_strdup (password);
+
+    _auth_request_push (config, req);
+}
+
+/**
+ * tlm_verify_user_async:
+ * @config: configuration used to pick the PAM service
+ * @username: user to authenticate
+ * @password: password of the user
+ * @salt: salt of the verifiers
+ * @expected: (allow-none): verifier of the password @username was last
+ * authenticated with
+ * @cancellable: (allow-none): cancels the delivery of the result
+ * @callback: called with the result in the thread-default main context of
+ * the caller, unless @cancellable has been cancelled
+ * @user_data: data passed to @callback
+ * @destroy: (allow-none): frees @user_data once the request is done
+ *
+ * Like tlm_authenticate_user_async(), but a @password that matches
+ * @expected only gets the PAM account management, which rejects locked and
+ * expired accounts. The verifiers are derived with a deliberately slow key
+ * derivation function, on the same pool of worker threads.
+ *
+ * On success @callback gets the verifier of @password if it was
+ * authenticated with PAM, or NULL if @expected matched.
+ */
+void
+tlm_verify_user_async (
+    TlmConfig *config,
+    const gchar *username,
+    const gchar *password,
+    const gchar *salt,
+    const gchar *expected,
+    GCancellable *cancellable,
+    TlmVerifyCb callback,
+    gpointer user_data,
+    GDestroyNotify destroy)
+{
+    TlmAuthRequest *req = NULL;
+
+    g_return_if_fail (callback && salt);
+
+    req = _auth_request_new (cancellable, NULL, user_data, destroy);
+    req->verify_callback = callback;
+
+    if (!password || !username) {
+        WARN("username or password would be NULL");
+        _auth_request_dispatch (req);
+        return;
+    }
+
+    req->service = g_strdup (_get_authentication_service (config));
+    req->username = g_strdup (username);
+    req->password = g_strdup (password);
+    req->salt = g_strdup (salt);
+    req->expected = g_strdup (expected);
+
+    _auth_request_push (config, req);
+}
+
+/**
+ * tlm_derive_verifier_async:
+ * @config: configuration used to size the worker pool
+ * @password: the password
+ * @salt: salt of the verifiers
+ * @cancellable: (allow-none): cancels the delivery of the result
+ * @callback: called with the verifier in the thread-default main context of
+ * the caller, unless @cancellable has been cancelled
+ * @user_data: data passed to @callback
+ * @destroy: (allow-none): frees @user_data once the request is done
+ *
+ * Derives the verifier tlm_verify_user_async() compares with, for a
+ * password that is authenticated elsewhere.
+ */
+void
+tlm_derive_verifier_async (
+    TlmConfig *config,
+    const gchar *password,
+    const gchar *salt,
+    GCancellable *cancellable,
+    TlmVerifyCb callback,
+    gpointer user_data,
+    GDestroyNotify destroy)
+{
+    TlmAuthRequest *req = NULL;
+
+    g_return_if_fail (callback && password && salt);
+
+    req = _auth_request_new (cancellable, NULL, user_data, destroy);
+    req->verify_callback = callback;
+    req->password = g_strdup (password);
+    req->salt = g_strdup (salt);
+
+    _auth_request_push (config, req);
+}
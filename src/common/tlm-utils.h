@@ -29,6 +29,7 @@
 
 #include <sys/types.h>
 #include <glib.h>
+#include <gio/gio.h>
 
 #include "tlm-config.h"
 
@@ -40,20 +41,17 @@ g_clear_string (gchar **);
 const gchar *
 tlm_user_get_name (uid_t user_id);
 
-uid_t
-tlm_user_get_uid (const gchar *username);
-
-gid_t
-tlm_user_get_gid (const gchar *username);
+gboolean
+tlm_utils_delete_dir (const gchar *dir);
 
-const gchar *
-tlm_user_get_home_dir (const gchar *username);
+gboolean
+tlm_utils_trash_dir (const gchar *dir);
 
-const gchar *
-tlm_user_get_shell (const gchar *username);
+gboolean
+tlm_utils_secret_equal (const gchar *secret, const gchar *expected);
 
 gboolean
-tlm_utils_delete_dir (const gchar *dir);
+tlm_utils_sd_notify (const gchar *state);
 
 void
 tlm_utils_log_utmp_entry (const gchar *username);
@@ -72,6 +70,31 @@ tlm_utils_watch_for_files (const gchar **watch_list, WatchCb cb, gpointer userda
 gboolean
 tlm_authenticate_user (TlmConfig *config, const gchar *username, const gchar *password);
 
+const gchar *
+tlm_authenticate_user_get_service (TlmConfig *config);
+
+typedef void (*TlmAuthenticateCb) (gboolean authenticated, gpointer userdata);
+
+void
+tlm_authenticate_user_async (TlmConfig *config, const gchar *username,
+        const gchar *password, GCancellable *cancellable,
+        TlmAuthenticateCb callback, gpointer userdata,
+        GDestroyNotify destroy);
+
+typedef void (*TlmVerifyCb) (gboolean authenticated, const gchar *verifier,
+        gpointer userdata);
+
+void
+tlm_verify_user_async (TlmConfig *config, const gchar *username,
+        const gchar *password, const gchar *salt, const gchar *expected,
+        GCancellable *cancellable, TlmVerifyCb callback, gpointer userdata,
+        GDestroyNotify destroy);
+
+void
+tlm_derive_verifier_async (TlmConfig *config, const gchar *password,
+        const gchar *salt, GCancellable *cancellable, TlmVerifyCb callback,
+        gpointer userdata, GDestroyNotify destroy);
+
 G_END_DECLS
 
 #endif /* _TLM_UTILS_H */
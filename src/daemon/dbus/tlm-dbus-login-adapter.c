@@ -59,6 +59,8 @@ enum {
     SIG_LOGOUT_USER,
     SIG_SWITCH_USER,
     SIG_GET_SESSION_INFO,
+    SIG_ADD_SEAT,
+    SIG_REMOVE_SEAT,
 
     SIG_MAX
 };
@@ -248,6 +250,33 @@ tlm_dbus_login_adapter_class_init (
             2,
             G_TYPE_STRING,
             G_TYPE_DBUS_METHOD_INVOCATION);
+
+    signals[SIG_ADD_SEAT] = g_signal_new ("add-seat",
+            TLM_TYPE_LOGIN_ADAPTER,
+            G_SIGNAL_RUN_LAST,
+            0,
+            NULL,
+            NULL,
+            NULL,
+            G_TYPE_NONE,
+            4,
+            G_TYPE_STRING,
+            G_TYPE_VARIANT,
+            G_TYPE_BOOLEAN,
+            G_TYPE_DBUS_METHOD_INVOCATION);
+
+    signals[SIG_REMOVE_SEAT] = g_signal_new ("remove-seat",
+            TLM_TYPE_LOGIN_ADAPTER,
+            G_SIGNAL_RUN_LAST,
+            0,
+            NULL,
+            NULL,
+            NULL,
+            G_TYPE_NONE,
+            3,
+            G_TYPE_STRING,
+            G_TYPE_BOOLEAN,
+            G_TYPE_DBUS_METHOD_INVOCATION);
 }
 
 static void
@@ -373,6 +402,63 @@ _handle_get_session_info (
     return TRUE;
 }
 
+static gboolean
+_handle_add_seat (
+        TlmDbusLoginAdapter *self,
+        GDBusMethodInvocation *invocation,
+        const gchar *seat_id,
+        const GVariant *config,
+        gboolean persist,
+        gpointer emitter)
+{
+    GError *error = NULL;
+
+    g_return_val_if_fail (self && TLM_IS_DBUS_LOGIN_ADAPTER(self),
+            FALSE);
+
+    if (!seat_id || !seat_id[0]) {
+        error = TLM_GET_ERROR_FOR_ID (TLM_ERROR_INVALID_INPUT,
+                "Invalid input");
+        g_dbus_method_invocation_return_gerror (invocation, error);
+        g_error_free (error);
+        return TRUE;
+    }
+    DBG ("seat_id %s persist %d", seat_id, persist);
+
+    g_signal_emit (self, signals[SIG_ADD_SEAT], 0, seat_id, config, persist,
+            invocation);
+
+    return TRUE;
+}
+
+static gboolean
+_handle_remove_seat (
+        TlmDbusLoginAdapter *self,
+        GDBusMethodInvocation *invocation,
+        const gchar *seat_id,
+        gboolean persist,
+        gpointer emitter)
+{
+    GError *error = NULL;
+
+    g_return_val_if_fail (self && TLM_IS_DBUS_LOGIN_ADAPTER(self),
+            FALSE);
+
+    if (!seat_id || !seat_id[0]) {
+        error = TLM_GET_ERROR_FOR_ID (TLM_ERROR_INVALID_INPUT,
+                "Invalid input");
+        g_dbus_method_invocation_return_gerror (invocation, error);
+        g_error_free (error);
+        return TRUE;
+    }
+    DBG ("seat_id %s persist %d", seat_id, persist);
+
+    g_signal_emit (self, signals[SIG_REMOVE_SEAT], 0, seat_id, persist,
+            invocation);
+
+    return TRUE;
+}
+
 TlmDbusLoginAdapter *
 tlm_dbus_login_adapter_new_with_connection (
         GDBusConnection *bus_connection)
@@ -401,6 +487,10 @@ tlm_dbus_login_adapter_new_with_connection (
         "handle-switch-user", G_CALLBACK(_handle_switch_user), adapter);
     g_signal_connect_swapped (adapter->priv->dbus_obj,
         "handle-get-session-info", G_CALLBACK(_handle_get_session_info), adapter);
+    g_signal_connect_swapped (adapter->priv->dbus_obj,
+        "handle-add-seat", G_CALLBACK(_handle_add_seat), adapter);
+    g_signal_connect_swapped (adapter->priv->dbus_obj,
+        "handle-remove-seat", G_CALLBACK(_handle_remove_seat), adapter);
 
     return adapter;
 }
@@ -438,5 +528,13 @@ tlm_dbus_login_adapter_request_completed (
         tlm_dbus_login_complete_get_session_info (adapter->priv->dbus_obj,
                 request->invocation, response->sessioninfo);
         break;
+    case TLM_DBUS_REQUEST_TYPE_ADD_SEAT:
+        tlm_dbus_login_complete_add_seat (adapter->priv->dbus_obj,
+                request->invocation);
+        break;
+    case TLM_DBUS_REQUEST_TYPE_REMOVE_SEAT:
+        tlm_dbus_login_complete_remove_seat (adapter->priv->dbus_obj,
+                request->invocation);
+        break;
     }
 }
@@ -0,0 +1,512 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of tlm (Tiny Login Manager)
+ *
+ * Copyright (C) 2014 Intel Corporation.
+ *
+ * Contact: Jussi Laako <jussi.laako@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#include "config.h"
+#include "tlm-account-pool.h"
+#include "tlm-log.h"
+
+/**
+ * SECTION:tlm-account-pool
+ * @short_description: pre-provisioned guest accounts
+ * @include: tlm-account-pool.h
+ *
+ * #TlmAccountPool keeps guest accounts ready for the default user logins,
+ * so a login does not wait for the account plugin. The accounts of a base
+ * name, the default user name of the seats, are named "base-1" to
+ * "base-N" and are all provisioned in the background when the base name
+ * is added. A seat leases a ready account at login and releases it at
+ * logout; used accounts are recycled in the background once fewer than
+ * the low-water mark of their base name are ready, with at most the
+ * configured number of plugin jobs running at a time.
+ */
+
+G_DEFINE_TYPE (TlmAccountPool, tlm_account_pool, G_TYPE_OBJECT);
+
+#define TLM_ACCOUNT_POOL_PRIV(obj) G_TYPE_INSTANCE_GET_PRIVATE ((obj), \
+            TLM_TYPE_ACCOUNT_POOL, TlmAccountPoolPrivate)
+
+typedef enum {
+    POOL_ACCOUNT_NEW,       /* not provisioned yet */
+    POOL_ACCOUNT_READY,     /* fresh, can be leased */
+    POOL_ACCOUNT_LEASED,
+    POOL_ACCOUNT_USED       /* released, not recycled yet */
+} PoolAccountState;
+
+typedef struct _PoolAccount
+{
+    gchar *name;
+    GPtrArray *group; /* the accounts of the same base name */
+    PoolAccountState state;
+    gboolean queued;
+    gboolean busy; /* plugin job running */
+} PoolAccount;
+
+typedef struct _PoolJob
+{
+    TlmAccountPool *pool;
+    PoolAccount *account;
+} PoolJob;
+
+struct _TlmAccountPoolPrivate
+{
+    TlmAccountPlugin *plugin;
+    guint size;
+    guint low_water;
+    guint max_jobs;
+    GHashTable *bases; /* { gchar*:GPtrArray* of PoolAccount* } */
+    GHashTable *accounts; /* { gchar*:PoolAccount* } */
+    GQueue *work; /* PoolAccount's waiting for a job */
+    guint running;
+    guint pump_id;
+};
+
+static void
+_start_job (TlmAccountPool *self, PoolAccount *account);
+
+static void
+_account_free (PoolAccount *account)
+{
+    g_free (account->name);
+    g_slice_free (PoolAccount, account);
+}
+
+static gboolean
+_pump (gpointer user_data)
+{
+    TlmAccountPool *self = TLM_ACCOUNT_POOL (user_data);
+    TlmAccountPoolPrivate *priv = self->priv;
+    PoolAccount *account = NULL;
+
+    priv->pump_id = 0;
+    if (!priv->plugin) {
+        WARN ("no account plugin for the pool");
+        return G_SOURCE_REMOVE;
+    }
+
+    while (priv->running < priv->max_jobs &&
+           (account = g_queue_pop_head (priv->work))) {
+        account->queued = FALSE;
+        /* claimed while it was waiting */
+        if (account->state == POOL_ACCOUNT_LEASED)
+            continue;
+        _start_job (self, account);
+    }
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+_schedule_pump (TlmAccountPool *self)
+{
+    if (self->priv->pump_id || g_queue_is_empty (self->priv->work))
+        return;
+    self->priv->pump_id = g_idle_add_full (G_PRIORITY_LOW, _pump, self, NULL);
+}
+
+static void
+_queue_account (TlmAccountPool *self, PoolAccount *account)
+{
+    if (account->queued || account->busy)
+        return;
+    account->queued = TRUE;
+    g_queue_push_tail (self->priv->work, account);
+}
+
+/* recycles used accounts of the group while fewer than low-water are, or
+ * are about to be, ready */
+static void
+_refill (TlmAccountPool *self, GPtrArray *group)
+{
+    guint i, ready = 0;
+
+    for (i = 0; i < group->len; i++) {
+        PoolAccount *account = g_ptr_array_index (group, i);
+        if (account->state == POOL_ACCOUNT_READY || account->queued ||
+            account->busy)
+            ready++;
+    }
+
+    for (i = 0; i < group->len && ready < self->priv->low_water; i++) {
+        PoolAccount *account = g_ptr_array_index (group, i);
+        if (account->state == POOL_ACCOUNT_READY ||
+            account->state == POOL_ACCOUNT_LEASED ||
+            account->queued || account->busy)
+            continue;
+        _queue_account (self, account);
+        ready++;
+    }
+    _schedule_pump (self);
+}
+
+static void
+_job_done (PoolJob *job, gboolean res, GError *error)
+{
+    TlmAccountPool *self = job->pool;
+    PoolAccount *account = job->account;
+
+    account->busy = FALSE;
+    self->priv->running--;
+    if (res) {
+        DBG ("pool account '%s' ready", account->name);
+        account->state = POOL_ACCOUNT_READY;
+    } else {
+        /* tried again on the next refill */
+        WARN ("failed to prepare pool account '%s' : %s", account->name,
+              error ? error->message : "");
+    }
+    if (error)
+        g_error_free (error);
+
+    _schedule_pump (self);
+    g_object_unref (self);
+    g_slice_free (PoolJob, job);
+}
+
+static void
+_on_account_cleaned_up (
+        GObject *source,
+        GAsyncResult *result,
+        gpointer user_data)
+{
+    GError *error = NULL;
+    gboolean res = tlm_account_plugin_cleanup_guest_user_finish (
+            TLM_ACCOUNT_PLUGIN (source), result, &error);
+
+    _job_done ((PoolJob *) user_data, res, error);
+}
+
+static void
+_on_account_set_up (
+        GObject *source,
+        GAsyncResult *result,
+        gpointer user_data)
+{
+    GError *error = NULL;
+    gboolean res = tlm_account_plugin_setup_guest_user_account_finish (
+            TLM_ACCOUNT_PLUGIN (source), result, &error);
+
+    _job_done ((PoolJob *) user_data, res, error);
+}
+
+static void
+_on_account_checked (
+        GObject *source,
+        GAsyncResult *result,
+        gpointer user_data)
+{
+    PoolJob *job = (PoolJob *) user_data;
+    TlmAccountPlugin *plugin = TLM_ACCOUNT_PLUGIN (source);
+
+    /* left over from an earlier run */
+    if (tlm_account_plugin_is_valid_user_finish (plugin, result, NULL))
+        tlm_account_plugin_cleanup_guest_user_async (plugin,
+                job->account->name, FALSE, NULL, _on_account_cleaned_up, job);
+    else
+        tlm_account_plugin_setup_guest_user_account_async (plugin,
+                job->account->name, NULL, _on_account_set_up, job);
+}
+
+static void
+_start_job (TlmAccountPool *self, PoolAccount *account)
+{
+    PoolJob *job = g_slice_new0 (PoolJob);
+
+    job->pool = g_object_ref (self);
+    job->account = account;
+    account->busy = TRUE;
+    self->priv->running++;
+
+    if (account->state == POOL_ACCOUNT_NEW) {
+        DBG ("provisioning pool account '%s'", account->name);
+        tlm_account_plugin_is_valid_user_async (self->priv->plugin,
+                account->name, NULL, _on_account_checked, job);
+    } else {
+        DBG ("recycling pool account '%s'", account->name);
+        tlm_account_plugin_cleanup_guest_user_async (self->priv->plugin,
+                account->name, FALSE, NULL, _on_account_cleaned_up, job);
+    }
+}
+
+static void
+tlm_account_pool_dispose (GObject *object)
+{
+    TlmAccountPool *self = TLM_ACCOUNT_POOL (object);
+
+    if (self->priv->pump_id) {
+        g_source_remove (self->priv->pump_id);
+        self->priv->pump_id = 0;
+    }
+    g_clear_object (&self->priv->plugin);
+
+    G_OBJECT_CLASS (tlm_account_pool_parent_class)->dispose (object);
+}
+
+static void
+tlm_account_pool_finalize (GObject *object)
+{
+    TlmAccountPool *self = TLM_ACCOUNT_POOL (object);
+
+    g_queue_free (self->priv->work);
+    g_hash_table_unref (self->priv->bases);
+    g_hash_table_unref (self->priv->accounts);
+
+    G_OBJECT_CLASS (tlm_account_pool_parent_class)->finalize (object);
+}
+
+static void
+tlm_account_pool_class_init (TlmAccountPoolClass *klass)
+{
+    GObjectClass *g_klass = G_OBJECT_CLASS (klass);
+
+    g_type_class_add_private (klass, sizeof (TlmAccountPoolPrivate));
+
+    g_klass->dispose = tlm_account_pool_dispose;
+    g_klass->finalize = tlm_account_pool_finalize;
+}
+
+static void
+tlm_account_pool_init (TlmAccountPool *self)
+{
+    TlmAccountPoolPrivate *priv = TLM_ACCOUNT_POOL_PRIV (self);
+
+    priv->plugin = NULL;
+    priv->bases = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+            (GDestroyNotify) g_ptr_array_unref);
+    priv->accounts = g_hash_table_new_full (g_str_hash, g_str_equal, NULL,
+            (GDestroyNotify) _account_free);
+    priv->work = g_queue_new ();
+    priv->running = 0;
+    priv->pump_id = 0;
+    self->priv = priv;
+}
+
+/**
+ * tlm_account_pool_new:
+ * @plugin: (transfer none): the account plugin doing the work
+ * @size: number of accounts per base name
+ * @low_water: number of ready accounts per base name below which the used
+ * ones are recycled, @size at most
+ * @max_jobs: number of plugin jobs running at a time
+ *
+ * Returns: (transfer full): a new #TlmAccountPool
+ */
+TlmAccountPool *
+tlm_account_pool_new (
+        TlmAccountPlugin *plugin,
+        guint size,
+        guint low_water,
+        guint max_jobs)
+{
+    TlmAccountPool *self = g_object_new (TLM_TYPE_ACCOUNT_POOL, NULL);
+
+    tlm_account_pool_set_plugin (self, plugin);
+    self->priv->size = size;
+    self->priv->low_water = MIN (low_water, size);
+    self->priv->max_jobs = MAX (max_jobs, 1);
+    DBG ("account pool of %u, low-water %u, %u job(s)", self->priv->size,
+         self->priv->low_water, self->priv->max_jobs);
+
+    return self;
+}
+
+/**
+ * tlm_account_pool_set_plugin:
+ * @self: (transfer none): an instance of #TlmAccountPool
+ * @plugin: (transfer none) (allow-none): the account plugin
+ *
+ * Changes the plugin used for the jobs that are not started yet.
+ */
+void
+tlm_account_pool_set_plugin (
+        TlmAccountPool *self,
+        TlmAccountPlugin *plugin)
+{
+    g_return_if_fail (self && TLM_IS_ACCOUNT_POOL (self));
+
+    g_clear_object (&self->priv->plugin);
+    if (plugin)
+        self->priv->plugin = g_object_ref (plugin);
+    _schedule_pump (self);
+}
+
+/**
+ * tlm_account_pool_add_base:
+ * @self: (transfer none): an instance of #TlmAccountPool
+ * @base_name: the default user name the accounts are named after
+ *
+ * Starts provisioning the accounts of @base_name, unless it is in the pool
+ * already.
+ */
+void
+tlm_account_pool_add_base (
+        TlmAccountPool *self,
+        const gchar *base_name)
+{
+    TlmAccountPoolPrivate *priv = NULL;
+    GPtrArray *group = NULL;
+    guint i;
+
+    g_return_if_fail (self && TLM_IS_ACCOUNT_POOL (self));
+    g_return_if_fail (base_name && base_name[0]);
+    priv = self->priv;
+
+    if (g_hash_table_contains (priv->bases, base_name))
+        return;
+
+    DBG ("adding %u account(s) of '%s' to the pool", priv->size, base_name);
+    group = g_ptr_array_new ();
+    for (i = 1; i <= priv->size; i++) {
+        PoolAccount *account = g_slice_new0 (PoolAccount);
+        account->name = g_strdup_printf ("%s-%u", base_name, i);
+        account->group = group;
+        account->state = POOL_ACCOUNT_NEW;
+        g_ptr_array_add (group, account);
+        g_hash_table_insert (priv->accounts, account->name, account);
+        _queue_account (self, account);
+    }
+    g_hash_table_insert (priv->bases, g_strdup (base_name), group);
+    _schedule_pump (self);
+}
+
+/**
+ * tlm_account_pool_lease:
+ * @self: (transfer none): an instance of #TlmAccountPool
+ * @base_name: the default user name of the seat
+ *
+ * Takes a ready account of @base_name for a login. @base_name is added to
+ * the pool if it is not there yet.
+ *
+ * Returns: (transfer full): the name of the leased account, or NULL if
+ * none is ready
+ */
+gchar *
+tlm_account_pool_lease (
+        TlmAccountPool *self,
+        const gchar *base_name)
+{
+    GPtrArray *group = NULL;
+    guint i;
+
+    g_return_val_if_fail (self && TLM_IS_ACCOUNT_POOL (self), NULL);
+    g_return_val_if_fail (base_name && base_name[0], NULL);
+
+    if (!(group = g_hash_table_lookup (self->priv->bases, base_name))) {
+        tlm_account_pool_add_base (self, base_name);
+        return NULL;
+    }
+
+    for (i = 0; i < group->len; i++) {
+        PoolAccount *account = g_ptr_array_index (group, i);
+        if (account->state == POOL_ACCOUNT_READY) {
+            DBG ("leasing pool account '%s'", account->name);
+            account->state = POOL_ACCOUNT_LEASED;
+            _refill (self, group);
+            return g_strdup (account->name);
+        }
+    }
+
+    DBG ("no pool account of '%s' ready", base_name);
+    _refill (self, group);
+    return NULL;
+}
+
+/**
+ * tlm_account_pool_claim:
+ * @self: (transfer none): an instance of #TlmAccountPool
+ * @user_name: the account name
+ *
+ * Marks an account as leased without preparing it, for a session that is
+ * using it already, like one left running by a previous daemon.
+ *
+ * Returns: whether @user_name was an account of the pool that is now
+ * leased
+ */
+gboolean
+tlm_account_pool_claim (
+        TlmAccountPool *self,
+        const gchar *user_name)
+{
+    PoolAccount *account = NULL;
+
+    g_return_val_if_fail (self && TLM_IS_ACCOUNT_POOL (self), FALSE);
+
+    account = user_name ?
+        g_hash_table_lookup (self->priv->accounts, user_name) : NULL;
+    if (!account || account->busy || account->state == POOL_ACCOUNT_LEASED)
+        return FALSE;
+
+    DBG ("claiming pool account '%s'", account->name);
+    account->state = POOL_ACCOUNT_LEASED;
+    return TRUE;
+}
+
+/**
+ * tlm_account_pool_release:
+ * @self: (transfer none): an instance of #TlmAccountPool
+ * @user_name: the account name
+ *
+ * Returns an account leased with tlm_account_pool_lease() or
+ * tlm_account_pool_claim() after the logout. It is recycled in the
+ * background.
+ *
+ * Returns: whether @user_name was a leased account of the pool
+ */
+gboolean
+tlm_account_pool_release (
+        TlmAccountPool *self,
+        const gchar *user_name)
+{
+    PoolAccount *account = NULL;
+
+    g_return_val_if_fail (self && TLM_IS_ACCOUNT_POOL (self), FALSE);
+
+    account = user_name ?
+        g_hash_table_lookup (self->priv->accounts, user_name) : NULL;
+    if (!account || account->state != POOL_ACCOUNT_LEASED)
+        return FALSE;
+
+    DBG ("releasing pool account '%s'", account->name);
+    account->state = POOL_ACCOUNT_USED;
+    _refill (self, account->group);
+    return TRUE;
+}
+
+/**
+ * tlm_account_pool_has_user:
+ * @self: (transfer none): an instance of #TlmAccountPool
+ * @user_name: the account name
+ *
+ * Returns: whether @user_name is an account of the pool
+ */
+gboolean
+tlm_account_pool_has_user (
+        TlmAccountPool *self,
+        const gchar *user_name)
+{
+    g_return_val_if_fail (self && TLM_IS_ACCOUNT_POOL (self), FALSE);
+
+    return user_name &&
+        g_hash_table_contains (self->priv->accounts, user_name);
+}
@@ -0,0 +1,102 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of tlm (Tiny Login Manager)
+ *
+ * Copyright (C) 2014 Intel Corporation.
+ *
+ * Contact: Jussi Laako <jussi.laako@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#ifndef _TLM_ACCOUNT_POOL_H
+#define _TLM_ACCOUNT_POOL_H
+
+#include <glib-object.h>
+
+#include "tlm-account-plugin.h"
+
+G_BEGIN_DECLS
+
+#define TLM_TYPE_ACCOUNT_POOL       (tlm_account_pool_get_type())
+#define TLM_ACCOUNT_POOL(obj)       (G_TYPE_CHECK_INSTANCE_CAST((obj), \
+            TLM_TYPE_ACCOUNT_POOL, TlmAccountPool))
+#define TLM_IS_ACCOUNT_POOL(obj)    (G_TYPE_CHECK_INSTANCE_TYPE((obj), \
+            TLM_TYPE_ACCOUNT_POOL))
+#define TLM_ACCOUNT_POOL_CLASS(kls) (G_TYPE_CHECK_CLASS_CAST((kls), \
+            TLM_TYPE_ACCOUNT_POOL))
+#define TLM_ACCOUNT_POOL_IS_CLASS(kls)  (G_TYPE_CHECK_CLASS_TYPE((kls), \
+            TLM_TYPE_ACCOUNT_POOL))
+
+typedef struct _TlmAccountPool TlmAccountPool;
+typedef struct _TlmAccountPoolClass TlmAccountPoolClass;
+typedef struct _TlmAccountPoolPrivate TlmAccountPoolPrivate;
+
+struct _TlmAccountPool
+{
+    GObject parent;
+    /* Private */
+    TlmAccountPoolPrivate *priv;
+};
+
+struct _TlmAccountPoolClass
+{
+    GObjectClass parent_class;
+};
+
+GType tlm_account_pool_get_type (void);
+
+TlmAccountPool *
+tlm_account_pool_new (
+        TlmAccountPlugin *plugin,
+        guint size,
+        guint low_water,
+        guint max_jobs);
+
+void
+tlm_account_pool_set_plugin (
+        TlmAccountPool *self,
+        TlmAccountPlugin *plugin);
+
+void
+tlm_account_pool_add_base (
+        TlmAccountPool *self,
+        const gchar *base_name);
+
+gchar *
+tlm_account_pool_lease (
+        TlmAccountPool *self,
+        const gchar *base_name);
+
+gboolean
+tlm_account_pool_claim (
+        TlmAccountPool *self,
+        const gchar *user_name);
+
+gboolean
+tlm_account_pool_release (
+        TlmAccountPool *self,
+        const gchar *user_name);
+
+gboolean
+tlm_account_pool_has_user (
+        TlmAccountPool *self,
+        const gchar *user_name);
+
+G_END_DECLS
+
+#endif /* _TLM_ACCOUNT_POOL_H */
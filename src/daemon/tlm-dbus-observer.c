@@ -120,6 +120,23 @@ _handle_dbus_get_session_info (
         GDBusMethodInvocation *invocation,
         GObject *dbus_adapter);
 
+static void
+_handle_dbus_add_seat (
+        TlmDbusObserver *self,
+        const gchar *seat_id,
+        GVariant *config,
+        gboolean persist,
+        GDBusMethodInvocation *invocation,
+        GObject *dbus_adapter);
+
+static void
+_handle_dbus_remove_seat (
+        TlmDbusObserver *self,
+        const gchar *seat_id,
+        gboolean persist,
+        GDBusMethodInvocation *invocation,
+        GObject *dbus_adapter);
+
 static void
 _disconnect_dbus_adapter (
         TlmDbusObserver *self,
@@ -327,6 +344,12 @@ _connect_dbus_adapter (
         g_signal_connect_swapped (G_OBJECT (adapter),
                 "get-session-info", G_CALLBACK(_handle_dbus_get_session_info),
                 self);
+    if (self->priv->enable_flags & DBUS_OBSERVER_ENABLE_ADD_SEAT)
+        g_signal_connect_swapped (G_OBJECT (adapter),
+                "add-seat", G_CALLBACK(_handle_dbus_add_seat), self);
+    if (self->priv->enable_flags & DBUS_OBSERVER_ENABLE_REMOVE_SEAT)
+        g_signal_connect_swapped (G_OBJECT (adapter),
+                "remove-seat", G_CALLBACK(_handle_dbus_remove_seat), self);
 }
 
 static void
@@ -346,6 +369,12 @@ _disconnect_dbus_adapter (
     if (self->priv->enable_flags & DBUS_OBSERVER_ENABLE_GET_SESSION_INFO)
         g_signal_handlers_disconnect_by_func (G_OBJECT(adapter),
                 _handle_dbus_get_session_info, self);
+    if (self->priv->enable_flags & DBUS_OBSERVER_ENABLE_ADD_SEAT)
+        g_signal_handlers_disconnect_by_func (G_OBJECT(adapter),
+                _handle_dbus_add_seat, self);
+    if (self->priv->enable_flags & DBUS_OBSERVER_ENABLE_REMOVE_SEAT)
+        g_signal_handlers_disconnect_by_func (G_OBJECT(adapter),
+                _handle_dbus_remove_seat, self);
 }
 
 static void
@@ -453,6 +482,10 @@ _is_request_supported (
     case TLM_DBUS_REQUEST_TYPE_GET_SESSION_INFO:
         return (self->priv->enable_flags &
                 DBUS_OBSERVER_ENABLE_GET_SESSION_INFO);
+    case TLM_DBUS_REQUEST_TYPE_ADD_SEAT:
+        return (self->priv->enable_flags & DBUS_OBSERVER_ENABLE_ADD_SEAT);
+    case TLM_DBUS_REQUEST_TYPE_REMOVE_SEAT:
+        return (self->priv->enable_flags & DBUS_OBSERVER_ENABLE_REMOVE_SEAT);
     }
     return FALSE;
 }
@@ -486,6 +519,27 @@ _process_request (
             goto _finished;
         }
 
+        /* seat management is done by the manager right away, the seat
+         * does not exist yet when adding it */
+        if (dbus_req->type == TLM_DBUS_REQUEST_TYPE_ADD_SEAT ||
+            dbus_req->type == TLM_DBUS_REQUEST_TYPE_REMOVE_SEAT) {
+            if (!self->priv->manager) {
+                err = TLM_GET_ERROR_FOR_ID (TLM_ERROR_DBUS_REQ_NOT_SUPPORTED,
+                        "Dbus request not supported");
+                goto _finished;
+            }
+            if (dbus_req->type == TLM_DBUS_REQUEST_TYPE_ADD_SEAT)
+                ret = tlm_manager_add_seat (self->priv->manager,
+                        dbus_req->seat_id, dbus_req->environment,
+                        dbus_req->persist, &err);
+            else
+                ret = tlm_manager_remove_seat (self->priv->manager,
+                        dbus_req->seat_id, dbus_req->persist, &err);
+            if (ret)
+                _complete_request (self, req, NULL, NULL);
+            goto _finished;
+        }
+
         seat = self->priv->seat;
         if (!seat && self->priv->manager) {
             if (dbus_req->seat_id)
@@ -519,7 +573,7 @@ _process_request (
                     dbus_req->password, dbus_req->environment);
             break;
         case TLM_DBUS_REQUEST_TYPE_LOGOUT_USER:
-            ret = tlm_seat_terminate_session (seat);
+            ret = tlm_seat_logout_user (seat);
             break;
         case TLM_DBUS_REQUEST_TYPE_SWITCH_USER:
             ret = tlm_seat_switch_user (seat, NULL, dbus_req->username,
@@ -528,6 +582,8 @@ _process_request (
         case TLM_DBUS_REQUEST_TYPE_GET_SESSION_INFO:
             ret = tlm_seat_get_session_info (seat, dbus_req->sessionid);
             break;
+        default:
+            break;
         }
         if (!ret) {
             _dispose_request (self, self->priv->active_request);
@@ -757,6 +813,47 @@ _handle_dbus_get_session_info (
     _add_request (self, _create_request (self, request, NULL));
 }
 
+static void
+_handle_dbus_add_seat (
+        TlmDbusObserver *self,
+        const gchar *seat_id,
+        GVariant *config,
+        gboolean persist,
+        GDBusMethodInvocation *invocation,
+        GObject *dbus_adapter)
+{
+    TlmDbusRequest *request = NULL;
+
+    DBG ("seat id %s", seat_id);
+    g_return_if_fail (self && TLM_IS_DBUS_OBSERVER(self));
+
+    request = tlm_dbus_utils_create_request (dbus_adapter, invocation,
+            TLM_DBUS_REQUEST_TYPE_ADD_SEAT, seat_id, NULL, NULL, NULL,
+            config);
+    request->persist = persist;
+    _add_request (self, _create_request (self, request, NULL));
+}
+
+static void
+_handle_dbus_remove_seat (
+        TlmDbusObserver *self,
+        const gchar *seat_id,
+        gboolean persist,
+        GDBusMethodInvocation *invocation,
+        GObject *dbus_adapter)
+{
+    TlmDbusRequest *request = NULL;
+
+    DBG ("seat id %s", seat_id);
+    g_return_if_fail (self && TLM_IS_DBUS_OBSERVER(self));
+
+    request = tlm_dbus_utils_create_request (dbus_adapter, invocation,
+            TLM_DBUS_REQUEST_TYPE_REMOVE_SEAT, seat_id, NULL, NULL, NULL,
+            NULL);
+    request->persist = persist;
+    _add_request (self, _create_request (self, request, NULL));
+}
+
 static void
 _stop_dbus_server (TlmDbusObserver *self)
 {
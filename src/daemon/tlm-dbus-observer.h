@@ -63,7 +63,9 @@ typedef enum {
     DBUS_OBSERVER_ENABLE_LOGOUT_USER = 0x02,
     DBUS_OBSERVER_ENABLE_SWITCH_USER = 0x04,
     DBUS_OBSERVER_ENABLE_GET_SESSION_INFO = 0x08,
-    DBUS_OBSERVER_ENABLE_ALL = 0x0F,
+    DBUS_OBSERVER_ENABLE_ADD_SEAT = 0x10,
+    DBUS_OBSERVER_ENABLE_REMOVE_SEAT = 0x20,
+    DBUS_OBSERVER_ENABLE_ALL = 0x3F,
 } DbusObserverEnableFlags;
 
 GType tlm_dbus_observer_get_type(void);
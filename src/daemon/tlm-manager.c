@@ -27,12 +27,17 @@
 #include "tlm-manager.h"
 #include "tlm-seat.h"
 #include "tlm-log.h"
+#include "tlm-error.h"
 #include "tlm-account-plugin.h"
 #include "tlm-auth-plugin.h"
 #include "tlm-config.h"
 #include "tlm-config-general.h"
 #include "tlm-config-seat.h"
+#include "tlm-seat-config.h"
 #include "tlm-dbus-observer.h"
+#include "common/dbus/tlm-dbus.h"
+#include "common/dbus/tlm-dbus-server-p2p.h"
+#include "tlm-plugin-manifest.h"
 #include "tlm-utils.h"
 #include "config.h"
 
@@ -44,6 +49,11 @@
 #include <string.h>
 #include <errno.h>
 #include <limits.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/xattr.h>
 #include <sys/inotify.h>
 
 G_DEFINE_TYPE (TlmManager, tlm_manager, G_TYPE_OBJECT);
@@ -62,17 +72,65 @@ struct _TlmManagerPrivate
     GHashTable *seats; /* { gchar*:TlmSeat* } */
     TlmDbusObserver *dbus_observer; /* dbus observer accessed by root only */
     TlmAccountPlugin *account_plugin;
+    gchar *account_plugin_name;
     GList *auth_plugins;
+    GHashTable *plugin_manifest; /* { gchar*:TlmPluginTypes } */
+    gboolean auth_plugins_loaded; /* also the ones without configuration */
+    guint auth_plugins_id;
     gboolean is_started;
     gchar *initial_user;
 
     guint seat_added_id;
     guint seat_removed_id;
+
+    gint64 stop_time;
+    guint shutdown_timer_id;
+
+    GCancellable *cancellable; /* pending logind calls */
+    gint64 start_time;
+    guint startup_seats; /* seats whose first session is not up yet */
+    gint64 startup_last;
+
+    GQueue *pending_logins; /* TlmSeat's waiting for their initial login,
+                               highest priority first */
+    GList *inflight_logins; /* TlmSeat's (weak) with an initial login
+                               under way */
+    guint login_sched_id;
+
+    GHashTable *seat_changes; /* { gchar*:TlmSeatChange* } net logind seat
+                                 changes not applied yet */
+    guint seat_changes_id;
+    guint seat_events; /* SeatNew/SeatRemoved received */
+    guint seat_events_suppressed; /* ones that did not change any seat */
+
+    GFileMonitor *config_monitor;
+    gchar *config_monitor_path;
+    guint config_reload_id;
+
+    gchar *primary_seat; /* started first in fast boot mode */
+    guint deferred_start_id;
+    gboolean ready_sent; /* READY=1 to the service manager */
+
+    GHashTable *attached_sessions; /* { gchar*:TlmSessionRemote* } sessions
+                                      left running by the previous daemon,
+                                      until their seat is added */
+    GCancellable *attach_cancellable; /* reattaching them */
+    guint pending_attaches;
+    guint attach_timeout_id;
+    gboolean start_pending; /* tlm_manager_start() before they answered */
+    GHashTable *provisioned_seats; /* { gchar*:GHashTable* } configuration
+                                      of the seats added at runtime without
+                                      persisting them */
+    GPtrArray *seat_workers; /* TlmSeatWorker's handed out to the seats */
+    TlmAccountPool *account_pool; /* guest accounts of PREPARE_DEFAULT */
+    guint next_worker;
 };
 
 enum {
     PROP_0,
     PROP_INITIAL_USER,
+    PROP_SEAT_EVENTS,
+    PROP_SEAT_EVENTS_SUPPRESSED,
     N_PROPERTIES
 };
 static GParamSpec *pspecs[N_PROPERTIES];
@@ -93,6 +151,38 @@ typedef struct _TlmSeatWatchClosure
     gchar *seat_path;
 } TlmSeatWatchClosure;
 
+/* guest account work done on the seat's worker, or asynchronously in the
+ * main loop when the seat has none */
+typedef struct _TlmGuestUserJob
+{
+    TlmAccountPlugin *plugin;
+    gchar *user_name;
+    gboolean setup; /* FALSE to clean up after the logout */
+    TlmSeat *seat; /* weak, set for the asynchronous jobs */
+} TlmGuestUserJob;
+
+typedef struct _TlmSeatChange
+{
+    gboolean added; /* last state reported by logind */
+    gchar *seat_path;
+    guint events; /* events folded into this change */
+} TlmSeatChange;
+
+static void
+_clear_seat_changes (TlmManager *manager);
+
+static void
+_clear_login_scheduler (TlmManager *manager);
+
+static void
+_clear_config_monitor (TlmManager *manager);
+
+static void
+_update_config_monitor (TlmManager *manager);
+
+static void
+_detach_sessions (TlmManager *manager);
+
 static void
 _unref_auth_plugins (gpointer data)
 {
@@ -113,23 +203,83 @@ tlm_manager_dispose (GObject *self)
         manager->priv->dbus_observer = NULL;
     }
 
+    if (manager->priv->cancellable) {
+        g_cancellable_cancel (manager->priv->cancellable);
+        g_clear_object (&manager->priv->cancellable);
+    }
+
     if (manager->priv->is_started) {
         tlm_manager_stop (manager);
     }
 
+    if (manager->priv->attach_timeout_id) {
+        g_source_remove (manager->priv->attach_timeout_id);
+        manager->priv->attach_timeout_id = 0;
+    }
+    if (manager->priv->attach_cancellable) {
+        g_cancellable_cancel (manager->priv->attach_cancellable);
+        g_clear_object (&manager->priv->attach_cancellable);
+    }
+    manager->priv->pending_attaches = 0;
+    manager->priv->start_pending = FALSE;
+
+    _clear_login_scheduler (manager);
+    _clear_seat_changes (manager);
+    _clear_config_monitor (manager);
+    if (manager->priv->deferred_start_id) {
+        g_source_remove (manager->priv->deferred_start_id);
+        manager->priv->deferred_start_id = 0;
+    }
+    if (manager->priv->seat_changes) {
+        g_hash_table_unref (manager->priv->seat_changes);
+        manager->priv->seat_changes = NULL;
+    }
+    if (manager->priv->pending_logins) {
+        g_queue_free (manager->priv->pending_logins);
+        manager->priv->pending_logins = NULL;
+    }
+
+    if (manager->priv->shutdown_timer_id) {
+        g_source_remove (manager->priv->shutdown_timer_id);
+        manager->priv->shutdown_timer_id = 0;
+    }
+
     if (manager->priv->seats) {
         g_hash_table_unref (manager->priv->seats);
         manager->priv->seats = NULL;
     }
+    _detach_sessions (manager);
+    if (manager->priv->provisioned_seats) {
+        g_hash_table_unref (manager->priv->provisioned_seats);
+        manager->priv->provisioned_seats = NULL;
+    }
+    if (manager->priv->seat_workers) {
+        /* waits for the account work under way */
+        g_ptr_array_unref (manager->priv->seat_workers);
+        manager->priv->seat_workers = NULL;
+    }
+    g_clear_object (&manager->priv->account_pool);
 
     g_clear_object (&manager->priv->account_plugin);
+    g_clear_string (&manager->priv->account_plugin_name);
     g_clear_object (&manager->priv->config);
+    g_clear_object (&manager->priv->connection);
 
+    if (manager->priv->auth_plugins_id) {
+        g_source_remove (manager->priv->auth_plugins_id);
+        manager->priv->auth_plugins_id = 0;
+    }
     if (manager->priv->auth_plugins) {
     	g_list_free_full(manager->priv->auth_plugins, _unref_auth_plugins);
+    	manager->priv->auth_plugins = NULL;
+    }
+    if (manager->priv->plugin_manifest) {
+        g_hash_table_unref (manager->priv->plugin_manifest);
+        manager->priv->plugin_manifest = NULL;
     }
 
     g_clear_string (&manager->priv->initial_user);
+    g_clear_string (&manager->priv->primary_seat);
 
     G_OBJECT_CLASS (tlm_manager_parent_class)->dispose (self);
 }
@@ -169,6 +319,12 @@ _manager_get_property (GObject *obj,
         case PROP_INITIAL_USER:
             g_value_set_string (value, manager->priv->initial_user);
             break;
+        case PROP_SEAT_EVENTS:
+            g_value_set_uint (value, manager->priv->seat_events);
+            break;
+        case PROP_SEAT_EVENTS_SUPPRESSED:
+            g_value_set_uint (value, manager->priv->seat_events_suppressed);
+            break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID (obj, property_id, pspec);
     }
@@ -207,6 +363,18 @@ tlm_manager_class_init (TlmManagerClass *klass)
                              "User name for initial auto-login",
                              NULL,
                              G_PARAM_READWRITE|G_PARAM_CONSTRUCT_ONLY|G_PARAM_STATIC_STRINGS);
+    pspecs[PROP_SEAT_EVENTS] =
+        g_param_spec_uint ("seat-events",
+                           "seat events",
+                           "Number of seat added/removed events from logind",
+                           0, G_MAXUINT, 0,
+                           G_PARAM_READABLE|G_PARAM_STATIC_STRINGS);
+    pspecs[PROP_SEAT_EVENTS_SUPPRESSED] =
+        g_param_spec_uint ("seat-events-suppressed",
+                           "suppressed seat events",
+                           "Number of seat events that were coalesced away",
+                           0, G_MAXUINT, 0,
+                           G_PARAM_READABLE|G_PARAM_STATIC_STRINGS);
     g_object_class_install_properties (g_klass, N_PROPERTIES, pspecs);
 
     signals[SIG_SEAT_ADDED] =  g_signal_new ("seat-added",
@@ -337,315 +505,1259 @@ _load_accounts_plugin (TlmManager *self, const gchar *name)
 
     self->priv->account_plugin =  TLM_ACCOUNT_PLUGIN(
         _load_plugin_file (plugin_file, name, "account", accounts_config));
+    g_free (self->priv->account_plugin_name);
+    self->priv->account_plugin_name = g_strdup (name);
 
     g_free (plugin_file);
 }
 
 static void
-_load_auth_plugins (TlmManager *self)
+_load_configured_accounts_plugin (TlmManager *self)
 {
+    _load_accounts_plugin (self,
+                           tlm_config_get_string_default (self->priv->config,
+                                                          TLM_CONFIG_GENERAL,
+                                                          TLM_CONFIG_GENERAL_ACCOUNTS_PLUGIN,
+                                                          "default"));
+}
+
+static GObject *
+_load_auth_plugin (TlmManager *self, const gchar *plugin_file_path,
+                   const gchar *plugin_name)
+{
+    GHashTable *plugin_config = NULL;
+    GObject    *plugin = NULL;
+
+    DBG ("loading auth plugin '%s'", plugin_name);
+
+    plugin_config = tlm_config_get_group (self->priv->config, plugin_name);
+
+    plugin = _load_plugin_file (plugin_file_path,
+                                plugin_name,
+                                "auth",
+                                plugin_config);
+    if (plugin) {
+        g_signal_connect (plugin, "authenticate",
+             G_CALLBACK(_manager_authenticate_cb), self);
+        /* to find its configuration group again on reload */
+        g_object_set_data_full (plugin, "tlm-plugin-name",
+                                g_strdup (plugin_name), g_free);
+        g_object_set_data_full (plugin, "tlm-plugin-path",
+                                g_strdup (plugin_file_path), g_free);
+    }
+    return plugin;
+}
+
+static GObject *
+_find_auth_plugin (TlmManager *self, const gchar *plugin_name)
+{
+    GList *elem;
+
+    for (elem = self->priv->auth_plugins; elem; elem = g_list_next (elem)) {
+        if (g_strcmp0 (g_object_get_data (G_OBJECT (elem->data),
+                                          "tlm-plugin-name"),
+                       plugin_name) == 0)
+            return G_OBJECT (elem->data);
+    }
+    return NULL;
+}
+
+/* loads the auth plugins not loaded yet, with configured_only just the ones
+ * having a configuration group */
+static void
+_load_auth_plugins (TlmManager *self, gboolean configured_only)
+{
+    TlmManagerPrivate *priv = self->priv;
     const gchar *plugins_path = NULL;
-    const gchar *plugin_file_name = NULL;
-    GDir  *plugins_dir = NULL;
-    GError *error = NULL;
+    GHashTableIter iter;
+    gpointer key, value;
 
     plugins_path = _get_plugins_path ();
-    
-    DBG("plugins_path : %s", plugins_path);
-    plugins_dir = g_dir_open (plugins_path, 0, &error);
-    if (!plugins_dir) {
-        WARN ("Failed to open pluins folder '%s' : %s", plugins_path,
-                 error ? error->message : "NULL");
-        g_error_free (error);
-        return;
-    }
 
-    while ((plugin_file_name = g_dir_read_name (plugins_dir)) != NULL)
-    {
-        DBG("Plugin File : %s", plugin_file_name);
-        if (g_str_has_prefix (plugin_file_name, "libtlm-plugin-") &&
-            g_str_has_suffix (plugin_file_name, ".so"))
-        {
-            gchar      *plugin_file_path = NULL;
-            gchar      *plugin_name = NULL;
-            GHashTable *plugin_config = NULL;
-            GObject    *plugin = NULL;
-        
-            plugin_file_path = g_module_build_path(plugins_path, 
-                                                   plugin_file_name);
-
-            if (!g_file_test (plugin_file_path, 
-                              G_FILE_TEST_IS_REGULAR && G_FILE_TEST_EXISTS)) {
-                WARN ("Ingnoring plugin : %s", plugin_file_path);
-                g_free (plugin_file_path);
-                continue;
-            }
+    DBG("plugins_path : %s", plugins_path);
+    if (!priv->plugin_manifest)
+        priv->plugin_manifest = tlm_plugin_manifest_load (plugins_path);
 
-            DBG ("loading auth plugin '%s'", plugin_file_name);
- 
-            plugin_name = g_strdup (plugin_file_name + 14); // truncate prefix
-            plugin_name[strlen(plugin_name) - 3] = '\0' ; // truncate suffix
+    g_hash_table_iter_init (&iter, priv->plugin_manifest);
+    while (g_hash_table_iter_next (&iter, &key, &value)) {
+        const gchar *plugin_name = (const gchar *) key;
+        gchar       *plugin_file_path = NULL;
+        GObject     *plugin = NULL;
+
+        if (!(GPOINTER_TO_UINT (value) & TLM_PLUGIN_TYPE_AUTH) ||
+            _find_auth_plugin (self, plugin_name))
+            continue;
+        if (configured_only &&
+            !tlm_config_has_group (priv->config, plugin_name)) {
+            DBG ("deferring auth plugin '%s'", plugin_name);
+            continue;
+        }
 
-            plugin_config = tlm_config_get_group (self->priv->config,
-                                                  plugin_name);
-    
-            plugin = _load_plugin_file (plugin_file_path,
-                                        plugin_name, 
-                                        "auth",
-                                        plugin_config);
-            if (plugin) {
-                g_signal_connect (plugin, "authenticate",
-                     G_CALLBACK(_manager_authenticate_cb), self);
-                self->priv->auth_plugins = g_list_append (
-                            self->priv->auth_plugins, plugin);
-            }
-            g_free (plugin_file_path);
-            g_free (plugin_name);
+        plugin_file_path = tlm_plugin_manifest_build_path (plugins_path,
+                                                           plugin_name);
+        plugin = _load_auth_plugin (self, plugin_file_path, plugin_name);
+        if (plugin) {
+            priv->auth_plugins = g_list_append (priv->auth_plugins, plugin);
         }
+        g_free (plugin_file_path);
     }
 
-    g_dir_close (plugins_dir);
+    if (!configured_only)
+        priv->auth_plugins_loaded = TRUE;
+}
+
+static gboolean
+_load_deferred_auth_plugins (gpointer user_data)
+{
+    TlmManager *manager = TLM_MANAGER (user_data);
 
+    manager->priv->auth_plugins_id = 0;
+    _load_auth_plugins (manager, FALSE);
+
+    return G_SOURCE_REMOVE;
 }
 
+/* the rest of the auth plugins are not needed before the first session */
 static void
-tlm_manager_init (TlmManager *manager)
+_defer_auth_plugins (TlmManager *manager)
 {
-    GError *error = NULL;
-    TlmManagerPrivate *priv = TLM_MANAGER_PRIV (manager);
-    
-    priv->config = tlm_config_new ();
-    priv->connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, &error);
-    if (!priv->connection) {
-        CRITICAL ("error getting system bus: %s", error->message);
-        g_error_free (error);
+    TlmManagerPrivate *priv = manager->priv;
+
+    if (priv->auth_plugins_loaded || priv->auth_plugins_id)
         return;
-    }
+    priv->auth_plugins_id = g_idle_add (_load_deferred_auth_plugins, manager);
+}
 
-    priv->seats = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
-                                         (GDestroyNotify)g_object_unref);
+static void
+_start_account_pool (TlmManager *manager)
+{
+    TlmManagerPrivate *priv = manager->priv;
+    GHashTableIter iter;
+    gpointer seat = NULL;
+    guint size;
 
-    priv->account_plugin = NULL;
-    priv->auth_plugins = NULL;
+    if (priv->account_pool || !priv->account_plugin ||
+        !tlm_config_get_boolean (priv->config, TLM_CONFIG_GENERAL,
+                                 TLM_CONFIG_GENERAL_PREPARE_DEFAULT, FALSE))
+        return;
+    size = tlm_config_get_uint (priv->config, TLM_CONFIG_GENERAL,
+                                TLM_CONFIG_GENERAL_GUEST_POOL_SIZE, 0);
+    if (!size)
+        return;
 
-    manager->priv = priv;
+    priv->account_pool = tlm_account_pool_new (priv->account_plugin, size,
+            tlm_config_get_uint (priv->config, TLM_CONFIG_GENERAL,
+                                 TLM_CONFIG_GENERAL_GUEST_POOL_LOW_WATER,
+                                 size),
+            tlm_config_get_uint (priv->config, TLM_CONFIG_GENERAL,
+                                 TLM_CONFIG_GENERAL_GUEST_POOL_JOBS, 1));
+
+    /* the primary seat of the fast boot mode is there already */
+    g_hash_table_iter_init (&iter, priv->seats);
+    while (g_hash_table_iter_next (&iter, NULL, &seat))
+        tlm_seat_set_account_pool (TLM_SEAT (seat), priv->account_pool);
+}
 
-    _load_accounts_plugin (manager,
-                           tlm_config_get_string_default (priv->config,
-                                                          TLM_CONFIG_GENERAL,
-                                                          TLM_CONFIG_GENERAL_ACCOUNTS_PLUGIN,
-                                                          "default"));
-    _load_auth_plugins (manager);
+/* the pieces not needed for the first session */
+static void
+_start_services (TlmManager *manager)
+{
+    TlmManagerPrivate *priv = manager->priv;
+
+    if (!priv->account_plugin_name)
+        _load_configured_accounts_plugin (manager);
+    _start_account_pool (manager);
+    _load_auth_plugins (manager, TRUE);
 
-    /* delete tlm runtime directory */
-    tlm_utils_delete_dir (TLM_DBUS_SOCKET_PATH);
     priv->dbus_observer = TLM_DBUS_OBSERVER (tlm_dbus_observer_new (manager,
             NULL, TLM_DBUS_ROOT_SOCKET_ADDRESS, getuid (),
             DBUS_OBSERVER_ENABLE_ALL));
 }
 
-static void
-_prepare_user_login_cb (TlmSeat *seat, const gchar *user_name, gpointer user_data)
+static gchar *
+_get_primary_seat (TlmManagerPrivate *priv)
 {
-    TlmManager *manager = TLM_MANAGER(user_data);
+    const gchar *seat_id = NULL;
 
-    g_return_if_fail (user_data && TLM_IS_MANAGER(manager));
+    if (!tlm_config_get_boolean (priv->config, TLM_CONFIG_GENERAL,
+                                 TLM_CONFIG_GENERAL_FAST_BOOT, FALSE))
+        return NULL;
 
-    if (tlm_config_get_boolean (manager->priv->config,
-                                TLM_CONFIG_GENERAL,
-                                TLM_CONFIG_GENERAL_PREPARE_DEFAULT,
-                                FALSE)) {
-        DBG ("prepare for login for '%s'", user_name);
-        if (!tlm_manager_setup_guest_user (manager, user_name)) {
-            WARN ("failed to prepare for '%s'", user_name);
-        }
-    }
+    seat_id = tlm_config_get_string (priv->config, TLM_CONFIG_GENERAL,
+                                     TLM_CONFIG_GENERAL_PRIMARY_SEAT);
+    if (seat_id && seat_id[0])
+        return g_strdup (seat_id);
+    if (tlm_config_get_uint (priv->config, TLM_CONFIG_GENERAL,
+                             TLM_CONFIG_GENERAL_NSEATS, 0))
+        return g_strdup ("seat0");
+
+    WARN ("fast boot needs %s or %s, ignored",
+          TLM_CONFIG_GENERAL_PRIMARY_SEAT, TLM_CONFIG_GENERAL_NSEATS);
+    return NULL;
 }
 
 static void
-_prepare_user_logout_cb (TlmSeat *seat, const gchar *user_name, gpointer user_data)
+_notify_status (TlmManager *manager, gboolean ready, const gchar *status)
 {
-    TlmManager *manager = TLM_MANAGER(user_data);
-
-    g_return_if_fail (user_data && TLM_IS_MANAGER(manager));
+    TlmManagerPrivate *priv = manager->priv;
+    gchar *state = NULL;
+
+    ready = ready && !priv->ready_sent;
+    state = g_strdup_printf ("%sSTATUS=%s", ready ? "READY=1\n" : "",
+                             status);
+    if (tlm_utils_sd_notify (state) && ready)
+        DBG ("notified ready: %s", status);
+    if (ready)
+        priv->ready_sent = TRUE;
+    g_free (state);
+}
 
-    if (tlm_config_get_boolean (manager->priv->config,
-                                TLM_CONFIG_GENERAL,
-                                TLM_CONFIG_GENERAL_PREPARE_DEFAULT,
-                                FALSE)) {
-        DBG ("prepare for logout for '%s'", user_name);
-        if (!tlm_account_plugin_cleanup_guest_user (
-                manager->priv->account_plugin, user_name, FALSE)) {
-            WARN ("failed to prepare for '%s'", user_name);
-        }
-    }
+static gboolean
+_get_persist_sessions (TlmManagerPrivate *priv)
+{
+    return tlm_config_get_boolean (priv->config, TLM_CONFIG_GENERAL,
+                                   TLM_CONFIG_GENERAL_PERSIST_SESSIONS, FALSE);
 }
 
-static void
-_create_seat (TlmManager *manager,
-              const gchar *seat_id, const gchar *seat_path)
+typedef struct
 {
-    g_return_if_fail (manager && TLM_IS_MANAGER (manager));
+    TlmManager *manager;
+    GCancellable *cancellable;
+    gchar *path;
+} TlmAttachClosure;
 
-    TlmManagerPrivate *priv = TLM_MANAGER_PRIV (manager);
+static void
+_attach_closure_free (TlmAttachClosure *closure)
+{
+    g_object_unref (closure->cancellable);
+    g_free (closure->path);
+    g_slice_free (TlmAttachClosure, closure);
+}
 
-    TlmSeat *seat = tlm_seat_new (priv->config,
-                                  seat_id,
-                                  seat_path);
-    g_signal_connect (seat,
-                      "prepare-user-login",
-                      G_CALLBACK (_prepare_user_login_cb),
-                      manager);
-    g_signal_connect (seat,
-                      "prepare-user-logout",
-                      G_CALLBACK (_prepare_user_logout_cb),
-                      manager);
-    g_hash_table_insert (priv->seats, g_strdup (seat_id), seat);
-    g_signal_emit (manager, signals[SIG_SEAT_ADDED], 0, seat, NULL);
+static void
+_clear_runtime_dir (gboolean keep_sessions);
 
-    if (tlm_config_get_boolean (priv->config,
-                                TLM_CONFIG_GENERAL,
-                                TLM_CONFIG_GENERAL_AUTO_LOGIN,
-                                TRUE) ||
-        priv->initial_user) {
-        DBG("intial auto-login for user '%s'", priv->initial_user);
-        if (!tlm_seat_create_session (seat,
-                                      NULL,
-                                      priv->initial_user,
-                                      NULL,
-                                      NULL))
-            WARN("Failed to create session for default user");
-    }
-}
+static void
+_start (TlmManager *manager);
 
+/* all the sessions answered or the rest were given up on */
 static void
-_seat_watch_cb (
-    const gchar *watch_item,
-    gboolean is_final,
-    GError *error,
-    gpointer user_data)
+_attach_sessions_done (TlmManager *manager)
 {
-    g_return_if_fail (watch_item && user_data);
-
-    TlmSeatWatchClosure *closure = (TlmSeatWatchClosure *) user_data;
+    TlmManagerPrivate *priv = manager->priv;
 
-    if (error) {
-      WARN ("Error in notify %s on seat %s: %s", watch_item, closure->seat_id,
-          error->message);
-      g_error_free (error);
-      return;
+    if (priv->attach_timeout_id) {
+        g_source_remove (priv->attach_timeout_id);
+        priv->attach_timeout_id = 0;
     }
+    g_clear_object (&priv->attach_cancellable);
+    priv->pending_attaches = 0;
 
-    DBG ("seat %s notify for %s", closure->seat_id, watch_item);
+    /* delete tlm runtime directory, before any session puts its socket
+     * there, unless it holds the root socket of the service manager */
+    if (tlm_dbus_server_p2p_get_listen_fd (TLM_DBUS_ROOT_SOCKET_ADDRESS) < 0)
+        _clear_runtime_dir (
+                g_hash_table_size (priv->attached_sessions) > 0);
 
-    if (is_final) {
-        _create_seat (closure->manager, closure->seat_id, closure->seat_path);
-        g_object_unref (closure->manager);
-        g_free (closure->seat_id);
-        g_free (closure->seat_path);
-        g_free (closure);
+    if (!priv->primary_seat)
+        _start_services (manager);
+
+    if (priv->start_pending) {
+        priv->start_pending = FALSE;
+        _start (manager);
     }
 }
 
 static void
-_add_seat (TlmManager *manager, const gchar *seat_id, const gchar *seat_path)
+_attach_finished (TlmManager *manager)
 {
-    g_return_if_fail (manager && TLM_IS_MANAGER (manager));
+    if (--manager->priv->pending_attaches == 0)
+        _attach_sessions_done (manager);
+}
 
-    TlmManagerPrivate *priv = TLM_MANAGER_PRIV (manager);
+static gboolean
+_attach_timeout_cb (gpointer user_data)
+{
+    TlmManager *manager = TLM_MANAGER (user_data);
 
-    if (!tlm_config_get_boolean (priv->config,
-                                 seat_id,
-                                 TLM_CONFIG_SEAT_ACTIVE,
-                                 TRUE))
+    WARN ("%u sessions of the previous daemon did not answer",
+          manager->priv->pending_attaches);
+    manager->priv->attach_timeout_id = 0;
+    g_cancellable_cancel (manager->priv->attach_cancellable);
+    _attach_sessions_done (manager);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+_on_session_attached (
+        GObject *object,
+        GAsyncResult *res,
+        gpointer user_data)
+{
+    TlmAttachClosure *closure = (TlmAttachClosure *) user_data;
+    TlmManager *manager = closure->manager;
+    TlmManagerPrivate *priv = NULL;
+    TlmSessionRemote *session = NULL;
+    GError *error = NULL;
+    gchar *seat_id = NULL;
+
+    session = tlm_session_remote_attach_finish (res, &error);
+    if (g_cancellable_is_cancelled (closure->cancellable)) {
+        /* given up on, or the manager is gone */
+        if (session) g_object_unref (session);
+        g_clear_error (&error);
+        _attach_closure_free (closure);
         return;
+    }
 
-    guint nwatch = tlm_config_get_uint (priv->config,
-                                        seat_id,
-                                        TLM_CONFIG_SEAT_NWATCH,
-                                        0);
-    if (nwatch) {
-        int x;
-        int watch_id = 0;
-        gchar **watch_items = g_new0 (gchar *, nwatch + 1);
-        for (x = 0; x < nwatch; x++) {
-          gchar *watchx = g_strdup_printf ("%s%u", TLM_CONFIG_SEAT_WATCHX, x);
-          watch_items[x] = (char *)tlm_config_get_string (
-              priv->config, seat_id, watchx);
-          g_free (watchx);
-        }
-        watch_items[nwatch] = NULL;
-        TlmSeatWatchClosure *watch_closure = 
-            g_new0 (TlmSeatWatchClosure, 1);
-        watch_closure->manager = g_object_ref (manager);
-        watch_closure->seat_id = g_strdup (seat_id);
-        watch_closure->seat_path = g_strdup (seat_path);
+    priv = manager->priv;
+    if (!session) {
+        DBG ("removing stale session socket %s: %s", closure->path,
+             error ? error->message : "");
+        g_clear_error (&error);
+        g_unlink (closure->path);
+        _attach_closure_free (closure);
+        _attach_finished (manager);
+        return;
+    }
+    _attach_closure_free (closure);
+
+    g_object_get (G_OBJECT (session), "seatid", &seat_id, NULL);
+    if (!_get_persist_sessions (priv) || !seat_id ||
+        g_hash_table_contains (priv->attached_sessions, seat_id)) {
+        INFO ("terminating session %s left on seat %s",
+              tlm_session_remote_get_sessionid (session), seat_id);
+        g_object_unref (session);
+        g_free (seat_id);
+    } else {
+        INFO ("session %s on seat %s survived the restart",
+              tlm_session_remote_get_sessionid (session), seat_id);
+        g_hash_table_insert (priv->attached_sessions, seat_id, session);
+    }
+    _attach_finished (manager);
+}
 
-        watch_id = tlm_utils_watch_for_files (
-            (const gchar **)watch_items, _seat_watch_cb, watch_closure);
-        g_free (watch_items);
-        if (watch_id <= 0) {
-            WARN ("Failed to add watch on seat %s", seat_id);
-        } else {
-            return;
+/* reconnects to the sessions the previous daemon left running, the ones
+ * that are not wanted anymore get terminated, startup continues in
+ * _attach_sessions_done() once they all answered */
+static void
+_attach_sessions (TlmManager *manager)
+{
+    TlmManagerPrivate *priv = manager->priv;
+    GDir *dir = NULL;
+    const gchar *name = NULL;
+    guint timeout = 0;
+
+    /* held until all the attaches are under way */
+    priv->pending_attaches = 1;
+    priv->attach_cancellable = g_cancellable_new ();
+
+    if ((dir = g_dir_open (TLM_SESSIOND_CONTROL_DIR, 0, NULL))) {
+        while ((name = g_dir_read_name (dir)) != NULL) {
+            TlmAttachClosure *closure = g_slice_new0 (TlmAttachClosure);
+            gchar *address = NULL;
+
+            closure->manager = manager;
+            closure->cancellable = g_object_ref (priv->attach_cancellable);
+            closure->path = g_build_filename (TLM_SESSIOND_CONTROL_DIR, name,
+                                              NULL);
+            address = g_strdup_printf ("unix:path=%s", closure->path);
+            priv->pending_attaches++;
+            tlm_session_remote_attach_async (priv->config, address,
+                    priv->attach_cancellable, _on_session_attached, closure);
+            g_free (address);
         }
+        g_dir_close (dir);
     }
 
-    _create_seat (manager, seat_id, seat_path);
+    /* a hung sessiond gets the same time as a new one would */
+    timeout = tlm_config_get_uint (priv->config, TLM_CONFIG_GENERAL,
+                    TLM_CONFIG_GENERAL_SESSIOND_CONNECT_TIMEOUT, 10) +
+              tlm_config_get_uint (priv->config, TLM_CONFIG_GENERAL,
+                    TLM_CONFIG_GENERAL_SESSIOND_PROXY_TIMEOUT, 10);
+    if (priv->pending_attaches > 1 && timeout)
+        priv->attach_timeout_id = g_timeout_add_seconds (timeout,
+                _attach_timeout_cb, manager);
+
+    _attach_finished (manager);
 }
 
+/* the ones whose seat did not come back are left for the next daemon */
 static void
-_manager_hashify_seats (TlmManager *manager, GVariant *hash_map)
+_detach_sessions (TlmManager *manager)
 {
-    GVariantIter iter;
-    gchar *id = 0, *path = 0;
+    GHashTableIter iter;
+    gpointer value;
 
-    g_return_if_fail (manager);
-    g_return_if_fail (hash_map);
+    if (!manager->priv->attached_sessions)
+        return;
 
-    g_variant_iter_init (&iter, hash_map);
-    while (g_variant_iter_next (&iter, "(so)", &id, &path)) {
-        DBG("found seat %s:%s", id, path);
-        _add_seat (manager, id, path);
-        g_free (id);
-        g_free (path);
-    }
+    g_hash_table_iter_init (&iter, manager->priv->attached_sessions);
+    while (g_hash_table_iter_next (&iter, NULL, &value))
+        tlm_session_remote_detach (TLM_SESSION_REMOTE (value));
+    g_hash_table_unref (manager->priv->attached_sessions);
+    manager->priv->attached_sessions = NULL;
 }
 
 static void
-_manager_sync_seats (TlmManager *manager)
+_clear_runtime_dir (gboolean keep_sessions)
 {
-    GError *error = NULL;
-    GVariant *reply = NULL;
-    GVariant *hash_map = NULL;
-
-    g_return_if_fail (manager && manager->priv->connection);
+    GDir *dir = NULL;
+    const gchar *name = NULL;
 
-    reply = g_dbus_connection_call_sync (manager->priv->connection,
-                                         LOGIND_BUS_NAME,
-                                         LOGIND_OBJECT_PATH,
-                                         LOGIND_MANAGER_IFACE,
-                                         "ListSeats",
-                                         g_variant_new("()"),
-                                         G_VARIANT_TYPE_TUPLE,
-                                         G_DBUS_CALL_FLAGS_NONE,
-                                         -1,
-                                         NULL,
-                                         &error);
-    if (!reply) {
-        WARN ("failed to get attached seats: %s", error->message);
-        g_error_free (error);
+    if (!keep_sessions) {
+        tlm_utils_trash_dir (TLM_DBUS_SOCKET_PATH);
         return;
     }
 
-    g_variant_get (reply, "(@a(so))", &hash_map);
-    g_variant_unref (reply);
+    if (!(dir = g_dir_open (TLM_DBUS_SOCKET_PATH, 0, NULL)))
+        return;
+    while ((name = g_dir_read_name (dir)) != NULL) {
+        gchar *path = g_build_filename (TLM_DBUS_SOCKET_PATH, name, NULL);
+        if (g_strcmp0 (path, TLM_SESSIOND_CONTROL_DIR) != 0)
+            tlm_utils_trash_dir (path);
+        g_free (path);
+    }
+    g_dir_close (dir);
+}
 
+static void
+_seat_change_free (TlmSeatChange *change)
+{
+    g_free (change->seat_path);
+    g_free (change);
+}
+
+static void
+tlm_manager_init (TlmManager *manager)
+{
+    GError *error = NULL;
+    TlmManagerPrivate *priv = TLM_MANAGER_PRIV (manager);
+    
+    priv->config = tlm_config_new ();
+    priv->cancellable = g_cancellable_new ();
+    priv->start_time = 0;
+    priv->startup_seats = 0;
+    priv->startup_last = 0;
+    priv->pending_logins = g_queue_new ();
+    priv->inflight_logins = NULL;
+    priv->login_sched_id = 0;
+    priv->seat_changes = g_hash_table_new_full (g_str_hash, g_str_equal,
+            g_free, (GDestroyNotify) _seat_change_free);
+    priv->seat_changes_id = 0;
+    priv->seat_events = 0;
+    priv->seat_events_suppressed = 0;
+    priv->config_monitor = NULL;
+    priv->config_monitor_path = NULL;
+    priv->config_reload_id = 0;
+    priv->deferred_start_id = 0;
+    priv->ready_sent = FALSE;
+    priv->connection = NULL;
+    priv->dbus_observer = NULL;
+
+    priv->seats = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                         (GDestroyNotify)g_object_unref);
+
+    priv->account_plugin = NULL;
+    priv->account_plugin_name = NULL;
+    priv->auth_plugins = NULL;
+    priv->plugin_manifest = NULL;
+    priv->auth_plugins_loaded = FALSE;
+    priv->auth_plugins_id = 0;
+    priv->stop_time = 0;
+    priv->shutdown_timer_id = 0;
+    priv->attached_sessions = g_hash_table_new_full (g_str_hash, g_str_equal,
+            g_free, g_object_unref);
+    priv->provisioned_seats = g_hash_table_new_full (g_str_hash, g_str_equal,
+            g_free, (GDestroyNotify) g_hash_table_unref);
+    priv->seat_workers = NULL;
+    priv->account_pool = NULL;
+    priv->next_worker = 0;
+
+    priv->attach_cancellable = NULL;
+    priv->pending_attaches = 0;
+    priv->attach_timeout_id = 0;
+    priv->start_pending = FALSE;
+
+    manager->priv = priv;
+
+    priv->primary_seat = _get_primary_seat (priv);
+    if (priv->primary_seat) {
+        DBG ("fast boot, primary seat '%s'", priv->primary_seat);
+    } else {
+        priv->connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, &error);
+        if (!priv->connection) {
+            CRITICAL ("error getting system bus: %s", error->message);
+            g_error_free (error);
+        }
+    }
+
+    /* before the sockets of the previous sessions are cleaned up, the
+     * services follow in _attach_sessions_done() */
+    _attach_sessions (manager);
+}
+
+static gboolean
+_setup_guest_user (TlmAccountPlugin *plugin, const gchar *user_name)
+{
+    if (tlm_account_plugin_is_valid_user (plugin, user_name)) {
+        DBG("user account '%s' already existing, cleaning the home folder",
+                 user_name);
+        return tlm_account_plugin_cleanup_guest_user (plugin, user_name,
+                                                      FALSE);
+    }
+    else {
+        DBG("Asking plugin to setup guest user '%s'", user_name); 
+        return tlm_account_plugin_setup_guest_user_account (plugin,
+                                                            user_name);
+    }
+}
+
+/* runs on the seat's worker if it has one */
+static void
+_guest_user_job (gpointer data)
+{
+    TlmGuestUserJob *job = (TlmGuestUserJob *) data;
+    gboolean res;
+
+    if (job->setup)
+        res = _setup_guest_user (job->plugin, job->user_name);
+    else
+        res = tlm_account_plugin_cleanup_guest_user (job->plugin,
+                                                     job->user_name, FALSE);
+    if (!res)
+        WARN ("failed to prepare for '%s'", job->user_name);
+}
+
+static void
+_guest_user_job_free (gpointer data)
+{
+    TlmGuestUserJob *job = (TlmGuestUserJob *) data;
+
+    g_object_unref (job->plugin);
+    g_free (job->user_name);
+    g_slice_free (TlmGuestUserJob, job);
+}
+
+static void
+_guest_user_job_done (
+        TlmGuestUserJob *job,
+        gboolean res,
+        GError *error)
+{
+    if (!res)
+        WARN ("failed to prepare for '%s' : %s", job->user_name,
+              error ? error->message : "");
+    if (error)
+        g_error_free (error);
+
+    if (job->seat) {
+        g_object_remove_weak_pointer (G_OBJECT (job->seat),
+                                      (gpointer *) &job->seat);
+        tlm_seat_end_job (job->seat);
+    }
+    _guest_user_job_free (job);
+}
+
+static void
+_on_guest_user_cleaned_up (
+        GObject *source,
+        GAsyncResult *result,
+        gpointer user_data)
+{
+    GError *error = NULL;
+    gboolean res = tlm_account_plugin_cleanup_guest_user_finish (
+            TLM_ACCOUNT_PLUGIN (source), result, &error);
+
+    _guest_user_job_done ((TlmGuestUserJob *) user_data, res, error);
+}
+
+static void
+_on_guest_user_set_up (
+        GObject *source,
+        GAsyncResult *result,
+        gpointer user_data)
+{
+    GError *error = NULL;
+    gboolean res = tlm_account_plugin_setup_guest_user_account_finish (
+            TLM_ACCOUNT_PLUGIN (source), result, &error);
+
+    _guest_user_job_done ((TlmGuestUserJob *) user_data, res, error);
+}
+
+static void
+_on_guest_user_checked (
+        GObject *source,
+        GAsyncResult *result,
+        gpointer user_data)
+{
+    TlmGuestUserJob *job = (TlmGuestUserJob *) user_data;
+
+    if (tlm_account_plugin_is_valid_user_finish (job->plugin, result, NULL)) {
+        DBG("user account '%s' already existing, cleaning the home folder",
+            job->user_name);
+        tlm_account_plugin_cleanup_guest_user_async (job->plugin,
+                job->user_name, FALSE, NULL, _on_guest_user_cleaned_up, job);
+    } else {
+        DBG("Asking plugin to setup guest user '%s'", job->user_name);
+        tlm_account_plugin_setup_guest_user_account_async (job->plugin,
+                job->user_name, NULL, _on_guest_user_set_up, job);
+    }
+}
+
+static void
+_start_guest_user_job (TlmGuestUserJob *job)
+{
+    tlm_seat_begin_job (job->seat);
+    g_object_add_weak_pointer (G_OBJECT (job->seat), (gpointer *) &job->seat);
+
+    if (job->setup)
+        tlm_account_plugin_is_valid_user_async (job->plugin, job->user_name,
+                NULL, _on_guest_user_checked, job);
+    else
+        tlm_account_plugin_cleanup_guest_user_async (job->plugin,
+                job->user_name, FALSE, NULL, _on_guest_user_cleaned_up, job);
+}
+
+static void
+_run_guest_user_job (
+        TlmManager *manager,
+        TlmSeat *seat,
+        const gchar *user_name,
+        gboolean setup)
+{
+    TlmGuestUserJob *job = NULL;
+
+    /* not loaded yet in fast boot mode */
+    if (!manager->priv->account_plugin_name)
+        _load_configured_accounts_plugin (manager);
+    if (!manager->priv->account_plugin) {
+        WARN ("no account plugin to prepare for '%s'", user_name);
+        return;
+    }
+
+    job = g_slice_new0 (TlmGuestUserJob);
+    job->plugin = g_object_ref (manager->priv->account_plugin);
+    job->user_name = g_strdup (user_name);
+    job->setup = setup;
+    if (tlm_seat_get_worker (seat)) {
+        tlm_seat_run_job (seat, _guest_user_job, job, _guest_user_job_free);
+    } else {
+        job->seat = seat;
+        _start_guest_user_job (job);
+    }
+}
+
+static void
+_prepare_user_login_cb (TlmSeat *seat, const gchar *user_name, gpointer user_data)
+{
+    TlmManager *manager = TLM_MANAGER(user_data);
+
+    g_return_if_fail (user_data && TLM_IS_MANAGER(manager));
+
+    if (tlm_config_get_boolean (manager->priv->config,
+                                TLM_CONFIG_GENERAL,
+                                TLM_CONFIG_GENERAL_PREPARE_DEFAULT,
+                                FALSE)) {
+        DBG ("prepare for login for '%s'", user_name);
+        if (manager->priv->account_pool &&
+            tlm_account_pool_has_user (manager->priv->account_pool,
+                                       user_name)) {
+            DBG ("'%s' is prepared by the pool", user_name);
+            return;
+        }
+        _run_guest_user_job (manager, seat, user_name, TRUE);
+    }
+}
+
+static void
+_prepare_user_logout_cb (TlmSeat *seat, const gchar *user_name, gpointer user_data)
+{
+    TlmManager *manager = TLM_MANAGER(user_data);
+
+    g_return_if_fail (user_data && TLM_IS_MANAGER(manager));
+
+    if (tlm_config_get_boolean (manager->priv->config,
+                                TLM_CONFIG_GENERAL,
+                                TLM_CONFIG_GENERAL_PREPARE_DEFAULT,
+                                FALSE)) {
+        DBG ("prepare for logout for '%s'", user_name);
+        if (manager->priv->account_pool &&
+            tlm_account_pool_release (manager->priv->account_pool,
+                                      user_name))
+            return;
+        _run_guest_user_job (manager, seat, user_name, FALSE);
+    }
+}
+
+static void
+_inflight_seat_gone (gpointer data, GObject *where_the_object_was);
+
+static void
+_login_session_created_cb (
+        TlmSeat *seat,
+        const gchar *sessionid,
+        TlmManager *manager);
+
+static void
+_login_session_error_cb (
+        TlmSeat *seat,
+        guint error,
+        TlmManager *manager);
+
+static guint
+_get_max_concurrent_logins (TlmManagerPrivate *priv)
+{
+    return tlm_config_get_uint (priv->config, TLM_CONFIG_GENERAL,
+                                TLM_CONFIG_GENERAL_MAX_CONCURRENT_LOGINS, 0);
+}
+
+/* keeps seats of equal priority in arrival order */
+static gint
+_compare_seat_priority (
+        gconstpointer queued,
+        gconstpointer seat,
+        gpointer user_data)
+{
+    TlmConfig *config = TLM_CONFIG (user_data);
+    TlmSeatConfig *queued_config = tlm_config_get_seat_config (config,
+            tlm_seat_get_id ((TlmSeat *) queued));
+    TlmSeatConfig *seat_config = tlm_config_get_seat_config (config,
+            tlm_seat_get_id ((TlmSeat *) seat));
+    gint res = queued_config->priority >= seat_config->priority ? -1 : 1;
+
+    tlm_seat_config_unref (queued_config);
+    tlm_seat_config_unref (seat_config);
+    return res;
+}
+
+static void
+_start_initial_login (TlmManager *manager, TlmSeat *seat)
+{
+    TlmManagerPrivate *priv = manager->priv;
+
+    DBG ("admitting seat %s, %u login(s) already in flight",
+         tlm_seat_get_id (seat), g_list_length (priv->inflight_logins));
+
+    priv->inflight_logins = g_list_prepend (priv->inflight_logins, seat);
+    g_object_weak_ref (G_OBJECT (seat), _inflight_seat_gone, manager);
+    g_signal_connect (seat, "session-created",
+            G_CALLBACK (_login_session_created_cb), manager);
+    g_signal_connect (seat, "session-error",
+            G_CALLBACK (_login_session_error_cb), manager);
+    if (priv->start_time)
+        priv->startup_seats++;
+
+    DBG("intial auto-login for user '%s'", priv->initial_user);
+    if (!tlm_seat_create_session (seat,
+                                  NULL,
+                                  priv->initial_user,
+                                  NULL,
+                                  NULL))
+        WARN("Failed to create session for default user");
+}
+
+static gboolean
+_run_login_scheduler (gpointer user_data)
+{
+    TlmManager *manager = TLM_MANAGER (user_data);
+    TlmManagerPrivate *priv = manager->priv;
+    guint max_logins = _get_max_concurrent_logins (priv);
+    TlmSeat *seat = NULL;
+
+    if (max_logins &&
+        g_list_length (priv->inflight_logins) >= max_logins) {
+        /* rescheduled when one of them completes */
+        priv->login_sched_id = 0;
+        return G_SOURCE_REMOVE;
+    }
+
+    seat = g_queue_pop_head (priv->pending_logins);
+    if (!seat) {
+        priv->login_sched_id = 0;
+        return G_SOURCE_REMOVE;
+    }
+
+    /* one seat per main loop iteration */
+    if (g_hash_table_lookup (priv->seats, tlm_seat_get_id (seat)) == seat)
+        _start_initial_login (manager, seat);
+    g_object_unref (seat);
+    return G_SOURCE_CONTINUE;
+}
+
+static void
+_schedule_logins (TlmManager *manager)
+{
+    TlmManagerPrivate *priv = manager->priv;
+
+    if (priv->login_sched_id || g_queue_is_empty (priv->pending_logins))
+        return;
+    priv->login_sched_id = g_idle_add (_run_login_scheduler, manager);
+}
+
+static void
+_queue_initial_login (TlmManager *manager, TlmSeat *seat)
+{
+    TlmManagerPrivate *priv = manager->priv;
+
+    g_queue_insert_sorted (priv->pending_logins, g_object_ref (seat),
+            _compare_seat_priority, priv->config);
+    _schedule_logins (manager);
+}
+
+static void
+_login_done (TlmManager *manager, TlmSeat *seat, gboolean created)
+{
+    TlmManagerPrivate *priv = manager->priv;
+    gint64 now = g_get_monotonic_time ();
+
+    if (!g_list_find (priv->inflight_logins, seat))
+        return;
+
+    g_signal_handlers_disconnect_by_func (seat, _login_session_created_cb,
+            manager);
+    g_signal_handlers_disconnect_by_func (seat, _login_session_error_cb,
+            manager);
+    g_object_weak_unref (G_OBJECT (seat), _inflight_seat_gone, manager);
+    priv->inflight_logins = g_list_remove (priv->inflight_logins, seat);
+
+    if (priv->primary_seat &&
+        g_strcmp0 (tlm_seat_get_id (seat), priv->primary_seat) == 0) {
+        gchar *status = g_strdup_printf ("Session on %s %s",
+                priv->primary_seat, created ? "created" : "failed");
+        _notify_status (manager, TRUE, status);
+        g_free (status);
+    }
+
+    if (priv->start_time) {
+        INFO ("startup: seat %s session %s after %.3f s",
+              tlm_seat_get_id (seat), created ? "created" : "failed",
+              (now - priv->start_time) * 1.0e-6);
+        priv->startup_last = now;
+        if (priv->startup_seats && --priv->startup_seats == 0 &&
+            g_queue_is_empty (priv->pending_logins)) {
+            INFO ("startup: initial logins done after %.3f s",
+                  (priv->startup_last - priv->start_time) * 1.0e-6);
+            priv->start_time = 0;
+            _notify_status (manager, TRUE, "Initial logins done");
+        }
+    }
+
+    _schedule_logins (manager);
+}
+
+static void
+_login_session_created_cb (
+        TlmSeat *seat,
+        const gchar *sessionid,
+        TlmManager *manager)
+{
+    _login_done (manager, seat, TRUE);
+}
+
+static void
+_login_session_error_cb (
+        TlmSeat *seat,
+        guint error,
+        TlmManager *manager)
+{
+    DBG ("initial login on seat %s failed: %u", tlm_seat_get_id (seat), error);
+    _login_done (manager, seat, FALSE);
+}
+
+static void
+_inflight_seat_gone (gpointer data, GObject *where_the_object_was)
+{
+    TlmManager *manager = TLM_MANAGER (data);
+
+    manager->priv->inflight_logins = g_list_remove (
+            manager->priv->inflight_logins, where_the_object_was);
+    if (manager->priv->startup_seats)
+        manager->priv->startup_seats--;
+    _schedule_logins (manager);
+}
+
+static void
+_clear_login_scheduler (TlmManager *manager)
+{
+    TlmManagerPrivate *priv = manager->priv;
+    GList *elem;
+
+    if (priv->login_sched_id) {
+        g_source_remove (priv->login_sched_id);
+        priv->login_sched_id = 0;
+    }
+    if (priv->pending_logins) {
+        g_queue_foreach (priv->pending_logins, (GFunc) g_object_unref, NULL);
+        g_queue_clear (priv->pending_logins);
+    }
+    for (elem = priv->inflight_logins; elem; elem = g_list_next (elem)) {
+        TlmSeat *seat = TLM_SEAT (elem->data);
+        g_signal_handlers_disconnect_by_func (seat, _login_session_created_cb,
+                manager);
+        g_signal_handlers_disconnect_by_func (seat, _login_session_error_cb,
+                manager);
+        g_object_weak_unref (G_OBJECT (seat), _inflight_seat_gone, manager);
+    }
+    g_list_free (priv->inflight_logins);
+    priv->inflight_logins = NULL;
+}
+
+/* the seats are spread over the workers in the order they are added */
+static TlmSeatWorker *
+_get_seat_worker (TlmManager *manager)
+{
+    TlmManagerPrivate *priv = manager->priv;
+    guint nthreads, i;
+
+    if (!priv->seat_workers) {
+        nthreads = tlm_config_get_uint (priv->config, TLM_CONFIG_GENERAL,
+                                        TLM_CONFIG_GENERAL_SEAT_THREADS, 0);
+        priv->seat_workers = g_ptr_array_new_with_free_func (
+                (GDestroyNotify) tlm_seat_worker_free);
+        for (i = 0; i < nthreads; i++) {
+            gchar *name = g_strdup_printf ("tlm-seat-%u", i);
+            g_ptr_array_add (priv->seat_workers, tlm_seat_worker_new (name));
+            g_free (name);
+        }
+        DBG ("%u seat worker(s)", nthreads);
+    }
+    if (!priv->seat_workers->len)
+        return NULL;
+
+    return g_ptr_array_index (priv->seat_workers,
+                              priv->next_worker++ % priv->seat_workers->len);
+}
+
+static void
+_create_seat (TlmManager *manager,
+              const gchar *seat_id, const gchar *seat_path)
+{
+    g_return_if_fail (manager && TLM_IS_MANAGER (manager));
+
+    TlmManagerPrivate *priv = TLM_MANAGER_PRIV (manager);
+    TlmSessionRemote *session = NULL;
+
+    /* a seat re-added on reload while its watch was pending */
+    if (g_hash_table_contains (priv->seats, seat_id)) {
+        DBG ("seat %s exists already", seat_id);
+        return;
+    }
+
+    TlmSeat *seat = tlm_seat_new (priv->config,
+                                  seat_id,
+                                  seat_path);
+    tlm_seat_set_worker (seat, _get_seat_worker (manager));
+    tlm_seat_set_account_pool (seat, priv->account_pool);
+    g_signal_connect (seat,
+                      "prepare-user-login",
+                      G_CALLBACK (_prepare_user_login_cb),
+                      manager);
+    g_signal_connect (seat,
+                      "prepare-user-logout",
+                      G_CALLBACK (_prepare_user_logout_cb),
+                      manager);
+    g_signal_connect_swapped (seat,
+                              "session-created",
+                              G_CALLBACK (_defer_auth_plugins),
+                              manager);
+    g_hash_table_insert (priv->seats, g_strdup (seat_id), seat);
+    g_signal_emit (manager, signals[SIG_SEAT_ADDED], 0, seat, NULL);
+
+    session = priv->attached_sessions ?
+        g_hash_table_lookup (priv->attached_sessions, seat_id) : NULL;
+    if (session && tlm_seat_attach_session (seat, session)) {
+        g_hash_table_remove (priv->attached_sessions, seat_id);
+        _defer_auth_plugins (manager);
+        if (g_strcmp0 (seat_id, priv->primary_seat) == 0 ||
+            (g_hash_table_size (priv->attached_sessions) == 0 &&
+             !priv->startup_seats && !priv->inflight_logins &&
+             g_queue_is_empty (priv->pending_logins)))
+            _notify_status (manager, TRUE, "Sessions taken over");
+        return;
+    }
+
+    if (tlm_config_get_boolean (priv->config,
+                                TLM_CONFIG_GENERAL,
+                                TLM_CONFIG_GENERAL_AUTO_LOGIN,
+                                TRUE) ||
+        priv->initial_user) {
+        /* admitted by _run_login_scheduler() */
+        _queue_initial_login (manager, seat);
+    }
+}
+
+static void
+_seat_watch_cb (
+    const gchar *watch_item,
+    gboolean is_final,
+    GError *error,
+    gpointer user_data)
+{
+    g_return_if_fail (watch_item && user_data);
+
+    TlmSeatWatchClosure *closure = (TlmSeatWatchClosure *) user_data;
+
+    if (error) {
+      WARN ("Error in notify %s on seat %s: %s", watch_item, closure->seat_id,
+          error->message);
+      g_error_free (error);
+      return;
+    }
+
+    DBG ("seat %s notify for %s", closure->seat_id, watch_item);
+
+    if (is_final) {
+        _create_seat (closure->manager, closure->seat_id, closure->seat_path);
+        g_object_unref (closure->manager);
+        g_free (closure->seat_id);
+        g_free (closure->seat_path);
+        g_free (closure);
+    }
+}
+
+static void
+_add_seat (TlmManager *manager, const gchar *seat_id, const gchar *seat_path)
+{
+    g_return_if_fail (manager && TLM_IS_MANAGER (manager));
+
+    TlmManagerPrivate *priv = TLM_MANAGER_PRIV (manager);
+    TlmSeatConfig *seat_config = tlm_config_get_seat_config (priv->config,
+                                                             seat_id);
+    gboolean active = seat_config->active;
+    guint nwatch = seat_config->nwatch;
+
+    tlm_seat_config_unref (seat_config);
+    if (!active)
+        return;
+
+    if (nwatch) {
+        int x;
+        int watch_id = 0;
+        gchar **watch_items = g_new0 (gchar *, nwatch + 1);
+        for (x = 0; x < nwatch; x++) {
+          gchar *watchx = g_strdup_printf ("%s%u", TLM_CONFIG_SEAT_WATCHX, x);
+          watch_items[x] = (char *)tlm_config_get_string (
+              priv->config, seat_id, watchx);
+          g_free (watchx);
+        }
+        watch_items[nwatch] = NULL;
+        TlmSeatWatchClosure *watch_closure = 
+            g_new0 (TlmSeatWatchClosure, 1);
+        watch_closure->manager = g_object_ref (manager);
+        watch_closure->seat_id = g_strdup (seat_id);
+        watch_closure->seat_path = g_strdup (seat_path);
+
+        watch_id = tlm_utils_watch_for_files (
+            (const gchar **)watch_items, _seat_watch_cb, watch_closure);
+        g_free (watch_items);
+        if (watch_id <= 0) {
+            WARN ("Failed to add watch on seat %s", seat_id);
+        } else {
+            return;
+        }
+    }
+
+    _create_seat (manager, seat_id, seat_path);
+}
+
+static void
+_manager_hashify_seats (TlmManager *manager, GVariant *hash_map)
+{
+    GVariantIter iter;
+    gchar *id = 0, *path = 0;
+
+    g_return_if_fail (manager);
+    g_return_if_fail (hash_map);
+
+    g_variant_iter_init (&iter, hash_map);
+    while (g_variant_iter_next (&iter, "(so)", &id, &path)) {
+        DBG("found seat %s:%s", id, path);
+        /* SeatNew may have announced it already */
+        if (!g_hash_table_contains (manager->priv->seats, id))
+            _add_seat (manager, id, path);
+        g_free (id);
+        g_free (path);
+    }
+}
+
+static void
+_manager_on_seats_listed (
+        GObject *object,
+        GAsyncResult *res,
+        gpointer user_data)
+{
+    GError *error = NULL;
+    GVariant *reply = NULL;
+    GVariant *hash_map = NULL;
+    TlmManager *manager = NULL;
+
+    reply = g_dbus_connection_call_finish (G_DBUS_CONNECTION (object), res,
+            &error);
+    if (!reply) {
+        if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+            WARN ("failed to get attached seats: %s", error->message);
+        g_error_free (error);
+        return;
+    }
+
+    manager = TLM_MANAGER (user_data);
+    g_variant_get (reply, "(@a(so))", &hash_map);
+    g_variant_unref (reply);
+
+    DBG ("seats listed after %.3f s",
+         (g_get_monotonic_time () - manager->priv->start_time) * 1.0e-6);
     _manager_hashify_seats (manager, hash_map);
 
     g_variant_unref (hash_map);
 }
 
+static void
+_manager_sync_seats (TlmManager *manager)
+{
+    g_return_if_fail (manager && manager->priv->connection);
+
+    g_dbus_connection_call (manager->priv->connection,
+                            LOGIND_BUS_NAME,
+                            LOGIND_OBJECT_PATH,
+                            LOGIND_MANAGER_IFACE,
+                            "ListSeats",
+                            g_variant_new("()"),
+                            G_VARIANT_TYPE_TUPLE,
+                            G_DBUS_CALL_FLAGS_NONE,
+                            -1,
+                            manager->priv->cancellable,
+                            _manager_on_seats_listed,
+                            manager);
+}
+
+static guint
+_get_seat_change_delay (TlmManagerPrivate *priv)
+{
+    return tlm_config_get_uint (priv->config, TLM_CONFIG_GENERAL,
+                                TLM_CONFIG_GENERAL_SEAT_CHANGE_DELAY, 250);
+}
+
+static gboolean
+_apply_seat_change (
+        TlmManager *manager,
+        const gchar *seat_id,
+        const gchar *seat_path,
+        gboolean added)
+{
+    TlmManagerPrivate *priv = manager->priv;
+
+    if (added) {
+        if (g_hash_table_contains (priv->seats, seat_id))
+            return FALSE;
+        _add_seat (manager, seat_id, seat_path);
+    } else {
+        if (!g_hash_table_contains (priv->seats, seat_id))
+            return FALSE;
+        g_hash_table_remove (priv->seats, seat_id);
+        g_signal_emit (manager, signals[SIG_SEAT_REMOVED], 0, seat_id, NULL);
+    }
+    return TRUE;
+}
+
+static void
+_apply_seat_changes (TlmManager *manager, GHashTable *changes, gboolean added)
+{
+    GHashTableIter iter;
+    gpointer key, value;
+
+    g_hash_table_iter_init (&iter, changes);
+    while (g_hash_table_iter_next (&iter, &key, &value)) {
+        TlmSeatChange *change = (TlmSeatChange *) value;
+        guint applied;
+
+        if (change->added != added)
+            continue;
+        applied = _apply_seat_change (manager, (const gchar *) key,
+                                      change->seat_path, added) ? 1 : 0;
+        manager->priv->seat_events_suppressed += change->events - applied;
+        DBG ("seat %s %s, %u event(s) coalesced", (const gchar *) key,
+             applied ? (added ? "added" : "removed") : "unchanged",
+             change->events - applied);
+    }
+}
+
+static gboolean
+_flush_seat_changes (gpointer user_data)
+{
+    TlmManager *manager = TLM_MANAGER (user_data);
+    TlmManagerPrivate *priv = manager->priv;
+    GHashTable *changes = priv->seat_changes;
+
+    priv->seat_changes_id = 0;
+    /* changes arriving while applying go to the next batch */
+    priv->seat_changes = g_hash_table_new_full (g_str_hash, g_str_equal,
+            g_free, (GDestroyNotify) _seat_change_free);
+
+    /* removals first so that their VTs are free again for new seats */
+    _apply_seat_changes (manager, changes, FALSE);
+    _apply_seat_changes (manager, changes, TRUE);
+    g_hash_table_unref (changes);
+
+    DBG ("%u seat event(s), %u suppressed", priv->seat_events,
+         priv->seat_events_suppressed);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+_queue_seat_change (
+        TlmManager *manager,
+        const gchar *seat_id,
+        const gchar *seat_path,
+        gboolean added)
+{
+    TlmManagerPrivate *priv = manager->priv;
+    TlmSeatChange *change = NULL;
+    guint delay = _get_seat_change_delay (priv);
+
+    priv->seat_events++;
+    if (!delay) {
+        if (!_apply_seat_change (manager, seat_id, seat_path, added))
+            priv->seat_events_suppressed++;
+        return;
+    }
+
+    change = g_hash_table_lookup (priv->seat_changes, seat_id);
+    if (!change) {
+        change = g_new0 (TlmSeatChange, 1);
+        g_hash_table_insert (priv->seat_changes, g_strdup (seat_id), change);
+    } else if (change->added != added) {
+        DBG ("seat %s flapping, waiting for it to settle", seat_id);
+    }
+    change->added = added;
+    change->events++;
+    if (seat_path) {
+        g_free (change->seat_path);
+        change->seat_path = g_strdup (seat_path);
+    }
+
+    /* the window is not extended by further events so that a steady storm
+     * cannot hold back seat changes forever */
+    if (!priv->seat_changes_id)
+        priv->seat_changes_id = g_timeout_add (delay, _flush_seat_changes,
+                                               manager);
+}
+
+static void
+_clear_seat_changes (TlmManager *manager)
+{
+    TlmManagerPrivate *priv = manager->priv;
+
+    if (priv->seat_changes_id) {
+        g_source_remove (priv->seat_changes_id);
+        priv->seat_changes_id = 0;
+    }
+    if (priv->seat_changes)
+        g_hash_table_remove_all (priv->seat_changes);
+}
+
 static void
 _manager_on_seat_added (GDBusConnection *connection,
                         const gchar *sender,
@@ -655,22 +1767,17 @@ _manager_on_seat_added (GDBusConnection *connection,
                         GVariant *params,
                         gpointer userdata)
 {
-    gchar *id = NULL, *path = NULL;
+    const gchar *id = NULL, *path = NULL;
     TlmManager *manager = TLM_MANAGER (userdata);
 
     g_return_if_fail (manager);
     g_return_if_fail (params);
 
     g_variant_get (params, "(&s&o)", &id, &path);
-    g_variant_unref (params);
 
     DBG("Seat added: %s:%s", id, path);
 
-    if (!g_hash_table_contains (manager->priv->seats, id)) {
-        _add_seat (manager, id, path);
-    }
-    g_free (id);
-    g_free (path);
+    _queue_seat_change (manager, id, path, TRUE);
 }
 
 static void
@@ -682,24 +1789,17 @@ _manager_on_seat_removed (GDBusConnection *connection,
                         GVariant *params,
                         gpointer userdata)
 {
-    gchar *id = NULL, *path = NULL;
+    const gchar *id = NULL, *path = NULL;
     TlmManager *manager = TLM_MANAGER (userdata);
 
     g_return_if_fail (manager);
     g_return_if_fail (params);
 
-    g_variant_get (params, "(&s&o)", &id, path);
-    g_variant_unref (params);
+    g_variant_get (params, "(&s&o)", &id, &path);
 
     DBG("Seat removed: %s:%s", id, path);
 
-    if (!g_hash_table_contains (manager->priv->seats, id)) {
-        g_hash_table_remove (manager->priv->seats, id);
-        g_signal_emit (manager, signals[SIG_SEAT_REMOVED], 0, id, NULL);
-
-    } 
-    g_free (id);
-    g_free (path);
+    _queue_seat_change (manager, id, NULL, FALSE);
 }
 
 static void
@@ -718,40 +1818,90 @@ _manager_subscribe_seat_changes (TlmManager *manager)
                               _manager_on_seat_added,
                               manager, NULL);
 
-    priv->seat_removed_id = g_dbus_connection_signal_subscribe (
-                                priv->connection,
-                                LOGIND_BUS_NAME,
-                                LOGIND_MANAGER_IFACE,
-                                "SeatRemoved",
-                                LOGIND_OBJECT_PATH,
-                                NULL,
-                                G_DBUS_SIGNAL_FLAGS_NONE,
-                                _manager_on_seat_removed,
-                                manager, NULL);
+    priv->seat_removed_id = g_dbus_connection_signal_subscribe (
+                                priv->connection,
+                                LOGIND_BUS_NAME,
+                                LOGIND_MANAGER_IFACE,
+                                "SeatRemoved",
+                                LOGIND_OBJECT_PATH,
+                                NULL,
+                                G_DBUS_SIGNAL_FLAGS_NONE,
+                                _manager_on_seat_removed,
+                                manager, NULL);
+}
+
+static void
+_manager_unsubsribe_seat_changes (TlmManager *manager)
+{
+    if (manager->priv->seat_added_id) {
+        g_dbus_connection_signal_unsubscribe (manager->priv->connection,
+                                              manager->priv->seat_added_id);
+        manager->priv->seat_added_id = 0;
+    }
+
+    if (manager->priv->seat_removed_id) {
+        g_dbus_connection_signal_unsubscribe (manager->priv->connection,
+                                              manager->priv->seat_removed_id);
+        manager->priv->seat_removed_id = 0;
+    }
+}
+
+static void
+_apply_seat_config (
+        TlmConfig *config,
+        const gchar *seat_id,
+        GHashTable *seat_config)
+{
+    GHashTableIter iter;
+    gpointer key, value;
+
+    g_hash_table_iter_init (&iter, seat_config);
+    while (g_hash_table_iter_next (&iter, &key, &value))
+        tlm_config_set_string (config, seat_id, key, value);
+}
+
+/* the runtime configuration is not in the file, reloading drops it */
+static void
+_apply_provisioned_seats (TlmManager *manager)
+{
+    GHashTableIter iter;
+    gpointer key, value;
+
+    g_hash_table_iter_init (&iter, manager->priv->provisioned_seats);
+    while (g_hash_table_iter_next (&iter, &key, &value))
+        _apply_seat_config (manager->priv->config, key, value);
+}
+
+static gchar **
+_get_virtual_seats (TlmConfig *config)
+{
+    const gchar *value = tlm_config_get_string (config, TLM_CONFIG_GENERAL,
+            TLM_CONFIG_GENERAL_VIRTUAL_SEATS);
+
+    return g_strsplit (value ? value : "", ";", -1);
 }
 
 static void
-_manager_unsubsribe_seat_changes (TlmManager *manager)
+_start_virtual_seats (TlmManager *manager)
 {
-    if (manager->priv->seat_added_id) {
-        g_dbus_connection_signal_unsubscribe (manager->priv->connection,
-                                              manager->priv->seat_added_id);
-        manager->priv->seat_added_id = 0;
-    }
+    gchar **ids = _get_virtual_seats (manager->priv->config);
+    gchar **id;
 
-    if (manager->priv->seat_removed_id) {
-        g_dbus_connection_signal_unsubscribe (manager->priv->connection,
-                                              manager->priv->seat_removed_id);
-        manager->priv->seat_removed_id = 0;
+    for (id = ids; *id; id++) {
+        if ((*id)[0] && !g_hash_table_contains (manager->priv->seats, *id)) {
+            DBG ("adding configured virtual seat '%s'", *id);
+            _add_seat (manager, *id, NULL);
+        }
     }
+    g_strfreev (ids);
 }
 
-gboolean
-tlm_manager_start (TlmManager *manager)
+/* adds the seats that are not there yet */
+static void
+_start_seats (TlmManager *manager)
 {
-    g_return_val_if_fail (manager && TLM_IS_MANAGER (manager), FALSE);
-
-    guint nseats = tlm_config_get_uint (manager->priv->config,
+    TlmManagerPrivate *priv = manager->priv;
+    guint nseats = tlm_config_get_uint (priv->config,
                                         TLM_CONFIG_GENERAL,
                                         TLM_CONFIG_GENERAL_NSEATS,
                                         0);
@@ -759,20 +1909,139 @@ tlm_manager_start (TlmManager *manager)
         guint i;
         for (i = 0; i < nseats; i++) {
             gchar *id = g_strdup_printf("seat%u", i);
-            DBG ("adding virtual seat '%s'", id);
-            _add_seat (manager, id, NULL);
+            if (!g_hash_table_contains (priv->seats, id)) {
+                DBG ("adding virtual seat '%s'", id);
+                _add_seat (manager, id, NULL);
+            }
             g_free (id);
         }
-    } else {
-        _manager_sync_seats (manager);
+    } else if (priv->connection && !priv->seat_added_id) {
+        /* subscribe first so that no seat slips in between */
         _manager_subscribe_seat_changes (manager);
+        _manager_sync_seats (manager);
     }
+    _start_virtual_seats (manager);
+}
+
+static void
+_on_bus_ready (GObject *object, GAsyncResult *res, gpointer user_data)
+{
+    GError *error = NULL;
+    GDBusConnection *connection = NULL;
+    TlmManager *manager = NULL;
+
+    connection = g_bus_get_finish (res, &error);
+    if (!connection) {
+        if (!g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+            CRITICAL ("error getting system bus: %s", error->message);
+        g_error_free (error);
+        return;
+    }
+
+    manager = TLM_MANAGER (user_data);
+    DBG ("system bus connected");
+    manager->priv->connection = connection;
+    if (manager->priv->is_started)
+        _start_seats (manager);
+}
+
+static gboolean
+_deferred_start_cb (gpointer user_data)
+{
+    TlmManager *manager = TLM_MANAGER (user_data);
+    TlmManagerPrivate *priv = manager->priv;
+
+    priv->deferred_start_id = 0;
+    DBG ("fast boot, starting the rest after %.3f s",
+         priv->start_time ?
+            (g_get_monotonic_time () - priv->start_time) * 1.0e-6 : 0.0);
 
+    _start_services (manager);
+    _start_seats (manager);
+    g_bus_get (G_BUS_TYPE_SYSTEM, priv->cancellable, _on_bus_ready, manager);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+_start (TlmManager *manager)
+{
+    manager->priv->start_time = g_get_monotonic_time ();
+    manager->priv->startup_seats = 0;
     manager->priv->is_started = TRUE;
 
+    if (manager->priv->primary_seat) {
+        /* the bus, plugins and observer follow once the main loop is idle,
+         * the primary seat's login gets going first */
+        _notify_status (manager, FALSE, "Starting primary seat");
+        _add_seat (manager, manager->priv->primary_seat, NULL);
+        if (!manager->priv->deferred_start_id)
+            manager->priv->deferred_start_id = g_idle_add_full (
+                    G_PRIORITY_LOW, _deferred_start_cb, manager, NULL);
+    } else {
+        _start_seats (manager);
+    }
+    _update_config_monitor (manager);
+
+    /* without auto-login there is no session to wait for */
+    if (!manager->priv->initial_user &&
+        !tlm_config_get_boolean (manager->priv->config, TLM_CONFIG_GENERAL,
+                                 TLM_CONFIG_GENERAL_AUTO_LOGIN, TRUE)) {
+        _defer_auth_plugins (manager);
+        _notify_status (manager, TRUE, "Waiting for logins");
+    }
+}
+
+gboolean
+tlm_manager_start (TlmManager *manager)
+{
+    g_return_val_if_fail (manager && TLM_IS_MANAGER (manager), FALSE);
+
+    /* the seats wait for the sessions they may get back */
+    if (manager->priv->pending_attaches) {
+        DBG ("start deferred until the previous sessions are attached");
+        _notify_status (manager, FALSE, "Attaching previous sessions");
+        manager->priv->start_pending = TRUE;
+        return TRUE;
+    }
+
+    _start (manager);
     return TRUE;
 }
 
+static void
+_manager_stopped (TlmManager *manager)
+{
+    TlmManagerPrivate *priv = manager->priv;
+
+    if (priv->shutdown_timer_id) {
+        g_source_remove (priv->shutdown_timer_id);
+        priv->shutdown_timer_id = 0;
+    }
+    if (priv->stop_time) {
+        DBG ("shutdown took %.3f s",
+             (g_get_monotonic_time () - priv->stop_time) * 1.0e-6);
+        priv->stop_time = 0;
+    }
+
+    DBG ("signalling stopped");
+    g_signal_emit (manager, signals[SIG_MANAGER_STOPPED], 0);
+}
+
+static gboolean
+_shutdown_timeout_cb (gpointer user_data)
+{
+    TlmManager *manager = TLM_MANAGER (user_data);
+
+    manager->priv->shutdown_timer_id = 0;
+    WARN ("%u seat(s) still terminating after %.3f s, giving up",
+          g_hash_table_size (manager->priv->seats),
+          (g_get_monotonic_time () - manager->priv->stop_time) * 1.0e-6);
+    _manager_stopped (manager);
+
+    return G_SOURCE_REMOVE;
+}
+
 static gboolean
 _session_terminated_cb (GObject *emitter, const gchar *session_id,
         TlmManager *manager)
@@ -784,10 +2053,9 @@ _session_terminated_cb (GObject *emitter, const gchar *session_id,
     seat = TLM_SEAT(emitter);
     if (seat) {
         g_hash_table_remove (manager->priv->seats, tlm_seat_get_id (seat));
-        if (g_hash_table_size (manager->priv->seats) == 0) {
-            DBG ("signalling stopped");
-            g_signal_emit (manager, signals[SIG_MANAGER_STOPPED], 0);
-        }
+        if (g_hash_table_size (manager->priv->seats) == 0 &&
+            manager->priv->stop_time)
+            _manager_stopped (manager);
     }
     return TRUE;
 }
@@ -798,11 +2066,27 @@ tlm_manager_stop (TlmManager *manager)
     g_return_val_if_fail (manager && TLM_IS_MANAGER (manager), FALSE);
 
     _manager_unsubsribe_seat_changes (manager);
+    _clear_seat_changes (manager);
+    _clear_config_monitor (manager);
+    tlm_utils_sd_notify ("STOPPING=1");
 
     GHashTableIter iter;
     gpointer key, value;
     gboolean delayed = FALSE;
+    gboolean persist = _get_persist_sessions (manager->priv);
+    guint timeout = 0;
+
+    manager->priv->stop_time = g_get_monotonic_time ();
+    manager->priv->start_time = 0;
+    _clear_login_scheduler (manager);
+    if (manager->priv->cancellable) {
+        g_cancellable_cancel (manager->priv->cancellable);
+        g_object_unref (manager->priv->cancellable);
+        manager->priv->cancellable = g_cancellable_new ();
+    }
 
+    /* all seats are terminated in parallel, each one reporting back through
+     * session-terminated, persistent sessions are just left running */
     g_hash_table_iter_init (&iter, manager->priv->seats);
     while (g_hash_table_iter_next (&iter, &key, &value)) {
         DBG ("terminate seat '%s'", (const gchar *) key);
@@ -810,15 +2094,25 @@ tlm_manager_stop (TlmManager *manager)
                                   "session-terminated",
                                   G_CALLBACK (_session_terminated_cb),
                                   manager);
-        if (!tlm_seat_terminate_session ((TlmSeat *) value)) {
+        if ((persist && tlm_seat_detach_session ((TlmSeat *) value)) ||
+            !tlm_seat_terminate_session ((TlmSeat *) value)) {
             g_hash_table_remove (manager->priv->seats, key);
             g_hash_table_iter_init (&iter, manager->priv->seats);
         } else {
             delayed = TRUE;
         }
     }
-    if (!delayed)
-        g_signal_emit (manager, signals[SIG_MANAGER_STOPPED], 0);
+    if (!delayed) {
+        _manager_stopped (manager);
+    } else {
+        timeout = tlm_config_get_uint (manager->priv->config,
+                                       TLM_CONFIG_GENERAL,
+                                       TLM_CONFIG_GENERAL_SHUTDOWN_TIMEOUT,
+                                       30);
+        if (timeout && !manager->priv->shutdown_timer_id)
+            manager->priv->shutdown_timer_id = g_timeout_add_seconds (
+                    timeout, _shutdown_timeout_cb, manager);
+    }
 
     manager->priv->is_started = FALSE;
 
@@ -829,20 +2123,13 @@ gboolean
 tlm_manager_setup_guest_user (TlmManager *manager, const gchar *user_name)
 {
     g_return_val_if_fail (manager && TLM_IS_MANAGER (manager), FALSE);
+
+    /* not loaded yet in fast boot mode */
+    if (!manager->priv->account_plugin_name)
+        _load_configured_accounts_plugin (manager);
     g_return_val_if_fail (manager->priv->account_plugin, FALSE);
 
-    if (tlm_account_plugin_is_valid_user (
-            manager->priv->account_plugin, user_name)) {
-        DBG("user account '%s' already existing, cleaning the home folder",
-                 user_name);
-        return tlm_account_plugin_cleanup_guest_user (
-                    manager->priv->account_plugin, user_name, FALSE);
-    }
-    else {
-        DBG("Asking plugin to setup guest user '%s'", user_name); 
-        return tlm_account_plugin_setup_guest_user_account (
-                    manager->priv->account_plugin, user_name);
-    }
+    return _setup_guest_user (manager->priv->account_plugin, user_name);
 }
 
 TlmManager *
@@ -879,18 +2166,563 @@ tlm_manager_get_seat_by_sessionid (TlmManager *manager, const gchar *session_id)
     return NULL;
 }
 
+static gboolean
+_is_valid_seat_id (const gchar *seat_id)
+{
+    const gchar *p;
+
+    /* it names a configuration group and the sockets of the seat */
+    if (!seat_id || !seat_id[0] ||
+        g_strcmp0 (seat_id, TLM_CONFIG_GENERAL) == 0)
+        return FALSE;
+    for (p = seat_id; *p; p++) {
+        if (!g_ascii_isalnum (*p) && *p != '-' && *p != '_')
+            return FALSE;
+    }
+    return TRUE;
+}
+
+/* carries the extended attributes over, the SELinux label among them */
+static void
+_copy_xattrs (int from_fd, int to_fd)
+{
+    gssize list_len = flistxattr (from_fd, NULL, 0);
+    gchar *list = NULL;
+    gchar *name = NULL;
+
+    if (list_len <= 0)
+        return;
+    list = g_malloc (list_len);
+    list_len = flistxattr (from_fd, list, list_len);
+    for (name = list; list_len > 0 && name < list + list_len;
+         name += strlen (name) + 1) {
+        gssize value_len = fgetxattr (from_fd, name, NULL, 0);
+        gchar *value = NULL;
+
+        if (value_len < 0)
+            continue;
+        value = g_malloc (value_len + 1);
+        value_len = fgetxattr (from_fd, name, value, value_len);
+        if (value_len < 0 ||
+            fsetxattr (to_fd, name, value, value_len, 0) != 0)
+            DBG ("could not copy attribute %s: %s", name, strerror (errno));
+        g_free (value);
+    }
+    g_free (list);
+}
+
+/* replaces the file a symlink points to rather than the link, the new one
+ * gets the mode, owner and attributes of the old one before it is renamed
+ * in place */
+static gboolean
+_replace_config_file (
+        const gchar *path,
+        const gchar *data,
+        gsize len,
+        GError **error)
+{
+    gchar *target = realpath (path, NULL);
+    gchar *tmp_path = NULL;
+    struct stat st;
+    int old_fd = -1;
+    int fd = -1;
+    gboolean res = FALSE;
+
+    if (!target || (old_fd = open (target, O_RDONLY | O_CLOEXEC)) < 0 ||
+        fstat (old_fd, &st) != 0) {
+        g_set_error (error, TLM_ERROR, TLM_ERROR_INTERNAL_SERVER,
+                     "Cannot open %s: %s", path, strerror (errno));
+        goto _finished;
+    }
+
+    tmp_path = g_strdup_printf ("%s.XXXXXX", target);
+    if ((fd = g_mkstemp_full (tmp_path, O_WRONLY | O_CLOEXEC, 0600)) < 0) {
+        g_set_error (error, TLM_ERROR, TLM_ERROR_INTERNAL_SERVER,
+                     "%s is not writable in place: %s", target,
+                     strerror (errno));
+        g_clear_string (&tmp_path);
+        goto _finished;
+    }
+    _copy_xattrs (old_fd, fd);
+    if (fchown (fd, st.st_uid, st.st_gid) != 0 ||
+        fchmod (fd, st.st_mode & 07777) != 0 ||
+        write (fd, data, len) != (gssize) len ||
+        fsync (fd) != 0) {
+        g_set_error (error, TLM_ERROR, TLM_ERROR_INTERNAL_SERVER,
+                     "Cannot write %s: %s", tmp_path, strerror (errno));
+        goto _finished;
+    }
+    if (close (fd) != 0) {
+        fd = -1;
+        g_set_error (error, TLM_ERROR, TLM_ERROR_INTERNAL_SERVER,
+                     "Cannot write %s: %s", tmp_path, strerror (errno));
+        goto _finished;
+    }
+    fd = -1;
+    if (rename (tmp_path, target) != 0) {
+        g_set_error (error, TLM_ERROR, TLM_ERROR_INTERNAL_SERVER,
+                     "Cannot replace %s: %s", target, strerror (errno));
+        goto _finished;
+    }
+    g_clear_string (&tmp_path);
+    res = TRUE;
+
+_finished:
+    if (fd >= 0) close (fd);
+    if (old_fd >= 0) close (old_fd);
+    if (tmp_path) {
+        g_unlink (tmp_path);
+        g_free (tmp_path);
+    }
+    free (target);
+    return res;
+}
+
+/* updates the seat in the configuration file, removes it if seat_config is
+ * NULL; like tlm-addseat but the rest of the file is left as it is */
+static gboolean
+_save_seat (
+        TlmManager *manager,
+        const gchar *seat_id,
+        GHashTable *seat_config,
+        GError **error)
+{
+    TlmManagerPrivate *priv = manager->priv;
+    const gchar *path = tlm_config_get_path (priv->config);
+    GKeyFile *key_file = NULL;
+    gchar **ids = NULL;
+    GPtrArray *list = NULL;
+    gboolean listed = FALSE;
+    gchar *data = NULL;
+    gsize len = 0;
+    gboolean res = FALSE;
+    guint i;
+
+    if (!path) {
+        g_set_error (error, TLM_ERROR, TLM_ERROR_INTERNAL_SERVER,
+                     "No configuration file");
+        return FALSE;
+    }
+
+    key_file = g_key_file_new ();
+    if (!g_key_file_load_from_file (key_file, path, G_KEY_FILE_KEEP_COMMENTS,
+                                    error))
+        goto _finished;
+
+    ids = g_key_file_get_string_list (key_file, TLM_CONFIG_GENERAL,
+            TLM_CONFIG_GENERAL_VIRTUAL_SEATS, NULL, NULL);
+    list = g_ptr_array_new ();
+    for (i = 0; ids && ids[i]; i++) {
+        if (g_strcmp0 (ids[i], seat_id) == 0)
+            listed = TRUE;
+        else if (ids[i][0])
+            g_ptr_array_add (list, ids[i]);
+    }
+
+    if (seat_config) {
+        GHashTableIter iter;
+        gpointer key, value;
+
+        g_hash_table_iter_init (&iter, seat_config);
+        while (g_hash_table_iter_next (&iter, &key, &value))
+            g_key_file_set_string (key_file, seat_id, key, value);
+        g_ptr_array_add (list, (gpointer) seat_id);
+    } else if (listed) {
+        g_key_file_remove_group (key_file, seat_id, NULL);
+    } else {
+        /* a seat of NSEATS or systemd, keep it from coming back */
+        g_key_file_set_boolean (key_file, seat_id, TLM_CONFIG_SEAT_ACTIVE,
+                                FALSE);
+        tlm_config_set_boolean (priv->config, seat_id,
+                                TLM_CONFIG_SEAT_ACTIVE, FALSE);
+    }
+
+    if (!seat_config != !listed) {
+        if (list->len)
+            g_key_file_set_string_list (key_file, TLM_CONFIG_GENERAL,
+                    TLM_CONFIG_GENERAL_VIRTUAL_SEATS,
+                    (const gchar * const *) list->pdata, list->len);
+        else
+            g_key_file_remove_key (key_file, TLM_CONFIG_GENERAL,
+                    TLM_CONFIG_GENERAL_VIRTUAL_SEATS, NULL);
+        /* in step with the file until it is reloaded */
+        data = g_key_file_get_value (key_file, TLM_CONFIG_GENERAL,
+                TLM_CONFIG_GENERAL_VIRTUAL_SEATS, NULL);
+        tlm_config_set_string (priv->config, TLM_CONFIG_GENERAL,
+                TLM_CONFIG_GENERAL_VIRTUAL_SEATS, data ? data : "");
+        g_clear_string (&data);
+    }
+
+    data = g_key_file_to_data (key_file, &len, NULL);
+    res = _replace_config_file (path, data, len, error);
+    if (res)
+        DBG ("seat %s %s in %s", seat_id, seat_config ? "saved" : "removed",
+             path);
+
+_finished:
+    if (list) g_ptr_array_free (list, TRUE);
+    g_free (data);
+    g_strfreev (ids);
+    g_key_file_free (key_file);
+    return res;
+}
+
+/**
+ * tlm_manager_add_seat:
+ * @manager: (transfer none): an instance of #TlmManager
+ * @seat_id: id of the new virtual seat
+ * @seat_config: (transfer none) (allow-none): { key: value } of the seat
+ * group, merged on top of the configured group if there is one
+ * @persist: whether to save the seat to the configuration file and
+ * #TLM_CONFIG_GENERAL_VIRTUAL_SEATS
+ * @error: return location for the error
+ *
+ * Adds a virtual seat without reloading the configuration, the seat starts
+ * its auto-login like the ones found at startup. Without @persist the seat
+ * configuration survives configuration reloads but not a restart.
+ *
+ * Returns: TRUE if the seat was added or is waiting for its watch items.
+ */
+gboolean
+tlm_manager_add_seat (
+        TlmManager *manager,
+        const gchar *seat_id,
+        GHashTable *seat_config,
+        gboolean persist,
+        GError **error)
+{
+    g_return_val_if_fail (manager && TLM_IS_MANAGER (manager), FALSE);
+
+    TlmManagerPrivate *priv = manager->priv;
+    GHashTable *values = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                g_free, g_free);
+    TlmSeatConfig *config = NULL;
+    gboolean active = FALSE;
+
+    if (!_is_valid_seat_id (seat_id)) {
+        g_set_error (error, TLM_ERROR, TLM_ERROR_INVALID_INPUT,
+                     "Invalid seat id");
+        goto _error;
+    }
+    if (!priv->is_started) {
+        g_set_error (error, TLM_ERROR, TLM_ERROR_INTERNAL_SERVER,
+                     "Not started");
+        goto _error;
+    }
+    if (g_hash_table_contains (priv->seats, seat_id)) {
+        g_set_error (error, TLM_ERROR, TLM_ERROR_INVALID_INPUT,
+                     "Seat %s exists already", seat_id);
+        goto _error;
+    }
+
+    if (seat_config) {
+        GHashTableIter iter;
+        gpointer key, value;
+
+        g_hash_table_iter_init (&iter, seat_config);
+        while (g_hash_table_iter_next (&iter, &key, &value))
+            g_hash_table_insert (values, g_strdup (key), g_strdup (value));
+    }
+    /* undo an earlier persistent removal of a configured seat */
+    if (!g_hash_table_contains (values, TLM_CONFIG_SEAT_ACTIVE) &&
+        tlm_config_has_key (priv->config, seat_id, TLM_CONFIG_SEAT_ACTIVE))
+        g_hash_table_insert (values, g_strdup (TLM_CONFIG_SEAT_ACTIVE),
+                             g_strdup ("true"));
+
+    _apply_seat_config (priv->config, seat_id, values);
+    config = tlm_config_get_seat_config (priv->config, seat_id);
+    active = config->active;
+    tlm_seat_config_unref (config);
+    if (!active) {
+        g_set_error (error, TLM_ERROR, TLM_ERROR_INVALID_INPUT,
+                     "Seat %s is not active", seat_id);
+        goto _error;
+    }
+
+    if (persist && !_save_seat (manager, seat_id, values, error))
+        goto _error;
+
+    if (persist)
+        g_hash_table_remove (priv->provisioned_seats, seat_id);
+    else
+        g_hash_table_insert (priv->provisioned_seats, g_strdup (seat_id),
+                             g_hash_table_ref (values));
+    g_hash_table_unref (values);
+
+    INFO ("adding virtual seat '%s'", seat_id);
+    _add_seat (manager, seat_id, NULL);
+    return TRUE;
+
+_error:
+    g_hash_table_unref (values);
+    return FALSE;
+}
+
+/**
+ * tlm_manager_remove_seat:
+ * @manager: (transfer none): an instance of #TlmManager
+ * @seat_id: id of the seat
+ * @persist: whether to remove the seat from the configuration file, or
+ * deactivate it there if it is not a #TLM_CONFIG_GENERAL_VIRTUAL_SEATS one
+ * @error: return location for the error
+ *
+ * Removes a seat without reloading the configuration, its session is
+ * terminated.
+ *
+ * Returns: TRUE if the seat was removed.
+ */
+gboolean
+tlm_manager_remove_seat (
+        TlmManager *manager,
+        const gchar *seat_id,
+        gboolean persist,
+        GError **error)
+{
+    g_return_val_if_fail (manager && TLM_IS_MANAGER (manager), FALSE);
+
+    TlmManagerPrivate *priv = manager->priv;
+
+    if (!seat_id || !g_hash_table_contains (priv->seats, seat_id)) {
+        g_set_error (error, TLM_ERROR, TLM_ERROR_SEAT_NOT_FOUND,
+                     "Seat not found");
+        return FALSE;
+    }
+    if (persist && !_save_seat (manager, seat_id, NULL, error))
+        return FALSE;
+
+    g_hash_table_remove (priv->provisioned_seats, seat_id);
+    INFO ("removing seat '%s'", seat_id);
+    g_hash_table_remove (priv->seats, seat_id);
+    g_signal_emit (manager, signals[SIG_SEAT_REMOVED], 0, seat_id, NULL);
+    return TRUE;
+}
+
+static void
+_reload_plugins (TlmManager *manager, GHashTable *changed)
+{
+    TlmManagerPrivate *priv = manager->priv;
+    const gchar *name = tlm_config_get_string_default (priv->config,
+            TLM_CONFIG_GENERAL, TLM_CONFIG_GENERAL_ACCOUNTS_PLUGIN, "default");
+    GList *elem, *next;
+
+    if (g_strcmp0 (name, priv->account_plugin_name) != 0 ||
+        g_hash_table_contains (changed, name)) {
+        DBG ("reloading account plugin '%s'", name);
+        g_clear_object (&priv->account_plugin);
+        _load_accounts_plugin (manager, name);
+        if (priv->account_pool)
+            tlm_account_pool_set_plugin (priv->account_pool,
+                                         priv->account_plugin);
+    }
+
+    for (elem = priv->auth_plugins; elem; elem = next) {
+        GObject *plugin = G_OBJECT (elem->data);
+        gchar *plugin_name = g_strdup (g_object_get_data (plugin,
+                                                          "tlm-plugin-name"));
+        gchar *plugin_path = g_strdup (g_object_get_data (plugin,
+                                                          "tlm-plugin-path"));
+
+        next = g_list_next (elem);
+        if (g_hash_table_contains (changed, plugin_name)) {
+            g_signal_handlers_disconnect_by_func (plugin,
+                    _manager_authenticate_cb, manager);
+            g_object_unref (plugin);
+            elem->data = _load_auth_plugin (manager, plugin_path,
+                                            plugin_name);
+            if (!elem->data)
+                priv->auth_plugins = g_list_delete_link (priv->auth_plugins,
+                                                         elem);
+        }
+        g_free (plugin_name);
+        g_free (plugin_path);
+    }
+
+    /* ones that got a configuration group */
+    if (!priv->auth_plugins_loaded)
+        _load_auth_plugins (manager, TRUE);
+}
+
+static void
+_reload_seats (TlmManager *manager, GHashTable *changed)
+{
+    TlmManagerPrivate *priv = manager->priv;
+    gboolean general = g_hash_table_contains (changed, TLM_CONFIG_GENERAL);
+    GPtrArray *inactive = g_ptr_array_new_with_free_func (g_free);
+    GHashTableIter iter;
+    gpointer key, value;
+    guint nseats, i;
+
+    g_hash_table_iter_init (&iter, priv->seats);
+    while (g_hash_table_iter_next (&iter, &key, &value)) {
+        TlmSeatConfig *seat_config = NULL;
+
+        if (!general && !g_hash_table_contains (changed, key))
+            continue;
+        /* the seat picks up the new snapshot with its next session, the
+         * running one is left alone */
+        seat_config = tlm_config_get_seat_config (priv->config, key);
+        if (!seat_config->active)
+            g_ptr_array_add (inactive, g_strdup (key));
+        else
+            DBG ("seat %s configuration changed", (const gchar *) key);
+        tlm_seat_config_unref (seat_config);
+    }
+
+    for (i = 0; i < inactive->len; i++) {
+        const gchar *seat_id = g_ptr_array_index (inactive, i);
+        DBG ("seat %s deactivated", seat_id);
+        g_hash_table_remove (priv->seats, seat_id);
+        g_signal_emit (manager, signals[SIG_SEAT_REMOVED], 0, seat_id, NULL);
+    }
+    g_ptr_array_unref (inactive);
+
+    if (!priv->is_started)
+        return;
+
+    /* pick up seats that became active, existing ones are skipped */
+    nseats = tlm_config_get_uint (priv->config, TLM_CONFIG_GENERAL,
+                                  TLM_CONFIG_GENERAL_NSEATS, 0);
+    if (nseats) {
+        for (i = 0; i < nseats; i++) {
+            gchar *id = g_strdup_printf ("seat%u", i);
+            if ((general || g_hash_table_contains (changed, id)) &&
+                !g_hash_table_contains (priv->seats, id))
+                _add_seat (manager, id, NULL);
+            g_free (id);
+        }
+    } else if (priv->connection) {
+        _manager_sync_seats (manager);
+    }
+    if (general)
+        _start_virtual_seats (manager);
+}
+
+static void
+_config_group_changed_cb (
+        TlmConfig *config,
+        const gchar *group,
+        GHashTable *changed)
+{
+    g_hash_table_add (changed, g_strdup (group));
+}
+
+static void
+_reload_config (TlmManager *manager)
+{
+    TlmManagerPrivate *priv = manager->priv;
+    GHashTable *changed = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                 g_free, NULL);
+    gulong handler_id = g_signal_connect (priv->config, "group-changed",
+            G_CALLBACK (_config_group_changed_cb), changed);
+
+    tlm_config_reload (priv->config);
+    g_signal_handler_disconnect (priv->config, handler_id);
+    _apply_provisioned_seats (manager);
+
+    if (g_hash_table_size (changed) == 0) {
+        DBG ("configuration unchanged");
+    } else {
+        _reload_plugins (manager, changed);
+        _reload_seats (manager, changed);
+        if (priv->is_started)
+            _update_config_monitor (manager);
+    }
+    g_hash_table_unref (changed);
+}
+
+static gboolean
+_config_reload_timeout_cb (gpointer user_data)
+{
+    TlmManager *manager = TLM_MANAGER (user_data);
+
+    manager->priv->config_reload_id = 0;
+    DBG ("configuration file changed");
+    _reload_config (manager);
+
+    return G_SOURCE_REMOVE;
+}
+
+static void
+_config_file_changed_cb (
+        GFileMonitor *monitor,
+        GFile *file,
+        GFile *other_file,
+        GFileMonitorEvent event_type,
+        TlmManager *manager)
+{
+    TlmManagerPrivate *priv = manager->priv;
+    guint delay;
+
+    if (event_type == G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED)
+        return;
+
+    /* editors write in several steps, reload once they are quiet */
+    delay = tlm_config_get_uint (priv->config, TLM_CONFIG_GENERAL,
+                                 TLM_CONFIG_GENERAL_CONFIG_WATCH_DELAY, 0);
+    if (priv->config_reload_id)
+        g_source_remove (priv->config_reload_id);
+    priv->config_reload_id = g_timeout_add (delay, _config_reload_timeout_cb,
+                                            manager);
+}
+
+static void
+_update_config_monitor (TlmManager *manager)
+{
+    TlmManagerPrivate *priv = manager->priv;
+    const gchar *path = tlm_config_get_path (priv->config);
+    GFile *file = NULL;
+    GError *error = NULL;
+
+    if (!path || !tlm_config_get_uint (priv->config, TLM_CONFIG_GENERAL,
+            TLM_CONFIG_GENERAL_CONFIG_WATCH_DELAY, 0)) {
+        _clear_config_monitor (manager);
+        return;
+    }
+    if (priv->config_monitor &&
+        g_strcmp0 (path, priv->config_monitor_path) == 0)
+        return;
+
+    _clear_config_monitor (manager);
+    file = g_file_new_for_path (path);
+    priv->config_monitor = g_file_monitor_file (file, G_FILE_MONITOR_NONE,
+                                                NULL, &error);
+    g_object_unref (file);
+    if (!priv->config_monitor) {
+        WARN ("cannot watch configuration file %s: %s", path,
+              error->message);
+        g_error_free (error);
+        return;
+    }
+    priv->config_monitor_path = g_strdup (path);
+    g_signal_connect (priv->config_monitor, "changed",
+                      G_CALLBACK (_config_file_changed_cb), manager);
+    DBG ("watching configuration file %s", path);
+}
+
+static void
+_clear_config_monitor (TlmManager *manager)
+{
+    TlmManagerPrivate *priv = manager->priv;
+
+    if (priv->config_reload_id) {
+        g_source_remove (priv->config_reload_id);
+        priv->config_reload_id = 0;
+    }
+    if (priv->config_monitor) {
+        g_signal_handlers_disconnect_by_func (priv->config_monitor,
+                _config_file_changed_cb, manager);
+        g_file_monitor_cancel (priv->config_monitor);
+        g_clear_object (&priv->config_monitor);
+    }
+    g_clear_string (&priv->config_monitor_path);
+}
+
 void
 tlm_manager_sighup_received (TlmManager *manager)
 {
     g_return_if_fail (manager && TLM_IS_MANAGER (manager));
 
-    DBG ("sighup recvd. reload configuration and account plugin");
-    tlm_config_reload (manager->priv->config);
-    g_clear_object (&manager->priv->account_plugin);
-    _load_accounts_plugin (manager,
-                           tlm_config_get_string_default (manager->priv->config,
-                                                          TLM_CONFIG_GENERAL,
-                                                          TLM_CONFIG_GENERAL_ACCOUNTS_PLUGIN,
-                                                          "default"));
+    DBG ("sighup recvd. reload configuration");
+    _reload_config (manager);
 }
 
@@ -76,6 +76,14 @@ TlmSeat *
 tlm_manager_get_seat_by_sessionid (TlmManager *manager,
         const gchar *session_id);
 
+gboolean
+tlm_manager_add_seat (TlmManager *manager, const gchar *seat_id,
+        GHashTable *seat_config, gboolean persist, GError **error);
+
+gboolean
+tlm_manager_remove_seat (TlmManager *manager, const gchar *seat_id,
+        gboolean persist, GError **error);
+
 void
 tlm_manager_sighup_received (TlmManager *manager);
 
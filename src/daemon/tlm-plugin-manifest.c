@@ -0,0 +1,350 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of tlm (Tiny Login Manager)
+ *
+ * Copyright (C) 2014 Intel Corporation.
+ *
+ * Contact: Jussi Laako <jussi.laako@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#include "config.h"
+#include "tlm-plugin-manifest.h"
+#include "tlm-log.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <gmodule.h>
+#include <glib/gstdio.h>
+
+#define PLUGIN_PREFIX   "libtlm-plugin-"
+#define PLUGIN_SUFFIX   ".so"
+
+#define MANIFEST_GROUP          "Manifest"
+#define MANIFEST_KEY_DIRECTORY  "Directory"
+#define MANIFEST_KEY_MTIME      "MTime"
+#define MANIFEST_KEY_SIZE       "Size"
+#define MANIFEST_KEY_INODE      "Inode"
+#define MANIFEST_KEY_DEVICE     "Device"
+#define MANIFEST_KEY_CTIME      "CTime"
+#define MANIFEST_KEY_ACCOUNT    "Account"
+#define MANIFEST_KEY_AUTH       "Auth"
+
+/* the only way to learn the types without a manifest is to look for the
+ * plugin type functions, see _load_plugin_file() in tlm-manager.c */
+static TlmPluginTypes
+_probe_plugin (const gchar *file_path, const gchar *plugin_name)
+{
+    GModule *module = NULL;
+    gchar *symbol = NULL;
+    gpointer p = NULL;
+    TlmPluginTypes types = 0;
+
+    DBG ("probing plugin %s", file_path);
+    module = g_module_open (file_path,
+                            G_MODULE_BIND_LAZY | G_MODULE_BIND_LOCAL);
+    if (!module) {
+        DBG ("Plugin couldn't be opened: %s", g_module_error ());
+        return 0;
+    }
+
+    symbol = g_strdup_printf ("tlm_account_plugin_%s_get_type", plugin_name);
+    if (g_module_symbol (module, symbol, &p))
+        types |= TLM_PLUGIN_TYPE_ACCOUNT;
+    g_free (symbol);
+
+    symbol = g_strdup_printf ("tlm_auth_plugin_%s_get_type", plugin_name);
+    if (g_module_symbol (module, symbol, &p))
+        types |= TLM_PLUGIN_TYPE_AUTH;
+    g_free (symbol);
+
+    g_module_close (module);
+    return types;
+}
+
+static GKeyFile *
+_load_manifest (const gchar *plugins_path)
+{
+#ifdef TLM_PLUGINS_MANIFEST_FILE
+    GKeyFile *manifest = NULL;
+    GError *error = NULL;
+    gchar *directory = NULL;
+    struct stat st;
+
+    if (g_stat (TLM_PLUGINS_MANIFEST_FILE, &st) != 0)
+        return NULL;
+    /* it decides which code is loaded into tlm */
+    if (st.st_uid != 0 || (st.st_mode & (S_IWGRP | S_IWOTH))) {
+        WARN ("ignoring plugin manifest %s with unsafe owner or mode",
+              TLM_PLUGINS_MANIFEST_FILE);
+        return NULL;
+    }
+
+    manifest = g_key_file_new ();
+    if (!g_key_file_load_from_file (manifest, TLM_PLUGINS_MANIFEST_FILE,
+                                    G_KEY_FILE_NONE, &error)) {
+        WARN ("error reading plugin manifest: %s", error->message);
+        g_error_free (error);
+        g_key_file_free (manifest);
+        return NULL;
+    }
+
+    directory = g_key_file_get_string (manifest, MANIFEST_GROUP,
+                                       MANIFEST_KEY_DIRECTORY, NULL);
+    if (g_strcmp0 (directory, plugins_path) != 0) {
+        DBG ("plugin manifest is for %s", directory);
+        g_free (directory);
+        g_key_file_free (manifest);
+        return NULL;
+    }
+    g_free (directory);
+
+    return manifest;
+#else
+    return NULL;
+#endif
+}
+
+static void
+_save_manifest (GKeyFile *manifest)
+{
+#ifdef TLM_PLUGINS_MANIFEST_FILE
+    GError *error = NULL;
+    gchar *data = NULL;
+    gchar *dir = NULL;
+    gsize len = 0;
+
+    /* only root may provide the manifest, see _load_manifest() */
+    if (geteuid () != 0)
+        return;
+
+    dir = g_path_get_dirname (TLM_PLUGINS_MANIFEST_FILE);
+    g_mkdir_with_parents (dir, 0755);
+    g_free (dir);
+
+    data = g_key_file_to_data (manifest, &len, NULL);
+    if (!g_file_set_contents (TLM_PLUGINS_MANIFEST_FILE, data, len, &error)) {
+        WARN ("failed to write plugin manifest: %s", error->message);
+        g_error_free (error);
+    } else {
+        DBG ("plugin manifest written to %s", TLM_PLUGINS_MANIFEST_FILE);
+    }
+    g_free (data);
+#endif
+}
+
+/* in nanoseconds, the change time can not be set from user space */
+static gint64
+_get_ctime (const struct stat *st)
+{
+    return (gint64) st->st_ctim.tv_sec * 1000000000 + st->st_ctim.tv_nsec;
+}
+
+static gboolean
+_key_matches (
+        GKeyFile *manifest,
+        const gchar *plugin_name,
+        const gchar *key,
+        gint64 value)
+{
+    GError *error = NULL;
+    gint64 stored = g_key_file_get_int64 (manifest, plugin_name, key,
+                                          &error);
+
+    if (error) {
+        g_error_free (error);
+        return FALSE;
+    }
+    return stored == value;
+}
+
+/* a plugin replaced by a same sized build with its mtime preserved, like
+ * with cp -p, still gets a new inode or change time */
+static gboolean
+_lookup_plugin (
+        GKeyFile *manifest,
+        const gchar *plugin_name,
+        const struct stat *st,
+        TlmPluginTypes *types)
+{
+    if (!g_key_file_has_group (manifest, plugin_name) ||
+        !_key_matches (manifest, plugin_name, MANIFEST_KEY_MTIME,
+                       (gint64) st->st_mtime) ||
+        !_key_matches (manifest, plugin_name, MANIFEST_KEY_SIZE,
+                       (gint64) st->st_size) ||
+        !_key_matches (manifest, plugin_name, MANIFEST_KEY_INODE,
+                       (gint64) st->st_ino) ||
+        !_key_matches (manifest, plugin_name, MANIFEST_KEY_DEVICE,
+                       (gint64) st->st_dev) ||
+        !_key_matches (manifest, plugin_name, MANIFEST_KEY_CTIME,
+                       _get_ctime (st)))
+        return FALSE;
+
+    *types = 0;
+    if (g_key_file_get_boolean (manifest, plugin_name, MANIFEST_KEY_ACCOUNT,
+                                NULL))
+        *types |= TLM_PLUGIN_TYPE_ACCOUNT;
+    if (g_key_file_get_boolean (manifest, plugin_name, MANIFEST_KEY_AUTH,
+                                NULL))
+        *types |= TLM_PLUGIN_TYPE_AUTH;
+    return TRUE;
+}
+
+static void
+_record_plugin (
+        GKeyFile *manifest,
+        const gchar *plugin_name,
+        const struct stat *st,
+        TlmPluginTypes types)
+{
+    g_key_file_set_int64 (manifest, plugin_name, MANIFEST_KEY_MTIME,
+                          (gint64) st->st_mtime);
+    g_key_file_set_int64 (manifest, plugin_name, MANIFEST_KEY_SIZE,
+                          (gint64) st->st_size);
+    g_key_file_set_int64 (manifest, plugin_name, MANIFEST_KEY_INODE,
+                          (gint64) st->st_ino);
+    g_key_file_set_int64 (manifest, plugin_name, MANIFEST_KEY_DEVICE,
+                          (gint64) st->st_dev);
+    g_key_file_set_int64 (manifest, plugin_name, MANIFEST_KEY_CTIME,
+                          _get_ctime (st));
+    g_key_file_set_boolean (manifest, plugin_name, MANIFEST_KEY_ACCOUNT,
+                            (types & TLM_PLUGIN_TYPE_ACCOUNT) != 0);
+    g_key_file_set_boolean (manifest, plugin_name, MANIFEST_KEY_AUTH,
+                            (types & TLM_PLUGIN_TYPE_AUTH) != 0);
+}
+
+/**
+ * tlm_plugin_manifest_load:
+ * @plugins_path: the plugins directory
+ *
+ * Lists the plugins in @plugins_path with the plugin types they provide.
+ * Plugins that are not in the manifest yet, or that changed since, are
+ * opened once to find out; the manifest is updated then.
+ *
+ * Returns: (transfer full): { plugin name: #TlmPluginTypes } of the plugins
+ * that provide any type.
+ */
+GHashTable *
+tlm_plugin_manifest_load (const gchar *plugins_path)
+{
+    GHashTable *plugins = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                 g_free, NULL);
+    GHashTable *found = NULL;
+    GKeyFile *manifest = NULL;
+    gboolean dirty = FALSE;
+    GDir *plugins_dir = NULL;
+    GError *error = NULL;
+    const gchar *file_name = NULL;
+    gchar **groups = NULL;
+    gint i;
+
+    g_return_val_if_fail (plugins_path, plugins);
+
+    plugins_dir = g_dir_open (plugins_path, 0, &error);
+    if (!plugins_dir) {
+        WARN ("Failed to open plugins folder '%s' : %s", plugins_path,
+              error ? error->message : "NULL");
+        g_error_free (error);
+        return plugins;
+    }
+
+    found = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+    manifest = _load_manifest (plugins_path);
+    if (!manifest) {
+        manifest = g_key_file_new ();
+        g_key_file_set_string (manifest, MANIFEST_GROUP,
+                               MANIFEST_KEY_DIRECTORY, plugins_path);
+        dirty = TRUE;
+    }
+
+    while ((file_name = g_dir_read_name (plugins_dir)) != NULL) {
+        gchar *file_path = NULL;
+        gchar *plugin_name = NULL;
+        TlmPluginTypes types = 0;
+        struct stat st;
+
+        if (!g_str_has_prefix (file_name, PLUGIN_PREFIX) ||
+            !g_str_has_suffix (file_name, PLUGIN_SUFFIX))
+            continue;
+
+        file_path = g_build_filename (plugins_path, file_name, NULL);
+        if (g_stat (file_path, &st) != 0 || !S_ISREG (st.st_mode)) {
+            WARN ("Ignoring plugin : %s", file_path);
+            g_free (file_path);
+            continue;
+        }
+        plugin_name = g_strndup (file_name + strlen (PLUGIN_PREFIX),
+                                 strlen (file_name) - strlen (PLUGIN_PREFIX) -
+                                 strlen (PLUGIN_SUFFIX));
+
+        if (!_lookup_plugin (manifest, plugin_name, &st, &types)) {
+            types = _probe_plugin (file_path, plugin_name);
+            _record_plugin (manifest, plugin_name, &st, types);
+            dirty = TRUE;
+        }
+        DBG ("plugin '%s' types 0x%x", plugin_name, types);
+        g_hash_table_add (found, g_strdup (plugin_name));
+
+        if (types)
+            g_hash_table_insert (plugins, plugin_name,
+                                 GUINT_TO_POINTER (types));
+        else
+            g_free (plugin_name);
+        g_free (file_path);
+    }
+    g_dir_close (plugins_dir);
+
+    /* forget the plugins that were removed */
+    groups = g_key_file_get_groups (manifest, NULL);
+    for (i = 0; groups[i]; i++) {
+        if (g_strcmp0 (groups[i], MANIFEST_GROUP) != 0 &&
+            !g_hash_table_contains (found, groups[i])) {
+            g_key_file_remove_group (manifest, groups[i], NULL);
+            dirty = TRUE;
+        }
+    }
+    g_strfreev (groups);
+    g_hash_table_unref (found);
+
+    if (dirty)
+        _save_manifest (manifest);
+    g_key_file_free (manifest);
+
+    return plugins;
+}
+
+/**
+ * tlm_plugin_manifest_build_path:
+ * @plugins_path: the plugins directory
+ * @plugin_name: the name of the plugin
+ *
+ * Returns: (transfer full): the path of the plugin module
+ */
+gchar *
+tlm_plugin_manifest_build_path (
+        const gchar *plugins_path,
+        const gchar *plugin_name)
+{
+    gchar *file_name = g_strconcat (PLUGIN_PREFIX, plugin_name, PLUGIN_SUFFIX,
+                                    NULL);
+    gchar *file_path = g_build_filename (plugins_path, file_name, NULL);
+
+    g_free (file_name);
+    return file_path;
+}
@@ -0,0 +1,48 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of tlm (Tiny Login Manager)
+ *
+ * Copyright (C) 2014 Intel Corporation.
+ *
+ * Contact: Jussi Laako <jussi.laako@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#ifndef _TLM_PLUGIN_MANIFEST_H
+#define _TLM_PLUGIN_MANIFEST_H
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+    TLM_PLUGIN_TYPE_ACCOUNT = 1 << 0,
+    TLM_PLUGIN_TYPE_AUTH    = 1 << 1
+} TlmPluginTypes;
+
+GHashTable *
+tlm_plugin_manifest_load (const gchar *plugins_path);
+
+gchar *
+tlm_plugin_manifest_build_path (
+        const gchar *plugins_path,
+        const gchar *plugin_name);
+
+G_END_DECLS
+
+#endif /* _TLM_PLUGIN_MANIFEST_H */
@@ -0,0 +1,209 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of tlm (Tiny Login Manager)
+ *
+ * Copyright (C) 2014 Intel Corporation.
+ *
+ * Contact: Jussi Laako <jussi.laako@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+
+#include "config.h"
+#include "tlm-seat-worker.h"
+#include "tlm-log.h"
+
+/**
+ * SECTION:tlm-seat-worker
+ * @short_description: thread for the blocking work of seats
+ * @include: tlm-seat-worker.h
+ *
+ * #TlmSeatWorker runs jobs one after the other on a thread of its own, with
+ * its own #GMainContext as the thread default context. The jobs are
+ * completed back in the context that pushed them, so the seats stay on the
+ * main loop and only the work that blocks moves over.
+ *
+ * This is not a thread per seat: only the guest account preparation and
+ * cleanup run on the workers. These stay shared by all the seats:
+ * - the main loop, with the session state of every seat, the D-Bus
+ * observers and the handshakes with tlm-sessiond; these do not block
+ * - the user lookups of tlm_user_info_lookup(), which block on a cache
+ * miss with a slow NSS backend
+ * - the VT allocation and switching ioctls
+ * - the PAM verification of user switches, on the pool of
+ * #TLM_CONFIG_GENERAL_AUTH_WORKERS threads
+ *
+ * The PAM conversation of a login and the utmp entry run in the
+ * tlm-sessiond process of the seat.
+ */
+
+struct _TlmSeatWorker
+{
+    gchar *name;
+    GMainContext *context;
+    GMainLoop *loop;
+    GThread *thread;
+};
+
+typedef struct _TlmSeatWorkerJob
+{
+    TlmSeatWorkerFunc func;
+    TlmSeatWorkerFunc done;
+    gpointer data;
+    GMainContext *caller; /* where done runs */
+} TlmSeatWorkerJob;
+
+static gpointer
+_worker_thread (gpointer user_data)
+{
+    TlmSeatWorker *self = user_data;
+
+    DBG ("worker %s running", self->name);
+    g_main_context_push_thread_default (self->context);
+    g_main_loop_run (self->loop);
+    g_main_context_pop_thread_default (self->context);
+    DBG ("worker %s stopped", self->name);
+
+    return NULL;
+}
+
+static gboolean
+_job_done (gpointer user_data)
+{
+    TlmSeatWorkerJob *job = user_data;
+
+    job->done (job->data);
+    g_main_context_unref (job->caller);
+    g_slice_free (TlmSeatWorkerJob, job);
+
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean
+_run_job (gpointer user_data)
+{
+    TlmSeatWorkerJob *job = user_data;
+    GSource *source = NULL;
+
+    if (job->func)
+        job->func (job->data);
+
+    if (!job->done) {
+        g_main_context_unref (job->caller);
+        g_slice_free (TlmSeatWorkerJob, job);
+        return G_SOURCE_REMOVE;
+    }
+
+    source = g_idle_source_new ();
+    g_source_set_callback (source, _job_done, job, NULL);
+    g_source_attach (source, job->caller);
+    g_source_unref (source);
+
+    return G_SOURCE_REMOVE;
+}
+
+static gboolean
+_quit (gpointer user_data)
+{
+    g_main_loop_quit ((GMainLoop *) user_data);
+
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * tlm_seat_worker_new:
+ * @name: name of the thread
+ *
+ * Starts a worker thread.
+ *
+ * Returns: (transfer full): a new #TlmSeatWorker, free with
+ * tlm_seat_worker_free()
+ */
+TlmSeatWorker *
+tlm_seat_worker_new (const gchar *name)
+{
+    TlmSeatWorker *self = g_slice_new0 (TlmSeatWorker);
+
+    self->name = g_strdup (name);
+    self->context = g_main_context_new ();
+    self->loop = g_main_loop_new (self->context, FALSE);
+    self->thread = g_thread_new (name, _worker_thread, self);
+
+    return self;
+}
+
+/**
+ * tlm_seat_worker_free:
+ * @self: (transfer full): a #TlmSeatWorker
+ *
+ * Stops the worker once the jobs pushed so far are done and waits for it.
+ * The completions of those jobs are still dispatched in their contexts.
+ */
+void
+tlm_seat_worker_free (TlmSeatWorker *self)
+{
+    GSource *source = NULL;
+
+    g_return_if_fail (self);
+
+    /* behind the queued jobs */
+    source = g_idle_source_new ();
+    g_source_set_callback (source, _quit, self->loop, NULL);
+    g_source_attach (source, self->context);
+    g_source_unref (source);
+    g_thread_join (self->thread);
+
+    g_main_loop_unref (self->loop);
+    g_main_context_unref (self->context);
+    g_free (self->name);
+    g_slice_free (TlmSeatWorker, self);
+}
+
+/**
+ * tlm_seat_worker_push:
+ * @self: (transfer none): a #TlmSeatWorker
+ * @func: (allow-none): function run on the worker thread
+ * @done: (allow-none): function run afterwards in the thread default
+ * context of the caller
+ * @data: data passed to both
+ *
+ * Queues a job, the jobs of a worker are run in the order they were pushed.
+ */
+void
+tlm_seat_worker_push (
+        TlmSeatWorker *self,
+        TlmSeatWorkerFunc func,
+        TlmSeatWorkerFunc done,
+        gpointer data)
+{
+    TlmSeatWorkerJob *job = NULL;
+    GSource *source = NULL;
+
+    g_return_if_fail (self);
+
+    job = g_slice_new0 (TlmSeatWorkerJob);
+    job->func = func;
+    job->done = done;
+    job->data = data;
+    job->caller = g_main_context_ref_thread_default ();
+
+    source = g_idle_source_new ();
+    g_source_set_callback (source, _run_job, job, NULL);
+    g_source_attach (source, self->context);
+    g_source_unref (source);
+}
@@ -24,10 +24,13 @@
  * 02110-1301 USA
  */
 
+#include <errno.h>
 #include <string.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/ioctl.h>
+#include <linux/vt.h>
 
 #include "config.h"
 
@@ -37,6 +40,9 @@
 #include "tlm-error.h"
 #include "tlm-utils.h"
 #include "tlm-config-general.h"
+#include "tlm-config-seat.h"
+#include "tlm-seat-config.h"
+#include "tlm-user-info.h"
 #include "tlm-dbus-observer.h"
 
 G_DEFINE_TYPE (TlmSeat, tlm_seat, G_TYPE_OBJECT);
@@ -67,6 +73,7 @@ static guint signals[SIG_MAX];
 struct _TlmSeatPrivate
 {
     TlmConfig *config;
+    TlmSeatConfig *seat_config; /* snapshot taken at the last login */
     gchar *id;
     gchar *default_user;
     gchar *path;
@@ -81,6 +88,22 @@ struct _TlmSeatPrivate
     TlmDbusObserver *dbus_observer; /* dbus server accessed only by user who has
     active session */
     TlmDbusObserver *prev_dbus_observer;
+    GQueue *sessiond_pool; /* idle, already connected TlmSessionRemote's */
+    guint pool_refill_id;
+    GCancellable *switch_cancellable; /* set while verifying a switch */
+    GVariant *auth_token; /* single-use token of the last verified switch */
+    guint session_vtnr; /* VT of the active session */
+    gchar *session_verifier; /* verifier of the active session's password */
+    guint session_serial; /* credentials serial the verifier was made at */
+    GCancellable *verifier_cancellable; /* set while deriving it */
+    gchar *verifier_salt;
+    GList *parked_sessions; /* ParkedSession's, most recently parked first */
+    TlmSessionRemote *closing_session; /* terminating while the next one is
+                                          already coming up */
+    TlmSeatWorker *worker; /* not owned, NULL to run the jobs in place */
+    guint pending_jobs;
+    struct _DelayClosure *held_login; /* waiting for the pending jobs */
+    TlmAccountPool *account_pool; /* not owned, leases the default user */
 };
 
 typedef struct _DelayClosure
@@ -92,10 +115,45 @@ typedef struct _DelayClosure
     GHashTable *environment;
 } DelayClosure;
 
+/* seat is not referenced: the verification is cancelled on seat dispose */
+typedef struct _SwitchClosure
+{
+    TlmSeat *seat;
+    gchar *service;
+    gchar *username;
+    gchar *password;
+    GHashTable *environment;
+    guint serial; /* credentials serial when the switch was requested */
+} SwitchClosure;
+
+/* a job of tlm_seat_run_job() */
+typedef struct _SeatJob
+{
+    TlmSeat *seat; /* weak */
+    TlmSeatWorkerFunc func;
+    gpointer data;
+    GDestroyNotify destroy;
+} SeatJob;
+
+/* a session kept running in the background after a user switch */
+typedef struct _ParkedSession
+{
+    TlmSessionRemote *session;
+    gchar *username;
+    gchar *verifier;
+    guint serial; /* credentials serial the verifier was made at */
+    guint vtnr;
+} ParkedSession;
+
 static void
 _disconnect_session_signals (
         TlmSeat *seat);
 
+static void
+_activate_parked_session (
+        TlmSeat *seat,
+        ParkedSession *parked);
+
 static void
 _reset_next (TlmSeatPrivate *priv)
 {
@@ -108,6 +166,133 @@ _reset_next (TlmSeatPrivate *priv)
     }
 }
 
+static void
+_clear_auth_token (TlmSeatPrivate *priv)
+{
+    if (priv->auth_token) {
+        g_variant_unref (priv->auth_token);
+        priv->auth_token = NULL;
+    }
+}
+
+/* renewed by tlm_seat_create_session(), configuration reloaded in between
+ * applies from the next login on */
+static TlmSeatConfig *
+_get_seat_config (TlmSeatPrivate *priv)
+{
+    if (!priv->seat_config)
+        priv->seat_config = tlm_config_get_seat_config (priv->config,
+                                                        priv->id);
+    return priv->seat_config;
+}
+
+static void
+_clear_seat_config (TlmSeatPrivate *priv)
+{
+    if (priv->seat_config) {
+        tlm_seat_config_unref (priv->seat_config);
+        priv->seat_config = NULL;
+    }
+}
+
+static void
+_held_login_free (DelayClosure *held)
+{
+    g_free (held->service);
+    g_free (held->username);
+    g_free (held->password);
+    if (held->environment)
+        g_hash_table_unref (held->environment);
+    g_slice_free (DelayClosure, held);
+}
+
+static void
+_clear_held_login (TlmSeatPrivate *priv)
+{
+    if (!priv->held_login) return;
+
+    _held_login_free (priv->held_login);
+    priv->held_login = NULL;
+}
+
+static const gchar *
+_resolve_pam_service (
+        TlmSeat *seat,
+        const gchar *service,
+        const gchar *username)
+{
+    TlmSeatPrivate *priv = TLM_SEAT_PRIV (seat);
+
+    if (service)
+        return service;
+
+    DBG ("PAM service not defined, looking up configuration");
+    return username ? _get_seat_config (priv)->pam_service :
+                      _get_seat_config (priv)->default_pam_service;
+}
+
+static void
+_issue_auth_token (
+        TlmSeat *seat,
+        const gchar *service,
+        const gchar *username)
+{
+    TlmSeatPrivate *priv = TLM_SEAT_PRIV (seat);
+    guint lifetime = 0;
+
+    _clear_auth_token (priv);
+
+    lifetime = _get_seat_config (priv)->auth_token_lifetime;
+    if (lifetime == 0)
+        return;
+
+    /* sessiond may only skip the authentication stack that actually
+     * verified the password */
+    service = _resolve_pam_service (seat, service, username);
+    if (g_strcmp0 (service,
+            tlm_authenticate_user_get_service (priv->config)) != 0) {
+        DBG ("session service '%s' differs from authentication service, "
+             "no auth token", service);
+        return;
+    }
+
+    /* the nonce is filled in by the session with the secret of the
+     * sessiond the token is sent to */
+    priv->auth_token = g_variant_ref_sink (g_variant_new ("(ssssx)",
+            "", priv->id, username, service,
+            g_get_monotonic_time () + (gint64) lifetime * G_USEC_PER_SEC));
+}
+
+/* returns the token if it was issued for this login, the stored token is
+ * dropped either way */
+static GVariant *
+_take_auth_token (
+        TlmSeat *seat,
+        const gchar *service,
+        const gchar *username)
+{
+    TlmSeatPrivate *priv = TLM_SEAT_PRIV (seat);
+    GVariant *token = priv->auth_token;
+    const gchar *token_user = NULL;
+    const gchar *token_service = NULL;
+    gint64 expiry = 0;
+
+    priv->auth_token = NULL;
+    if (!token)
+        return NULL;
+
+    g_variant_get (token, "(&s&s&s&sx)", NULL, NULL, &token_user,
+            &token_service, &expiry);
+    if (g_strcmp0 (token_user, username) != 0 ||
+        g_strcmp0 (token_service, service) != 0 ||
+        expiry <= g_get_monotonic_time ()) {
+        DBG ("dropping stale auth token of user '%s'", token_user);
+        g_variant_unref (token);
+        return NULL;
+    }
+    return token;
+}
+
 static void
 _handle_session_created (
         TlmSeat *self,
@@ -123,6 +308,48 @@ _handle_session_created (
     g_clear_object (&self->priv->prev_dbus_observer);
 }
 
+static void
+_clear_session_verifier (TlmSeatPrivate *priv)
+{
+    if (priv->verifier_cancellable) {
+        g_cancellable_cancel (priv->verifier_cancellable);
+        g_clear_object (&priv->verifier_cancellable);
+    }
+    g_clear_string (&priv->session_verifier);
+}
+
+static void
+_session_verifier_derived (
+        gboolean derived,
+        const gchar *verifier,
+        gpointer user_data)
+{
+    TlmSeatPrivate *priv = TLM_SEAT_PRIV (TLM_SEAT (user_data));
+
+    g_clear_object (&priv->verifier_cancellable);
+    priv->session_verifier = g_strdup (verifier);
+}
+
+/* lets a parked session be resumed without another PAM conversation, the
+ * derivation is slow on purpose so it runs on the authentication workers */
+static void
+_derive_session_verifier (
+        TlmSeat *seat,
+        const gchar *password)
+{
+    TlmSeatPrivate *priv = TLM_SEAT_PRIV (seat);
+
+    _clear_session_verifier (priv);
+    if (!password || !*password)
+        return;
+
+    priv->session_serial = tlm_user_info_get_credentials_serial ();
+    priv->verifier_cancellable = g_cancellable_new ();
+    tlm_derive_verifier_async (priv->config, password, priv->verifier_salt,
+            priv->verifier_cancellable, _session_verifier_derived, seat,
+            NULL);
+}
+
 static void
 _close_active_session (TlmSeat *self)
 {
@@ -130,6 +357,8 @@ _close_active_session (TlmSeat *self)
     _disconnect_session_signals (self);
     if (priv->session)
         g_clear_object (&priv->session);
+    _clear_session_verifier (priv);
+    priv->session_vtnr = 0;
 }
 
 static void
@@ -158,21 +387,14 @@ _handle_session_terminated (
     }
     g_clear_object (&priv->dbus_observer);
 
-    if (tlm_config_get_boolean (priv->config,
-                                TLM_CONFIG_GENERAL,
-                                TLM_CONFIG_GENERAL_X11_SESSION,
-                                FALSE)) {
+    if (_get_seat_config (priv)->x11_session) {
         DBG ("X11 session termination");
         if (kill (0, SIGTERM))
             WARN ("Failed to send TERM signal to process tree");
         return;
     }
 
-    if (tlm_config_get_boolean (priv->config,
-                                TLM_CONFIG_GENERAL,
-                                TLM_CONFIG_GENERAL_AUTO_LOGIN,
-                                TRUE) ||
-                                seat->priv->next_user) {
+    if (_get_seat_config (priv)->auto_login || seat->priv->next_user) {
         DBG ("auto re-login with '%s'", seat->priv->next_user);
         tlm_seat_create_session (seat,
                 seat->priv->next_service,
@@ -196,7 +418,11 @@ _handle_error (
 
     if (error->code == TLM_ERROR_PAM_AUTH_FAILURE ||
         error->code == TLM_ERROR_SESSION_CREATION_FAILURE ||
-        error->code == TLM_ERROR_SESSION_TERMINATION_FAILURE) {
+        error->code == TLM_ERROR_SESSION_TERMINATION_FAILURE ||
+        error->code == TLM_ERROR_SESSION_CONNECT_FAILURE ||
+        error->code == TLM_ERROR_SESSION_PROXY_FAILURE ||
+        error->code == TLM_ERROR_SESSION_REQUEST_FAILURE ||
+        error->code == TLM_ERROR_SESSION_SETUP_TIMEOUT) {
         DBG ("Destroy the session in case of creation/termination failure");
         _close_active_session (self);
         g_clear_object (&self->priv->dbus_observer);
@@ -251,23 +477,91 @@ _connect_session_signals (
             G_CALLBACK(_handle_session_info), seat);
 }
 
+static guint
+_get_sessiond_pool_size (TlmSeatPrivate *priv)
+{
+    return _get_seat_config (priv)->sessiond_pool_size;
+}
+
+static gboolean
+_refill_sessiond_pool (gpointer user_data)
+{
+    TlmSeat *seat = TLM_SEAT (user_data);
+    TlmSeatPrivate *priv = TLM_SEAT_PRIV (seat);
+    TlmSessionRemote *session = NULL;
+
+    if (g_queue_get_length (priv->sessiond_pool) >=
+        _get_sessiond_pool_size (priv)) {
+        priv->pool_refill_id = 0;
+        return G_SOURCE_REMOVE;
+    }
+
+    /* one helper per iteration to keep the main loop responsive */
+    session = tlm_session_remote_spawn (priv->config);
+    if (!session) {
+        WARN ("failed to pre-spawn sessiond for seat %s", priv->id);
+        priv->pool_refill_id = 0;
+        return G_SOURCE_REMOVE;
+    }
+    g_queue_push_tail (priv->sessiond_pool, session);
+    DBG ("seat %s: %u sessiond(s) pooled", priv->id,
+         g_queue_get_length (priv->sessiond_pool));
+
+    return G_SOURCE_CONTINUE;
+}
+
+static void
+_schedule_sessiond_pool_refill (TlmSeat *seat)
+{
+    TlmSeatPrivate *priv = TLM_SEAT_PRIV (seat);
+
+    if (priv->pool_refill_id || _get_sessiond_pool_size (priv) == 0)
+        return;
+    priv->pool_refill_id = g_idle_add_full (G_PRIORITY_LOW,
+            _refill_sessiond_pool, seat, NULL);
+}
+
+static TlmSessionRemote *
+_take_pooled_session (TlmSeat *seat)
+{
+    TlmSeatPrivate *priv = TLM_SEAT_PRIV (seat);
+    TlmSessionRemote *session = NULL;
+
+    while ((session = g_queue_pop_head (priv->sessiond_pool))) {
+        if (tlm_session_remote_is_alive (session))
+            break;
+        DBG ("dropping dead pooled sessiond %p", session);
+        g_object_unref (session);
+    }
+    return session;
+}
+
+static void
+_clear_sessiond_pool (TlmSeatPrivate *priv)
+{
+    if (priv->pool_refill_id) {
+        g_source_remove (priv->pool_refill_id);
+        priv->pool_refill_id = 0;
+    }
+    if (priv->sessiond_pool) {
+        g_queue_free_full (priv->sessiond_pool, g_object_unref);
+        priv->sessiond_pool = NULL;
+    }
+}
+
 static gboolean
 _create_dbus_observer (
         TlmSeat *seat,
-        const gchar *username)
+        TlmUserInfo *user_info)
 {
     gchar *address = NULL;
-    gint uid = -1;
-
-    if (!username) return FALSE;
 
-    uid = tlm_user_get_uid (username);
-    if (uid == -1) return FALSE;
+    if (!user_info) return FALSE;
 
     address = g_strdup_printf ("unix:path=%s/%s-%d", TLM_DBUS_SOCKET_PATH,
-            seat->priv->id, uid);
+            seat->priv->id, (gint) user_info->uid);
     seat->priv->dbus_observer = TLM_DBUS_OBSERVER (tlm_dbus_observer_new (
-            NULL, seat, address, uid,
+            NULL, seat, address, user_info->uid,
             DBUS_OBSERVER_ENABLE_LOGOUT_USER |
             DBUS_OBSERVER_ENABLE_SWITCH_USER));
     g_free (address);
@@ -275,6 +569,307 @@ _create_dbus_observer (
     return (seat->priv->dbus_observer != NULL);
 }
 
+static guint
+_get_max_parked_sessions (TlmSeatPrivate *priv)
+{
+    return _get_seat_config (priv)->max_parked_sessions;
+}
+
+static gboolean
+_get_freeze_parked_sessions (TlmSeatPrivate *priv)
+{
+    return _get_seat_config (priv)->freeze_parked_sessions;
+}
+
+static void
+_handle_parked_session_terminated (
+        TlmSessionRemote *session,
+        const gchar *sessionid,
+        gpointer user_data);
+
+static void
+_parked_session_free (ParkedSession *parked)
+{
+    g_signal_handlers_disconnect_matched (parked->session,
+            G_SIGNAL_MATCH_FUNC, 0, 0, NULL,
+            _handle_parked_session_terminated, NULL);
+    /* logs the session out if it is still running */
+    g_object_unref (parked->session);
+    g_free (parked->username);
+    g_clear_string (&parked->verifier);
+    g_slice_free (ParkedSession, parked);
+}
+
+static void
+_clear_parked_sessions (TlmSeatPrivate *priv)
+{
+    g_list_free_full (priv->parked_sessions,
+            (GDestroyNotify) _parked_session_free);
+    priv->parked_sessions = NULL;
+}
+
+static ParkedSession *
+_find_parked_session (
+        TlmSeatPrivate *priv,
+        const gchar *username)
+{
+    GList *elem;
+
+    for (elem = priv->parked_sessions; elem; elem = g_list_next (elem)) {
+        ParkedSession *parked = elem->data;
+        if (g_strcmp0 (parked->username, username) == 0)
+            return parked;
+    }
+    return NULL;
+}
+
+static void
+_handle_parked_session_terminated (
+        TlmSessionRemote *session,
+        const gchar *sessionid,
+        gpointer user_data)
+{
+    TlmSeatPrivate *priv = TLM_SEAT_PRIV (TLM_SEAT (user_data));
+    GList *elem;
+
+    for (elem = priv->parked_sessions; elem; elem = g_list_next (elem)) {
+        ParkedSession *parked = elem->data;
+        if (parked->session != session)
+            continue;
+        DBG ("parked session of '%s' ended", parked->username);
+        priv->parked_sessions = g_list_delete_link (priv->parked_sessions,
+                elem);
+        _parked_session_free (parked);
+        return;
+    }
+}
+
+static gboolean
+_vt_in_use (
+        TlmSeatPrivate *priv,
+        guint vtnr)
+{
+    GList *elem;
+
+    if (priv->session && priv->session_vtnr == vtnr)
+        return TRUE;
+    for (elem = priv->parked_sessions; elem; elem = g_list_next (elem)) {
+        if (((ParkedSession *) elem->data)->vtnr == vtnr)
+            return TRUE;
+    }
+    return FALSE;
+}
+
+static guint
+_allocate_vt (TlmSeat *seat)
+{
+    TlmSeatPrivate *priv = TLM_SEAT_PRIV (seat);
+    int fd = -1;
+    int vtnr = 0;
+    guint base = _get_seat_config (priv)->vtnr;
+
+    if (base == 0 || !_vt_in_use (priv, base))
+        return base;
+
+    /* the seat's VT hosts a parked session, take the first unused one */
+    fd = open ("/dev/tty0", O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        WARN ("open(/dev/tty0): %s", strerror (errno));
+        return 0;
+    }
+    if (ioctl (fd, VT_OPENQRY, &vtnr) < 0 || vtnr <= 0) {
+        WARN ("ioctl(VT_OPENQRY) failed: %s", strerror (errno));
+        vtnr = 0;
+    }
+    close (fd);
+    return (guint) vtnr;
+}
+
+static void
+_activate_vt (guint vtnr)
+{
+    int fd = -1;
+
+    if (vtnr == 0)
+        return;
+    fd = open ("/dev/tty0", O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        WARN ("open(/dev/tty0): %s", strerror (errno));
+        return;
+    }
+    if (ioctl (fd, VT_ACTIVATE, (int) vtnr) < 0)
+        WARN ("ioctl(VT_ACTIVATE, %u) failed: %s", vtnr, strerror (errno));
+    close (fd);
+}
+
+static gboolean
+_park_active_session (TlmSeat *seat)
+{
+    TlmSeatPrivate *priv = TLM_SEAT_PRIV (seat);
+    guint max_parked = _get_max_parked_sessions (priv);
+    ParkedSession *parked = NULL;
+
+    /* default user sessions are recycled on logout, never park them */
+    if (!priv->session || max_parked == 0 || priv->session_vtnr == 0 ||
+        priv->default_active ||
+        !tlm_session_remote_get_sessionid (priv->session))
+        return FALSE;
+
+    while (g_list_length (priv->parked_sessions) >= max_parked) {
+        GList *oldest = g_list_last (priv->parked_sessions);
+        parked = oldest->data;
+        DBG ("too many parked sessions, logging out '%s'", parked->username);
+        priv->parked_sessions = g_list_delete_link (priv->parked_sessions,
+                oldest);
+        _parked_session_free (parked);
+    }
+
+    _disconnect_session_signals (seat);
+    parked = g_slice_new0 (ParkedSession);
+    parked->session = priv->session;
+    parked->verifier = priv->session_verifier;
+    parked->serial = priv->session_serial;
+    parked->vtnr = priv->session_vtnr;
+    g_object_get (G_OBJECT (parked->session), "username", &parked->username,
+            NULL);
+    priv->session = NULL;
+    priv->session_verifier = NULL;
+    _clear_session_verifier (priv);
+    priv->session_vtnr = 0;
+
+    g_signal_connect (parked->session, "session-terminated",
+            G_CALLBACK (_handle_parked_session_terminated), seat);
+    if (_get_freeze_parked_sessions (priv))
+        tlm_session_remote_set_frozen (parked->session, TRUE);
+
+    DBG ("parked session of '%s' on vt%u", parked->username, parked->vtnr);
+    priv->parked_sessions = g_list_prepend (priv->parked_sessions, parked);
+    return TRUE;
+}
+
+static void
+_activate_parked_session (
+        TlmSeat *seat,
+        ParkedSession *parked)
+{
+    TlmSeatPrivate *priv = TLM_SEAT_PRIV (seat);
+    TlmUserInfo *user_info = NULL;
+
+    DBG ("activating parked session of '%s' on vt%u", parked->username,
+         parked->vtnr);
+    priv->parked_sessions = g_list_remove (priv->parked_sessions, parked);
+    g_signal_handlers_disconnect_by_func (parked->session,
+            _handle_parked_session_terminated, seat);
+
+    if (priv->session && !_park_active_session (seat)) {
+        /* could not be kept, log it out without triggering a relogin */
+        if (priv->default_active) {
+            priv->default_active = FALSE;
+            g_signal_emit (seat, signals[SIG_PREPARE_USER_LOGOUT], 0,
+                    priv->default_user);
+        }
+        _close_active_session (seat);
+    }
+
+    priv->session = parked->session;
+    _clear_session_verifier (priv);
+    priv->session_verifier = parked->verifier;
+    priv->session_serial = parked->serial;
+    priv->session_vtnr = parked->vtnr;
+    _connect_session_signals (seat);
+    tlm_session_remote_set_frozen (priv->session, FALSE);
+    _activate_vt (priv->session_vtnr);
+
+    /* the observer of the previous user completes the switch request */
+    g_clear_object (&priv->prev_dbus_observer);
+    priv->prev_dbus_observer = priv->dbus_observer;
+    priv->dbus_observer = NULL;
+    user_info = tlm_user_info_lookup (parked->username);
+    if (!_create_dbus_observer (seat, user_info))
+        WARN ("no dbus observer for '%s'", parked->username);
+    if (user_info)
+        tlm_user_info_unref (user_info);
+
+    g_free (parked->username);
+    g_slice_free (ParkedSession, parked);
+
+    _handle_session_created (seat,
+            tlm_session_remote_get_sessionid (priv->session), NULL);
+}
+
+static gboolean
+_get_pipelined_relogin (TlmSeatPrivate *priv)
+{
+    return _get_seat_config (priv)->pipelined_relogin;
+}
+
+static void
+_handle_closing_session_terminated (
+        TlmSessionRemote *session,
+        const gchar *sessionid,
+        gpointer user_data)
+{
+    TlmSeat *seat = TLM_SEAT (user_data);
+    TlmSeatPrivate *priv = TLM_SEAT_PRIV (seat);
+    gboolean stop = FALSE;
+
+    DBG ("previous session %p is gone", session);
+    g_signal_handlers_disconnect_by_func (session,
+            _handle_closing_session_terminated, seat);
+    priv->closing_session = NULL;
+
+    /* the manager may drop the seat from its handler */
+    g_object_ref (seat);
+    g_signal_emit (seat, signals[SIG_SESSION_TERMINATED], 0, sessionid,
+            &stop);
+    if (!stop && priv->session) {
+        DBG ("releasing the next session");
+        tlm_session_remote_exec (priv->session);
+    }
+    g_object_unref (seat);
+    g_object_unref (session);
+}
+
+/* terminates the active session and starts the next one right away, the
+ * user session is started once the old one has exited */
+static gboolean
+_start_pipelined_relogin (
+        TlmSeat *seat,
+        const gchar *service,
+        const gchar *username,
+        const gchar *password,
+        GHashTable *environment)
+{
+    TlmSeatPrivate *priv = TLM_SEAT_PRIV (seat);
+
+    if (!_get_pipelined_relogin (priv) || priv->closing_session ||
+        !priv->session || !tlm_session_remote_is_alive (priv->session))
+        return FALSE;
+
+    /* the default user's home is recycled between its sessions */
+    if (!username && _get_seat_config (priv)->prepare_default)
+        return FALSE;
+
+    if (priv->default_active) {
+        priv->default_active = FALSE;
+        g_signal_emit (seat, signals[SIG_PREPARE_USER_LOGOUT], 0,
+                priv->default_user);
+    }
+
+    _disconnect_session_signals (seat);
+    priv->closing_session = priv->session;
+    priv->session = NULL;
+    _clear_session_verifier (priv);
+    priv->session_vtnr = 0;
+    g_signal_connect (priv->closing_session, "session-terminated",
+            G_CALLBACK (_handle_closing_session_terminated), seat);
+    tlm_session_remote_terminate (priv->closing_session);
+
+    DBG ("pipelined relogin with '%s'", username);
+    tlm_seat_create_session (seat, service, username, password, environment);
+    return TRUE;
+}
+
 static void
 tlm_seat_dispose (GObject *self)
 {
@@ -285,9 +880,25 @@ tlm_seat_dispose (GObject *self)
     g_clear_object (&seat->priv->dbus_observer);
     g_clear_object (&seat->priv->prev_dbus_observer);
 
+    if (seat->priv->switch_cancellable) {
+        g_cancellable_cancel (seat->priv->switch_cancellable);
+        g_clear_object (&seat->priv->switch_cancellable);
+    }
+    _clear_session_verifier (seat->priv);
+
+    _clear_sessiond_pool (seat->priv);
+    _clear_parked_sessions (seat->priv);
+    if (seat->priv->closing_session) {
+        g_signal_handlers_disconnect_by_func (seat->priv->closing_session,
+                _handle_closing_session_terminated, seat);
+        g_clear_object (&seat->priv->closing_session);
+    }
+
     _disconnect_session_signals (seat);
     if (seat->priv->session)
         g_clear_object (&seat->priv->session);
+    _clear_held_login (seat->priv);
+    _clear_seat_config (seat->priv);
     if (seat->priv->config) {
         g_object_unref (seat->priv->config);
         seat->priv->config = NULL;
@@ -307,6 +918,9 @@ tlm_seat_finalize (GObject *self)
     g_clear_string (&priv->path);
 
     _reset_next (priv);
+    _clear_auth_token (priv);
+    g_clear_string (&priv->session_verifier);
+    g_clear_string (&priv->verifier_salt);
 
     G_OBJECT_CLASS (tlm_seat_parent_class)->finalize (self);
 }
@@ -465,6 +1079,22 @@ tlm_seat_init (TlmSeat *seat)
     priv->id = priv->path = priv->default_user = NULL;
     priv->dbus_observer = priv->prev_dbus_observer = NULL;
     priv->default_active = FALSE;
+    priv->sessiond_pool = g_queue_new ();
+    priv->pool_refill_id = 0;
+    priv->auth_token = NULL;
+    priv->session_vtnr = 0;
+    priv->session_verifier = NULL;
+    priv->session_serial = 0;
+    priv->verifier_cancellable = NULL;
+    priv->verifier_salt = g_strdup_printf ("%08x%08x", g_random_int (),
+            g_random_int ());
+    priv->parked_sessions = NULL;
+    priv->closing_session = NULL;
+    priv->seat_config = NULL;
+    priv->worker = NULL;
+    priv->pending_jobs = 0;
+    priv->held_login = NULL;
+    priv->account_pool = NULL;
     seat->priv = priv;
 }
 
@@ -485,6 +1115,136 @@ tlm_seat_get_session_id (TlmSeat *seat)
     return tlm_session_remote_get_sessionid (seat->priv->session);
 }
 
+static void
+_switch_closure_free (SwitchClosure *closure)
+{
+    g_free (closure->service);
+    g_free (closure->username);
+    g_free (closure->password);
+    if (closure->environment)
+        g_hash_table_unref (closure->environment);
+    g_slice_free (SwitchClosure, closure);
+}
+
+static void
+_switch_user_authenticated (gboolean authenticated, gpointer user_data)
+{
+    SwitchClosure *closure = (SwitchClosure *) user_data;
+    TlmSeat *seat = closure->seat;
+    TlmSeatPrivate *priv = TLM_SEAT_PRIV (seat);
+    ParkedSession *parked = NULL;
+
+    g_clear_object (&priv->switch_cancellable);
+
+    // If username & its password is not authenticated, do not touch the
+    // current session.
+    if (!authenticated) {
+        WARN("fail to tlm_authenticate_user");
+        g_signal_emit (seat, signals[SIG_SESSION_ERROR], 0,
+                TLM_ERROR_PAM_AUTH_FAILURE);
+        return;
+    }
+
+    parked = _find_parked_session (priv, closure->username);
+    if (parked) {
+        _activate_parked_session (seat, parked);
+        return;
+    }
+
+    _issue_auth_token (seat, closure->service, closure->username);
+
+    if (!priv->session || _park_active_session (seat)) {
+        tlm_seat_create_session (seat, closure->service, closure->username,
+                closure->password, closure->environment);
+        return;
+    }
+
+    if (_start_pipelined_relogin (seat, closure->service, closure->username,
+            closure->password, closure->environment))
+        return;
+
+    _reset_next (priv);
+    priv->next_service = g_strdup (closure->service);
+    priv->next_user = g_strdup (closure->username);
+    priv->next_password = g_strdup (closure->password);
+    if (closure->environment)
+        priv->next_environment = g_hash_table_ref (closure->environment);
+
+    tlm_seat_terminate_session (seat);
+}
+
+/* verifier is NULL if the password matched the parked session's verifier
+ * and only the account was checked */
+static void
+_switch_to_parked_verified (
+        gboolean authenticated,
+        const gchar *verifier,
+        gpointer user_data)
+{
+    SwitchClosure *closure = (SwitchClosure *) user_data;
+    TlmSeat *seat = closure->seat;
+    TlmSeatPrivate *priv = TLM_SEAT_PRIV (seat);
+    ParkedSession *parked = NULL;
+
+    parked = _find_parked_session (priv, closure->username);
+    if (!authenticated) {
+        /* the password alone does not get the session back anymore */
+        if (parked)
+            g_clear_string (&parked->verifier);
+        _switch_user_authenticated (FALSE, user_data);
+        return;
+    }
+
+    if (!parked && !verifier) {
+        g_clear_object (&priv->switch_cancellable);
+        DBG ("parked session of '%s' ended, switching normally",
+             closure->username);
+        tlm_seat_switch_user (seat, closure->service, closure->username,
+                closure->password, closure->environment);
+        return;
+    }
+
+    if (parked && verifier) {
+        g_clear_string (&parked->verifier);
+        parked->verifier = g_strdup (verifier);
+        parked->serial = closure->serial;
+    }
+    _switch_user_authenticated (TRUE, user_data);
+}
+
+/* drops the verifiers made before the passwords may have changed */
+static void
+_expire_parked_verifiers (TlmSeatPrivate *priv)
+{
+    guint serial = tlm_user_info_get_credentials_serial ();
+    GList *elem;
+
+    for (elem = priv->parked_sessions; elem; elem = g_list_next (elem)) {
+        ParkedSession *parked = elem->data;
+        if (parked->verifier && parked->serial != serial) {
+            DBG ("credentials changed, '%s' needs the full PAM conversation",
+                 parked->username);
+            g_clear_string (&parked->verifier);
+        }
+    }
+}
+
+/**
+ * tlm_seat_switch_user:
+ * @seat: (transfer none): an instance of #TlmSeat
+ * @service: (allow-none): the PAM service, NULL for the seat's default
+ * @username: the user to switch to
+ * @password: the password of @username
+ * @environment: (allow-none): additional session environment
+ *
+ * Starts switching the seat to @username. The password is verified
+ * asynchronously, the outcome is reported with #TlmSeat::session-created, or
+ * #TlmSeat::session-error with TLM_ERROR_PAM_AUTH_FAILURE if the password is
+ * rejected.
+ *
+ * Returns: TRUE if the switch was started, FALSE if it could not be started
+ * at all; TRUE does not mean that the password is valid
+ */
 gboolean
 tlm_seat_switch_user (TlmSeat *seat,
                       const gchar *service,
@@ -495,26 +1255,44 @@ tlm_seat_switch_user (TlmSeat *seat,
     g_return_val_if_fail (seat && TLM_IS_SEAT(seat), FALSE);
 
     TlmSeatPrivate *priv = TLM_SEAT_PRIV (seat);
+    SwitchClosure *closure = NULL;
+    ParkedSession *parked = NULL;
 
-    // If username & its password is not authenticated, immediately return FALSE
-    // so that current session is not terminated.
-    if (!tlm_authenticate_user (priv->config, username, password)) {
-        WARN("fail to tlm_authenticate_user");
+    if (priv->switch_cancellable) {
+        WARN ("user switch already in progress on seat %s", priv->id);
         return FALSE;
     }
 
-    if (!priv->session) {
-        return tlm_seat_create_session (seat, service, username, password,
-                environment);
+    closure = g_slice_new0 (SwitchClosure);
+    closure->seat = seat;
+    closure->service = g_strdup (service);
+    closure->username = g_strdup (username);
+    closure->password = g_strdup (password);
+    if (environment)
+        closure->environment = g_hash_table_ref (environment);
+    priv->switch_cancellable = g_cancellable_new ();
+
+    _clear_auth_token (priv);
+
+    /* the password is verified off the main loop. Switching back to a
+     * parked session skips the PAM conversation if the password matches the
+     * one it was opened with and /etc/shadow did not change since, the
+     * account is still checked in case it was locked or has expired */
+    _expire_parked_verifiers (priv);
+    parked = _find_parked_session (priv, username);
+    if (parked) {
+        closure->serial = tlm_user_info_get_credentials_serial ();
+        tlm_verify_user_async (priv->config, username, password,
+                priv->verifier_salt, parked->verifier,
+                priv->switch_cancellable, _switch_to_parked_verified,
+                closure, (GDestroyNotify) _switch_closure_free);
+        return TRUE;
     }
 
-    _reset_next (priv);
-    priv->next_service = g_strdup (service);
-    priv->next_user = g_strdup (username);
-    priv->next_password = g_strdup (password);
-    priv->next_environment = g_hash_table_ref (environment);
-
-    return tlm_seat_terminate_session (seat);
+    tlm_authenticate_user_async (priv->config, username, password,
+            priv->switch_cancellable, _switch_user_authenticated, closure,
+            (GDestroyNotify) _switch_closure_free);
+    return TRUE;
 }
 
 static gchar *
@@ -553,6 +1331,33 @@ _build_user_name (const gchar *template, const gchar *seat_id)
     return out;
 }
 
+/* a fresh account of the pool for each login, the template's own name if
+ * none is ready */
+static void
+_lease_default_user (TlmSeatPrivate *priv)
+{
+    const gchar *name_tmpl = _get_seat_config (priv)->default_user;
+    gchar *base_name = NULL;
+    gchar *leased = NULL;
+
+    if (!name_tmpl)
+        return;
+
+    /* the previous login's account, unless its logout gave it back */
+    if (priv->default_user)
+        tlm_account_pool_release (priv->account_pool, priv->default_user);
+
+    base_name = _build_user_name (name_tmpl, priv->id);
+    leased = tlm_account_pool_lease (priv->account_pool, base_name);
+    g_free (priv->default_user);
+    if (leased) {
+        priv->default_user = leased;
+        g_free (base_name);
+    } else {
+        priv->default_user = base_name;
+    }
+}
+
 static gboolean
 _delayed_session (gpointer user_data)
 {
@@ -580,6 +1385,132 @@ _delayed_session (gpointer user_data)
     return G_SOURCE_REMOVE;
 }
 
+/* the default user's login did not get going, its account is given back
+ * as on logout */
+static void
+_abort_default_login (TlmSeat *seat)
+{
+    TlmSeatPrivate *priv = TLM_SEAT_PRIV (seat);
+
+    if (!priv->default_active)
+        return;
+    priv->default_active = FALSE;
+    g_signal_emit (seat, signals[SIG_PREPARE_USER_LOGOUT], 0,
+            priv->default_user);
+}
+
+static gboolean
+_start_session (TlmSeat *seat,
+                const gchar *service,
+                const gchar *username,
+                const gchar *password,
+                GHashTable *environment)
+{
+    TlmSeatPrivate *priv = TLM_SEAT_PRIV (seat);
+    GVariant *auth_token = NULL;
+    const gchar *user_name = NULL;
+    TlmUserInfo *user_info = NULL;
+
+    priv->session = _take_pooled_session (seat);
+    if (priv->session) {
+        DBG ("using pooled sessiond %p", priv->session);
+        g_object_set (G_OBJECT (priv->session),
+                "seatid", priv->id,
+                "service", service,
+                "username",
+                priv->default_active ? priv->default_user : username,
+                NULL);
+    } else {
+        priv->session = tlm_session_remote_new (priv->config,
+                priv->id,
+                service,
+                priv->default_active ? priv->default_user : username);
+    }
+    _schedule_sessiond_pool_refill (seat);
+    if (!priv->session) {
+        _abort_default_login (seat);
+        g_signal_emit (seat, signals[SIG_SESSION_ERROR], 0,
+                TLM_ERROR_SESSION_SPAWN_FAILURE);
+        return FALSE;
+    }
+    /* sessiond works with the same configuration as we do */
+    g_object_set (G_OBJECT (priv->session), "seatconfig",
+            tlm_seat_config_to_variant (_get_seat_config (priv)), NULL);
+    /* looked up once for the whole login, sessiond gets the same record */
+    user_name = priv->default_active ? priv->default_user : username;
+    if (user_name)
+        user_info = tlm_user_info_lookup (user_name);
+    if (user_info)
+        g_object_set (G_OBJECT (priv->session), "userinfo",
+                tlm_user_info_to_variant (user_info), NULL);
+
+    _clear_session_verifier (priv);
+    priv->session_vtnr = _allocate_vt (seat);
+    if (priv->parked_sessions && priv->session_vtnr) {
+        /* the seat's VT may be taken by a parked session */
+        g_object_set (G_OBJECT (priv->session), "vtnr", priv->session_vtnr,
+                NULL);
+        _activate_vt (priv->session_vtnr);
+    }
+    if (_get_max_parked_sessions (priv) > 0)
+        _derive_session_verifier (seat, password);
+    if (priv->closing_session)
+        g_object_set (G_OBJECT (priv->session), "deferexec", TRUE, NULL);
+
+    /*It is needed to handle switch user case which completes after new session
+     *is created */
+    seat->priv->prev_dbus_observer = seat->priv->dbus_observer;
+    seat->priv->dbus_observer = NULL;
+    if (!_create_dbus_observer (seat, user_info)) {
+        if (user_info)
+            tlm_user_info_unref (user_info);
+        g_clear_object (&priv->session);
+        _abort_default_login (seat);
+        g_signal_emit (seat, signals[SIG_SESSION_ERROR],  0,
+                TLM_ERROR_DBUS_SERVER_START_FAILURE);
+        return FALSE;
+    }
+    if (user_info)
+        tlm_user_info_unref (user_info);
+
+    if (username && !priv->default_active)
+        auth_token = _take_auth_token (seat, service, username);
+    else
+        _clear_auth_token (priv);
+
+    _connect_session_signals (seat);
+    tlm_session_remote_create (priv->session, password, environment,
+            auth_token);
+    if (auth_token)
+        g_variant_unref (auth_token);
+    return TRUE;
+}
+
+static void
+_run_seat_job (gpointer user_data)
+{
+    SeatJob *job = (SeatJob *) user_data;
+
+    job->func (job->data);
+}
+
+static void
+_seat_job_done (gpointer user_data)
+{
+    SeatJob *job = (SeatJob *) user_data;
+    TlmSeat *seat = job->seat;
+
+    if (job->destroy)
+        job->destroy (job->data);
+
+    if (seat) {
+        g_object_remove_weak_pointer (G_OBJECT (seat),
+                (gpointer *) &job->seat);
+        tlm_seat_end_job (seat);
+    }
+    g_slice_free (SeatJob, job);
+}
+
 gboolean
 tlm_seat_create_session (TlmSeat *seat,
                          const gchar *service,
@@ -590,7 +1521,7 @@ tlm_seat_create_session (TlmSeat *seat,
     g_return_val_if_fail (seat && TLM_IS_SEAT(seat), FALSE);
     TlmSeatPrivate *priv = TLM_SEAT_PRIV (seat);
 
-    if (priv->session != NULL) {
+    if (priv->session != NULL || priv->held_login != NULL) {
         g_signal_emit (seat, signals[SIG_SESSION_ERROR],  0,
                 TLM_ERROR_SESSION_ALREADY_EXISTS);
         return FALSE;
@@ -617,32 +1548,15 @@ tlm_seat_create_session (TlmSeat *seat,
         priv->prev_count = 1;
     }
 
-    if (!service) {
-        DBG ("PAM service not defined, looking up configuration");
-        service = tlm_config_get_string (priv->config,
-                                         priv->id,
-                                         username ? TLM_CONFIG_GENERAL_PAM_SERVICE : TLM_CONFIG_GENERAL_DEFAULT_PAM_SERVICE);
-        if (!service)
-            service = tlm_config_get_string (priv->config,
-                                             TLM_CONFIG_GENERAL,
-                                             username ? TLM_CONFIG_GENERAL_PAM_SERVICE : TLM_CONFIG_GENERAL_DEFAULT_PAM_SERVICE);
-        if (!service)
-            service = username ? "tlm-login" : "tlm-default-login";
-    }
+    _clear_seat_config (priv);
+    service = _resolve_pam_service (seat, service, username);
     DBG ("using PAM service %s for seat %s", service, priv->id);
 
     if (!username) {
+        if (priv->account_pool)
+            _lease_default_user (priv);
         if (!priv->default_user) {
-            const gchar *name_tmpl =
-                    tlm_config_get_string_default (priv->config,
-                            priv->id,
-                            TLM_CONFIG_GENERAL_DEFAULT_USER,
-                            "guest");
-            if (!name_tmpl)
-                name_tmpl = tlm_config_get_string_default (priv->config,
-                        TLM_CONFIG_GENERAL,
-                        TLM_CONFIG_GENERAL_DEFAULT_USER,
-                        "guest");
+            const gchar *name_tmpl = _get_seat_config (priv)->default_user;
             if (name_tmpl)
                 priv->default_user = _build_user_name (name_tmpl, priv->id);
         }
@@ -655,31 +1569,20 @@ tlm_seat_create_session (TlmSeat *seat,
         }
     }
 
-    priv->session = tlm_session_remote_new (priv->config,
-            priv->id,
-            service,
-            priv->default_active ? priv->default_user : username);
-    if (!priv->session) {
-        g_signal_emit (seat, signals[SIG_SESSION_ERROR], 0,
-                TLM_ERROR_SESSION_CREATION_FAILURE);
-        return FALSE;
-    }
-
-    /*It is needed to handle switch user case which completes after new session
-     *is created */
-    seat->priv->prev_dbus_observer = seat->priv->dbus_observer;
-    seat->priv->dbus_observer = NULL;
-    if (!_create_dbus_observer (seat,
-            priv->default_active ? priv->default_user : username)) {
-        g_clear_object (&priv->session);
-        g_signal_emit (seat, signals[SIG_SESSION_ERROR],  0,
-                TLM_ERROR_DBUS_SERVER_START_FAILURE);
-        return FALSE;
+    if (priv->pending_jobs) {
+        /* the preparation of the user is still running */
+        DBG ("login on seat %s waits for %u job(s)", priv->id,
+             priv->pending_jobs);
+        priv->held_login = g_slice_new0 (DelayClosure);
+        priv->held_login->service = g_strdup (service);
+        priv->held_login->username = g_strdup (username);
+        priv->held_login->password = g_strdup (password);
+        if (environment)
+            priv->held_login->environment = g_hash_table_ref (environment);
+        return TRUE;
     }
 
-    _connect_session_signals (seat);
-    tlm_session_remote_create (priv->session, password, environment);
-    return TRUE;
+    return _start_session (seat, service, username, password, environment);
 }
 
 gboolean
@@ -688,6 +1591,9 @@ tlm_seat_terminate_session (TlmSeat *seat)
     g_return_val_if_fail (seat && TLM_IS_SEAT(seat), FALSE);
     g_return_val_if_fail (seat->priv, FALSE);
 
+    /* a login still waiting for its preparation is just dropped */
+    _clear_held_login (seat->priv);
+
     if (seat->priv->default_active) {
         seat->priv->default_active = FALSE;
         g_signal_emit (seat,
@@ -707,6 +1613,80 @@ tlm_seat_terminate_session (TlmSeat *seat)
     return TRUE;
 }
 
+/* takes over a session left running by a previous daemon */
+gboolean
+tlm_seat_attach_session (TlmSeat *seat, TlmSessionRemote *session)
+{
+    g_return_val_if_fail (seat && TLM_IS_SEAT(seat), FALSE);
+    g_return_val_if_fail (session && TLM_IS_SESSION_REMOTE(session), FALSE);
+    TlmSeatPrivate *priv = TLM_SEAT_PRIV (seat);
+    const gchar *name_tmpl = NULL;
+    gchar *username = NULL;
+    TlmUserInfo *user_info = NULL;
+
+    if (priv->session != NULL) {
+        WARN ("seat %s has a session already", priv->id);
+        return FALSE;
+    }
+
+    g_object_get (G_OBJECT (session), "username", &username,
+            "vtnr", &priv->session_vtnr, NULL);
+    if (priv->account_pool &&
+        tlm_account_pool_claim (priv->account_pool, username)) {
+        g_free (priv->default_user);
+        priv->default_user = g_strdup (username);
+        priv->default_active = TRUE;
+    } else {
+        name_tmpl = _get_seat_config (priv)->default_user;
+        if (!priv->default_user && name_tmpl)
+            priv->default_user = _build_user_name (name_tmpl, priv->id);
+        priv->default_active = g_strcmp0 (username, priv->default_user) == 0;
+    }
+
+    DBG ("seat %s attached to session of '%s'", priv->id, username);
+    priv->session = g_object_ref (session);
+    if (username)
+        user_info = tlm_user_info_lookup (username);
+    if (!_create_dbus_observer (seat, user_info))
+        WARN ("no dbus observer for '%s' on seat %s", username, priv->id);
+    if (user_info)
+        tlm_user_info_unref (user_info);
+    _connect_session_signals (seat);
+
+    g_free (username);
+    return TRUE;
+}
+
+/* leaves the active session running when the daemon goes away */
+gboolean
+tlm_seat_detach_session (TlmSeat *seat)
+{
+    g_return_val_if_fail (seat && TLM_IS_SEAT(seat), FALSE);
+    TlmSeatPrivate *priv = TLM_SEAT_PRIV (seat);
+
+    if (!priv->session || !tlm_session_remote_detach (priv->session))
+        return FALSE;
+
+    DBG ("seat %s detached from session %s", priv->id,
+         tlm_session_remote_get_sessionid (priv->session));
+    _close_active_session (seat);
+    return TRUE;
+}
+
+gboolean
+tlm_seat_logout_user (TlmSeat *seat)
+{
+    g_return_val_if_fail (seat && TLM_IS_SEAT(seat), FALSE);
+    TlmSeatPrivate *priv = TLM_SEAT_PRIV (seat);
+
+    if (!priv->parked_sessions &&
+        _get_seat_config (priv)->auto_login &&
+        _start_pipelined_relogin (seat, NULL, NULL, NULL, NULL))
+        return TRUE;
+
+    return tlm_seat_terminate_session (seat);
+}
+
 gboolean
 tlm_seat_get_session_info (TlmSeat *seat, const gchar *sessionid)
 {
@@ -726,6 +1706,146 @@ tlm_seat_get_session_info (TlmSeat *seat, const gchar *sessionid)
     return TRUE;
 }
 
+/**
+ * tlm_seat_set_worker:
+ * @seat: (transfer none): an instance of #TlmSeat
+ * @worker: (transfer none) (allow-none): the worker for the jobs of the
+ * seat, it has to outlive the seat
+ *
+ * Moves the jobs of tlm_seat_run_job() off the main loop.
+ */
+void
+tlm_seat_set_worker (TlmSeat *seat, TlmSeatWorker *worker)
+{
+    g_return_if_fail (seat && TLM_IS_SEAT(seat));
+
+    seat->priv->worker = worker;
+}
+
+/**
+ * tlm_seat_set_account_pool:
+ * @seat: (transfer none): an instance of #TlmSeat
+ * @pool: (transfer none) (allow-none): the pool to lease the default user
+ * accounts from, it has to outlive the seat
+ *
+ * Makes the default user logins of the seat use the accounts of @pool
+ * named after the default user, and starts provisioning them.
+ */
+void
+tlm_seat_set_account_pool (TlmSeat *seat, TlmAccountPool *pool)
+{
+    g_return_if_fail (seat && TLM_IS_SEAT(seat));
+    TlmSeatPrivate *priv = TLM_SEAT_PRIV (seat);
+    const gchar *name_tmpl = _get_seat_config (priv)->default_user;
+    gchar *base_name = NULL;
+
+    priv->account_pool = pool;
+    if (pool && name_tmpl) {
+        base_name = _build_user_name (name_tmpl, priv->id);
+        tlm_account_pool_add_base (pool, base_name);
+        g_free (base_name);
+    }
+}
+
+/**
+ * tlm_seat_get_worker:
+ * @seat: (transfer none): an instance of #TlmSeat
+ *
+ * Returns: (transfer none): the worker set with tlm_seat_set_worker(), or
+ * NULL if the jobs of the seat run in place
+ */
+TlmSeatWorker *
+tlm_seat_get_worker (TlmSeat *seat)
+{
+    g_return_val_if_fail (seat && TLM_IS_SEAT(seat), NULL);
+
+    return seat->priv->worker;
+}
+
+/**
+ * tlm_seat_begin_job:
+ * @seat: (transfer none): an instance of #TlmSeat
+ *
+ * Marks the start of asynchronous work the next login of the seat has to
+ * wait for, like tlm_seat_run_job() does for the blocking jobs. Every call
+ * has to be paired with tlm_seat_end_job().
+ */
+void
+tlm_seat_begin_job (TlmSeat *seat)
+{
+    g_return_if_fail (seat && TLM_IS_SEAT(seat));
+
+    seat->priv->pending_jobs++;
+}
+
+/**
+ * tlm_seat_end_job:
+ * @seat: (transfer none): an instance of #TlmSeat
+ *
+ * Marks the end of the work started with tlm_seat_begin_job(). The login
+ * held for the jobs of the seat resumes when the last one ends.
+ */
+void
+tlm_seat_end_job (TlmSeat *seat)
+{
+    TlmSeatPrivate *priv = NULL;
+    DelayClosure *held = NULL;
+
+    g_return_if_fail (seat && TLM_IS_SEAT(seat));
+    priv = seat->priv;
+    g_return_if_fail (priv->pending_jobs > 0);
+
+    if (--priv->pending_jobs == 0 && priv->held_login) {
+        held = priv->held_login;
+        priv->held_login = NULL;
+        DBG ("resuming the login on seat %s", priv->id);
+        _start_session (seat, held->service, held->username,
+                held->password, held->environment);
+        _held_login_free (held);
+    }
+}
+
+/**
+ * tlm_seat_run_job:
+ * @seat: (transfer none): an instance of #TlmSeat
+ * @func: the blocking work
+ * @data: data for @func
+ * @destroy: (allow-none): frees @data, called in the seat's context
+ *
+ * Runs @func on the worker of the seat, or right away if there is none.
+ * A login started on the seat while jobs are pending waits for them, so
+ * the handlers of #TlmSeat::prepare-user-login can push the preparation of
+ * the user here.
+ */
+void
+tlm_seat_run_job (
+        TlmSeat *seat,
+        TlmSeatWorkerFunc func,
+        gpointer data,
+        GDestroyNotify destroy)
+{
+    g_return_if_fail (seat && TLM_IS_SEAT(seat));
+    g_return_if_fail (func);
+
+    SeatJob *job = NULL;
+
+    if (!seat->priv->worker) {
+        func (data);
+        if (destroy) destroy (data);
+        return;
+    }
+
+    job = g_slice_new0 (SeatJob);
+    job->seat = seat;
+    job->func = func;
+    job->data = data;
+    job->destroy = destroy;
+    g_object_add_weak_pointer (G_OBJECT (seat), (gpointer *) &job->seat);
+    tlm_seat_begin_job (seat);
+    tlm_seat_worker_push (seat->priv->worker, _run_seat_job, _seat_job_done,
+            job);
+}
+
 TlmSeat *
 tlm_seat_new (TlmConfig *config,
               const gchar *id,
@@ -736,6 +1856,7 @@ tlm_seat_new (TlmConfig *config,
                          "id", id,
                          "path", path,
                          NULL);
+    _schedule_sessiond_pool_refill (seat);
     return seat;
 }
 
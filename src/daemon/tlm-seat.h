@@ -30,6 +30,9 @@
 #include <glib-object.h>
 #include <tlm-config.h>
 #include "tlm-types.h"
+#include "tlm-session-remote.h"
+#include "tlm-seat-worker.h"
+#include "tlm-account-pool.h"
 
 G_BEGIN_DECLS
 
@@ -87,9 +90,39 @@ tlm_seat_create_session (TlmSeat *seat,
 gboolean
 tlm_seat_terminate_session (TlmSeat *seat);
 
+gboolean
+tlm_seat_attach_session (TlmSeat *seat, TlmSessionRemote *session);
+
+gboolean
+tlm_seat_detach_session (TlmSeat *seat);
+
+gboolean
+tlm_seat_logout_user (TlmSeat *seat);
+
 gboolean
 tlm_seat_get_session_info (TlmSeat *seat, const gchar *sessionid);
 
+void
+tlm_seat_set_worker (TlmSeat *seat, TlmSeatWorker *worker);
+
+TlmSeatWorker *
+tlm_seat_get_worker (TlmSeat *seat);
+
+void
+tlm_seat_set_account_pool (TlmSeat *seat, TlmAccountPool *pool);
+
+void
+tlm_seat_begin_job (TlmSeat *seat);
+
+void
+tlm_seat_end_job (TlmSeat *seat);
+
+void
+tlm_seat_run_job (TlmSeat *seat,
+                  TlmSeatWorkerFunc func,
+                  gpointer data,
+                  GDestroyNotify destroy);
+
 G_END_DECLS
 
 #endif /* _TLM_SEAT_H */
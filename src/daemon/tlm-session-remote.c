@@ -27,12 +27,15 @@
 
 #include <string.h>
 #include <errno.h>
+#include <sys/socket.h>
+#include <uuid/uuid.h>
 
 #include "common/tlm-log.h"
 #include "common/tlm-error.h"
 #include "common/tlm-config.h"
 #include "common/tlm-config-general.h"
 #include "common/tlm-pipe-stream.h"
+#include "common/tlm-utils.h"
 #include "common/dbus/tlm-dbus.h"
 #include "common/dbus/tlm-dbus-utils.h"
 #include "common/dbus/tlm-dbus-session-gen.h"
@@ -48,11 +51,27 @@ enum
     PROP_SERVICE,
     PROP_USERNAME,
     PROP_SESSIONID,
+    PROP_VTNR,
+    PROP_DEFER_EXEC,
+    PROP_SEAT_CONFIG,
+    PROP_USER_INFO,
     N_PROPERTIES
 };
 
 static GParamSpec *properties[N_PROPERTIES];
 
+/* Bring-up phases of a remote session, each one guarded by its own timeout */
+typedef enum {
+    SESSION_PHASE_SPAWN = 0,
+    SESSION_PHASE_CONNECT,
+    SESSION_PHASE_PROXY,
+    SESSION_PHASE_IDLE,
+    SESSION_PHASE_CREATE,
+    SESSION_PHASE_SETUP,
+    SESSION_PHASE_CREATED,
+    SESSION_PHASE_FAILED
+} SessionPhase;
+
 struct _TlmSessionRemotePrivate
 {
 	TlmConfig *config;
@@ -64,6 +83,27 @@ struct _TlmSessionRemotePrivate
     int last_sig;
     guint timer_id;
     gboolean can_emit_signal;
+    gboolean is_terminating;
+    gboolean persistent; /* sessiond keeps the session when we go away */
+    gboolean is_attached; /* sessiond of a previous daemon, not our child */
+    gchar *token_secret; /* handed to sessiond at spawn, the auth token nonce */
+
+    SessionPhase phase;
+    guint phase_timer_id;
+    GCancellable *cancellable;
+
+    /* values set before the proxy is available */
+    gchar *seatid;
+    gchar *service;
+    gchar *username;
+    guint vtnr;
+    gboolean defer_exec;
+    GVariant *seat_config;
+    GVariant *user_info;
+    gboolean pending_create;
+    gchar *pending_password;
+    GVariant *pending_environment;
+    GVariant *pending_auth_token;
 
     /* Signals */
     gulong signal_session_created;
@@ -91,20 +131,27 @@ enum {
 static guint signals[SIG_MAX];
 
 static void
-_on_child_down_cb (
-        GPid  pid,
-        gint  status,
-        gpointer data)
+_stop_phase_timer (TlmSessionRemote *self)
 {
-    g_spawn_close_pid (pid);
-
-    TlmSessionRemote *session = TLM_SESSION_REMOTE (data);
+    if (self->priv->phase_timer_id) {
+        g_source_remove (self->priv->phase_timer_id);
+        self->priv->phase_timer_id = 0;
+    }
+}
 
-    DBG ("Sessiond(%p) with pid (%d) closed with status %d", session, pid,
-            status);
+static void
+_sessiond_down (
+        TlmSessionRemote *session)
+{
+    gboolean terminating = session->priv->is_terminating;
 
     session->priv->is_sessiond_up = FALSE;
+    session->priv->is_terminating = FALSE;
     session->priv->child_watch_id = 0;
+    _stop_phase_timer (session);
+    if (session->priv->phase < SESSION_PHASE_CREATED)
+        session->priv->phase = SESSION_PHASE_FAILED;
+    g_cancellable_cancel (session->priv->cancellable);
     if (session->priv->timer_id) {
         g_source_remove (session->priv->timer_id);
         session->priv->timer_id = 0;
@@ -112,6 +159,42 @@ _on_child_down_cb (
     if (session->priv->can_emit_signal)
         g_signal_emit (session, signals[SIG_SESSION_TERMINATED], 0,
                 session->priv->sessionid);
+
+    /* drop the reference taken by tlm_session_remote_terminate() */
+    if (terminating)
+        g_object_unref (session);
+}
+
+static void
+_on_child_down_cb (
+        GPid  pid,
+        gint  status,
+        gpointer data)
+{
+    g_spawn_close_pid (pid);
+
+    TlmSessionRemote *session = TLM_SESSION_REMOTE (data);
+
+    DBG ("Sessiond(%p) with pid (%d) closed with status %d", session, pid,
+            status);
+    _sessiond_down (session);
+}
+
+/* an attached sessiond is not our child, its connection tells when it is
+ * gone */
+static void
+_on_connection_closed_cb (
+        GDBusConnection *connection,
+        gboolean remote_peer_vanished,
+        GError *error,
+        gpointer user_data)
+{
+    TlmSessionRemote *session = TLM_SESSION_REMOTE (user_data);
+
+    DBG ("Sessiond(%p) with pid (%d) disconnected", session,
+            session->priv->cpid);
+    if (session->priv->is_attached && session->priv->is_sessiond_up)
+        _sessiond_down (session);
 }
 
 static void
@@ -129,12 +212,43 @@ tlm_session_remote_set_property (
 		case PROP_SEATID:
 		case PROP_USERNAME:
 		case PROP_SERVICE: {
+			gchar **field = property_id == PROP_SEATID ? &self->priv->seatid :
+			        property_id == PROP_USERNAME ? &self->priv->username :
+			        &self->priv->service;
+			g_free (*field);
+			*field = g_value_dup_string (value);
 			if (self->priv->dbus_session_proxy) {
 				g_object_set_property (G_OBJECT(self->priv->dbus_session_proxy),
 						pspec->name, value);
 			}
 			break;
 		}
+        case PROP_VTNR:
+        case PROP_DEFER_EXEC:
+            if (property_id == PROP_VTNR)
+                self->priv->vtnr = g_value_get_uint (value);
+            else
+                self->priv->defer_exec = g_value_get_boolean (value);
+            if (self->priv->dbus_session_proxy)
+                g_object_set_property (G_OBJECT(self->priv->dbus_session_proxy),
+                        pspec->name, value);
+            break;
+        case PROP_SEAT_CONFIG:
+            if (self->priv->seat_config)
+                g_variant_unref (self->priv->seat_config);
+            self->priv->seat_config = g_value_dup_variant (value);
+            if (self->priv->dbus_session_proxy && self->priv->seat_config)
+                g_object_set_property (G_OBJECT(self->priv->dbus_session_proxy),
+                        pspec->name, value);
+            break;
+        case PROP_USER_INFO:
+            if (self->priv->user_info)
+                g_variant_unref (self->priv->user_info);
+            self->priv->user_info = g_value_dup_variant (value);
+            if (self->priv->dbus_session_proxy && self->priv->user_info)
+                g_object_set_property (G_OBJECT(self->priv->dbus_session_proxy),
+                        pspec->name, value);
+            break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
     }
@@ -160,9 +274,27 @@ tlm_session_remote_get_property (
             if (self->priv->dbus_session_proxy) {
                 g_object_get_property (G_OBJECT(self->priv->dbus_session_proxy),
                         pspec->name, value);
+            } else if (property_id == PROP_SEATID) {
+                g_value_set_string (value, self->priv->seatid);
+            } else if (property_id == PROP_USERNAME) {
+                g_value_set_string (value, self->priv->username);
+            } else if (property_id == PROP_SERVICE) {
+                g_value_set_string (value, self->priv->service);
             }
             break;
 		}
+        case PROP_VTNR:
+            g_value_set_uint (value, self->priv->vtnr);
+            break;
+        case PROP_DEFER_EXEC:
+            g_value_set_boolean (value, self->priv->defer_exec);
+            break;
+        case PROP_SEAT_CONFIG:
+            g_value_set_variant (value, self->priv->seat_config);
+            break;
+        case PROP_USER_INFO:
+            g_value_set_variant (value, self->priv->user_info);
+            break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
     }
@@ -223,11 +355,16 @@ tlm_session_remote_dispose (GObject *object)
     self->priv->can_emit_signal = FALSE;
 
     DBG("self %p", self);
+    _stop_phase_timer (self);
+    g_cancellable_cancel (self->priv->cancellable);
+
     if (self->priv->is_sessiond_up) {
+        /* The owner let go while sessiond is still running: the termination
+         * holds a reference until the child is reaped, after which we get
+         * disposed again. */
         tlm_session_remote_terminate (self);
-        while (self->priv->is_sessiond_up)
-            g_main_context_iteration(NULL, TRUE);
-        DBG ("Sessiond DESTROYED");
+        DBG ("Sessiond termination pending");
+        return;
     }
 
     if (self->priv->timer_id) {
@@ -244,6 +381,7 @@ tlm_session_remote_dispose (GObject *object)
     }
 
     g_clear_object (&self->priv->config);
+    g_clear_object (&self->priv->cancellable);
 
     if (self->priv->dbus_session_proxy) {
         g_signal_handler_disconnect (self->priv->dbus_session_proxy,
@@ -265,8 +403,11 @@ tlm_session_remote_dispose (GObject *object)
          * Following code snippet at least closes the stream to avoid any
          * descriptors leak.
          * */
-       GIOStream *stream = g_dbus_connection_get_stream (
-                self->priv->connection);
+       GIOStream *stream = NULL;
+
+        g_signal_handlers_disconnect_by_func (self->priv->connection,
+                _on_connection_closed_cb, self);
+        stream = g_dbus_connection_get_stream (self->priv->connection);
         if (stream) g_io_stream_close (stream, NULL, NULL);
         g_object_unref (self->priv->connection);
         self->priv->connection = NULL;
@@ -279,7 +420,30 @@ tlm_session_remote_dispose (GObject *object)
 static void
 tlm_session_remote_finalize (GObject *object)
 {
-    //TlmSessionRemote *self = TLM_SESSION_REMOTE (object);
+    TlmSessionRemote *self = TLM_SESSION_REMOTE (object);
+
+    g_clear_string (&self->priv->seatid);
+    g_clear_string (&self->priv->service);
+    g_clear_string (&self->priv->username);
+    g_clear_string (&self->priv->sessionid);
+    g_clear_string (&self->priv->pending_password);
+    g_clear_string (&self->priv->token_secret);
+    if (self->priv->pending_environment) {
+        g_variant_unref (self->priv->pending_environment);
+        self->priv->pending_environment = NULL;
+    }
+    if (self->priv->pending_auth_token) {
+        g_variant_unref (self->priv->pending_auth_token);
+        self->priv->pending_auth_token = NULL;
+    }
+    if (self->priv->seat_config) {
+        g_variant_unref (self->priv->seat_config);
+        self->priv->seat_config = NULL;
+    }
+    if (self->priv->user_info) {
+        g_variant_unref (self->priv->user_info);
+        self->priv->user_info = NULL;
+    }
 
     G_OBJECT_CLASS (tlm_session_remote_parent_class)->finalize (object);
 }
@@ -327,6 +491,32 @@ tlm_session_remote_class_init (TlmSessionRemoteClass *klass)
             "" /* default value */,
             G_PARAM_READABLE |
             G_PARAM_STATIC_STRINGS);
+    properties[PROP_VTNR] = g_param_spec_uint ("vtnr",
+            "VT number",
+            "VT of the session, 0 uses the seat's VTNR",
+            0, G_MAXUINT, 0,
+            G_PARAM_READWRITE |
+            G_PARAM_STATIC_STRINGS);
+    properties[PROP_DEFER_EXEC] = g_param_spec_boolean ("deferexec",
+            "Defer exec",
+            "Hold the user session until tlm_session_remote_exec()",
+            FALSE,
+            G_PARAM_READWRITE |
+            G_PARAM_STATIC_STRINGS);
+    properties[PROP_SEAT_CONFIG] = g_param_spec_variant ("seatconfig",
+            "Seat config",
+            "Serialized TlmSeatConfig of the seat",
+            G_VARIANT_TYPE ("(sa{sv})"),
+            NULL,
+            G_PARAM_READWRITE |
+            G_PARAM_STATIC_STRINGS);
+    properties[PROP_USER_INFO] = g_param_spec_variant ("userinfo",
+            "User info",
+            "Serialized TlmUserInfo of the user",
+            G_VARIANT_TYPE ("(suuss)"),
+            NULL,
+            G_PARAM_READWRITE |
+            G_PARAM_STATIC_STRINGS);
 
     g_object_class_install_properties (object_class, N_PROPERTIES, properties);
 
@@ -367,7 +557,167 @@ tlm_session_remote_init (TlmSessionRemote *self)
     self->priv->is_sessiond_up = FALSE;
     self->priv->last_sig = 0;
     self->priv->timer_id = 0;
+    self->priv->is_terminating = FALSE;
+    self->priv->persistent = FALSE;
+    self->priv->is_attached = FALSE;
     self->priv->sessionid = 0;
+    self->priv->phase = SESSION_PHASE_SPAWN;
+    self->priv->phase_timer_id = 0;
+    self->priv->cancellable = g_cancellable_new ();
+    self->priv->seatid = NULL;
+    self->priv->service = NULL;
+    self->priv->username = NULL;
+    self->priv->vtnr = 0;
+    self->priv->defer_exec = FALSE;
+    self->priv->seat_config = NULL;
+    self->priv->user_info = NULL;
+    self->priv->pending_create = FALSE;
+    self->priv->pending_password = NULL;
+    self->priv->pending_environment = NULL;
+    self->priv->pending_auth_token = NULL;
+    self->priv->token_secret = NULL;
+}
+
+static const gchar *
+_phase_name (SessionPhase phase)
+{
+    switch (phase) {
+        case SESSION_PHASE_SPAWN: return "spawn";
+        case SESSION_PHASE_CONNECT: return "connect";
+        case SESSION_PHASE_PROXY: return "proxy";
+        case SESSION_PHASE_IDLE: return "idle";
+        case SESSION_PHASE_CREATE: return "create";
+        case SESSION_PHASE_SETUP: return "setup";
+        case SESSION_PHASE_CREATED: return "created";
+        default: return "failed";
+    }
+}
+
+static TlmError
+_phase_error (SessionPhase phase)
+{
+    switch (phase) {
+        case SESSION_PHASE_SPAWN: return TLM_ERROR_SESSION_SPAWN_FAILURE;
+        case SESSION_PHASE_CONNECT: return TLM_ERROR_SESSION_CONNECT_FAILURE;
+        case SESSION_PHASE_PROXY: return TLM_ERROR_SESSION_PROXY_FAILURE;
+        case SESSION_PHASE_CREATE: return TLM_ERROR_SESSION_REQUEST_FAILURE;
+        case SESSION_PHASE_SETUP: return TLM_ERROR_SESSION_SETUP_TIMEOUT;
+        default: return TLM_ERROR_SESSION_CREATION_FAILURE;
+    }
+}
+
+static guint
+_phase_timeout (
+        TlmSessionRemote *self,
+        SessionPhase phase)
+{
+    const gchar *key = NULL;
+    guint def = 0;
+
+    switch (phase) {
+        case SESSION_PHASE_CONNECT:
+            key = TLM_CONFIG_GENERAL_SESSIOND_CONNECT_TIMEOUT;
+            def = 10;
+            break;
+        case SESSION_PHASE_PROXY:
+            key = TLM_CONFIG_GENERAL_SESSIOND_PROXY_TIMEOUT;
+            def = 10;
+            break;
+        case SESSION_PHASE_CREATE:
+            key = TLM_CONFIG_GENERAL_SESSION_REQUEST_TIMEOUT;
+            def = 10;
+            break;
+        case SESSION_PHASE_SETUP:
+            key = TLM_CONFIG_GENERAL_SESSION_SETUP_TIMEOUT;
+            def = 60;
+            break;
+        default:
+            return 0;
+    }
+    return tlm_config_get_uint (self->priv->config, TLM_CONFIG_GENERAL, key,
+            def);
+}
+
+static void
+_fail_phase (
+        TlmSessionRemote *self,
+        const GError *cause)
+{
+    TlmSessionRemotePrivate *priv = self->priv;
+    GError *error = NULL;
+
+    if (priv->phase == SESSION_PHASE_FAILED) return;
+
+    _stop_phase_timer (self);
+    error = TLM_GET_ERROR_FOR_ID (_phase_error (priv->phase),
+            "Session %s phase failed: %s", _phase_name (priv->phase),
+            cause ? cause->message : "timed out");
+    WARN ("%s", error->message);
+    priv->phase = SESSION_PHASE_FAILED;
+    g_cancellable_cancel (priv->cancellable);
+
+    /* handlers might drop the last external reference */
+    g_object_ref (self);
+    if (priv->can_emit_signal)
+        g_signal_emit (self, signals[SIG_SESSION_ERROR], 0, error);
+    g_error_free (error);
+
+    /* the failed helper is of no further use */
+    priv->can_emit_signal = FALSE;
+    if (priv->is_sessiond_up)
+        tlm_session_remote_terminate (self);
+    g_object_unref (self);
+}
+
+static gboolean
+_phase_timeout_cb (gpointer user_data)
+{
+    TlmSessionRemote *self = TLM_SESSION_REMOTE (user_data);
+
+    self->priv->phase_timer_id = 0;
+    _fail_phase (self, NULL);
+    return G_SOURCE_REMOVE;
+}
+
+static void
+_set_phase (
+        TlmSessionRemote *self,
+        SessionPhase phase)
+{
+    guint timeout = 0;
+
+    DBG ("session %p: %s -> %s", self, _phase_name (self->priv->phase),
+            _phase_name (phase));
+    _stop_phase_timer (self);
+    self->priv->phase = phase;
+
+    timeout = _phase_timeout (self, phase);
+    if (timeout > 0)
+        self->priv->phase_timer_id = g_timeout_add_seconds (timeout,
+                _phase_timeout_cb, self);
+}
+
+static void
+_handle_session_create_reply (
+        GError *error,
+        gpointer user_data)
+{
+    TlmSessionRemote *self = NULL;
+
+    if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        g_error_free (error);
+        return;
+    }
+
+    self = TLM_SESSION_REMOTE (user_data);
+    if (error) {
+        WARN("session creation request failed");
+        _fail_phase (self, error);
+        g_error_free (error);
+        return;
+    }
+    if (self->priv->phase == SESSION_PHASE_CREATE)
+        _set_phase (self, SESSION_PHASE_SETUP);
 }
 
 static void
@@ -377,34 +727,94 @@ _session_created_async_cb (
         gpointer user_data)
 {
     GError *error = NULL;
-    TlmDbusSession *proxy = TLM_DBUS_SESSION (object);
-    TlmSessionRemote *self = TLM_SESSION_REMOTE (user_data);
 
-    tlm_dbus_session_call_session_create_finish (proxy,
+    tlm_dbus_session_call_session_create_finish (TLM_DBUS_SESSION (object),
             res, &error);
-    if (error) {
-        WARN("session creation request failed");
-        g_signal_emit (self, signals[SIG_SESSION_ERROR],  0, error);
-        g_error_free (error);
+    _handle_session_create_reply (error, user_data);
+}
+
+static void
+_session_created_with_token_async_cb (
+        GObject *object,
+        GAsyncResult *res,
+        gpointer user_data)
+{
+    GError *error = NULL;
+
+    tlm_dbus_session_call_session_create_with_token_finish (
+            TLM_DBUS_SESSION (object), res, &error);
+    _handle_session_create_reply (error, user_data);
+}
+
+static void
+_send_session_create (
+        TlmSessionRemote *self,
+        const gchar *password,
+        GVariant *environment,
+        GVariant *auth_token)
+{
+    _set_phase (self, SESSION_PHASE_CREATE);
+    if (auth_token && self->priv->token_secret) {
+        const gchar *seat = NULL;
+        const gchar *user = NULL;
+        const gchar *service = NULL;
+        gint64 expiry = 0;
+
+        /* sessiond only accepts the secret it was spawned with as nonce */
+        g_variant_get (auth_token, "(&s&s&s&sx)", NULL, &seat, &user,
+                &service, &expiry);
+        /* the password still travels along so that sessiond can fall back
+         * to a full authentication if it rejects the token */
+        tlm_dbus_session_call_session_create_with_token (
+                self->priv->dbus_session_proxy, password,
+                g_variant_new ("(ssssx)", self->priv->token_secret, seat,
+                        user, service, expiry),
+                environment, self->priv->cancellable,
+                _session_created_with_token_async_cb, self);
+        return;
     }
+    tlm_dbus_session_call_session_create (
+            self->priv->dbus_session_proxy, password, environment,
+            self->priv->cancellable, _session_created_async_cb, self);
 }
 
 void
 tlm_session_remote_create (
     TlmSessionRemote *session,
     const gchar *password,
-    GHashTable *environment)
+    GHashTable *environment,
+    GVariant *auth_token)
 {
+    g_return_if_fail (session && TLM_IS_SESSION_REMOTE (session));
+    TlmSessionRemotePrivate *priv = session->priv;
     GVariant *data = NULL;
-    gchar *pass = g_strdup (password);
+
+    if (priv->phase == SESSION_PHASE_FAILED) {
+        WARN ("sessiond failed to come up, dropping create request");
+        return;
+    }
+
     if (environment) data = tlm_dbus_utils_hash_table_to_variant (environment);
     if (!data) data = g_variant_new ("a{ss}", NULL);
 
-    if (!pass) pass = g_strdup ("");
-    tlm_dbus_session_call_session_create (
-            session->priv->dbus_session_proxy, pass, data, NULL,
-            _session_created_async_cb, session);
-    g_free (pass);
+    if (priv->phase < SESSION_PHASE_IDLE) {
+        /* sent as soon as the proxy is ready */
+        DBG ("queuing create request in %s phase", _phase_name (priv->phase));
+        g_clear_string (&priv->pending_password);
+        if (priv->pending_environment)
+            g_variant_unref (priv->pending_environment);
+        priv->pending_create = TRUE;
+        priv->pending_password = g_strdup (password ? password : "");
+        priv->pending_environment = g_variant_ref_sink (data);
+        if (priv->pending_auth_token)
+            g_variant_unref (priv->pending_auth_token);
+        priv->pending_auth_token = auth_token ?
+            g_variant_ref_sink (auth_token) : NULL;
+        return;
+    }
+
+    _send_session_create (session, password ? password : "", data,
+            auth_token);
 }
 
 /* signals */
@@ -416,6 +826,8 @@ _on_session_created_cb (
 {
     g_return_if_fail (self && TLM_IS_SESSION_REMOTE (self));
     DBG("sessionid: %s", sessionid ? sessionid : "NULL");
+    _set_phase (self, SESSION_PHASE_CREATED);
+    g_clear_string (&self->priv->sessionid);
     self->priv->sessionid = g_strdup (sessionid);
     g_signal_emit (self, signals[SIG_SESSION_CREATED], 0,
             self->priv->sessionid);
@@ -451,25 +863,150 @@ _on_error_cb (
 
     GError *gerror = tlm_error_new_from_variant (error);
     WARN("error %d:%s", gerror->code, gerror->message);
+    /* sessiond reported the outcome itself, no need to time it out */
+    if (self->priv->phase == SESSION_PHASE_SETUP)
+        _stop_phase_timer (self);
     if (self->priv->can_emit_signal)
         g_signal_emit (self, signals[SIG_SESSION_ERROR],  0, gerror);
     g_error_free (gerror);
 }
 
+static void
+_set_proxy (
+        TlmSessionRemote *self,
+        TlmDbusSession *proxy)
+{
+    self->priv->dbus_session_proxy = proxy;
+    self->priv->signal_session_created = g_signal_connect_swapped (
+            proxy, "session-created",
+            G_CALLBACK (_on_session_created_cb), self);
+    self->priv->signal_session_terminated = g_signal_connect_swapped (
+            proxy, "session-terminated",
+            G_CALLBACK(_on_session_terminated_cb), self);
+    self->priv->signal_authenticated = g_signal_connect_swapped (
+            proxy, "authenticated",
+            G_CALLBACK(_on_authenticated_cb), self);
+    self->priv->signal_error = g_signal_connect_swapped (
+            proxy, "error",
+            G_CALLBACK(_on_error_cb), self);
+}
+
+static void
+_on_proxy_ready_cb (
+        GObject *object,
+        GAsyncResult *res,
+        gpointer user_data)
+{
+    GError *error = NULL;
+    TlmSessionRemote *self = NULL;
+    TlmDbusSession *proxy = tlm_dbus_session_proxy_new_finish (res, &error);
+
+    if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        g_error_free (error);
+        return;
+    }
+
+    self = TLM_SESSION_REMOTE (user_data);
+    if (error) {
+        DBG ("Failed to register object: %s", error->message);
+        _fail_phase (self, error);
+        g_error_free (error);
+        return;
+    }
+    DBG("'%s' object exported(%p)", TLM_SESSION_OBJECTPATH, self);
+
+    _set_proxy (self, proxy);
+
+    /* push the values which were set while the proxy was not available */
+    if (self->priv->seatid)
+        g_object_set (G_OBJECT (proxy), "seatid", self->priv->seatid, NULL);
+    if (self->priv->service)
+        g_object_set (G_OBJECT (proxy), "service", self->priv->service, NULL);
+    if (self->priv->username)
+        g_object_set (G_OBJECT (proxy), "username", self->priv->username,
+                NULL);
+    if (self->priv->vtnr)
+        g_object_set (G_OBJECT (proxy), "vtnr", self->priv->vtnr, NULL);
+    if (self->priv->defer_exec)
+        g_object_set (G_OBJECT (proxy), "deferexec", TRUE, NULL);
+    if (self->priv->seat_config)
+        g_object_set (G_OBJECT (proxy), "seatconfig", self->priv->seat_config,
+                NULL);
+    if (self->priv->user_info)
+        g_object_set (G_OBJECT (proxy), "userinfo", self->priv->user_info,
+                NULL);
+
+    _set_phase (self, SESSION_PHASE_IDLE);
+
+    if (self->priv->pending_create) {
+        GVariant *data = self->priv->pending_environment;
+        gchar *pass = self->priv->pending_password;
+        GVariant *token = self->priv->pending_auth_token;
+
+        self->priv->pending_create = FALSE;
+        self->priv->pending_environment = NULL;
+        self->priv->pending_password = NULL;
+        self->priv->pending_auth_token = NULL;
+        _send_session_create (self, pass, data, token);
+        g_variant_unref (data);
+        if (token)
+            g_variant_unref (token);
+        g_free (pass);
+    }
+}
+
+static void
+_on_connection_ready_cb (
+        GObject *object,
+        GAsyncResult *res,
+        gpointer user_data)
+{
+    GError *error = NULL;
+    TlmSessionRemote *self = NULL;
+    GDBusConnection *connection = g_dbus_connection_new_finish (res, &error);
+
+    if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        g_error_free (error);
+        return;
+    }
+
+    self = TLM_SESSION_REMOTE (user_data);
+    if (error) {
+        DBG ("Failed to connect to sessiond: %s", error->message);
+        _fail_phase (self, error);
+        g_error_free (error);
+        return;
+    }
+
+    self->priv->connection = connection;
+
+    /* Create dbus proxy */
+    _set_phase (self, SESSION_PHASE_PROXY);
+    tlm_dbus_session_proxy_new (
+            self->priv->connection,
+            G_DBUS_PROXY_FLAGS_NONE,
+            NULL,
+            TLM_SESSION_OBJECTPATH,
+            self->priv->cancellable,
+            _on_proxy_ready_cb,
+            self);
+}
+
 TlmSessionRemote *
-tlm_session_remote_new (
-        TlmConfig *config,
-        const gchar *seat_id,
-        const gchar *service,
-        const gchar *username)
+tlm_session_remote_spawn (
+        TlmConfig *config)
 {
     GError *error = NULL;
     GPid cpid = 0;
     gchar **argv;
+    gchar **envp;
     gint cin_fd, cout_fd;
+    uuid_t uuid;
+    gchar secret[37];
     TlmSessionRemote *session = NULL;
     TlmPipeStream *stream = NULL;
     gboolean ret = FALSE;
+    gboolean persistent = FALSE;
     const gchar *bin_path = TLM_BIN_DIR;
 
 #   ifdef ENABLE_DEBUG
@@ -488,13 +1025,24 @@ tlm_session_remote_new (
      * error will be returned */
     signal(SIGPIPE, SIG_IGN);
 
+    persistent = tlm_config_get_boolean (config, TLM_CONFIG_GENERAL,
+            TLM_CONFIG_GENERAL_PERSIST_SESSIONS, FALSE);
+
     /* Spawn child process */
-    argv = g_new0 (gchar *, 1 + 1);
+    argv = g_new0 (gchar *, 2 + 1);
     argv[0] = g_build_filename (bin_path, TLM_SESSIOND_NAME, NULL);
-    ret = g_spawn_async_with_pipes (NULL, argv, NULL,
+    if (persistent)
+        argv[1] = g_strdup ("--persist");
+    /* a secret of this sessiond only, it accepts no auth token without it */
+    uuid_generate_random (uuid);
+    uuid_unparse_lower (uuid, secret);
+    envp = g_environ_setenv (g_get_environ (), TLM_SESSIOND_TOKEN_SECRET_ENV,
+            secret, TRUE);
+    ret = g_spawn_async_with_pipes (NULL, argv, envp,
             G_SPAWN_DO_NOT_REAP_CHILD, NULL,
             NULL, &cpid, &cin_fd, &cout_fd, NULL, &error);
     g_strfreev (argv);
+    g_strfreev (envp);
     if (ret == FALSE || (kill(cpid, 0) != 0)) {
         DBG ("failed to start sessiond: error %s(%d)",
             error ? error->message : "(null)", ret);
@@ -510,51 +1058,284 @@ tlm_session_remote_new (
             (GChildWatchFunc)_on_child_down_cb, session);
     session->priv->cpid = cpid;
     session->priv->is_sessiond_up = TRUE;
+    session->priv->can_emit_signal = TRUE;
+    session->priv->persistent = persistent;
+    session->priv->token_secret = g_strdup (secret);
 
-    /* Create dbus connection */
+    /* Create dbus connection; the rest of the bring-up continues from the
+     * main loop so that a slow sessiond does not stall other seats */
+    _set_phase (session, SESSION_PHASE_CONNECT);
     stream = tlm_pipe_stream_new (cout_fd, cin_fd, TRUE);
-    session->priv->connection = g_dbus_connection_new_sync (
-            G_IO_STREAM (stream), NULL, G_DBUS_CONNECTION_FLAGS_NONE, NULL,
-            NULL, NULL);
+    g_dbus_connection_new (G_IO_STREAM (stream), NULL,
+            G_DBUS_CONNECTION_FLAGS_NONE, NULL, session->priv->cancellable,
+            _on_connection_ready_cb, session);
     g_object_unref (stream);
 
-    /* Create dbus proxy */
-    session->priv->dbus_session_proxy =
-            tlm_dbus_session_proxy_new_sync (
-                    session->priv->connection,
-                    G_DBUS_PROXY_FLAGS_NONE,
-                    NULL,
-                    TLM_SESSION_OBJECTPATH,
-                    NULL,
-                    &error);
-    if (error) {
-        DBG ("Failed to register object: %s", error->message);
-        g_error_free (error);
-        g_object_unref (session);
-        return NULL;
-    }
-    DBG("'%s' object exported(%p)", TLM_SESSION_OBJECTPATH, session);
-
-    session->priv->signal_session_created = g_signal_connect_swapped (
-            session->priv->dbus_session_proxy, "session-created",
-            G_CALLBACK (_on_session_created_cb), session);
-    session->priv->signal_session_terminated = g_signal_connect_swapped (
-            session->priv->dbus_session_proxy, "session-terminated",
-            G_CALLBACK(_on_session_terminated_cb), session);
-    session->priv->signal_authenticated = g_signal_connect_swapped (
-            session->priv->dbus_session_proxy, "authenticated",
-            G_CALLBACK(_on_authenticated_cb), session);
-    session->priv->signal_error = g_signal_connect_swapped (
-            session->priv->dbus_session_proxy, "error",
-            G_CALLBACK(_on_error_cb), session);
+    return session;
+}
+
+TlmSessionRemote *
+tlm_session_remote_new (
+        TlmConfig *config,
+        const gchar *seat_id,
+        const gchar *service,
+        const gchar *username)
+{
+    TlmSessionRemote *session = tlm_session_remote_spawn (config);
+    if (!session) return NULL;
 
     g_object_set (G_OBJECT (session), "seatid", seat_id, "service", service,
             "username", username, NULL);
 
-    session->priv->can_emit_signal = TRUE;
     return session;
 }
 
+typedef struct
+{
+    TlmConfig *config;
+    gchar *address;
+    GDBusConnection *connection;
+    pid_t pid;
+} TlmSessionAttach;
+
+static void
+_session_attach_free (TlmSessionAttach *data)
+{
+    g_object_unref (data->config);
+    g_free (data->address);
+    if (data->connection)
+        g_object_unref (data->connection);
+    g_slice_free (TlmSessionAttach, data);
+}
+
+static void
+_attach_proxy_cb (
+        GObject *object,
+        GAsyncResult *res,
+        gpointer user_data)
+{
+    GTask *task = G_TASK (user_data);
+    TlmSessionAttach *data = g_task_get_task_data (task);
+    GError *error = NULL;
+    TlmDbusSession *proxy = NULL;
+    TlmSessionRemote *session = NULL;
+    gchar *sessionid = NULL;
+
+    proxy = tlm_dbus_session_proxy_new_finish (res, &error);
+    if (proxy)
+        g_object_get (G_OBJECT (proxy), "sessionid", &sessionid, NULL);
+    if (!sessionid || !sessionid[0]) {
+        DBG ("No session at %s: %s", data->address,
+                error ? error->message : "not created");
+        if (!error)
+            error = TLM_GET_ERROR_FOR_ID (TLM_ERROR_SESSION_NOT_VALID,
+                    "No session at %s", data->address);
+        g_task_return_error (task, error);
+        g_free (sessionid);
+        if (proxy) g_object_unref (proxy);
+        g_object_unref (task);
+        return;
+    }
+
+    session = TLM_SESSION_REMOTE (g_object_new (TLM_TYPE_SESSION_REMOTE,
+            "config", data->config, NULL));
+    session->priv->connection = data->connection;
+    data->connection = NULL;
+    session->priv->cpid = data->pid;
+    session->priv->is_sessiond_up = TRUE;
+    session->priv->can_emit_signal = TRUE;
+    session->priv->persistent = TRUE;
+    session->priv->is_attached = TRUE;
+    session->priv->phase = SESSION_PHASE_CREATED;
+    session->priv->sessionid = sessionid;
+    g_object_get (G_OBJECT (proxy), "seatid", &session->priv->seatid,
+            "service", &session->priv->service,
+            "username", &session->priv->username,
+            "vtnr", &session->priv->vtnr, NULL);
+    _set_proxy (session, proxy);
+    g_signal_connect (session->priv->connection, "closed",
+            G_CALLBACK (_on_connection_closed_cb), session);
+
+    DBG ("attached to session %s of %s on %s, sessiond pid %d", sessionid,
+            session->priv->username, session->priv->seatid, data->pid);
+    g_task_return_pointer (task, session, g_object_unref);
+    g_object_unref (task);
+}
+
+static void
+_attach_connected_cb (
+        GObject *object,
+        GAsyncResult *res,
+        gpointer user_data)
+{
+    GTask *task = G_TASK (user_data);
+    TlmSessionAttach *data = g_task_get_task_data (task);
+    GError *error = NULL;
+    gint peer_fd = -1;
+    struct ucred peer_cred;
+    socklen_t cred_size = sizeof (peer_cred);
+
+    data->connection = g_dbus_connection_new_for_address_finish (res, &error);
+    if (!data->connection) {
+        DBG ("Failed to connect to sessiond at %s: %s", data->address,
+                error->message);
+        g_task_return_error (task, error);
+        g_object_unref (task);
+        return;
+    }
+
+    peer_fd = g_socket_get_fd (g_socket_connection_get_socket (
+            G_SOCKET_CONNECTION (g_dbus_connection_get_stream (
+                    data->connection))));
+    if (getsockopt (peer_fd, SOL_SOCKET, SO_PEERCRED, &peer_cred,
+                    &cred_size) != 0 || peer_cred.uid != 0) {
+        WARN ("Ignoring sessiond at %s of unknown origin", data->address);
+        error = TLM_GET_ERROR_FOR_ID (TLM_ERROR_PERMISSION_DENIED,
+                "sessiond of unknown origin");
+        g_task_return_error (task, error);
+        g_object_unref (task);
+        return;
+    }
+    data->pid = peer_cred.pid;
+
+    tlm_dbus_session_proxy_new (data->connection, G_DBUS_PROXY_FLAGS_NONE,
+            NULL, TLM_SESSION_OBJECTPATH, g_task_get_cancellable (task),
+            _attach_proxy_cb, task);
+}
+
+/**
+ * tlm_session_remote_attach_async:
+ * @config: the configuration
+ * @address: control socket address of a tlm-sessiond left running by a
+ * previous daemon, see #TLM_CONFIG_GENERAL_PERSIST_SESSIONS
+ * @cancellable: (allow-none): a #GCancellable
+ * @callback: called once the session is attached or found missing
+ * @user_data: data passed to @callback
+ *
+ * Connects to the running session, which then behaves as if it had been
+ * created by this daemon. A sessiond that does not answer does not hold up
+ * the caller. Use tlm_session_remote_attach_finish() in @callback.
+ */
+void
+tlm_session_remote_attach_async (
+        TlmConfig *config,
+        const gchar *address,
+        GCancellable *cancellable,
+        GAsyncReadyCallback callback,
+        gpointer user_data)
+{
+    GTask *task = NULL;
+    TlmSessionAttach *data = NULL;
+
+    g_return_if_fail (config && address);
+
+    task = g_task_new (NULL, cancellable, callback, user_data);
+    data = g_slice_new0 (TlmSessionAttach);
+    data->config = g_object_ref (config);
+    data->address = g_strdup (address);
+    g_task_set_task_data (task, data, (GDestroyNotify) _session_attach_free);
+
+    g_dbus_connection_new_for_address (address,
+            G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT, NULL, cancellable,
+            _attach_connected_cb, task);
+}
+
+/**
+ * tlm_session_remote_attach_finish:
+ * @result: the #GAsyncResult passed to the callback
+ * @error: (allow-none): return location for the error
+ *
+ * Returns: (transfer full): the session, or NULL if there is no session
+ * behind the address
+ */
+TlmSessionRemote *
+tlm_session_remote_attach_finish (
+        GAsyncResult *result,
+        GError **error)
+{
+    g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+
+    return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+/**
+ * tlm_session_remote_detach:
+ * @self: the session
+ *
+ * Lets go of a created session without terminating it, it can be taken
+ * over again with tlm_session_remote_attach_async(). No signals are emitted
+ * after this.
+ *
+ * Returns: TRUE if the session keeps running
+ */
+gboolean
+tlm_session_remote_detach (
+        TlmSessionRemote *self)
+{
+    g_return_val_if_fail (self && TLM_IS_SESSION_REMOTE(self), FALSE);
+    TlmSessionRemotePrivate *priv = TLM_SESSION_REMOTE_PRIV(self);
+
+    if (!priv->persistent || !priv->is_sessiond_up || priv->is_terminating ||
+        priv->phase != SESSION_PHASE_CREATED)
+        return FALSE;
+
+    DBG ("detaching from session %s, sessiond pid %d", priv->sessionid,
+            priv->cpid);
+    priv->can_emit_signal = FALSE;
+    priv->is_sessiond_up = FALSE;
+    if (priv->child_watch_id > 0) {
+        g_source_remove (priv->child_watch_id);
+        priv->child_watch_id = 0;
+    }
+    return TRUE;
+}
+
+gboolean
+tlm_session_remote_is_alive (
+        TlmSessionRemote *self)
+{
+    g_return_val_if_fail (self && TLM_IS_SESSION_REMOTE(self), FALSE);
+    return self->priv->is_sessiond_up &&
+           self->priv->phase != SESSION_PHASE_FAILED;
+}
+
+void
+tlm_session_remote_exec (
+        TlmSessionRemote *self)
+{
+    g_return_if_fail (self && TLM_IS_SESSION_REMOTE(self));
+    TlmSessionRemotePrivate *priv = TLM_SESSION_REMOTE_PRIV(self);
+
+    if (!priv->dbus_session_proxy) {
+        /* not connected yet, just don't ask sessiond to wait */
+        priv->defer_exec = FALSE;
+        return;
+    }
+    tlm_dbus_session_call_session_exec (priv->dbus_session_proxy,
+            priv->cancellable, NULL, NULL);
+}
+
+void
+tlm_session_remote_set_frozen (
+        TlmSessionRemote *self,
+        gboolean frozen)
+{
+    g_return_if_fail (self && TLM_IS_SESSION_REMOTE(self));
+    TlmSessionRemotePrivate *priv = TLM_SESSION_REMOTE_PRIV(self);
+
+    if (!priv->is_sessiond_up || !priv->dbus_session_proxy) {
+        WARN ("sessiond is not running");
+        return;
+    }
+
+    if (frozen)
+        tlm_dbus_session_call_session_freeze (priv->dbus_session_proxy,
+                priv->cancellable, NULL, NULL);
+    else
+        tlm_dbus_session_call_session_thaw (priv->dbus_session_proxy,
+                priv->cancellable, NULL, NULL);
+}
+
 gboolean
 tlm_session_remote_terminate (
         TlmSessionRemote *self)
@@ -567,6 +1348,11 @@ tlm_session_remote_terminate (
         return FALSE;
     }
 
+    if (priv->is_terminating) {
+        DBG ("Termination already in progress");
+        return TRUE;
+    }
+
     DBG ("Terminate child session process");
     if (kill (priv->cpid, SIGHUP) < 0)
         WARN ("kill(%u, SIGHUP): %s", priv->cpid, strerror(errno));
@@ -575,6 +1361,10 @@ tlm_session_remote_terminate (
             tlm_config_get_uint (priv->config, TLM_CONFIG_GENERAL,
                     TLM_CONFIG_GENERAL_TERMINATE_TIMEOUT, 3),
             _terminate_timeout, self);
+
+    /* keep the object alive until the child has been reaped */
+    priv->is_terminating = TRUE;
+    g_object_ref (self);
     return TRUE;
 }
 
@@ -609,7 +1399,7 @@ tlm_session_remote_get_info (
     g_return_val_if_fail (self && TLM_IS_SESSION_REMOTE(self), FALSE);
     TlmSessionRemotePrivate *priv = TLM_SESSION_REMOTE_PRIV(self);
 
-    if (!priv->is_sessiond_up) {
+    if (!priv->is_sessiond_up || !priv->dbus_session_proxy) {
         WARN ("sessiond is not running");
         return FALSE;
     }
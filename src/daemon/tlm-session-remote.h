@@ -27,6 +27,7 @@
 #define __TLM_SESSION_REMOTE_H_
 
 #include <glib.h>
+#include <gio/gio.h>
 #include "common/tlm-config.h"
 
 G_BEGIN_DECLS
@@ -65,6 +66,10 @@ struct _TlmSessionRemoteClass
 GType
 tlm_session_remote_get_type (void) G_GNUC_CONST;
 
+TlmSessionRemote *
+tlm_session_remote_spawn (
+        TlmConfig *config);
+
 TlmSessionRemote *
 tlm_session_remote_new (
         TlmConfig *config,
@@ -72,20 +77,51 @@ tlm_session_remote_new (
         const gchar *service,
         const gchar *username);
 
+void
+tlm_session_remote_attach_async (
+        TlmConfig *config,
+        const gchar *address,
+        GCancellable *cancellable,
+        GAsyncReadyCallback callback,
+        gpointer user_data);
+
+TlmSessionRemote *
+tlm_session_remote_attach_finish (
+        GAsyncResult *result,
+        GError **error);
+
+gboolean
+tlm_session_remote_detach (
+        TlmSessionRemote *session);
+
 void
 tlm_session_remote_create (
     TlmSessionRemote *session,
     const gchar *password,
-    GHashTable *environment);
+    GHashTable *environment,
+    GVariant *auth_token);
 
 gboolean
 tlm_session_remote_terminate (
         TlmSessionRemote *session);
 
+void
+tlm_session_remote_exec (
+        TlmSessionRemote *session);
+
+void
+tlm_session_remote_set_frozen (
+        TlmSessionRemote *session,
+        gboolean frozen);
+
 gboolean
 tlm_session_remote_get_info (
         TlmSessionRemote *self);
 
+gboolean
+tlm_session_remote_is_alive (
+        TlmSessionRemote *self);
+
 const gchar *
 tlm_session_remote_get_sessionid (
         TlmSessionRemote *session);
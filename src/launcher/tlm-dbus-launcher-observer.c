@@ -52,12 +52,14 @@ G_DEFINE_TYPE (TlmDbusLauncherObserver, tlm_dbus_launcher_observer, G_TYPE_OBJEC
 
 struct ProcessObject
 {
+	TlmDbusLauncherObserver *observer; /* NULL once detached */
 	pid_t pid;
 	gchar *path;
 	gchar *args;
     int last_sig;
     guint timer_id;
     guint watch_id;
+    gboolean is_pending; /* counted in _detached_processes */
 };
 
 struct _TlmDbusLauncherObserverPrivate
@@ -76,6 +78,18 @@ enum {
 
 static GParamSpec *pspecs[N_PROPERTIES];
 
+/* processes still being terminated after their observer went away */
+static guint _detached_processes = 0;
+
+static void
+_release_detached (struct ProcessObject *obj)
+{
+    if (obj->is_pending) {
+        obj->is_pending = FALSE;
+        _detached_processes--;
+    }
+}
+
 enum {
 	SIG_PROCESS_STOPPED,
 
@@ -145,6 +159,7 @@ _stop_process_timeout (gpointer user_data)
             WARN ("process %u didn't respond to SIGKILL, it is stuck in kernel",
             	 obj->pid);
             obj->timer_id = 0;
+            _release_detached (obj);
             return G_SOURCE_REMOVE;
         default:
             WARN ("%d has unknown signaling state %d", obj->pid, obj->last_sig);
@@ -175,18 +190,6 @@ _stop_process (
             		_stop_process_timeout, obj);
 }
 
-static void
-_stop_process_blocking (
-        pid_t pid,
-        gpointer proc_obj,
-        TlmDbusLauncherObserver *self)
-{
-	struct ProcessObject *obj = proc_obj;
-	_stop_process (pid, obj, self);
-	while (obj->timer_id != 0)
-	      g_main_context_iteration(NULL, TRUE);
-}
-
 static void
 _stop_dbus_server (TlmDbusLauncherObserver *self)
 {
@@ -218,13 +221,18 @@ tlm_dbus_launcher_observer_dispose (GObject *object)
 
     if (self->priv->launched_processes) {
         GHashTableIter iter;
-        pid_t key;
+        gpointer key;
         struct ProcessObject *value = NULL;
     	g_hash_table_iter_init (&iter, self->priv->launched_processes);
-    	while (g_hash_table_iter_next (&iter,
-    			(gpointer)&key,
-    			(gpointer)&value)) {
-    		_stop_process_blocking (key, value, self);
+    	while (g_hash_table_iter_next (&iter, &key, (gpointer)&value)) {
+    		/* the process object outlives the observer until the child
+    		 * has been reaped, see _on_process_down_cb */
+    		if (!value->timer_id)
+    			_stop_process (GPOINTER_TO_UINT (key), value, self);
+    		value->observer = NULL;
+    		value->is_pending = TRUE;
+    		_detached_processes++;
+    		g_hash_table_iter_steal (&iter);
     	}
     	g_hash_table_unref (self->priv->launched_processes);
         self->priv->launched_processes = NULL;
@@ -296,7 +304,10 @@ _on_process_down_cb (
 {
     g_spawn_close_pid (pid);
 
-    TlmDbusLauncherObserver *self = TLM_DBUS_LAUNCHER_OBSERVER (data);
+    struct ProcessObject *obj = data;
+    TlmDbusLauncherObserver *self = obj->observer;
+
+    obj->watch_id = 0;
     if (WIFEXITED(status)) {
         DBG ("process with pid (%d) exited status %d", pid,
                WEXITSTATUS(status));
@@ -308,6 +319,13 @@ _on_process_down_cb (
                WSTOPSIG(status));
     }
 
+    if (!self) {
+        /* observer is gone, nobody to notify */
+        _release_detached (obj);
+        _destroy_process_obj (obj);
+        return;
+    }
+
     g_hash_table_remove (self->priv->launched_processes,
     		GUINT_TO_POINTER (pid));
     g_signal_emit (self, signals[SIG_PROCESS_STOPPED], 0, pid);
@@ -331,12 +349,13 @@ tlm_dbus_launcher_launch_process (
     if (child_pid) {
     	DBG ("setup watch for the new process with pid %u", child_pid);
     	struct ProcessObject *obj = g_malloc0 (sizeof (struct ProcessObject));
+    	obj->observer = self;
     	obj->pid = child_pid;
     	g_hash_table_insert (self->priv->launched_processes,
     			GUINT_TO_POINTER (child_pid), obj);
         *procid = obj->pid;
     	obj->watch_id = g_child_watch_add (child_pid,
-    			(GChildWatchFunc)_on_process_down_cb, self);
+    			(GChildWatchFunc)_on_process_down_cb, obj);
     	return TRUE;
     }
 
@@ -375,6 +394,12 @@ tlm_dbus_launcher_stop_process (
     return TRUE;
 }
 
+guint
+tlm_dbus_launcher_observer_get_pending_processes (void)
+{
+    return _detached_processes;
+}
+
 gboolean
 tlm_dbus_launcher_list_processes (
         TlmDbusLauncherObserver *self)
@@ -78,6 +78,9 @@ tlm_dbus_launcher_stop_process (
         guint procid,
         GError **error);
 
+guint
+tlm_dbus_launcher_observer_get_pending_processes (void);
+
 gboolean
 tlm_dbus_launcher_list_processes (
         TlmDbusLauncherObserver *self);
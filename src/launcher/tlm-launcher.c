@@ -279,6 +279,10 @@ int main (int argc, char *argv[])
   g_main_loop_run (launcher.loop);
 
   g_object_unref (dbus_observer);
+  /* processes launched over dbus are terminated in the background, wait
+   * until all of them have been reaped */
+  while (tlm_dbus_launcher_observer_get_pending_processes () > 0)
+    g_main_context_iteration (NULL, TRUE);
   g_object_unref (config);
   _tlm_launcher_deinit (&launcher);
 
@@ -24,24 +24,59 @@
  */
 
 #include <pwd.h>
+#include <grp.h>
+#include <shadow.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <glib.h>
+#include <glib/gstdio.h>
 
 #include "tlm-account-plugin-default.h"
+#include "tlm-home-template.h"
 #include "tlm-log.h"
+#include "tlm-user-info.h"
+#include "tlm-utils.h"
 
 /**
  * SECTION:tlm-account-plugin-default
  * @short_description: an default plugin for user account operation
  *
  * #TlmAccountPluginDefault provides a default implementation of user account
- * operations:
- * - setting up guest account is performed by running 'useradd'
- * - cleaning up guest account is performed by running 'rm -rf' on the account's
- * home directory
- * - check the account validity is done using getpwnam().
+ * operations, done in-process without running any external tools:
+ * - setting up guest account adds the user and a group of the same name to
+ * the account files and creates the home directory from the template
+ * - cleaning up guest account resets the account's home directory to the
+ * template
+ * - check the account validity is done using tlm_user_info_lookup().
+ *
+ * The asynchronous operations run in a thread, the files are shared with the
+ * shadow tools through lckpwdf(). An account is added to all of the account
+ * files or to none of them: each file is written to a copy that replaces it
+ * once all the copies are complete, with the previous contents kept as the
+ * "-" backup. User names follow the rules of the shadow tools. The plugin
+ * reads these keys from its configuration group:
+ * - UID_MIN, UID_MAX: range of the ids for new accounts, 1000 to 60000 by
+ * default
+ * - HOME_DIR: where the home directories are created, /home by default
+ * - SHELL: login shell of new accounts, /bin/sh by default
+ * - SKEL_DIR: contents of new home directories, /etc/skel by default
+ * - HOME_BACKEND: "copy" to copy the template to the home directories,
+ * with reflinks where possible, or "overlay" to mount them as an overlay
+ * of the template with a tmpfs layer for the changes. Resetting an overlay
+ * is unmounting it and mounting a fresh one, however much the session
+ * wrote; the plugin falls back to copying where it can not be mounted.
+ * "copy" by default
+ * - HOME_TEMPLATE: the template, SKEL_DIR by default
+ * - HOME_LAYERS_DIR: where the tmpfs layers are mounted,
+ * /var/run/tlm-homes by default
+ * - HOME_LAYER_SIZE: size limit of a tmpfs layer, like "64m", half of the
+ * memory by default
  *
  * It is recommended to use a GUM plugin instead: see #TlmAccountPluginGumd.
  *
@@ -70,22 +105,445 @@ struct _TlmAccountPluginDefault
     GHashTable *config;
 };
 
+#define PASSWD_FILE     "/etc/passwd"
+#define GROUP_FILE      "/etc/group"
+#define SHADOW_FILE     "/etc/shadow"
+#define GSHADOW_FILE    "/etc/gshadow"
+
+/* lckpwdf() locks are per process, this keeps the threads apart */
+G_LOCK_DEFINE_STATIC (account_files);
+
+static const gchar *
+_get_config (
+        TlmAccountPluginDefault *self,
+        const gchar *key,
+        const gchar *def)
+{
+    const gchar *value = NULL;
+
+    if (self->config)
+        value = g_hash_table_lookup (self->config, key);
+    return value ? value : def;
+}
+
+static guint
+_get_config_uint (
+        TlmAccountPluginDefault *self,
+        const gchar *key,
+        guint def)
+{
+    const gchar *value = _get_config (self, key, NULL);
+
+    return value ? (guint) g_ascii_strtoull (value, NULL, 10) : def;
+}
+
+static gboolean
+_user_exists (const gchar *user_name)
+{
+    TlmUserInfo *info = tlm_user_info_lookup (user_name);
+
+    if (!info)
+        return FALSE;
+    tlm_user_info_unref (info);
+    return TRUE;
+}
+
+/* the first id in the range that is neither a user nor a group id */
+static uid_t
+_allocate_id (TlmAccountPluginDefault *self)
+{
+    GHashTable *used = g_hash_table_new (g_direct_hash, g_direct_equal);
+    guint id_min = _get_config_uint (self, "UID_MIN", 1000);
+    guint id_max = _get_config_uint (self, "UID_MAX", 60000);
+    uid_t id = (uid_t) -1;
+    struct passwd *pwd = NULL;
+    struct group *grp = NULL;
+    FILE *f = NULL;
+    guint i;
+
+    if ((f = fopen (PASSWD_FILE, "r"))) {
+        while ((pwd = fgetpwent (f)))
+            g_hash_table_add (used, GUINT_TO_POINTER (pwd->pw_uid));
+        fclose (f);
+    }
+    if ((f = fopen (GROUP_FILE, "r"))) {
+        while ((grp = fgetgrent (f)))
+            g_hash_table_add (used, GUINT_TO_POINTER (grp->gr_gid));
+        fclose (f);
+    }
+
+    for (i = id_min; i <= id_max; i++) {
+        if (!g_hash_table_contains (used, GUINT_TO_POINTER (i))) {
+            id = (uid_t) i;
+            break;
+        }
+    }
+    g_hash_table_unref (used);
+
+    return id;
+}
+
+/* the rules of the shadow tools: [a-z_][a-z0-9_-]*[$]?, at most 32
+ * characters */
+static gboolean
+_is_valid_user_name (const gchar *user_name)
+{
+    gsize len = strlen (user_name);
+    gsize i;
+
+    if (len == 0 || len > 32)
+        return FALSE;
+    if (!g_ascii_islower (user_name[0]) && user_name[0] != '_')
+        return FALSE;
+    for (i = 1; i < len; i++) {
+        gchar c = user_name[i];
+        if (g_ascii_islower (c) || g_ascii_isdigit (c) || c == '_' ||
+            c == '-' || (c == '$' && i == len - 1))
+            continue;
+        return FALSE;
+    }
+    return TRUE;
+}
+
+typedef struct
+{
+    const gchar *path;
+    int (*put) (FILE *f, gconstpointer entry);
+    gconstpointer entry;
+    gchar *new_path; /* <path>+, the updated copy */
+    gchar *backup_path; /* <path>-, the previous contents */
+    gboolean replaced;
+} TlmAccountFile;
+
+static int
+_put_group (FILE *f, gconstpointer entry)
+{
+    return putgrent ((const struct group *) entry, f);
+}
+
+static int
+_put_passwd (FILE *f, gconstpointer entry)
+{
+    return putpwent ((const struct passwd *) entry, f);
+}
+
+static int
+_put_shadow (FILE *f, gconstpointer entry)
+{
+    return putspent ((const struct spwd *) entry, f);
+}
+
+static int
+_put_gshadow (FILE *f, gconstpointer entry)
+{
+    return fprintf (f, "%s:!::\n", (const gchar *) entry);
+}
+
+static gboolean
+_write_all (int fd, const gchar *buf, gssize len)
+{
+    while (len > 0) {
+        gssize n = write (fd, buf, len);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return FALSE;
+        buf += n;
+        len -= n;
+    }
+    return TRUE;
+}
+
+/* writes the current contents and the new entry to <path>+, with the mode
+ * and owner of the file, and flushes it to the disk */
+static gboolean
+_stage_account_file (TlmAccountFile *file)
+{
+    struct stat st;
+    gchar buf[4096];
+    gchar last = '\n';
+    gssize n = 0;
+    int in_fd = -1;
+    int out_fd = -1;
+    FILE *f = NULL;
+    gboolean res = FALSE;
+
+    file->new_path = g_strconcat (file->path, "+", NULL);
+    file->backup_path = g_strconcat (file->path, "-", NULL);
+
+    in_fd = open (file->path, O_RDONLY | O_CLOEXEC);
+    if (in_fd < 0 || fstat (in_fd, &st) != 0)
+        goto _out;
+    g_unlink (file->new_path);
+    out_fd = open (file->new_path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                   0600);
+    if (out_fd < 0 ||
+        fchown (out_fd, st.st_uid, st.st_gid) != 0 ||
+        fchmod (out_fd, st.st_mode & 07777) != 0)
+        goto _out;
+
+    while ((n = read (in_fd, buf, sizeof (buf))) != 0) {
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 || !_write_all (out_fd, buf, n))
+            goto _out;
+        last = buf[n - 1];
+    }
+    if (last != '\n' && !_write_all (out_fd, "\n", 1))
+        goto _out;
+
+    if (!(f = fdopen (out_fd, "w")))
+        goto _out;
+    out_fd = -1;
+    if (file->put (f, file->entry) < 0 || fflush (f) != 0 ||
+        fsync (fileno (f)) != 0)
+        goto _out;
+    res = TRUE;
+
+_out:
+    if (f && fclose (f) != 0)
+        res = FALSE;
+    if (out_fd >= 0)
+        close (out_fd);
+    if (in_fd >= 0)
+        close (in_fd);
+    if (!res) {
+        WARN ("Failed to write %s : %s", file->new_path, strerror (errno));
+        g_unlink (file->new_path);
+    }
+    return res;
+}
+
+static void
+_sync_dir (const gchar *file_path)
+{
+    gchar *dir_path = g_path_get_dirname (file_path);
+    int fd = open (dir_path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (fd >= 0) {
+        fsync (fd);
+        close (fd);
+    }
+    g_free (dir_path);
+}
+
+/* all the files are staged before any is replaced, the ones replaced
+ * already get their backup back if a later one fails */
+static gboolean
+_update_account_files (TlmAccountFile *files, guint n_files)
+{
+    gboolean res = TRUE;
+    guint i;
+
+    for (i = 0; i < n_files && res; i++)
+        res = _stage_account_file (&files[i]);
+
+    for (i = 0; i < n_files && res; i++) {
+        g_unlink (files[i].backup_path);
+        if (link (files[i].path, files[i].backup_path) != 0 ||
+            rename (files[i].new_path, files[i].path) != 0) {
+            WARN ("Failed to replace %s : %s", files[i].path,
+                  strerror (errno));
+            res = FALSE;
+            break;
+        }
+        files[i].replaced = TRUE;
+    }
+
+    for (i = 0; i < n_files; i++) {
+        if (!res && files[i].replaced &&
+            rename (files[i].backup_path, files[i].path) != 0)
+            CRITICAL ("Failed to restore %s from %s : %s", files[i].path,
+                      files[i].backup_path, strerror (errno));
+        if (files[i].new_path)
+            g_unlink (files[i].new_path);
+        g_free (files[i].new_path);
+        g_free (files[i].backup_path);
+    }
+    if (n_files > 0)
+        _sync_dir (files[0].path);
+
+    return res;
+}
+
+/* the user gets a group of its own with the same id, the shadow entries
+ * are locked so that the account can only be used through tlm */
+static gboolean
+_add_account (
+        const gchar *user_name,
+        uid_t id,
+        const gchar *home_dir,
+        const gchar *shell)
+{
+    gchar *no_members[] = { NULL };
+    struct group grp = { (gchar *) user_name, "x", id, no_members };
+    struct passwd pwd = {
+        (gchar *) user_name, "x", id, id, "", (gchar *) home_dir,
+        (gchar *) shell };
+    struct spwd spwd = {
+        (gchar *) user_name, "!", time (NULL) / (24 * 60 * 60), 0, 99999, 7,
+        -1, -1, ~0UL };
+    TlmAccountFile files[4];
+    guint n_files = 0;
+
+    memset (files, 0, sizeof (files));
+    files[n_files].path = GROUP_FILE;
+    files[n_files].put = _put_group;
+    files[n_files++].entry = &grp;
+    files[n_files].path = PASSWD_FILE;
+    files[n_files].put = _put_passwd;
+    files[n_files++].entry = &pwd;
+    if (g_file_test (GSHADOW_FILE, G_FILE_TEST_EXISTS)) {
+        files[n_files].path = GSHADOW_FILE;
+        files[n_files].put = _put_gshadow;
+        files[n_files++].entry = user_name;
+    }
+    if (g_file_test (SHADOW_FILE, G_FILE_TEST_EXISTS)) {
+        files[n_files].path = SHADOW_FILE;
+        files[n_files].put = _put_shadow;
+        files[n_files++].entry = &spwd;
+    }
+
+    return _update_account_files (files, n_files);
+}
+
+static const gchar *
+_get_template_dir (TlmAccountPluginDefault *self)
+{
+    return _get_config (self, "HOME_TEMPLATE",
+                        _get_config (self, "SKEL_DIR", "/etc/skel"));
+}
+
+static gboolean
+_is_overlay_backend (TlmAccountPluginDefault *self)
+{
+    return g_strcmp0 (_get_config (self, "HOME_BACKEND", "copy"),
+                      "overlay") == 0;
+}
+
+static gchar *
+_get_layer_dir (
+        TlmAccountPluginDefault *self,
+        const gchar *user_name)
+{
+    return g_build_filename (_get_config (self, "HOME_LAYERS_DIR",
+                                          "/var/run/tlm-homes"),
+                             user_name, NULL);
+}
+
+static gboolean
+_populate_home_dir (
+        TlmAccountPluginDefault *self,
+        const gchar *user_name,
+        const gchar *home_dir,
+        uid_t uid,
+        gid_t gid)
+{
+    gchar *parent = g_path_get_dirname (home_dir);
+    gchar *layer_dir = NULL;
+    gboolean mounted = FALSE;
+
+    g_mkdir_with_parents (parent, 0755);
+    g_free (parent);
+
+    if (g_mkdir (home_dir, 0700) != 0 && errno != EEXIST) {
+        WARN ("Failed to create %s : %s", home_dir, strerror (errno));
+        return FALSE;
+    }
+    if (chown (home_dir, uid, gid) != 0) {
+        WARN ("Failed to change owner of %s : %s", home_dir, strerror (errno));
+        return FALSE;
+    }
+
+    if (_is_overlay_backend (self)) {
+        layer_dir = _get_layer_dir (self, user_name);
+        mounted = tlm_home_template_mount (_get_template_dir (self),
+                layer_dir, _get_config (self, "HOME_LAYER_SIZE", NULL),
+                home_dir, uid, gid);
+        g_free (layer_dir);
+        if (mounted)
+            return TRUE;
+        DBG ("copying the template to %s instead", home_dir);
+    }
+
+    return tlm_home_template_copy (_get_template_dir (self), home_dir,
+                                   uid, gid);
+}
+
+/* an overlay is dropped as a whole, a copy is moved out of the way */
+static gboolean
+_reset_home_dir (
+        TlmAccountPluginDefault *self,
+        const gchar *user_name,
+        const gchar *home_dir,
+        uid_t uid,
+        gid_t gid)
+{
+    gchar *layer_dir = NULL;
+    gboolean res = FALSE;
+
+    if (_is_overlay_backend (self) &&
+        tlm_home_template_is_mounted (home_dir)) {
+        layer_dir = _get_layer_dir (self, user_name);
+        res = tlm_home_template_unmount (layer_dir, home_dir);
+        g_free (layer_dir);
+    } else {
+        /* deleted in the background, the new one does not wait for it */
+        res = tlm_utils_trash_dir (home_dir);
+    }
+
+    return res && _populate_home_dir (self, user_name, home_dir, uid, gid);
+}
 
 static gboolean
 _setup_guest_account (TlmAccountPlugin *plugin, const gchar *user_name)
 {
-    gchar *command = NULL;
-    int res;
+    TlmAccountPluginDefault *self = NULL;
+    gchar *home_dir = NULL;
+    const gchar *shell = NULL;
+    uid_t id = (uid_t) -1;
+    gboolean res = FALSE;
+
     g_return_val_if_fail (plugin, FALSE);
     g_return_val_if_fail (TLM_IS_ACCOUNT_PLUGIN_DEFAULT(plugin), FALSE);
     g_return_val_if_fail (user_name && user_name[0], FALSE);
 
-    command = g_strdup_printf ("useradd %s", user_name);
-    res = system (command);
+    if (!_is_valid_user_name (user_name)) {
+        WARN ("Invalid user name '%s'", user_name);
+        return FALSE;
+    }
+
+    self = TLM_ACCOUNT_PLUGIN_DEFAULT (plugin);
+    shell = _get_config (self, "SHELL", "/bin/sh");
+    home_dir = g_build_filename (_get_config (self, "HOME_DIR", "/home"),
+                                 user_name, NULL);
+
+    G_LOCK (account_files);
+    if (lckpwdf () != 0) {
+        WARN ("Failed to lock the account files : %s", strerror (errno));
+        G_UNLOCK (account_files);
+        g_free (home_dir);
+        return FALSE;
+    }
+
+    if (_user_exists (user_name)) {
+        WARN ("User '%s' exists already", user_name);
+    } else if ((id = _allocate_id (self)) == (uid_t) -1) {
+        WARN ("No free id for user '%s'", user_name);
+    } else {
+        res = _add_account (user_name, id, home_dir, shell);
+        if (res)
+            DBG ("Added user '%s' with id %u", user_name, (guint) id);
+    }
+
+    ulckpwdf ();
+    G_UNLOCK (account_files);
 
-    g_free (command);
+    if (res)
+        res = _populate_home_dir (self, user_name, home_dir, id, id);
+    g_free (home_dir);
 
-    return res != -1;
+    return res;
 }
 
 static gboolean
@@ -93,9 +551,8 @@ _cleanup_guest_user (TlmAccountPlugin *plugin,
                      const gchar *user_name,
                      gboolean delete)
 {
-    struct passwd *pwd_entry = NULL;
-    char *command = NULL;
-    int res;
+    TlmUserInfo *info = NULL;
+    gboolean res = FALSE;
 
     (void) delete;
 
@@ -103,52 +560,31 @@ _cleanup_guest_user (TlmAccountPlugin *plugin,
     g_return_val_if_fail (TLM_IS_ACCOUNT_PLUGIN_DEFAULT(plugin), FALSE);
     g_return_val_if_fail (user_name && user_name[0], FALSE);
 
-    /* clear error */
-    errno = 0;
-
-    pwd_entry = getpwnam (user_name);
-
-    if (!pwd_entry) {
-        DBG("Could not get info for user '%s', error : %s", 
-            user_name, strerror(errno));
+    info = tlm_user_info_lookup (user_name);
+    if (!info)
         return FALSE;
-    }
 
-    if (!pwd_entry->pw_dir) {
+    if (!info->home_dir || !info->home_dir[0]) {
         DBG("No home folder entry found for user '%s'", user_name);
+        tlm_user_info_unref (info);
         return FALSE;
     }
 
-    command = g_strdup_printf ("rm -rf %s/*", pwd_entry->pw_dir);
-
-    res = system (command);
+    res = _reset_home_dir (TLM_ACCOUNT_PLUGIN_DEFAULT (plugin), user_name,
+                           info->home_dir, info->uid, info->gid);
+    tlm_user_info_unref (info);
 
-    g_free (command);
-
-    return res != -1;
+    return res;
 }
 
 static gboolean
 _is_valid_user (TlmAccountPlugin *plugin, const gchar *user_name)
 {
-    struct passwd *pwd_entry = NULL;
-
     g_return_val_if_fail (plugin, FALSE);
     g_return_val_if_fail (TLM_IS_ACCOUNT_PLUGIN_DEFAULT(plugin), FALSE);
     g_return_val_if_fail (user_name && user_name[0], FALSE);
 
-    /* clear error */
-    errno = 0;
-
-    pwd_entry = getpwnam (user_name);
-
-    if (!pwd_entry) {
-        DBG("Could not get info for user '%s', error : %s",
-            user_name, strerror(errno));
-        return FALSE;
-    }
-
-    return TRUE;
+    return _user_exists (user_name);
 }
 
 static void
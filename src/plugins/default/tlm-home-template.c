@@ -0,0 +1,324 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of tlm (Tiny Login Manager)
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * Contact: Amarnath Valluri <amarnath.valluri@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/mount.h>
+#include <sys/stat.h>
+#include <linux/fs.h>
+#include <glib/gstdio.h>
+
+#include "tlm-home-template.h"
+#include "tlm-log.h"
+
+/*
+ * Guest homes built from a read-only template directory. Mounted homes
+ * are an overlay of the template with the changes of the session in a
+ * tmpfs layer of their own, so resetting one is two unmounts and a mount
+ * whatever the session wrote. Where overlays can not be mounted the
+ * template is copied, with reflinks if the filesystem supports them.
+ */
+
+static gboolean
+_copy_file (
+        const gchar *src,
+        const gchar *dst,
+        mode_t mode)
+{
+    gchar buf[16384];
+    ssize_t len = 0;
+    int src_fd, dst_fd;
+    gboolean res = TRUE;
+
+    if ((src_fd = open (src, O_RDONLY | O_CLOEXEC)) < 0)
+        return FALSE;
+    dst_fd = open (dst, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode);
+    if (dst_fd < 0) {
+        close (src_fd);
+        return FALSE;
+    }
+
+#ifdef FICLONE
+    if (ioctl (dst_fd, FICLONE, src_fd) == 0)
+        goto _done;
+#endif
+
+    while (res && (len = read (src_fd, buf, sizeof (buf))) != 0) {
+        if (len < 0) {
+            res = errno == EINTR;
+            continue;
+        }
+        res = write (dst_fd, buf, len) == len;
+    }
+
+#ifdef FICLONE
+_done:
+#endif
+    if (fchmod (dst_fd, mode) != 0)
+        res = FALSE;
+    if (close (dst_fd) != 0)
+        res = FALSE;
+    close (src_fd);
+
+    return res;
+}
+
+/**
+ * tlm_home_template_copy:
+ * @template_dir: the template, like /etc/skel
+ * @home_dir: the home directory to fill
+ * @uid: owner of the copies
+ * @gid: group of the copies
+ *
+ * Copies the contents of @template_dir to @home_dir, sharing the data of
+ * the files with reflinks where the filesystem supports them.
+ *
+ * Returns: whether the whole template was copied; a missing template is
+ * an empty one.
+ */
+gboolean
+tlm_home_template_copy (
+        const gchar *template_dir,
+        const gchar *home_dir,
+        uid_t uid,
+        gid_t gid)
+{
+    GDir *dir = NULL;
+    const gchar *name = NULL;
+    gboolean res = TRUE;
+
+    if (!(dir = g_dir_open (template_dir, 0, NULL)))
+        return TRUE;
+
+    while (res && (name = g_dir_read_name (dir))) {
+        gchar *src_path = g_build_filename (template_dir, name, NULL);
+        gchar *dst_path = g_build_filename (home_dir, name, NULL);
+        struct stat st;
+
+        if (lstat (src_path, &st) == 0) {
+            if (S_ISDIR (st.st_mode)) {
+                res = (g_mkdir (dst_path, st.st_mode & 07777) == 0 ||
+                       errno == EEXIST) &&
+                      tlm_home_template_copy (src_path, dst_path, uid, gid);
+            } else if (S_ISLNK (st.st_mode)) {
+                gchar *target = g_file_read_link (src_path, NULL);
+                res = target && symlink (target, dst_path) == 0;
+                g_free (target);
+            } else if (S_ISREG (st.st_mode)) {
+                res = _copy_file (src_path, dst_path, st.st_mode & 07777);
+            }
+            if (res && lchown (dst_path, uid, gid) != 0)
+                res = FALSE;
+        }
+        if (!res)
+            WARN ("Failed to copy %s : %s", src_path, strerror (errno));
+
+        g_free (src_path);
+        g_free (dst_path);
+    }
+    g_dir_close (dir);
+
+    return res;
+}
+
+/* hands the template's files over to the user in the merged view, with
+ * metacopy only their metadata is copied up */
+static gboolean
+_chown_merged (
+        const gchar *template_dir,
+        const gchar *merged_dir,
+        uid_t uid,
+        gid_t gid)
+{
+    GDir *dir = NULL;
+    const gchar *name = NULL;
+    gboolean res = TRUE;
+
+    if (!(dir = g_dir_open (template_dir, 0, NULL)))
+        return TRUE;
+
+    while (res && (name = g_dir_read_name (dir))) {
+        gchar *src_path = g_build_filename (template_dir, name, NULL);
+        gchar *dst_path = g_build_filename (merged_dir, name, NULL);
+        struct stat st;
+
+        res = lchown (dst_path, uid, gid) == 0;
+        if (res && lstat (src_path, &st) == 0 && S_ISDIR (st.st_mode))
+            res = _chown_merged (src_path, dst_path, uid, gid);
+        if (!res)
+            WARN ("Failed to change owner of %s : %s", dst_path,
+                  strerror (errno));
+
+        g_free (src_path);
+        g_free (dst_path);
+    }
+    g_dir_close (dir);
+
+    return res;
+}
+
+/**
+ * tlm_home_template_is_mounted:
+ * @home_dir: the home directory
+ *
+ * Returns: whether something is mounted on @home_dir
+ */
+gboolean
+tlm_home_template_is_mounted (
+        const gchar *home_dir)
+{
+    gchar *parent = g_path_get_dirname (home_dir);
+    struct stat home_st, parent_st;
+    gboolean res = FALSE;
+
+    if (lstat (home_dir, &home_st) == 0 && lstat (parent, &parent_st) == 0)
+        res = home_st.st_dev != parent_st.st_dev;
+    g_free (parent);
+
+    return res;
+}
+
+/**
+ * tlm_home_template_mount:
+ * @template_dir: the read-only lower layer
+ * @layer_dir: where the tmpfs with the upper layer is mounted, it is
+ * created if needed
+ * @layer_size: (allow-none): size limit of the tmpfs, like "64m"
+ * @home_dir: the mount point
+ * @uid: owner of the home directory
+ * @gid: group of the home directory
+ *
+ * Mounts a fresh overlay of @template_dir on @home_dir.
+ *
+ * Returns: whether the overlay was mounted, nothing is left mounted
+ * otherwise.
+ */
+gboolean
+tlm_home_template_mount (
+        const gchar *template_dir,
+        const gchar *layer_dir,
+        const gchar *layer_size,
+        const gchar *home_dir,
+        uid_t uid,
+        gid_t gid)
+{
+    gchar *layer_opts = NULL;
+    gchar *upper_dir = NULL;
+    gchar *work_dir = NULL;
+    gchar *opts = NULL;
+    gboolean res = FALSE;
+
+    if (g_mkdir_with_parents (layer_dir, 0700) != 0 ||
+        g_mkdir_with_parents (home_dir, 0700) != 0) {
+        WARN ("Failed to create %s : %s", layer_dir, strerror (errno));
+        return FALSE;
+    }
+
+    layer_opts = layer_size ? g_strdup_printf ("mode=0700,size=%s",
+                                               layer_size)
+                            : g_strdup ("mode=0700");
+    if (mount ("tmpfs", layer_dir, "tmpfs", MS_NOSUID | MS_NODEV,
+               layer_opts) != 0) {
+        WARN ("Failed to mount the layer on %s : %s", layer_dir,
+              strerror (errno));
+        g_free (layer_opts);
+        return FALSE;
+    }
+    g_free (layer_opts);
+
+    upper_dir = g_build_filename (layer_dir, "upper", NULL);
+    work_dir = g_build_filename (layer_dir, "work", NULL);
+    if (g_mkdir (upper_dir, 0700) != 0 || chown (upper_dir, uid, gid) != 0 ||
+        g_mkdir (work_dir, 0700) != 0) {
+        WARN ("Failed to set up the layer in %s : %s", layer_dir,
+              strerror (errno));
+        goto _finished;
+    }
+
+    opts = g_strdup_printf ("lowerdir=%s,upperdir=%s,workdir=%s,metacopy=on",
+                            template_dir, upper_dir, work_dir);
+    res = mount ("overlay", home_dir, "overlay", MS_NOSUID | MS_NODEV,
+                 opts) == 0;
+    if (!res && errno == EINVAL) {
+        /* kernel without metacopy, the chown copies the files up */
+        *strrchr (opts, ',') = '\0';
+        res = mount ("overlay", home_dir, "overlay", MS_NOSUID | MS_NODEV,
+                     opts) == 0;
+    }
+    if (!res) {
+        WARN ("Failed to mount the overlay on %s : %s", home_dir,
+              strerror (errno));
+        goto _finished;
+    }
+
+    if (!_chown_merged (template_dir, home_dir, uid, gid)) {
+        umount2 (home_dir, MNT_DETACH);
+        res = FALSE;
+    } else {
+        DBG ("mounted the template %s on %s", template_dir, home_dir);
+    }
+
+_finished:
+    if (!res)
+        umount2 (layer_dir, MNT_DETACH);
+    g_free (opts);
+    g_free (upper_dir);
+    g_free (work_dir);
+
+    return res;
+}
+
+/**
+ * tlm_home_template_unmount:
+ * @layer_dir: where the upper layer is mounted
+ * @home_dir: the mount point of the overlay
+ *
+ * Unmounts a home mounted with tlm_home_template_mount(), dropping the
+ * changes of the session with the layer. Both are detached, processes
+ * still using them keep them until they are done.
+ *
+ * Returns: whether the home was unmounted
+ */
+gboolean
+tlm_home_template_unmount (
+        const gchar *layer_dir,
+        const gchar *home_dir)
+{
+    gboolean res = TRUE;
+
+    if (umount2 (home_dir, MNT_DETACH) != 0) {
+        WARN ("Failed to unmount %s : %s", home_dir, strerror (errno));
+        res = FALSE;
+    }
+    if (umount2 (layer_dir, MNT_DETACH) != 0 && errno != EINVAL) {
+        WARN ("Failed to unmount %s : %s", layer_dir, strerror (errno));
+        res = FALSE;
+    }
+
+    return res;
+}
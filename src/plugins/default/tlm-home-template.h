@@ -0,0 +1,61 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of tlm (Tiny Login Manager)
+ *
+ * Copyright (C) 2013 Intel Corporation.
+ *
+ * Contact: Amarnath Valluri <amarnath.valluri@linux.intel.com>
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#ifndef _TLM_HOME_TEMPLATE_H
+#define _TLM_HOME_TEMPLATE_H
+
+#include <sys/types.h>
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+gboolean
+tlm_home_template_copy (
+        const gchar *template_dir,
+        const gchar *home_dir,
+        uid_t uid,
+        gid_t gid);
+
+gboolean
+tlm_home_template_mount (
+        const gchar *template_dir,
+        const gchar *layer_dir,
+        const gchar *layer_size,
+        const gchar *home_dir,
+        uid_t uid,
+        gid_t gid);
+
+gboolean
+tlm_home_template_unmount (
+        const gchar *layer_dir,
+        const gchar *home_dir);
+
+gboolean
+tlm_home_template_is_mounted (
+        const gchar *home_dir);
+
+G_END_DECLS
+
+#endif /* _TLM_HOME_TEMPLATE_H */
@@ -44,6 +44,12 @@
  * operations that is utiziling gumd daemon API to perform them:
  * <ulink url="https://github.com/01org/gumd">
  * https://github.com/01org/gumd</ulink>.
+ *
+ * The asynchronous operations talk to gumd without blocking, only the home
+ * directory reset is done in a thread. The user found by
+ * tlm_account_plugin_is_valid_user_async() is kept for the following
+ * tlm_account_plugin_cleanup_guest_user_async(), so preparing an existing
+ * guest account looks it up once.
  */
 
 /**
@@ -91,6 +97,26 @@ _setup_guest_account (
     return TRUE;
 }
 
+static gboolean
+_reset_home_dir (
+        uid_t uid,
+        gid_t gid,
+        const gchar *home_dir)
+{
+    GError *error = NULL;
+    guint umask = 022;
+
+    if (!gum_file_delete_home_dir (home_dir, &error) ||
+        !gum_file_create_home_dir (home_dir, uid, gid, umask, &error)) {
+        WARN ("Failed to reset home directory %s : %s", home_dir,
+              error ? error->message : "");
+        if (error) g_error_free (error);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
 static gboolean
 _cleanup_guest_user (
         TlmAccountPlugin *plugin,
@@ -100,9 +126,7 @@ _cleanup_guest_user (
     uid_t uid = 0;
     gid_t gid = 0;
     gchar *home_dir = NULL;
-    GError *error = NULL;
     gboolean ret = FALSE;
-    guint umask = 022;
 
     (void) delete;
 
@@ -118,18 +142,8 @@ _cleanup_guest_user (
     g_object_get (G_OBJECT (guser), "uid", &uid, "gid", &gid, "homedir",
             &home_dir, NULL);
 
-    if (!gum_file_delete_home_dir (home_dir, &error)) {
-        goto _finished;
-    }
-
-    if (!gum_file_create_home_dir (home_dir, uid, gid, umask, &error)) {
-        goto _finished;
-    }
-    ret = TRUE;
-
-_finished:
+    ret = _reset_home_dir (uid, gid, home_dir);
 
-    if (error) g_error_free (error);
     g_free (home_dir);
     g_object_unref (guser);
 
@@ -154,6 +168,215 @@ _is_valid_user (
     return TRUE;
 }
 
+typedef struct {
+    uid_t uid;
+    gid_t gid;
+    gchar *home_dir;
+} TlmGumdHome;
+
+static void
+_home_free (TlmGumdHome *home)
+{
+    g_free (home->home_dir);
+    g_slice_free (TlmGumdHome, home);
+}
+
+static void
+_on_user_added (
+        GumUser *guser,
+        const GError *error,
+        gpointer user_data)
+{
+    GTask *task = G_TASK (user_data);
+
+    if (error) {
+        WARN ("Failed user %s add : %s", (gchar *) g_task_get_task_data (task),
+              error->message);
+    }
+    g_object_unref (guser);
+    g_task_return_boolean (task, error == NULL);
+    g_object_unref (task);
+}
+
+static void
+_on_user_created (
+        GumUser *guser,
+        const GError *error,
+        gpointer user_data)
+{
+    GTask *task = G_TASK (user_data);
+    const gchar *user_name = g_task_get_task_data (task);
+
+    if (error) {
+        WARN ("Failed user %s creation : %s", user_name, error->message);
+        goto _failed;
+    }
+
+    g_object_set (G_OBJECT (guser), "usertype", GUM_USERTYPE_GUEST, "username",
+            user_name, NULL);
+
+    if (gum_user_add (guser, _on_user_added, task))
+        return;
+    WARN ("Failed user %s add", user_name);
+
+_failed:
+    g_object_unref (guser);
+    g_task_return_boolean (task, FALSE);
+    g_object_unref (task);
+}
+
+static void
+_setup_guest_account_async (
+        TlmAccountPlugin *plugin,
+        const gchar *user_name,
+        GCancellable *cancellable,
+        GAsyncReadyCallback callback,
+        gpointer user_data)
+{
+    TlmAccountPluginGumd *self = TLM_ACCOUNT_PLUGIN_GUMD (plugin);
+    GTask *task = g_task_new (plugin, cancellable, callback, user_data);
+
+    g_task_set_task_data (task, g_strdup (user_name), g_free);
+    g_hash_table_remove (self->users, user_name);
+
+    if (!gum_user_create (_on_user_created, task)) {
+        WARN ("Failed user %s creation", user_name);
+        g_task_return_boolean (task, FALSE);
+        g_object_unref (task);
+    }
+}
+
+static gboolean
+_async_finish (
+        TlmAccountPlugin *plugin,
+        GAsyncResult *result,
+        GError **error)
+{
+    g_return_val_if_fail (g_task_is_valid (result, plugin), FALSE);
+
+    return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+static void
+_on_user_found (
+        GumUser *guser,
+        const GError *error,
+        gpointer user_data)
+{
+    GTask *task = G_TASK (user_data);
+    TlmAccountPluginGumd *self = g_task_get_source_object (task);
+    const gchar *user_name = g_task_get_task_data (task);
+
+    if (error) {
+        WARN ("Failed to find user %s : %s", user_name, error->message);
+        g_object_unref (guser);
+    } else {
+        g_hash_table_replace (self->users, g_strdup (user_name), guser);
+    }
+    g_task_return_boolean (task, error == NULL);
+    g_object_unref (task);
+}
+
+static void
+_is_valid_user_async (
+        TlmAccountPlugin *plugin,
+        const gchar *user_name,
+        GCancellable *cancellable,
+        GAsyncReadyCallback callback,
+        gpointer user_data)
+{
+    TlmAccountPluginGumd *self = TLM_ACCOUNT_PLUGIN_GUMD (plugin);
+    GTask *task = g_task_new (plugin, cancellable, callback, user_data);
+
+    g_task_set_task_data (task, g_strdup (user_name), g_free);
+    g_hash_table_remove (self->users, user_name);
+
+    if (!gum_user_get_by_name (user_name, _on_user_found, task)) {
+        WARN ("Failed to find user %s", user_name);
+        g_task_return_boolean (task, FALSE);
+        g_object_unref (task);
+    }
+}
+
+static void
+_reset_home_dir_thread (
+        GTask *task,
+        gpointer source_object,
+        gpointer task_data,
+        GCancellable *cancellable)
+{
+    TlmGumdHome *home = task_data;
+
+    g_task_return_boolean (task,
+            _reset_home_dir (home->uid, home->gid, home->home_dir));
+}
+
+/* takes the task */
+static void
+_cleanup_user_home (
+        GTask *task,
+        GumUser *guser)
+{
+    TlmGumdHome *home = g_slice_new0 (TlmGumdHome);
+
+    g_object_get (G_OBJECT (guser), "uid", &home->uid, "gid", &home->gid,
+            "homedir", &home->home_dir, NULL);
+    g_task_set_task_data (task, home, (GDestroyNotify) _home_free);
+    g_task_run_in_thread (task, _reset_home_dir_thread);
+    g_object_unref (task);
+}
+
+static void
+_on_cleanup_user_found (
+        GumUser *guser,
+        const GError *error,
+        gpointer user_data)
+{
+    GTask *task = G_TASK (user_data);
+
+    if (error) {
+        WARN ("Failed to cleanup user %s : %s",
+              (gchar *) g_task_get_task_data (task), error->message);
+        g_task_return_boolean (task, FALSE);
+        g_object_unref (task);
+    } else {
+        _cleanup_user_home (task, guser);
+    }
+    g_object_unref (guser);
+}
+
+static void
+_cleanup_guest_user_async (
+        TlmAccountPlugin *plugin,
+        const gchar *user_name,
+        gboolean delete,
+        GCancellable *cancellable,
+        GAsyncReadyCallback callback,
+        gpointer user_data)
+{
+    TlmAccountPluginGumd *self = TLM_ACCOUNT_PLUGIN_GUMD (plugin);
+    GTask *task = g_task_new (plugin, cancellable, callback, user_data);
+    GumUser *guser = NULL;
+
+    (void) delete;
+
+    /* found by the preceding validity check */
+    if ((guser = g_hash_table_lookup (self->users, user_name))) {
+        g_object_ref (guser);
+        g_hash_table_remove (self->users, user_name);
+        _cleanup_user_home (task, guser);
+        g_object_unref (guser);
+        return;
+    }
+
+    g_task_set_task_data (task, g_strdup (user_name), g_free);
+    if (!gum_user_get_by_name (user_name, _on_cleanup_user_found, task)) {
+        WARN ("Failed to cleanup user %s", user_name);
+        g_task_return_boolean (task, FALSE);
+        g_object_unref (task);
+    }
+}
+
 static void
 _plugin_interface_init (
         TlmAccountPluginInterface *iface)
@@ -161,6 +384,12 @@ _plugin_interface_init (
     iface->setup_guest_user_account = _setup_guest_account;
     iface->cleanup_guest_user = _cleanup_guest_user;
     iface->is_valid_user = _is_valid_user;
+    iface->setup_guest_user_account_async = _setup_guest_account_async;
+    iface->setup_guest_user_account_finish = _async_finish;
+    iface->is_valid_user_async = _is_valid_user_async;
+    iface->is_valid_user_finish = _async_finish;
+    iface->cleanup_guest_user_async = _cleanup_guest_user_async;
+    iface->cleanup_guest_user_finish = _async_finish;
 }
 
 G_DEFINE_TYPE_WITH_CODE (
@@ -177,6 +406,7 @@ _plugin_finalize (GObject *self)
     TlmAccountPluginGumd *plugin = TLM_ACCOUNT_PLUGIN_GUMD(self);
 
     if (plugin->config) g_hash_table_unref (plugin->config);
+    g_hash_table_unref (plugin->users);
 
     G_OBJECT_CLASS (tlm_account_plugin_gumd_parent_class)->finalize(self);
 }
@@ -239,6 +469,8 @@ static void
 tlm_account_plugin_gumd_init (
         TlmAccountPluginGumd *self)
 {
+    self->users = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+                                         g_object_unref);
     tlm_log_init(G_LOG_DOMAIN);
 }
 
@@ -50,6 +50,7 @@ struct _TlmAccountPluginGumd
 {
     GObject parent;
     GHashTable *config;
+    GHashTable *users;
 };
 
 struct _TlmAccountPluginGumdClass
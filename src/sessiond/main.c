@@ -35,6 +35,7 @@
 #include <sys/prctl.h>
 
 #include "common/tlm-log.h"
+#include "common/dbus/tlm-dbus.h"
 #include "tlm-session-daemon.h"
 
 static TlmSessionDaemon *_daemon = NULL;
@@ -55,13 +56,17 @@ _handle_quit_signal (gpointer user_data)
 
     g_return_val_if_fail (ml != NULL, FALSE);
     DBG ("Received quit signal");
-    if (ml) g_main_loop_quit (ml);
+    /* the main loop quits once the daemon is gone, see _on_daemon_closed */
+    if (_daemon)
+        tlm_session_daemon_stop (_daemon);
+    else if (ml)
+        g_main_loop_quit (ml);
 
     return FALSE;
 }
 
 static void
-_install_sighandlers (GMainLoop *main_loop)
+_install_sighandlers (GMainLoop *main_loop, gboolean persistent)
 {
     GSource *source = NULL;
     GMainContext *ctx = g_main_loop_get_context (main_loop);
@@ -83,7 +88,8 @@ _install_sighandlers (GMainLoop *main_loop)
                            NULL);
     _sig_source_id[1] = g_source_attach (source, ctx);
 
-    if (prctl(PR_SET_PDEATHSIG, SIGHUP))
+    /* a persistent session waits for tlm to come back instead */
+    if (!persistent && prctl(PR_SET_PDEATHSIG, SIGHUP))
         WARN ("failed to set parent death signal");
 }
 
@@ -91,6 +97,17 @@ int main (int argc, char **argv)
 {
     GMainLoop *main_loop = NULL;
     gint in_fd = 0, out_fd = 1;
+    GError *error = NULL;
+    gboolean persistent = FALSE;
+    gchar *token_secret = NULL;
+
+    GOptionContext *opt_context = NULL;
+    GOptionEntry opt_entries[] = {
+        { "persist", 0, 0,
+          G_OPTION_ARG_NONE, &persistent,
+          "Keep the session running when tlm goes away", NULL },
+        {NULL }
+    };
 
     /* Duplicates stdin and stdout descriptors and point the descriptors
      * to /dev/null to avoid anyone writing to descriptors
@@ -121,16 +138,34 @@ int main (int argc, char **argv)
     g_type_init ();
 #endif
 
+    opt_context = g_option_context_new ("Tiny Login Manager session");
+    g_option_context_add_main_entries (opt_context, opt_entries, NULL);
+    g_option_context_parse (opt_context, &argc, &argv, &error);
+    g_option_context_free (opt_context);
+    if (error) {
+        WARN ("Error parsing options: %s", error->message);
+        g_error_free (error);
+        return -1;
+    }
+
     DBG ("old pgid=%u", getpgrp ());
 
-    _daemon = tlm_session_daemon_new (in_fd, out_fd);
+    /* the user session must not inherit the secret */
+    token_secret = g_strdup (g_getenv (TLM_SESSIOND_TOKEN_SECRET_ENV));
+    g_unsetenv (TLM_SESSIOND_TOKEN_SECRET_ENV);
+    if (!token_secret)
+        DBG ("no auth token secret, tokens are not accepted");
+
+    _daemon = tlm_session_daemon_new (in_fd, out_fd, persistent,
+            token_secret);
+    g_free (token_secret);
     if (_daemon == NULL) {
         return -1;
     }
 
     main_loop = g_main_loop_new (NULL, FALSE);
     g_object_weak_ref (G_OBJECT (_daemon), _on_daemon_closed, main_loop);
-    _install_sighandlers (main_loop);
+    _install_sighandlers (main_loop, persistent);
 
     tlm_log_init(G_LOG_DOMAIN);
 
@@ -321,16 +321,11 @@ tlm_auth_session_putenv (
     return TRUE;
 }
 
-gboolean
-tlm_auth_session_authenticate (TlmAuthSession *auth_session, GError **error)
+static void
+_auth_session_set_items (TlmAuthSessionPrivate *priv)
 {
-    int res;
     const char *pam_tty = NULL;
     const char *pam_ruser = NULL;
-    g_return_val_if_fail (auth_session &&
-                TLM_IS_AUTH_SESSION(auth_session), FALSE);
-
-    TlmAuthSessionPrivate *priv = TLM_AUTH_SESSION_PRIV (auth_session);
 
     pam_tty = getenv ("DISPLAY");
     if (!pam_tty)
@@ -353,6 +348,26 @@ tlm_auth_session_authenticate (TlmAuthSession *auth_session, GError **error)
         PAM_SUCCESS) {
         WARN ("pam_set_item(PAM_RHOST)");
     }
+}
+
+void
+tlm_auth_session_set_authenticated (TlmAuthSession *auth_session)
+{
+    g_return_if_fail (auth_session && TLM_IS_AUTH_SESSION(auth_session));
+
+    _auth_session_set_items (TLM_AUTH_SESSION_PRIV (auth_session));
+}
+
+gboolean
+tlm_auth_session_authenticate (TlmAuthSession *auth_session, GError **error)
+{
+    int res;
+    g_return_val_if_fail (auth_session &&
+                TLM_IS_AUTH_SESSION(auth_session), FALSE);
+
+    TlmAuthSessionPrivate *priv = TLM_AUTH_SESSION_PRIV (auth_session);
+
+    _auth_session_set_items (priv);
 
     char *p_service = 0, *p_uname = 0;
     pam_get_item (priv->pam_handle, PAM_SERVICE, (const void **)&p_service);
@@ -73,6 +73,9 @@ tlm_auth_session_putenv (TlmAuthSession *auth_session,
 gboolean
 tlm_auth_session_authenticate (TlmAuthSession *auth_session, GError **error);
 
+void
+tlm_auth_session_set_authenticated (TlmAuthSession *auth_session);
+
 gboolean
 tlm_auth_session_open (TlmAuthSession *auth_session, GError **error);
 
@@ -23,9 +23,18 @@
  * 02110-1301 USA
  */
 
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
+
 #include "common/tlm-log.h"
 #include "common/tlm-error.h"
 #include "common/tlm-pipe-stream.h"
+#include "common/tlm-seat-config.h"
+#include "common/tlm-user-info.h"
+#include "common/tlm-utils.h"
 #include "common/dbus/tlm-dbus-session-gen.h"
 #include "common/dbus/tlm-dbus-utils.h"
 #include "common/dbus/tlm-dbus.h"
@@ -37,6 +46,13 @@ struct _TlmSessionDaemonPrivate
     GDBusConnection *connection;
     TlmDbusSession *dbus_session;
     TlmSession *session;
+    gboolean is_stopping;
+    gboolean auth_token_used;
+    gchar *token_secret; /* expected nonce of an auth token, from tlm */
+    gboolean persistent; /* the session outlives the connection to tlm */
+    gboolean is_session_up;
+    GDBusServer *control_server; /* for tlm to reconnect after a restart */
+    gchar *control_path;
 };
 
 G_DEFINE_TYPE (TlmSessionDaemon, tlm_session_daemon, G_TYPE_OBJECT)
@@ -46,10 +62,40 @@ G_DEFINE_TYPE (TlmSessionDaemon, tlm_session_daemon, G_TYPE_OBJECT)
     G_TYPE_INSTANCE_GET_PRIVATE ((obj), TLM_TYPE_SESSION_DAEMON,\
             TlmSessionDaemonPrivate)
 
+static void
+_on_connection_closed (
+        GDBusConnection *connection,
+        gboolean         remote_peer_vanished,
+        GError          *error,
+        gpointer         user_data);
+
+static gboolean
+_on_control_connection (
+        GDBusServer *server,
+        GDBusConnection *connection,
+        gpointer user_data);
+
+static void
+_stop_control_server (TlmSessionDaemon *self)
+{
+    TlmSessionDaemonPrivate *priv = self->priv;
+
+    if (!priv->control_server) return;
+
+    g_signal_handlers_disconnect_by_func (priv->control_server,
+            _on_control_connection, self);
+    g_dbus_server_stop (priv->control_server);
+    g_clear_object (&priv->control_server);
+    g_unlink (priv->control_path);
+    g_clear_string (&priv->control_path);
+}
+
 static void
 _dispose (GObject *object)
 {
     TlmSessionDaemon *self = TLM_SESSION_DAEMON (object);
+
+    _stop_control_server (self);
     if (self->priv->dbus_session) {
         g_dbus_interface_skeleton_unexport (G_DBUS_INTERFACE_SKELETON (
                 self->priv->dbus_session));
@@ -58,6 +104,8 @@ _dispose (GObject *object)
     }
 
     if (self->priv->connection) {
+        g_signal_handlers_disconnect_by_func (self->priv->connection,
+                _on_connection_closed, self);
         g_object_unref (self->priv->connection);
         self->priv->connection = NULL;
     }
@@ -73,6 +121,10 @@ _dispose (GObject *object)
 static void
 _finalize (GObject *object)
 {
+    TlmSessionDaemon *self = TLM_SESSION_DAEMON (object);
+
+    g_clear_string (&self->priv->token_secret);
+
     G_OBJECT_CLASS (tlm_session_daemon_parent_class)->finalize (object);
 }
 
@@ -98,6 +150,13 @@ tlm_session_daemon_init (
     self->priv->connection = NULL;
     self->priv->dbus_session = NULL;
     self->priv->session = NULL;
+    self->priv->is_stopping = FALSE;
+    self->priv->auth_token_used = FALSE;
+    self->priv->persistent = FALSE;
+    self->priv->is_session_up = FALSE;
+    self->priv->control_server = NULL;
+    self->priv->control_path = NULL;
+    self->priv->token_secret = NULL;
 }
 
 static void
@@ -116,25 +175,171 @@ _on_connection_closed (
     if (error) {
        DBG("...reason : %s", error->message);
     }
-    g_object_unref (daemon);
+
+    if (daemon->priv->control_server && daemon->priv->is_session_up &&
+        !daemon->priv->is_stopping) {
+        DBG ("keeping the session until tlm reconnects");
+        g_dbus_interface_skeleton_unexport (G_DBUS_INTERFACE_SKELETON (
+                daemon->priv->dbus_session));
+        g_clear_object (&daemon->priv->connection);
+        return;
+    }
+    tlm_session_daemon_stop (daemon);
 }
 
+/* the daemon runs as root, nobody else gets to take the session over */
 static gboolean
-_handle_session_create_from_dbus (
+_on_control_authorize_peer (
+        GDBusServer *server,
+        GIOStream *stream,
+        GCredentials *credentials,
+        gpointer user_data)
+{
+    GError *error = NULL;
+    uid_t uid;
+
+    if (!credentials) {
+        WARN ("rejecting control connection without credentials");
+        return FALSE;
+    }
+    uid = g_credentials_get_unix_user (credentials, &error);
+    if (uid == (uid_t) -1) {
+        WARN ("rejecting control connection: %s",
+              error ? error->message : "no user");
+        g_clear_error (&error);
+        return FALSE;
+    }
+    if (uid != 0) {
+        WARN ("rejecting control connection of uid %u", (guint) uid);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static gboolean
+_on_control_connection (
+        GDBusServer *server,
+        GDBusConnection *connection,
+        gpointer user_data)
+{
+    TlmSessionDaemon *self = TLM_SESSION_DAEMON (user_data);
+    GError *error = NULL;
+
+    if (self->priv->connection || self->priv->is_stopping) {
+        DBG ("rejecting connection %p, tlm is attached", connection);
+        return FALSE;
+    }
+
+    if (!g_dbus_interface_skeleton_export (
+                G_DBUS_INTERFACE_SKELETON (self->priv->dbus_session),
+                connection, TLM_SESSION_OBJECTPATH, &error)) {
+        WARN ("failed to register object: %s", error->message);
+        g_error_free (error);
+        return FALSE;
+    }
+
+    DBG ("tlm reconnected on connection %p", connection);
+    self->priv->connection = g_object_ref (connection);
+    g_signal_connect (connection, "closed",
+            G_CALLBACK(_on_connection_closed), self);
+    return TRUE;
+}
+
+/* an existing directory is only used if it is root's own, its mode is
+ * fixed up to 0700 */
+static gboolean
+_prepare_control_dir (void)
+{
+    struct stat st;
+
+    if (g_mkdir_with_parents (TLM_SESSIOND_CONTROL_DIR, S_IRWXU) == -1) {
+        WARN ("Could not create '%s', error: %s", TLM_SESSIOND_CONTROL_DIR,
+                strerror (errno));
+        return FALSE;
+    }
+    if (lstat (TLM_SESSIOND_CONTROL_DIR, &st) != 0 || !S_ISDIR (st.st_mode) ||
+        st.st_uid != 0) {
+        WARN ("'%s' is not a directory of root", TLM_SESSIOND_CONTROL_DIR);
+        return FALSE;
+    }
+    if (st.st_gid != 0 && chown (TLM_SESSIOND_CONTROL_DIR, 0, 0) != 0) {
+        WARN ("Could not change the owner of '%s': %s",
+                TLM_SESSIOND_CONTROL_DIR, strerror (errno));
+        return FALSE;
+    }
+    if ((st.st_mode & 07777) != S_IRWXU &&
+        g_chmod (TLM_SESSIOND_CONTROL_DIR, S_IRWXU) != 0) {
+        WARN ("Could not set the mode of '%s': %s", TLM_SESSIOND_CONTROL_DIR,
+                strerror (errno));
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* only root may connect: the socket is 0600 in a 0700 directory, the peer
+ * is checked too */
+static void
+_start_control_server (
+        TlmSessionDaemon *self)
+{
+    TlmSessionDaemonPrivate *priv = self->priv;
+    GError *error = NULL;
+    gchar *address = NULL;
+    gchar *guid = NULL;
+    mode_t old_umask;
+
+    if (!priv->persistent || priv->control_server) return;
+
+    if (!_prepare_control_dir ())
+        return;
+
+    priv->control_path = g_strdup_printf ("%s/%d", TLM_SESSIOND_CONTROL_DIR,
+            getpid ());
+    g_unlink (priv->control_path);
+    address = g_strdup_printf ("unix:path=%s", priv->control_path);
+    guid = g_dbus_generate_guid ();
+    /* the socket is created with these permissions already */
+    old_umask = umask (S_IXUSR | S_IRWXG | S_IRWXO);
+    priv->control_server = g_dbus_server_new_sync (address,
+            G_DBUS_SERVER_FLAGS_NONE, guid, NULL, NULL, &error);
+    umask (old_umask);
+    g_free (guid);
+    if (!priv->control_server) {
+        WARN ("Failed to start server at address '%s': %s", address,
+                error ? error->message : "NULL");
+        g_clear_error (&error);
+        g_clear_string (&priv->control_path);
+        g_free (address);
+        return;
+    }
+
+    g_signal_connect (priv->control_server, "authorize-authenticated-peer",
+            G_CALLBACK (_on_control_authorize_peer), NULL);
+    g_signal_connect (priv->control_server, "new-connection",
+            G_CALLBACK (_on_control_connection), self);
+    g_dbus_server_start (priv->control_server);
+    if (g_chmod (priv->control_path, S_IRUSR | S_IWUSR) < 0)
+        WARN ("Unable to set mode of '%s'", priv->control_path);
+    DBG ("session control at %s", address);
+    g_free (address);
+}
+
+static void
+_start_session (
         TlmSessionDaemon *self,
-        GDBusMethodInvocation *invocation,
         const gchar *password,
         GVariant *environment,
-        gpointer user_data)
+        GVariant *auth_token)
 {
-    g_return_val_if_fail (self && TLM_IS_SESSION_DAEMON (self), FALSE);
     gchar *seatid = NULL;
     gchar *service = NULL;
     gchar *username = NULL;
     GHashTable *data = NULL;
-
-    tlm_dbus_session_complete_session_create (
-            self->priv->dbus_session, invocation);
+    gboolean authenticated = FALSE;
+    guint vtnr = 0;
+    gboolean defer_exec = FALSE;
+    GVariant *seat_config_variant = NULL;
+    GVariant *user_info_variant = NULL;
 
     gchar *data_str = g_variant_print(environment, TRUE);
     DBG("%s", data_str);
@@ -142,15 +347,137 @@ _handle_session_create_from_dbus (
 
     data = tlm_dbus_utils_hash_table_from_variant (environment);
     g_object_get (self->priv->dbus_session, "seatid", &seatid,
-            "username", &username, "service", &service, NULL);
+            "username", &username, "service", &service, "vtnr", &vtnr,
+            "deferexec", &defer_exec, "seatconfig", &seat_config_variant,
+            "userinfo", &user_info_variant, NULL);
+    if (seat_config_variant) {
+        TlmSeatConfig *seat_config = tlm_seat_config_new_from_variant (
+                seat_config_variant);
+        if (seat_config) {
+            g_object_set (self->priv->session, "seat-config", seat_config,
+                    NULL);
+            tlm_seat_config_unref (seat_config);
+        }
+        g_variant_unref (seat_config_variant);
+    }
+    if (user_info_variant) {
+        TlmUserInfo *user_info = tlm_user_info_new_from_variant (
+                user_info_variant);
+        if (user_info) {
+            g_object_set (self->priv->session, "user-info", user_info, NULL);
+            tlm_user_info_unref (user_info);
+        }
+        g_variant_unref (user_info_variant);
+    }
+    if (vtnr > 0)
+        g_object_set (self->priv->session, "vtnr", vtnr, NULL);
+    if (defer_exec)
+        g_object_set (self->priv->session, "defer-exec", TRUE, NULL);
+
+    if (auth_token) {
+        const gchar *nonce = NULL;
+        const gchar *token_seat = NULL;
+        const gchar *token_user = NULL;
+        const gchar *token_service = NULL;
+        gint64 expiry = 0;
+
+        g_variant_get (auth_token, "(&s&s&s&sx)", &nonce, &token_seat,
+                &token_user, &token_service, &expiry);
+        authenticated = !self->priv->auth_token_used &&
+                tlm_utils_secret_equal (nonce, self->priv->token_secret) &&
+                g_strcmp0 (token_seat, seatid) == 0 &&
+                g_strcmp0 (token_user, username) == 0 &&
+                g_strcmp0 (token_service, service) == 0 &&
+                expiry > g_get_monotonic_time ();
+        self->priv->auth_token_used = TRUE;
+        if (!authenticated)
+            WARN ("auth token of user '%s' rejected, authenticating again",
+                    token_user);
+    }
 
     tlm_session_start (self->priv->session, seatid, service, username,
-            password, data);
+            password, data, authenticated);
 
     g_hash_table_unref (data);
     g_free (seatid);
     g_free (service);
     g_free (username);
+}
+
+static gboolean
+_handle_session_create_from_dbus (
+        TlmSessionDaemon *self,
+        GDBusMethodInvocation *invocation,
+        const gchar *password,
+        GVariant *environment,
+        gpointer user_data)
+{
+    g_return_val_if_fail (self && TLM_IS_SESSION_DAEMON (self), FALSE);
+
+    tlm_dbus_session_complete_session_create (
+            self->priv->dbus_session, invocation);
+
+    _start_session (self, password, environment, NULL);
+    return TRUE;
+}
+
+static gboolean
+_handle_session_create_with_token_from_dbus (
+        TlmSessionDaemon *self,
+        GDBusMethodInvocation *invocation,
+        const gchar *password,
+        GVariant *token,
+        GVariant *environment,
+        gpointer user_data)
+{
+    g_return_val_if_fail (self && TLM_IS_SESSION_DAEMON (self), FALSE);
+
+    tlm_dbus_session_complete_session_create_with_token (
+            self->priv->dbus_session, invocation);
+
+    _start_session (self, password, environment, token);
+    return TRUE;
+}
+
+static gboolean
+_handle_session_exec_from_dbus (
+        TlmSessionDaemon *self,
+        GDBusMethodInvocation *invocation,
+        gpointer user_data)
+{
+    g_return_val_if_fail (self && TLM_IS_SESSION_DAEMON (self), FALSE);
+
+    tlm_dbus_session_complete_session_exec (
+            self->priv->dbus_session, invocation);
+    tlm_session_exec (self->priv->session);
+    return TRUE;
+}
+
+static gboolean
+_handle_session_freeze_from_dbus (
+        TlmSessionDaemon *self,
+        GDBusMethodInvocation *invocation,
+        gpointer user_data)
+{
+    g_return_val_if_fail (self && TLM_IS_SESSION_DAEMON (self), FALSE);
+
+    tlm_dbus_session_complete_session_freeze (
+            self->priv->dbus_session, invocation);
+    tlm_session_set_frozen (self->priv->session, TRUE);
+    return TRUE;
+}
+
+static gboolean
+_handle_session_thaw_from_dbus (
+        TlmSessionDaemon *self,
+        GDBusMethodInvocation *invocation,
+        gpointer user_data)
+{
+    g_return_val_if_fail (self && TLM_IS_SESSION_DAEMON (self), FALSE);
+
+    tlm_dbus_session_complete_session_thaw (
+            self->priv->dbus_session, invocation);
+    tlm_session_set_frozen (self->priv->session, FALSE);
     return TRUE;
 }
 
@@ -195,6 +522,8 @@ _handle_session_created_from_session (
 
     g_object_set (G_OBJECT (self->priv->dbus_session), "sessionid", sessionid,
             NULL);
+    self->priv->is_session_up = TRUE;
+    _start_control_server (self);
     tlm_dbus_session_emit_session_created (self->priv->dbus_session, sessionid);
 }
 
@@ -205,7 +534,12 @@ _handle_session_terminated_from_session (
 {
     g_return_if_fail (self && TLM_IS_SESSION_DAEMON (self));
 
+    self->priv->is_session_up = FALSE;
     tlm_dbus_session_emit_session_terminated (self->priv->dbus_session);
+
+    /* nobody to clean up after us while tlm is away */
+    if (!self->priv->connection)
+        tlm_session_daemon_stop (self);
 }
 
 static void
@@ -234,16 +568,52 @@ _handle_error_from_session (
     tlm_dbus_session_emit_error (self->priv->dbus_session, error);
 }
 
+static void
+_on_session_stopped (
+        TlmSessionDaemon *self,
+        gpointer user_data)
+{
+    g_signal_handlers_disconnect_by_func (self->priv->session,
+            _on_session_stopped, self);
+    DBG ("session stopped, releasing daemon %p", self);
+    g_object_unref (self);
+}
+
+void
+tlm_session_daemon_stop (
+        TlmSessionDaemon *self)
+{
+    g_return_if_fail (self && TLM_IS_SESSION_DAEMON (self));
+
+    if (self->priv->is_stopping) return;
+    self->priv->is_stopping = TRUE;
+
+    if (!self->priv->session) {
+        g_object_unref (self);
+        return;
+    }
+
+    /* the daemon reference is released only once the session child has been
+     * reaped, the main loop keeps running the termination meanwhile */
+    g_signal_connect_swapped (self->priv->session, "session-terminated",
+            G_CALLBACK (_on_session_stopped), self);
+    tlm_session_terminate (self->priv->session);
+}
+
 TlmSessionDaemon *
 tlm_session_daemon_new (
         gint in_fd,
-        gint out_fd)
+        gint out_fd,
+        gboolean persistent,
+        const gchar *token_secret)
 {
     GError *error = NULL;
     TlmPipeStream *stream = NULL;
 
     TlmSessionDaemon *daemon = TLM_SESSION_DAEMON (g_object_new (
             TLM_TYPE_SESSION_DAEMON, NULL));
+    daemon->priv->persistent = persistent;
+    daemon->priv->token_secret = g_strdup (token_secret);
 
     /* Load session */
     daemon->priv->session = tlm_session_new ();
@@ -268,9 +638,21 @@ tlm_session_daemon_new (
     g_signal_connect_swapped (daemon->priv->dbus_session,
             "handle-session-create", G_CALLBACK (
                 _handle_session_create_from_dbus), daemon);
+    g_signal_connect_swapped (daemon->priv->dbus_session,
+            "handle-session-create-with-token", G_CALLBACK (
+                _handle_session_create_with_token_from_dbus), daemon);
     g_signal_connect_swapped (daemon->priv->dbus_session,
             "handle-session-terminate", G_CALLBACK(
                 _handle_session_terminate_from_dbus), daemon);
+    g_signal_connect_swapped (daemon->priv->dbus_session,
+            "handle-session-exec", G_CALLBACK(
+                _handle_session_exec_from_dbus), daemon);
+    g_signal_connect_swapped (daemon->priv->dbus_session,
+            "handle-session-freeze", G_CALLBACK(
+                _handle_session_freeze_from_dbus), daemon);
+    g_signal_connect_swapped (daemon->priv->dbus_session,
+            "handle-session-thaw", G_CALLBACK(
+                _handle_session_thaw_from_dbus), daemon);
     g_signal_connect_swapped (daemon->priv->dbus_session,
             "handle-get-info", G_CALLBACK(
                 _handle_session_info_from_dbus), daemon);
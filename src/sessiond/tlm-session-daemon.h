@@ -65,6 +65,12 @@ GType tlm_session_daemon_get_type();
 TlmSessionDaemon *
 tlm_session_daemon_new (
         gint in_fd,
-        gint out_fd);
+        gint out_fd,
+        gboolean persistent,
+        const gchar *token_secret);
+
+void
+tlm_session_daemon_stop (
+        TlmSessionDaemon *self);
 
 #endif /* __TLM_SESSION_DAEMON_H_ */
@@ -54,6 +54,8 @@
 #include "common/tlm-error.h"
 #include "common/tlm-config-general.h"
 #include "common/tlm-config-seat.h"
+#include "common/tlm-seat-config.h"
+#include "common/tlm-user-info.h"
 
 G_DEFINE_TYPE (TlmSession, tlm_session, G_TYPE_OBJECT);
 
@@ -67,6 +69,10 @@ enum {
     PROP_SERVICE,
     PROP_USERNAME,
     PROP_ENVIRONMENT,
+    PROP_VTNR,
+    PROP_DEFER_EXEC,
+    PROP_SEAT_CONFIG,
+    PROP_USER_INFO,
     N_PROPERTIES
 };
 static GParamSpec *pspecs[N_PROPERTIES];
@@ -83,6 +89,7 @@ static guint signals[SIG_MAX];
 struct _TlmSessionPrivate
 {
     TlmConfig *config;
+    TlmSeatConfig *seat_config;
     pid_t child_pid;
     gchar *tty_dev;
     uid_t tty_uid;
@@ -92,6 +99,7 @@ struct _TlmSessionPrivate
     gchar *seat_id;
     gchar *service;
     gchar *username;
+    TlmUserInfo *user_info;
     GHashTable *env_hash;
     TlmAuthSession *auth_session;
     int last_sig;
@@ -102,6 +110,10 @@ struct _TlmSessionPrivate
     gboolean setup_runtime_dir;
     gboolean can_emit_signal;
     gboolean is_child_up;
+    gboolean is_terminating;
+    gboolean is_frozen;
+    gboolean defer_exec;
+    gboolean exec_pending;
     gboolean session_pause;
     int kb_mode;
 };
@@ -115,9 +127,21 @@ tlm_session_dispose (GObject *self)
     priv->can_emit_signal = FALSE;
 
     tlm_session_terminate (session);
-    while (priv->is_child_up)
-        g_main_context_iteration(NULL, TRUE);
+    if (priv->is_child_up) {
+        /* the pending termination holds a reference, we get disposed again
+         * once the child has been reaped */
+        DBG ("child termination pending");
+        return;
+    }
 
+    if (session->priv->seat_config) {
+        tlm_seat_config_unref (session->priv->seat_config);
+        session->priv->seat_config = NULL;
+    }
+    if (session->priv->user_info) {
+        tlm_user_info_unref (session->priv->user_info);
+        session->priv->user_info = NULL;
+    }
     g_clear_object (&session->priv->config);
 
     G_OBJECT_CLASS (tlm_session_parent_class)->dispose (self);
@@ -146,6 +170,11 @@ _session_set_property (GObject *obj,
         case PROP_SEAT:
             g_free (priv->seat_id);
             priv->seat_id = g_value_dup_string (value);
+            if (priv->seat_config &&
+                g_strcmp0 (priv->seat_config->seat_id, priv->seat_id) != 0) {
+                tlm_seat_config_unref (priv->seat_config);
+                priv->seat_config = NULL;
+            }
             break;
         case PROP_SERVICE:
             priv->service = g_value_dup_string (value);
@@ -158,6 +187,22 @@ _session_set_property (GObject *obj,
             if (priv->env_hash)
                 g_hash_table_ref (priv->env_hash);
             break;
+        case PROP_VTNR:
+            priv->vtnr = g_value_get_uint (value);
+            break;
+        case PROP_DEFER_EXEC:
+            priv->defer_exec = g_value_get_boolean (value);
+            break;
+        case PROP_SEAT_CONFIG:
+            if (priv->seat_config)
+                tlm_seat_config_unref (priv->seat_config);
+            priv->seat_config = g_value_dup_boxed (value);
+            break;
+        case PROP_USER_INFO:
+            if (priv->user_info)
+                tlm_user_info_unref (priv->user_info);
+            priv->user_info = g_value_dup_boxed (value);
+            break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID (obj, property_id, pspec);
     }
@@ -188,6 +233,18 @@ _session_get_property (GObject *obj,
         case PROP_ENVIRONMENT:
             g_value_set_pointer (value, priv->env_hash);
             break;
+        case PROP_VTNR:
+            g_value_set_uint (value, priv->vtnr);
+            break;
+        case PROP_DEFER_EXEC:
+            g_value_set_boolean (value, priv->defer_exec);
+            break;
+        case PROP_SEAT_CONFIG:
+            g_value_set_boxed (value, priv->seat_config);
+            break;
+        case PROP_USER_INFO:
+            g_value_set_boxed (value, priv->user_info);
+            break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID (obj, property_id, pspec);
     }
@@ -235,6 +292,31 @@ tlm_session_class_init (TlmSessionClass *klass)
                               "environment variables",
                               "Environment variables for the session",
                               G_PARAM_READWRITE|G_PARAM_STATIC_STRINGS);
+    pspecs[PROP_VTNR] =
+        g_param_spec_uint ("vtnr",
+                           "vt number",
+                           "VT of the session, 0 uses the seat's VTNR",
+                           0, G_MAXUINT, 0,
+                           G_PARAM_READWRITE|G_PARAM_STATIC_STRINGS);
+    pspecs[PROP_DEFER_EXEC] =
+        g_param_spec_boolean ("defer-exec",
+                              "defer exec",
+                              "Wait for tlm_session_exec() before starting "
+                              "the user session",
+                              FALSE,
+                              G_PARAM_READWRITE|G_PARAM_STATIC_STRINGS);
+    pspecs[PROP_SEAT_CONFIG] =
+        g_param_spec_boxed ("seat-config",
+                            "seat config",
+                            "Resolved configuration of the seat",
+                            TLM_TYPE_SEAT_CONFIG,
+                            G_PARAM_READWRITE|G_PARAM_STATIC_STRINGS);
+    pspecs[PROP_USER_INFO] =
+        g_param_spec_boxed ("user-info",
+                            "user info",
+                            "Password database entry of the user",
+                            TLM_TYPE_USER_INFO,
+                            G_PARAM_READWRITE|G_PARAM_STATIC_STRINGS);
 
     g_object_class_install_properties (g_klass, N_PROPERTIES, pspecs);
 
@@ -272,13 +354,51 @@ tlm_session_init (TlmSession *session)
     priv->sessionid = NULL;
     priv->child_watch_id = 0;
     priv->is_child_up = FALSE;
+    priv->is_terminating = FALSE;
+    priv->is_frozen = FALSE;
+    priv->defer_exec = FALSE;
+    priv->exec_pending = FALSE;
+    priv->vtnr = 0;
     priv->can_emit_signal = TRUE;
-    priv->config = tlm_config_new ();
+    priv->config = NULL;
+    priv->seat_config = NULL;
+    priv->user_info = NULL;
     priv->kb_mode = -1;
 
     session->priv = priv;
 }
 
+/* normally handed over by the daemon, reading the configuration file is
+ * only the fallback */
+static TlmSeatConfig *
+_get_seat_config (TlmSessionPrivate *priv)
+{
+    if (!priv->seat_config) {
+        if (!priv->config) {
+            WARN ("no seat configuration received, loading tlm.conf");
+            priv->config = tlm_config_new ();
+        }
+        priv->seat_config = tlm_config_get_seat_config (priv->config,
+                priv->seat_id ? priv->seat_id : TLM_CONFIG_GENERAL);
+    }
+    return priv->seat_config;
+}
+
+/* normally handed over by the daemon too, it is looked up again only if
+ * PAM changed the user */
+static TlmUserInfo *
+_get_user_info (TlmSessionPrivate *priv)
+{
+    if (priv->user_info &&
+        g_strcmp0 (priv->user_info->name, priv->username) != 0) {
+        tlm_user_info_unref (priv->user_info);
+        priv->user_info = NULL;
+    }
+    if (!priv->user_info && priv->username)
+        priv->user_info = tlm_user_info_lookup (priv->username);
+    return priv->user_info;
+}
+
 static void
 _setenv_to_session (const gchar *key, const gchar *val,
                     TlmSessionPrivate *user_data)
@@ -344,7 +464,7 @@ _prepare_terminal (TlmSessionPrivate *priv)
     if (ioctl (tty_fd, TCGETS, &priv->tty_state) < 0)
         WARN ("ioctl(TCGETS) failed: %s", strerror(errno));
 
-    if (fchown (tty_fd, tlm_user_get_uid (priv->username), -1)) {
+    if (fchown (tty_fd, _get_user_info (priv)->uid, -1)) {
         WARN ("Changing TTY access rights failed");
     }
 
@@ -422,7 +542,7 @@ static gboolean
 _set_environment (TlmSessionPrivate *priv)
 {
 	gchar **envlist = tlm_auth_session_get_envlist(priv->auth_session);
-	const gchar *home_dir = NULL, *shell = NULL;
+	TlmUserInfo *user_info = _get_user_info (priv);
 
     if (envlist) {
         gchar **env = 0;
@@ -434,32 +554,20 @@ _set_environment (TlmSessionPrivate *priv)
         g_free (envlist);
     }
 
-    const gchar *path = tlm_config_get_string (priv->config,
-                                               TLM_CONFIG_GENERAL,
-                                               TLM_CONFIG_GENERAL_SESSION_PATH);
-    if (!path)
-        path = "/usr/local/bin:/usr/bin:/bin";
-    _setenv_to_session ("PATH", path, priv);
+    _setenv_to_session ("PATH", _get_seat_config (priv)->session_path, priv);
 
     _setenv_to_session ("USER", priv->username, priv);
     _setenv_to_session ("LOGNAME", priv->username, priv);
-    home_dir = tlm_user_get_home_dir (priv->username);
-    if (home_dir) _setenv_to_session ("HOME", home_dir, priv);
-    shell = tlm_user_get_shell (priv->username);
-    if (shell) _setenv_to_session ("SHELL", shell, priv);
-
-    if (!tlm_config_has_key (priv->config,
-                             TLM_CONFIG_GENERAL,
-                             TLM_CONFIG_GENERAL_NSEATS))
+    if (user_info->home_dir)
+        _setenv_to_session ("HOME", user_info->home_dir, priv);
+    if (user_info->shell)
+        _setenv_to_session ("SHELL", user_info->shell, priv);
+
+    if (!_get_seat_config (priv)->nseats)
         _setenv_to_session ("XDG_SEAT", priv->seat_id, priv);
 
-    const gchar *xdg_data_dirs =
-        tlm_config_get_string (priv->config,
-                               TLM_CONFIG_GENERAL,
-                               TLM_CONFIG_GENERAL_DATA_DIRS);
-    if (!xdg_data_dirs)
-        xdg_data_dirs = "/usr/share:/usr/local/share";
-    _setenv_to_session ("XDG_DATA_DIRS", xdg_data_dirs, priv);
+    _setenv_to_session ("XDG_DATA_DIRS", _get_seat_config (priv)->data_dirs,
+                        priv);
 
     if (priv->xdg_runtime_dir)
         _setenv_to_session ("XDG_RUNTIME_DIR", priv->xdg_runtime_dir, priv);
@@ -480,7 +588,7 @@ _clear_session (TlmSession *session)
     _reset_terminal (priv);
 
     if (priv->setup_runtime_dir)
-        tlm_utils_delete_dir (priv->xdg_runtime_dir);
+        tlm_utils_trash_dir (priv->xdg_runtime_dir);
 
     if (priv->timer_id) {
         g_source_remove (priv->timer_id);
@@ -499,6 +607,14 @@ _clear_session (TlmSession *session)
         g_hash_table_unref (priv->env_hash);
         priv->env_hash = NULL;
     }
+    if (priv->seat_config) {
+        tlm_seat_config_unref (priv->seat_config);
+        priv->seat_config = NULL;
+    }
+    if (priv->user_info) {
+        tlm_user_info_unref (priv->user_info);
+        priv->user_info = NULL;
+    }
     g_clear_string (&priv->seat_id);
     g_clear_string (&priv->service);
     g_clear_string (&priv->username);
@@ -515,15 +631,22 @@ _on_child_down_cb (
     g_spawn_close_pid (pid);
 
     TlmSession *session = TLM_SESSION (data);
+    gboolean terminating = session->priv->is_terminating;
 
     DBG ("Sessiond(%p) with pid (%d) closed with status %d", session, pid,
             status);
 
     session->priv->child_pid = 0;
     session->priv->is_child_up = FALSE;
+    session->priv->is_terminating = FALSE;
+    session->priv->is_frozen = FALSE;
     _clear_session (session);
     if (session->priv->can_emit_signal)
         g_signal_emit (session, signals[SIG_SESSION_TERMINATED], 0);
+
+    /* drop the reference taken by tlm_session_terminate() */
+    if (terminating)
+        g_object_unref (session);
 }
 
 static gchar *
@@ -554,9 +677,11 @@ _build_session_command (const gchar *template, const gchar *session_id)
     return out;
 }
 
-static void
+/* forks and executes the user's session, returns in the parent only */
+static gboolean
 _exec_user_session (
-		TlmSession *session)
+		TlmSession *session,
+		GError **error)
 {
     int tty_fd = -1;
     gint i;
@@ -568,6 +693,7 @@ _exec_user_session (
     gchar *uid_str;
     gchar **args = NULL;
     gchar **args_iter = NULL;
+    TlmUserInfo *user_info = NULL;
     TlmSessionPrivate *priv = session->priv;
 
     priv = session->priv;
@@ -576,33 +702,24 @@ _exec_user_session (
                 priv->auth_session));
     DBG ("session ID : %s", priv->sessionid);
 
-    if (tlm_config_has_key (priv->config,
-                            priv->seat_id,
-                            TLM_CONFIG_GENERAL_SETUP_RUNTIME_DIR)) {
-        priv->setup_runtime_dir = tlm_config_get_boolean (priv->config,
-                                           priv->seat_id,
-                                           TLM_CONFIG_GENERAL_SETUP_RUNTIME_DIR,
-                                           FALSE);
-    } else {
-        priv->setup_runtime_dir = tlm_config_get_boolean (priv->config,
-                                           TLM_CONFIG_GENERAL,
-                                           TLM_CONFIG_GENERAL_SETUP_RUNTIME_DIR,
-                                           FALSE);
-    }
-    rtdir_perm_str = tlm_config_get_string (priv->config,
-                                            priv->seat_id,
-                                            TLM_CONFIG_GENERAL_RUNTIME_MODE);
-    if (!rtdir_perm_str)
-        rtdir_perm_str = tlm_config_get_string (priv->config,
-                                               TLM_CONFIG_GENERAL,
-                                               TLM_CONFIG_GENERAL_RUNTIME_MODE);
-    uid_str = g_strdup_printf ("%u", tlm_user_get_uid (priv->username));
+    /* everything below, also in the child, uses this one record */
+    user_info = _get_user_info (priv);
+    if (!user_info) {
+        WARN ("Unknown user '%s'", priv->username);
+        *error = TLM_GET_ERROR_FOR_ID (TLM_ERROR_SESSION_CREATION_FAILURE,
+                "Unknown user '%s'", priv->username);
+        return FALSE;
+    }
+
+    priv->setup_runtime_dir = _get_seat_config (priv)->setup_runtime_dir;
+    rtdir_perm_str = _get_seat_config (priv)->runtime_mode;
+    uid_str = g_strdup_printf ("%u", user_info->uid);
     priv->xdg_runtime_dir = g_build_filename ("/run/user",
                                               uid_str,
                                               NULL);
     g_free (uid_str);
     if (priv->setup_runtime_dir) {
-        tlm_utils_delete_dir (priv->xdg_runtime_dir);
+        tlm_utils_trash_dir (priv->xdg_runtime_dir);
         if (g_mkdir_with_parents ("/run/user", 0755))
             WARN ("g_mkdir_with_parents(\"/run/user\") failed");
         if (rtdir_perm_str)
@@ -611,9 +728,7 @@ _exec_user_session (
              priv->xdg_runtime_dir, rtdir_perm);
         if (g_mkdir (priv->xdg_runtime_dir, rtdir_perm))
             WARN ("g_mkdir(\"%s\") failed", priv->xdg_runtime_dir);
-        if (chown (priv->xdg_runtime_dir,
-               tlm_user_get_uid (priv->username),
-               tlm_user_get_gid (priv->username)))
+        if (chown (priv->xdg_runtime_dir, user_info->uid, user_info->gid))
             WARN ("chown(\"%s\"): %s", priv->xdg_runtime_dir, strerror(errno));
         if (chmod (priv->xdg_runtime_dir, rtdir_perm))
             WARN ("chmod(\"%s\"): %s", priv->xdg_runtime_dir, strerror(errno));
@@ -621,29 +736,27 @@ _exec_user_session (
         DBG ("not setting up XDG_RUNTIME_DIR");
     }
 
-    gboolean setup_terminal;
-    if (tlm_config_has_key (priv->config,
-                            priv->seat_id,
-                            TLM_CONFIG_GENERAL_SETUP_TERMINAL)) {
-        setup_terminal = tlm_config_get_boolean (priv->config,
-                                                 priv->seat_id,
-                                                 TLM_CONFIG_GENERAL_SETUP_TERMINAL,
-                                                 FALSE);
-    } else {
-        setup_terminal = tlm_config_get_boolean (priv->config,
-                                                 TLM_CONFIG_GENERAL,
-                                                 TLM_CONFIG_GENERAL_SETUP_TERMINAL,
-                                                 FALSE);
-    }
+    gboolean setup_terminal = _get_seat_config (priv)->setup_terminal;
     if (setup_terminal) {
         tty_fd = _prepare_terminal (priv);
         if (tty_fd < 0) {
             WARN ("Failed to prepare terminal");
-            return;
+            *error = TLM_GET_ERROR_FOR_ID (TLM_ERROR_SESSION_CREATION_FAILURE,
+                    "Failed to prepare terminal");
+            return FALSE;
         }
     }
 
     priv->child_pid = fork ();
+    if (priv->child_pid < 0) {
+        WARN ("fork() failed: %s", strerror (errno));
+        *error = TLM_GET_ERROR_FOR_ID (TLM_ERROR_SESSION_CREATION_FAILURE,
+                "Failed to start the session process: %s", strerror (errno));
+        priv->child_pid = 0;
+        if (tty_fd >= 0)
+            close (tty_fd);
+        return FALSE;
+    }
     if (priv->child_pid) {
         if (tty_fd >= 0)
             close (tty_fd);
@@ -651,7 +764,7 @@ _exec_user_session (
         session->priv->child_watch_id = g_child_watch_add (priv->child_pid,
                     (GChildWatchFunc)_on_child_down_cb, session);
         session->priv->is_child_up = TRUE;
-        return;
+        return TRUE;
     }
 
     /* ==================================
@@ -669,8 +782,8 @@ _exec_user_session (
         }
     }
 
-    uid_t target_uid = tlm_user_get_uid (priv->username);
-    gid_t target_gid = tlm_user_get_gid (priv->username);
+    uid_t target_uid = user_info->uid;
+    gid_t target_gid = user_info->gid;
 
     /*if (getppid() == 1) {
         if (setsid () == (pid_t) -1)
@@ -716,13 +829,7 @@ _exec_user_session (
             WARN ("Failed to change directroy : %s", strerror (errno));
     } else WARN ("Could not get home directory");
 
-    shell = tlm_config_get_string (priv->config,
-                                   priv->seat_id,
-                                   TLM_CONFIG_GENERAL_SESSION_CMD);
-    if (!shell)
-        shell = tlm_config_get_string (priv->config,
-                                       TLM_CONFIG_GENERAL,
-                                       TLM_CONFIG_GENERAL_SESSION_CMD);
+    shell = _get_seat_config (priv)->session_cmd;
     if (shell) {
         /* add sessionid if needed */
         gchar *cmd = _build_session_command (shell, priv->sessionid);
@@ -766,11 +873,37 @@ tlm_session_new ()
     return g_object_new (TLM_TYPE_SESSION, NULL);
 }
 
+static void
+_start_user_session (TlmSession *session)
+{
+    TlmSessionPrivate *priv = TLM_SESSION_PRIV(session);
+    GError *error = NULL;
+
+    tlm_utils_log_utmp_entry (priv->username);
+
+    priv->session_pause = _get_seat_config (priv)->pause_session;
+    if (!priv->session_pause) {
+        if (!_exec_user_session (session, &error)) {
+            /* no child to wait for, session-terminated would never come */
+            g_signal_emit (session, signals[SIG_SESSION_ERROR], 0, error);
+            g_error_free (error);
+            return;
+        }
+        g_signal_emit (session, signals[SIG_SESSION_CREATED], 0,
+                       priv->sessionid ? priv->sessionid : "");
+    } else {
+        g_signal_emit (session, signals[SIG_SESSION_CREATED], 0,
+                       priv->sessionid ? priv->sessionid : "");
+        pause ();
+        exit (0);
+    }
+}
+
 gboolean
 tlm_session_start (TlmSession *session,
                    const gchar *seat_id, const gchar *service,
                    const gchar *username, const gchar *password,
-                   GHashTable *environment)
+                   GHashTable *environment, gboolean authenticated)
 {
 	GError *error = NULL;
 	g_return_val_if_fail (session && TLM_IS_SESSION(session), FALSE);
@@ -790,10 +923,8 @@ tlm_session_start (TlmSession *session,
     g_object_set (G_OBJECT (session), "seat", seat_id, "service", service,
             "username", username, "environment", environment, NULL);
 
-    priv->vtnr = tlm_config_get_uint (priv->config,
-                                      priv->seat_id,
-                                      TLM_CONFIG_SEAT_VTNR,
-                                      0);
+    if (priv->vtnr == 0)
+        priv->vtnr = _get_seat_config (priv)->vtnr;
     gchar *tty_name = priv->vtnr > 0 ?
         g_strdup_printf ("tty%u", priv->vtnr) : NULL;
     priv->auth_session = tlm_auth_session_new (priv->service, priv->username,
@@ -808,16 +939,8 @@ tlm_session_start (TlmSession *session,
         return FALSE;
     }
 
-    session_type = tlm_config_get_string (priv->config,
-                                          priv->seat_id,
-                                          TLM_CONFIG_GENERAL_SESSION_TYPE);
-    if (!session_type)
-        session_type = tlm_config_get_string (priv->config,
-                                              TLM_CONFIG_GENERAL,
-                                              TLM_CONFIG_GENERAL_SESSION_TYPE);
-    if (!tlm_config_has_key (priv->config,
-                             TLM_CONFIG_GENERAL,
-                             TLM_CONFIG_GENERAL_NSEATS))
+    session_type = _get_seat_config (priv)->session_type;
+    if (!_get_seat_config (priv)->nseats)
         tlm_auth_session_putenv (priv->auth_session,
                                  "XDG_SEAT",
                                  priv->seat_id);
@@ -837,7 +960,12 @@ tlm_session_start (TlmSession *session,
         g_free (vtnr_str);
     }
 
-    if (!tlm_auth_session_authenticate (priv->auth_session, &error)) {
+    if (authenticated) {
+        /* the daemon verified the password for this very login already */
+        DBG ("pre-authenticated login of '%s', skipping PAM authentication",
+             priv->username);
+        tlm_auth_session_set_authenticated (priv->auth_session);
+    } else if (!tlm_auth_session_authenticate (priv->auth_session, &error)) {
         if (error) {
             //consistant error message flow
             GError *err = TLM_GET_ERROR_FOR_ID (
@@ -866,25 +994,35 @@ tlm_session_start (TlmSession *session,
     }
     priv->sessionid = g_strdup (tlm_auth_session_get_sessionid (
             priv->auth_session));
-    tlm_utils_log_utmp_entry (priv->username);
 
-    priv->session_pause =  tlm_config_get_boolean (priv->config,
-                                             TLM_CONFIG_GENERAL,
-                                             TLM_CONFIG_GENERAL_PAUSE_SESSION,
-                                             FALSE);
-    if (!priv->session_pause) {
-        _exec_user_session (session);
-        g_signal_emit (session, signals[SIG_SESSION_CREATED], 0,
-                       priv->sessionid ? priv->sessionid : "");
-    } else {
-        g_signal_emit (session, signals[SIG_SESSION_CREATED], 0,
-                       priv->sessionid ? priv->sessionid : "");
-        pause ();
-        exit (0);
+    if (priv->defer_exec) {
+        /* tty and runtime dir may still belong to the previous session */
+        DBG ("session opened, exec deferred");
+        priv->exec_pending = TRUE;
+        return TRUE;
     }
+
+    _start_user_session (session);
     return TRUE;
 }
 
+void
+tlm_session_exec (TlmSession *session)
+{
+    g_return_if_fail (session && TLM_IS_SESSION(session));
+    TlmSessionPrivate *priv = TLM_SESSION_PRIV(session);
+
+    /* may arrive before the session was opened, then there is nothing to
+     * wait for anymore */
+    priv->defer_exec = FALSE;
+    if (!priv->exec_pending)
+        return;
+
+    DBG ("starting deferred user session");
+    priv->exec_pending = FALSE;
+    _start_user_session (session);
+}
+
 static gboolean
 _terminate_timeout (gpointer user_data)
 {
@@ -949,16 +1087,46 @@ tlm_session_terminate (TlmSession *session)
         return;
     }
 
+    if (priv->is_terminating) {
+        DBG ("termination already in progress");
+        return;
+    }
+
     if (killpg (getpgid (priv->child_pid), SIGHUP) < 0)
         WARN ("kill(%u, SIGHUP): %s",
               getpgid (priv->child_pid),
               strerror(errno));
+    /* a frozen session has to run to see the hangup */
+    if (priv->is_frozen)
+        tlm_session_set_frozen (session, FALSE);
     priv->last_sig = SIGHUP;
     priv->timer_id = g_timeout_add_seconds (
-            tlm_config_get_uint (priv->config, TLM_CONFIG_GENERAL,
-                    TLM_CONFIG_GENERAL_TERMINATE_TIMEOUT, 3),
+            _get_seat_config (priv)->terminate_timeout,
             _terminate_timeout,
             session);
+
+    /* keep the session alive until the child has been reaped */
+    priv->is_terminating = TRUE;
+    g_object_ref (session);
+}
+
+void
+tlm_session_set_frozen (TlmSession *session, gboolean frozen)
+{
+    g_return_if_fail (session && TLM_IS_SESSION(session));
+    TlmSessionPrivate *priv = TLM_SESSION_PRIV(session);
+
+    if (!priv->is_child_up || priv->is_frozen == frozen)
+        return;
+
+    DBG ("%s session process group %u", frozen ? "freezing" : "thawing",
+         getpgid (priv->child_pid));
+    if (killpg (getpgid (priv->child_pid), frozen ? SIGSTOP : SIGCONT) < 0) {
+        WARN ("kill(%u, %s): %s", getpgid (priv->child_pid),
+              frozen ? "SIGSTOP" : "SIGCONT", strerror(errno));
+        return;
+    }
+    priv->is_frozen = frozen;
 }
 
 GVariant *
@@ -966,11 +1134,12 @@ tlm_session_get_info (TlmSession *session)
 {
     GVariant *info = NULL;
     GVariantBuilder builder;
+    TlmUserInfo *user_info = _get_user_info (session->priv);
 
     g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
 
     g_variant_builder_add (&builder, "{sv}", "uid",
-            g_variant_new_uint32 (tlm_user_get_uid (session->priv->username)));
+            g_variant_new_uint32 (user_info ? user_info->uid : (uid_t) -1));
     g_variant_builder_add (&builder, "{sv}", "sessionid",
             g_variant_new_string (session->priv->sessionid));
 
@@ -68,10 +68,16 @@ gboolean
 tlm_session_start (TlmSession *session,
                    const gchar *seat_id, const gchar *service,
                    const gchar *username, const gchar *password,
-                   GHashTable *environment);
+                   GHashTable *environment, gboolean authenticated);
+void
+tlm_session_exec (TlmSession *session);
+
 void
 tlm_session_terminate (TlmSession *session);
 
+void
+tlm_session_set_frozen (TlmSession *session, gboolean frozen);
+
 GVariant *
 tlm_session_get_info (TlmSession *session);
 
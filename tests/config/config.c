@@ -23,9 +23,15 @@
  * 02110-1301 USA
  */
 
+#include "config.h"
 #include <check.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <glib/gstdio.h>
 #include "tlm-config.h"
+#include "tlm-seat-config.h"
 
 #define TLM_GROUP   "tlm-test"
 #define STR_KEY     "str_key"
@@ -116,6 +122,422 @@ START_TEST(test_config)
 }
 END_TEST
 
+static void
+_group_changed_cb (TlmConfig *config, const gchar *group, GPtrArray *changed)
+{
+    g_ptr_array_add (changed, g_strdup (group));
+}
+
+START_TEST(test_config_reload)
+{
+    gchar *conf_file = NULL;
+    gchar *saved_conf_file = g_strdup (g_getenv ("TLM_CONF_FILE"));
+    GPtrArray *changed = g_ptr_array_new_with_free_func (g_free);
+    GHashTable *same_group = NULL;
+    TlmConfig *config = NULL;
+    gint fd;
+
+    fd = g_file_open_tmp ("tlm-test-XXXXXX.conf", &conf_file, NULL);
+    fail_if (fd < 0, "Failed to create config file");
+    close (fd);
+
+    fail_if (!g_file_set_contents (conf_file,
+             "[same]\nkey=value\n[changed]\nkey=value\n[removed]\nkey=value\n",
+             -1, NULL));
+    g_setenv ("TLM_CONF_FILE", conf_file, TRUE);
+
+    config = tlm_config_new ();
+    fail_if (config == NULL, "Failed to create config object");
+    same_group = tlm_config_get_group (config, "same");
+    fail_if (same_group == NULL);
+
+    fail_if (!g_file_set_contents (conf_file,
+             "[same]\nkey=value\n[changed]\nkey=other\n[added]\nkey=value\n",
+             -1, NULL));
+    g_signal_connect (config, "group-changed", G_CALLBACK (_group_changed_cb),
+                      changed);
+    tlm_config_reload (config);
+
+    fail_if (changed->len != 3, "Wrong number of changed groups: %u",
+             changed->len);
+    fail_if (tlm_config_get_group (config, "same") != same_group,
+             "Unchanged group was replaced");
+    fail_if (tlm_config_get_group (config, "removed") != NULL);
+    fail_if (g_strcmp0 (tlm_config_get_string (config, "changed", "key"),
+                        "other") != 0);
+    fail_if (tlm_config_get_string (config, "added", "key") == NULL);
+
+    /* nothing to report when the file is the same */
+    g_ptr_array_set_size (changed, 0);
+    tlm_config_reload (config);
+    fail_if (changed->len != 0, "Unchanged configuration reported changes");
+
+    g_object_unref (config);
+    g_ptr_array_unref (changed);
+    g_unlink (conf_file);
+    g_free (conf_file);
+    if (saved_conf_file)
+        g_setenv ("TLM_CONF_FILE", saved_conf_file, TRUE);
+    else
+        g_unsetenv ("TLM_CONF_FILE");
+    g_free (saved_conf_file);
+}
+END_TEST
+
+static gchar *
+_set_conf_file (const gchar *contents, gchar **saved_conf_file)
+{
+    gchar *conf_file = NULL;
+    gint fd;
+
+    fd = g_file_open_tmp ("tlm-test-XXXXXX.conf", &conf_file, NULL);
+    fail_if (fd < 0, "Failed to create config file");
+    close (fd);
+    fail_if (!g_file_set_contents (conf_file, contents, -1, NULL));
+
+    *saved_conf_file = g_strdup (g_getenv ("TLM_CONF_FILE"));
+    g_setenv ("TLM_CONF_FILE", conf_file, TRUE);
+    return conf_file;
+}
+
+static void
+_unset_conf_file (gchar *conf_file, gchar *saved_conf_file)
+{
+    g_unlink (conf_file);
+    g_free (conf_file);
+    if (saved_conf_file)
+        g_setenv ("TLM_CONF_FILE", saved_conf_file, TRUE);
+    else
+        g_unsetenv ("TLM_CONF_FILE");
+    g_free (saved_conf_file);
+}
+
+#define SEAT_CONF \
+    "[" TLM_CONFIG_GENERAL "]\n" \
+    TLM_CONFIG_GENERAL_SESSION_PATH "=/general/bin\n" \
+    TLM_CONFIG_GENERAL_DEFAULT_USER "=general-user\n" \
+    TLM_CONFIG_GENERAL_PAM_SERVICE "=general-login\n" \
+    TLM_CONFIG_GENERAL_SETUP_TERMINAL "=true\n" \
+    TLM_CONFIG_GENERAL_TERMINATE_TIMEOUT "=\n" \
+    "[seat0]\n" \
+    TLM_CONFIG_GENERAL_SESSION_PATH "=/seat/bin\n" \
+    TLM_CONFIG_GENERAL_DEFAULT_USER "=seat-user\n" \
+    TLM_CONFIG_GENERAL_SESSIOND_POOL_SIZE "=2\n" \
+    TLM_CONFIG_SEAT_ACTIVE "=false\n" \
+    TLM_CONFIG_SEAT_VTNR "=7\n" \
+    TLM_CONFIG_SEAT_PRIORITY "=-3\n" \
+    TLM_CONFIG_SEAT_NWATCH "=\n"
+
+START_TEST(test_seat_config)
+{
+    gchar *saved_conf_file = NULL;
+    gchar *conf_file = _set_conf_file (SEAT_CONF, &saved_conf_file);
+    TlmConfig *config = NULL;
+    TlmSeatConfig *seat_config = NULL;
+
+    config = tlm_config_new ();
+    fail_if (config == NULL, "Failed to create config object");
+    seat_config = tlm_seat_config_new (config, "seat0");
+    fail_if (seat_config == NULL);
+
+    /* set only in General */
+    fail_if (g_strcmp0 (seat_config->pam_service, "general-login") != 0,
+             "Wrong value : %s", seat_config->pam_service);
+    fail_if (seat_config->setup_terminal != TRUE);
+
+    /* overridden per seat */
+    fail_if (g_strcmp0 (seat_config->default_user, "seat-user") != 0,
+             "Wrong value : %s", seat_config->default_user);
+    fail_if (seat_config->sessiond_pool_size != 2);
+
+    /* General only keys ignore the seat group */
+    fail_if (g_strcmp0 (seat_config->session_path, "/general/bin") != 0,
+             "Wrong value : %s", seat_config->session_path);
+
+    /* seat only keys */
+    fail_if (seat_config->active != FALSE);
+    fail_if (seat_config->vtnr != 7);
+    fail_if (seat_config->priority != -3);
+
+    /* no value, the defaults apply */
+    fail_if (seat_config->terminate_timeout != 3, "Wrong value : %u",
+             seat_config->terminate_timeout);
+    fail_if (seat_config->nwatch != 0);
+    fail_if (g_strcmp0 (seat_config->default_pam_service,
+                        "tlm-default-login") != 0);
+    fail_if (g_strcmp0 (seat_config->data_dirs,
+                        "/usr/share:/usr/local/share") != 0);
+    fail_if (seat_config->session_cmd != NULL);
+    fail_if (seat_config->auth_token_lifetime != 30);
+
+    /* a seat without a group of its own gets General and the defaults */
+    tlm_seat_config_unref (seat_config);
+    seat_config = tlm_seat_config_new (config, "seat1");
+    fail_if (g_strcmp0 (seat_config->default_user, "general-user") != 0);
+    fail_if (seat_config->active != TRUE);
+    fail_if (seat_config->vtnr != 0);
+
+    tlm_seat_config_unref (seat_config);
+    g_object_unref (config);
+    _unset_conf_file (conf_file, saved_conf_file);
+}
+END_TEST
+
+#define SEAT_CONFIG_EQUAL_STRING(a, b)  (g_strcmp0 (a, b) == 0)
+#define SEAT_CONFIG_EQUAL_BOOLEAN(a, b) ((a) == (b))
+#define SEAT_CONFIG_EQUAL_UINT(a, b)    ((a) == (b))
+#define SEAT_CONFIG_EQUAL_INT(a, b)     ((a) == (b))
+
+#define SEAT_CONFIG_CHECK_MEMBER(type, scope, member, key, def) \
+    fail_unless (SEAT_CONFIG_EQUAL_##type (seat_config->member, \
+                                           copy->member), \
+                 "Value of '%s' changed in the round trip", key);
+
+START_TEST(test_seat_config_variant)
+{
+    gchar *saved_conf_file = NULL;
+    gchar *conf_file = _set_conf_file (SEAT_CONF, &saved_conf_file);
+    TlmConfig *config = NULL;
+    TlmSeatConfig *seat_config = NULL;
+    TlmSeatConfig *copy = NULL;
+    GVariant *variant = NULL;
+
+    config = tlm_config_new ();
+    fail_if (config == NULL, "Failed to create config object");
+    seat_config = tlm_seat_config_new (config, "seat0");
+    fail_if (seat_config == NULL);
+
+    variant = g_variant_ref_sink (tlm_seat_config_to_variant (seat_config));
+    fail_if (variant == NULL);
+    copy = tlm_seat_config_new_from_variant (variant);
+    fail_if (copy == NULL, "Failed to deserialize seat config");
+
+    fail_if (g_strcmp0 (seat_config->seat_id, copy->seat_id) != 0);
+    TLM_SEAT_CONFIG_KEYS (SEAT_CONFIG_CHECK_MEMBER)
+
+    /* not a seat config */
+    g_variant_unref (variant);
+    variant = g_variant_ref_sink (g_variant_new_string ("seat0"));
+    fail_if (tlm_seat_config_new_from_variant (variant) != NULL);
+
+    g_variant_unref (variant);
+    tlm_seat_config_unref (copy);
+    tlm_seat_config_unref (seat_config);
+    g_object_unref (config);
+    _unset_conf_file (conf_file, saved_conf_file);
+}
+END_TEST
+
+#ifdef TLM_CONFIG_CACHE_FILE
+
+/* must match TLM_CONFIG_CACHE_TYPE of tlm-config.c */
+#define CACHE_TYPE      "(usttxxta{sa{ss}})"
+#define CACHE_VERSION   1
+#define CACHE_CONF      "[" TLM_GROUP "]\n" STR_KEY "=" STR_VALUE "\n"
+#define CACHE_VALUE     "cached_value"
+
+typedef enum {
+    CACHE_FRESH,
+    CACHE_OTHER_MTIME,
+    CACHE_OTHER_SIZE,
+    CACHE_OTHER_INODE
+} CacheState;
+
+/* an image of the configuration file with STR_KEY set to CACHE_VALUE, so
+ * that a value read from the cache can be told apart from the file's */
+static GVariant *
+_new_cache_image (const gchar *conf_file, CacheState state)
+{
+    GVariantBuilder groups;
+    struct stat st;
+
+    fail_if (g_stat (conf_file, &st) != 0);
+    switch (state) {
+        case CACHE_OTHER_MTIME: st.st_mtim.tv_sec--; break;
+        case CACHE_OTHER_SIZE: st.st_size++; break;
+        case CACHE_OTHER_INODE: st.st_ino++; break;
+        default: break;
+    }
+
+    g_variant_builder_init (&groups, G_VARIANT_TYPE ("a{sa{ss}}"));
+    g_variant_builder_open (&groups, G_VARIANT_TYPE ("{sa{ss}}"));
+    g_variant_builder_add (&groups, "s", TLM_GROUP);
+    g_variant_builder_open (&groups, G_VARIANT_TYPE ("a{ss}"));
+    g_variant_builder_add (&groups, "{ss}", STR_KEY, CACHE_VALUE);
+    g_variant_builder_close (&groups);
+    g_variant_builder_close (&groups);
+
+    return g_variant_ref_sink (g_variant_new (CACHE_TYPE, CACHE_VERSION,
+            conf_file, (guint64) st.st_dev, (guint64) st.st_ino,
+            (gint64) st.st_mtim.tv_sec, (gint64) st.st_mtim.tv_nsec,
+            (guint64) st.st_size, &groups));
+}
+
+static void
+_write_cache (const gchar *cache_file, const gchar *data, gsize len)
+{
+    fail_if (!g_file_set_contents (cache_file, data, len, NULL));
+    fail_if (g_chmod (cache_file, 0644) != 0);
+}
+
+static void
+_write_cache_image (
+        const gchar *cache_file,
+        const gchar *conf_file,
+        CacheState state)
+{
+    GVariant *image = _new_cache_image (conf_file, state);
+
+    _write_cache (cache_file, g_variant_get_data (image),
+                  g_variant_get_size (image));
+    g_variant_unref (image);
+}
+
+static gchar *
+_get_config_value (void)
+{
+    TlmConfig *config = tlm_config_new ();
+    gchar *value = NULL;
+
+    fail_if (config == NULL, "Failed to create config object");
+    value = g_strdup (tlm_config_get_string (config, TLM_GROUP, STR_KEY));
+    g_object_unref (config);
+    return value;
+}
+
+#define FAIL_UNLESS_VALUE(expected) \
+    do { \
+        gchar *value = _get_config_value (); \
+        fail_if (g_strcmp0 (value, expected) != 0, \
+                 "Wrong value '%s' where expected '%s'", value, expected); \
+        g_free (value); \
+    } while (0)
+
+static gchar *
+_set_cache_file (void)
+{
+    gchar *cache_file = NULL;
+    gint fd;
+
+    fd = g_file_open_tmp ("tlm-test-XXXXXX.cache", &cache_file, NULL);
+    fail_if (fd < 0, "Failed to create cache file");
+    close (fd);
+    g_setenv ("TLM_CONFIG_CACHE_FILE", cache_file, TRUE);
+    return cache_file;
+}
+
+static void
+_unset_cache_file (gchar *cache_file)
+{
+    g_unlink (cache_file);
+    g_free (cache_file);
+    g_unsetenv ("TLM_CONFIG_CACHE_FILE");
+}
+
+START_TEST(test_config_cache_stale)
+{
+    gchar *saved_conf_file = NULL;
+    gchar *conf_file = NULL;
+    gchar *cache_file = NULL;
+
+    /* only root reads and writes the cache */
+    if (geteuid () != 0)
+        return;
+
+    conf_file = _set_conf_file (CACHE_CONF, &saved_conf_file);
+    cache_file = _set_cache_file ();
+
+    _write_cache_image (cache_file, conf_file, CACHE_FRESH);
+    FAIL_UNLESS_VALUE (CACHE_VALUE);
+
+    _write_cache_image (cache_file, conf_file, CACHE_OTHER_MTIME);
+    FAIL_UNLESS_VALUE (STR_VALUE);
+
+    _write_cache_image (cache_file, conf_file, CACHE_OTHER_SIZE);
+    FAIL_UNLESS_VALUE (STR_VALUE);
+
+    _write_cache_image (cache_file, conf_file, CACHE_OTHER_INODE);
+    FAIL_UNLESS_VALUE (STR_VALUE);
+
+    /* the cache written after parsing the file goes stale with it */
+    fail_if (!g_file_set_contents (conf_file,
+             "[" TLM_GROUP "]\n" STR_KEY "=other_value\n", -1, NULL));
+    FAIL_UNLESS_VALUE ("other_value");
+
+    _unset_cache_file (cache_file);
+    _unset_conf_file (conf_file, saved_conf_file);
+}
+END_TEST
+
+START_TEST(test_config_cache_unsafe)
+{
+    gchar *saved_conf_file = NULL;
+    gchar *conf_file = NULL;
+    gchar *cache_file = NULL;
+
+    conf_file = _set_conf_file (CACHE_CONF, &saved_conf_file);
+    cache_file = _set_cache_file ();
+
+    /* not owned by root */
+    _write_cache_image (cache_file, conf_file, CACHE_FRESH);
+    if (geteuid () == 0)
+        fail_if (chown (cache_file, 1, 0) != 0);
+    FAIL_UNLESS_VALUE (STR_VALUE);
+
+    if (geteuid () == 0) {
+        /* group writable */
+        _write_cache_image (cache_file, conf_file, CACHE_FRESH);
+        fail_if (g_chmod (cache_file, 0664) != 0);
+        FAIL_UNLESS_VALUE (STR_VALUE);
+
+        /* other writable */
+        _write_cache_image (cache_file, conf_file, CACHE_FRESH);
+        fail_if (g_chmod (cache_file, 0646) != 0);
+        FAIL_UNLESS_VALUE (STR_VALUE);
+    }
+
+    _unset_cache_file (cache_file);
+    _unset_conf_file (conf_file, saved_conf_file);
+}
+END_TEST
+
+START_TEST(test_config_cache_corrupt)
+{
+    gchar *saved_conf_file = NULL;
+    gchar *conf_file = NULL;
+    gchar *cache_file = NULL;
+    GVariant *image = NULL;
+    gchar garbage[64];
+
+    if (geteuid () != 0)
+        return;
+
+    conf_file = _set_conf_file (CACHE_CONF, &saved_conf_file);
+    cache_file = _set_cache_file ();
+    image = _new_cache_image (conf_file, CACHE_FRESH);
+
+    /* truncated */
+    _write_cache (cache_file, g_variant_get_data (image),
+                  g_variant_get_size (image) / 2);
+    FAIL_UNLESS_VALUE (STR_VALUE);
+
+    /* not a serialized image at all */
+    memset (garbage, 0xff, sizeof (garbage));
+    _write_cache (cache_file, garbage, sizeof (garbage));
+    FAIL_UNLESS_VALUE (STR_VALUE);
+
+    /* an image of another type */
+    _write_cache (cache_file, CACHE_CONF, strlen (CACHE_CONF));
+    FAIL_UNLESS_VALUE (STR_VALUE);
+
+    g_variant_unref (image);
+    _unset_cache_file (cache_file);
+    _unset_conf_file (conf_file, saved_conf_file);
+}
+END_TEST
+
+#endif /* TLM_CONFIG_CACHE_FILE */
+
 int main (void)
 {
     int number_failed;
@@ -127,6 +549,14 @@ int main (void)
     TCase *tc = tcase_create ("Config");
 
     tcase_add_test (tc, test_config);
+    tcase_add_test (tc, test_config_reload);
+    tcase_add_test (tc, test_seat_config);
+    tcase_add_test (tc, test_seat_config_variant);
+#ifdef TLM_CONFIG_CACHE_FILE
+    tcase_add_test (tc, test_config_cache_stale);
+    tcase_add_test (tc, test_config_cache_unsafe);
+    tcase_add_test (tc, test_config_cache_corrupt);
+#endif
     suite_add_tcase (s, tc);
 
     sr = srunner_create(s);
@@ -274,6 +274,60 @@ START_TEST (test_login_user)
 }
 END_TEST
 
+START_TEST (test_add_remove_seat)
+{
+    DBG ("\n");
+    GError *error = NULL;
+    GDBusConnection *connection = NULL;
+    TlmDbusLogin *login_object = NULL;
+    GHashTable *config = NULL;
+    GVariant *vconfig = NULL;
+
+    /* only the root login object manages seats */
+    if (getuid () != 0)
+        return;
+
+    connection = _get_root_socket_bus_connection (&error);
+    fail_if (connection == NULL, "failed to get bus connection : %s",
+            error ? error->message : "(null)");
+
+    login_object = _get_login_object (connection, &error);
+    fail_if (login_object == NULL, "failed to get login object: %s",
+            error ? error->message : "");
+
+    config = g_hash_table_new_full ((GHashFunc)g_str_hash,
+            (GEqualFunc)g_str_equal,
+            (GDestroyNotify)g_free,
+            (GDestroyNotify)g_free);
+    g_hash_table_insert (config, g_strdup ("SETUP_TERMINAL"), g_strdup ("0"));
+    vconfig = g_variant_ref_sink (tlm_dbus_utils_hash_table_to_variant (
+            config));
+    g_hash_table_unref (config);
+
+    fail_if (tlm_dbus_login_call_add_seat_sync (login_object,
+            "../seat", vconfig, FALSE, NULL, &error) == TRUE);
+    g_clear_error (&error);
+
+    fail_if (tlm_dbus_login_call_add_seat_sync (login_object,
+            "testseat", vconfig, FALSE, NULL, &error) == FALSE,
+            "failed to add seat: %s", error ? error->message : "");
+    fail_if (tlm_dbus_login_call_add_seat_sync (login_object,
+            "testseat", vconfig, FALSE, NULL, &error) == TRUE);
+    g_clear_error (&error);
+
+    fail_if (tlm_dbus_login_call_remove_seat_sync (login_object,
+            "testseat", FALSE, NULL, &error) == FALSE,
+            "failed to remove seat: %s", error ? error->message : "");
+    fail_if (tlm_dbus_login_call_remove_seat_sync (login_object,
+            "testseat", FALSE, NULL, &error) == TRUE);
+    g_clear_error (&error);
+
+    g_variant_unref (vconfig);
+    g_object_unref (login_object);
+    g_object_unref (connection);
+}
+END_TEST
+
 Suite* daemon_suite (void)
 {
     TCase *tc = NULL;
@@ -286,6 +340,7 @@ Suite* daemon_suite (void)
     tcase_add_checked_fixture (tc, _create_mainloop, _stop_mainloop);
 
     tcase_add_test (tc, test_login_user);
+    tcase_add_test (tc, test_add_remove_seat);
     suite_add_tcase (s, tc);
 
     return s;
@@ -0,0 +1,162 @@
+/* vi: set et sw=4 ts=4 cino=t0,(0: */
+/* -*- Mode: C; indent-tabs-mode: nil; c-basic-offset: 4 -*- */
+/*
+ * This file is part of tlm
+ *
+ * Copyright (C) 2014 Intel Corporation.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA
+ * 02110-1301 USA
+ */
+
+#include <check.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+#include "tlm-utils.h"
+#include "tlm-user-info.h"
+
+#define TRASH_PREFIX    ".tlm-trash."
+#define TRASH_TIMEOUT   10 /* seconds */
+
+static gboolean
+_has_trash (const gchar *dir)
+{
+    GDir *gdir = g_dir_open (dir, 0, NULL);
+    const gchar *name = NULL;
+    gboolean found = FALSE;
+
+    fail_if (gdir == NULL, "Failed to open '%s'", dir);
+    while (!found && (name = g_dir_read_name (gdir)) != NULL)
+        found = g_str_has_prefix (name, TRASH_PREFIX);
+    g_dir_close (gdir);
+    return found;
+}
+
+START_TEST(test_trash_dir)
+{
+    gchar *root = g_dir_make_tmp ("tlm-test-XXXXXX", NULL);
+    gchar *outside = NULL, *outside_file = NULL;
+    gchar *victim = NULL, *victim_dir = NULL, *path = NULL;
+    gint i;
+
+    fail_if (root == NULL, "Failed to create test directory");
+
+    /* a tree with links to a directory and a file outside of it */
+    outside = g_build_filename (root, "outside", NULL);
+    outside_file = g_build_filename (outside, "keep", NULL);
+    fail_if (g_mkdir (outside, 0700) != 0);
+    fail_if (!g_file_set_contents (outside_file, "keep", -1, NULL));
+
+    victim = g_build_filename (root, "victim", NULL);
+    victim_dir = g_build_filename (victim, "dir", NULL);
+    fail_if (g_mkdir_with_parents (victim_dir, 0700) != 0);
+    path = g_build_filename (victim_dir, "file", NULL);
+    fail_if (!g_file_set_contents (path, "delete", -1, NULL));
+    g_free (path);
+    path = g_build_filename (victim, "dir-link", NULL);
+    fail_if (symlink (outside, path) != 0);
+    g_free (path);
+    path = g_build_filename (victim_dir, "file-link", NULL);
+    fail_if (symlink (outside_file, path) != 0);
+    g_free (path);
+
+    fail_if (!tlm_utils_trash_dir (victim), "Failed to trash '%s'", victim);
+    fail_if (g_file_test (victim, G_FILE_TEST_EXISTS),
+             "'%s' still exists", victim);
+
+    /* emptied on another thread */
+    for (i = 0; i < TRASH_TIMEOUT * 10 && _has_trash (root); i++)
+        g_usleep (G_USEC_PER_SEC / 10);
+    fail_if (_has_trash (root), "Trash of '%s' not emptied", victim);
+
+    /* the link targets survive */
+    fail_if (!g_file_test (outside, G_FILE_TEST_IS_DIR));
+    fail_if (!g_file_test (outside_file, G_FILE_TEST_IS_REGULAR),
+             "'%s' was deleted through a symlink", outside_file);
+
+    fail_if (!tlm_utils_delete_dir (root));
+    g_free (victim_dir);
+    g_free (victim);
+    g_free (outside_file);
+    g_free (outside);
+    g_free (root);
+}
+END_TEST
+
+START_TEST(test_user_info_cache)
+{
+    const gchar *name = g_get_user_name ();
+    TlmUserInfo *info = NULL;
+    TlmUserInfo *cached = NULL;
+    TlmUserInfo *fresh = NULL;
+
+    info = tlm_user_info_lookup (name);
+    fail_if (info == NULL, "Failed to look up user '%s'", name);
+    fail_if (g_strcmp0 (info->name, name) != 0);
+    fail_if (info->uid != getuid (), "Wrong uid %u", info->uid);
+
+    /* the second lookup is answered from the cache */
+    cached = tlm_user_info_lookup (name);
+    fail_if (cached != info, "User '%s' was looked up again", name);
+    tlm_user_info_unref (cached);
+
+    /* dropping the user's entry looks it up again */
+    tlm_user_info_invalidate (name);
+    fresh = tlm_user_info_lookup (name);
+    fail_if (fresh == NULL);
+    fail_if (fresh == info, "Invalidated entry of '%s' was used", name);
+    fail_if (fresh->uid != info->uid || fresh->gid != info->gid);
+    fail_if (g_strcmp0 (fresh->home_dir, info->home_dir) != 0);
+    fail_if (g_strcmp0 (fresh->shell, info->shell) != 0);
+    tlm_user_info_unref (info);
+
+    /* and so does dropping all entries */
+    tlm_user_info_invalidate (NULL);
+    info = tlm_user_info_lookup (name);
+    fail_if (info == NULL);
+    fail_if (info == fresh, "Invalidated entry of '%s' was used", name);
+    tlm_user_info_unref (fresh);
+    tlm_user_info_unref (info);
+
+    /* unknown users are not cached */
+    fail_if (tlm_user_info_lookup ("tlm-test-no-such-user") != NULL);
+    fail_if (tlm_user_info_lookup ("tlm-test-no-such-user") != NULL);
+}
+END_TEST
+
+int main (void)
+{
+    int number_failed;
+#if !GLIB_CHECK_VERSION (2, 36, 0)
+    g_type_init ();
+#endif
+    SRunner *sr = NULL;
+    Suite *s = suite_create ("tlm utils tests");
+    TCase *tc = tcase_create ("Utils");
+
+    tcase_set_timeout (tc, TRASH_TIMEOUT + 5);
+    tcase_add_test (tc, test_trash_dir);
+    tcase_add_test (tc, test_user_info_cache);
+    suite_add_tcase (s, tc);
+
+    sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+
+    return (number_failed == 0) ? 0 : -1;
+}